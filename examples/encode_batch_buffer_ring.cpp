@@ -0,0 +1,159 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+//!
+//! \file     encode_batch_buffer_ring.cpp
+//! \brief    Defines a ring of persistently mapped second level batch buffers
+//!
+#include "encode_batch_buffer_ring.h"
+#include "encode_utils.h"
+
+namespace encode
+{
+    EncodeBatchBufferRing::~EncodeBatchBufferRing()
+    {
+        ENCODE_ASSERT(m_slots.empty());
+    }
+
+    MOS_STATUS EncodeBatchBufferRing::AllocateSlot(PMOS_INTERFACE osInterface, Slot &slot, uint32_t size)
+    {
+        ENCODE_FUNC_CALL();
+
+        MOS_ZeroMemory(&slot.batchBuffer, sizeof(MHW_BATCH_BUFFER));
+        ENCODE_CHK_STATUS_RETURN(Mhw_AllocateBb(osInterface, &slot.batchBuffer, nullptr, size));
+        ENCODE_CHK_STATUS_RETURN(Mhw_LockBb(osInterface, &slot.batchBuffer));
+
+        slot.acquired = false;
+        slot.retired  = false;
+        return MOS_STATUS_SUCCESS;
+    }
+
+    MOS_STATUS EncodeBatchBufferRing::FreeSlot(PMOS_INTERFACE osInterface, Slot &slot)
+    {
+        ENCODE_FUNC_CALL();
+
+        if (slot.batchBuffer.bLocked)
+        {
+            ENCODE_CHK_STATUS_RETURN(Mhw_UnlockBb(osInterface, &slot.batchBuffer, false));
+        }
+        ENCODE_CHK_STATUS_RETURN(Mhw_FreeBb(osInterface, &slot.batchBuffer, nullptr));
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    MOS_STATUS EncodeBatchBufferRing::Acquire(
+        PMOS_INTERFACE     osInterface,
+        uint32_t           size,
+        uint32_t           completedFence,
+        PMHW_BATCH_BUFFER &batchBuffer)
+    {
+        ENCODE_FUNC_CALL();
+
+        ENCODE_CHK_NULL_RETURN(osInterface);
+
+        batchBuffer = nullptr;
+        Slot *found  = nullptr;
+        Slot *oldest = nullptr;
+
+        for (auto slot : m_slots)
+        {
+            if (slot->acquired)
+            {
+                continue;
+            }
+            if (!slot->retired || EncodeFenceWait::IsDone(slot->fence, completedFence))
+            {
+                found = slot;
+                break;
+            }
+            if (oldest == nullptr || (int32_t)(slot->fence - oldest->fence) < 0)
+            {
+                oldest = slot;
+            }
+        }
+
+        if (found == nullptr && m_slots.size() < m_maxDepth)
+        {
+            found = MOS_New(Slot);
+            ENCODE_CHK_NULL_RETURN(found);
+            MOS_STATUS eStatus = AllocateSlot(osInterface, *found, size);
+            if (eStatus != MOS_STATUS_SUCCESS)
+            {
+                MOS_Delete(found);
+                return eStatus;
+            }
+            m_slots.push_back(found);
+        }
+
+        if (found == nullptr)
+        {
+            // All the buffers are in flight, same as a fixed ring wrapping onto a busy frame
+            ENCODE_CHK_NULL_RETURN(oldest);
+            ENCODE_NORMALMESSAGE("Batch buffer ring of depth %d is full, reusing a busy buffer", m_maxDepth);
+            found = oldest;
+            m_forcedReuses++;
+        }
+
+        if ((uint32_t)found->batchBuffer.iSize < size)
+        {
+            ENCODE_CHK_STATUS_RETURN(FreeSlot(osInterface, *found));
+            ENCODE_CHK_STATUS_RETURN(AllocateSlot(osInterface, *found, size));
+        }
+
+        found->batchBuffer.iCurrent   = 0;
+        found->batchBuffer.iRemaining = found->batchBuffer.iSize;
+        found->batchBuffer.dwOffset   = 0;
+        found->acquired               = true;
+
+        batchBuffer = &found->batchBuffer;
+        return MOS_STATUS_SUCCESS;
+    }
+
+    void EncodeBatchBufferRing::Retire(PMHW_BATCH_BUFFER batchBuffer, uint32_t fence)
+    {
+        for (auto slot : m_slots)
+        {
+            if (&slot->batchBuffer == batchBuffer)
+            {
+                slot->fence    = fence;
+                slot->acquired = false;
+                slot->retired  = true;
+                return;
+            }
+        }
+    }
+
+    MOS_STATUS EncodeBatchBufferRing::Destroy(PMOS_INTERFACE osInterface)
+    {
+        ENCODE_FUNC_CALL();
+
+        MOS_STATUS eStatus = MOS_STATUS_SUCCESS;
+        for (auto slot : m_slots)
+        {
+            MOS_STATUS status = FreeSlot(osInterface, *slot);
+            eStatus = (eStatus == MOS_STATUS_SUCCESS) ? status : eStatus;
+            MOS_Delete(slot);
+        }
+        m_slots.clear();
+
+        return eStatus;
+    }
+}
@@ -0,0 +1,121 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+//!
+//! \file     encode_batch_buffer_ring.h
+//! \brief    Defines a ring of persistently mapped second level batch buffers
+//!
+
+#ifndef __ENCODE_BATCH_BUFFER_RING_H__
+#define __ENCODE_BATCH_BUFFER_RING_H__
+
+#include <vector>
+#include "mos_os.h"
+#include "mhw_utilities.h"
+#include "encode_fence_wait.h"
+
+namespace encode
+{
+    class HevcVdencPktG12Bench;
+
+    //!
+    //! \class  EncodeBatchBufferRing
+    //! \brief  Hands out mapped batch buffers which the GPU no longer reads
+    //! \details Each buffer is locked once when it is allocated and stays mapped until
+    //!          Destroy(). A buffer given to Retire() is only handed out again once the
+    //!          completed fence reaches its fence. When every buffer is busy the ring
+    //!          grows, up to the maximum depth, after which the oldest buffer is reused.
+    //!
+    class EncodeBatchBufferRing
+    {
+        friend class HevcVdencPktG12Bench;
+
+    public:
+        EncodeBatchBufferRing(uint32_t maxDepth = m_defaultMaxDepth) : m_maxDepth(maxDepth) { }
+
+        virtual ~EncodeBatchBufferRing();
+
+        //!
+        //! \brief  Get a mapped batch buffer which is not in use
+        //! \param  [in] osInterface
+        //!         OS interface used to allocate the buffer
+        //! \param  [in] size
+        //!         Minimum size in bytes
+        //! \param  [in] completedFence
+        //!         Fence of the last completed submission
+        //! \param  [out] batchBuffer
+        //!         Mapped batch buffer, empty
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS Acquire(
+            PMOS_INTERFACE     osInterface,
+            uint32_t           size,
+            uint32_t           completedFence,
+            PMHW_BATCH_BUFFER &batchBuffer);
+
+        //!
+        //! \brief  Give back a buffer which is read by a submission
+        //! \param  [in] batchBuffer
+        //!         Buffer from Acquire()
+        //! \param  [in] fence
+        //!         Fence of the submission, the buffer is reused once the completed fence reaches it
+        //! \return void
+        //!
+        void Retire(PMHW_BATCH_BUFFER batchBuffer, uint32_t fence);
+
+        //!
+        //! \brief  Unmap and free all the buffers
+        //! \param  [in] osInterface
+        //!         OS interface the buffers were allocated with
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS Destroy(PMOS_INTERFACE osInterface);
+
+        uint32_t GetDepth() const { return (uint32_t)m_slots.size(); }
+        uint32_t GetForcedReuses() const { return m_forcedReuses; }
+
+        static constexpr uint32_t m_defaultMaxDepth = 16;  //!< Enough for the frames in flight of a deep pipeline
+
+    protected:
+        //!
+        //! \brief  One buffer of the ring
+        //!
+        struct Slot
+        {
+            MHW_BATCH_BUFFER batchBuffer;
+            uint32_t         fence    = 0;      //!< Fence of the last submission reading the buffer
+            bool             acquired = false;  //!< Handed out and not retired yet
+            bool             retired  = false;  //!< Read by a submission at least once
+        };
+
+        MOS_STATUS AllocateSlot(PMOS_INTERFACE osInterface, Slot &slot, uint32_t size);
+
+        MOS_STATUS FreeSlot(PMOS_INTERFACE osInterface, Slot &slot);
+
+        std::vector<Slot *> m_slots;              //!< Buffers of the ring
+        uint32_t            m_maxDepth;           //!< Maximum number of buffers
+        uint32_t            m_forcedReuses = 0;   //!< Buffers reused before their submission completed
+    };
+}
+
+#endif // __ENCODE_BATCH_BUFFER_RING_H__
@@ -0,0 +1,188 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+//!
+//! \file     encode_cmd_peephole.cpp
+//! \brief    Implements the peephole pass which drops redundant flush commands
+//!
+#include "encode_cmd_peephole.h"
+#include "encode_cmd_walker.h"
+#include "encode_utils.h"
+#include "mhw_mi_hwcmd_g12_X.h"
+#include "mhw_vdbox_vdenc_hwcmd_g12_X.h"
+
+namespace encode
+{
+    const EncodeCmdPeephole::Rule EncodeCmdPeephole::m_rules[] =
+    {
+        {2, {cmdFlushDw, cmdFlushDw}, 1},
+        {3, {cmdFlushDw, cmdVdPipelineFlush, cmdFlushDw}, 0},
+        {2, {cmdVdPipelineFlush, cmdVdPipelineFlush}, 1},
+    };
+    const uint32_t EncodeCmdPeephole::m_numRules = sizeof(m_rules) / sizeof(m_rules[0]);
+
+    EncodeCmdPeephole::EncodeCmdPeephole()
+    {
+        mhw_mi_g12_X::MI_FLUSH_DW_CMD                flushDw;
+        mhw_vdbox_vdenc_g12_X::VD_PIPELINE_FLUSH_CMD vdPipelineFlush;
+        m_flushDwHeader         = flushDw.DW0.Value;
+        m_vdPipelineFlushHeader = vdPipelineFlush.DW0.Value;
+    }
+
+    bool EncodeCmdPeephole::DecodeCmd(const uint32_t *cmd, uint32_t dwLeft, CmdInfo &info) const
+    {
+        uint32_t header = cmd[0];
+
+        info.kind    = cmdOther;
+        info.removed = false;
+
+        if (!EncodeCmdWalker::GetCmdSize(cmd, dwLeft, info.dwSize))
+        {
+            return false;
+        }
+
+        if (EncodeCmdWalker::IsMiNoop(header))
+        {
+            info.kind = cmdNoop;
+        }
+        else if (EncodeCmdWalker::IsMiCmd(header, m_flushDwHeader))
+        {
+            // Post sync writes an address, such a flush is never touched
+            auto flushDw = (const mhw_mi_g12_X::MI_FLUSH_DW_CMD *)cmd;
+            info.kind    = flushDw->DW0.PostSyncOperation ? cmdOther : cmdFlushDw;
+        }
+        else if ((header >> 29) == 3 && EncodeCmdWalker::IsVideoCmd(header, m_vdPipelineFlushHeader))
+        {
+            info.kind = cmdVdPipelineFlush;
+        }
+
+        return true;
+    }
+
+    bool EncodeCmdPeephole::IsSameCmd(const uint32_t *base, const CmdInfo &a, const CmdInfo &b) const
+    {
+        return a.kind == b.kind &&
+               a.dwSize == b.dwSize &&
+               memcmp(base + a.dwOffset, base + b.dwOffset, a.dwSize * sizeof(uint32_t)) == 0;
+    }
+
+    MOS_STATUS EncodeCmdPeephole::Run(MOS_COMMAND_BUFFER &cmdBuffer, int32_t startOffset)
+    {
+        ENCODE_FUNC_CALL();
+
+        ENCODE_CHK_NULL_RETURN(cmdBuffer.pCmdBase);
+        ENCODE_CHK_COND_RETURN(startOffset < 0 || startOffset > cmdBuffer.iOffset || (startOffset & 3),
+            "Invalid start offset of the peephole pass");
+
+        uint32_t *base    = cmdBuffer.pCmdBase;
+        uint32_t  dwStart = (uint32_t)startOffset / sizeof(uint32_t);
+        uint32_t  dwEnd   = (uint32_t)cmdBuffer.iOffset / sizeof(uint32_t);
+
+        // Decode the range, leave the buffer untouched if any header is unknown
+        m_cmds.clear();
+        m_window.clear();
+        for (uint32_t dw = dwStart; dw < dwEnd;)
+        {
+            CmdInfo info = {};
+            info.dwOffset = dw;
+            if (!DecodeCmd(base + dw, dwEnd - dw, info))
+            {
+                m_stats.abortedRuns++;
+                return MOS_STATUS_SUCCESS;
+            }
+            m_cmds.push_back(info);
+            if (info.kind != cmdNoop)
+            {
+                m_window.push_back((uint32_t)m_cmds.size() - 1);
+            }
+            dw += info.dwSize;
+        }
+        m_stats.scannedCmds += (uint32_t)m_cmds.size();
+
+        // Match the rules on the commands with MI_NOOP skipped
+        for (uint32_t i = 0; i < m_window.size();)
+        {
+            bool matched = false;
+            for (uint32_t r = 0; r < m_numRules && !matched; r++)
+            {
+                const Rule &rule = m_rules[r];
+                if (i + rule.length > m_window.size())
+                {
+                    continue;
+                }
+
+                matched = true;
+                for (uint32_t k = 0; k < rule.length && matched; k++)
+                {
+                    const CmdInfo &cmd = m_cmds[m_window[i + k]];
+                    matched = (cmd.kind == rule.pattern[k]);
+                    for (uint32_t j = 0; j < k && matched; j++)
+                    {
+                        const CmdInfo &prev = m_cmds[m_window[i + j]];
+                        if (prev.kind == cmd.kind)
+                        {
+                            matched = IsSameCmd(base, prev, cmd);
+                        }
+                    }
+                }
+
+                if (matched)
+                {
+                    CmdInfo &dropped = m_cmds[m_window[i + rule.drop]];
+                    MOS_ZeroMemory(base + dropped.dwOffset, dropped.dwSize * sizeof(uint32_t));
+                    dropped.kind    = cmdNoop;
+                    dropped.removed = true;
+                    m_stats.removedCmds++;
+                    m_stats.removedBytes += dropped.dwSize * sizeof(uint32_t);
+                    m_window.erase(m_window.begin() + i + rule.drop);
+                }
+            }
+
+            if (!matched)
+            {
+                i++;
+            }
+            else if (i > 0)
+            {
+                // The command before the match may start a new sequence now
+                i--;
+            }
+        }
+
+        // Give back the dropped commands which end the buffer
+        uint32_t trimmedDw = 0;
+        while (!m_cmds.empty() && m_cmds.back().removed)
+        {
+            trimmedDw += m_cmds.back().dwSize;
+            m_cmds.pop_back();
+        }
+        if (trimmedDw > 0)
+        {
+            uint32_t trimmedBytes = trimmedDw * sizeof(uint32_t);
+            cmdBuffer.pCmdPtr    -= trimmedDw;
+            cmdBuffer.iOffset    -= trimmedBytes;
+            cmdBuffer.iRemaining += trimmedBytes;
+            m_stats.trimmedBytes += trimmedBytes;
+        }
+
+        return MOS_STATUS_SUCCESS;
+    }
+}
@@ -0,0 +1,136 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+//!
+//! \file     encode_cmd_peephole.h
+//! \brief    Defines the peephole pass which drops redundant flush commands
+//!
+
+#ifndef __ENCODE_CMD_PEEPHOLE_H__
+#define __ENCODE_CMD_PEEPHOLE_H__
+
+#include <vector>
+#include "mos_os.h"
+
+namespace encode
+{
+    //!
+    //! \struct EncodeCmdPeepholeStats
+    //! \brief  Statistics of the peephole pass
+    //!
+    struct EncodeCmdPeepholeStats
+    {
+        uint32_t scannedCmds  = 0;  //!< Commands decoded
+        uint32_t removedCmds  = 0;  //!< Commands replaced by MI_NOOP or trimmed
+        uint32_t removedBytes = 0;  //!< Bytes of the removed commands
+        uint32_t trimmedBytes = 0;  //!< Bytes given back at the tail of the command buffer
+        uint32_t abortedRuns  = 0;  //!< Runs stopped on an unknown command header
+    };
+
+    //!
+    //! \class  EncodeCmdPeephole
+    //! \brief  Drops redundant MI_FLUSH_DW and VD_PIPELINE_FLUSH commands from a built command buffer
+    //! \details Rules, applied on adjacent commands with MI_NOOP skipped:
+    //!          1. MI_FLUSH_DW, MI_FLUSH_DW: the second one is dropped, nothing is
+    //!             left to flush after the first one.
+    //!          2. MI_FLUSH_DW, VD_PIPELINE_FLUSH, MI_FLUSH_DW: the first one is
+    //!             dropped, the last flush covers every write before it.
+    //!          3. VD_PIPELINE_FLUSH, VD_PIPELINE_FLUSH: the second one is dropped,
+    //!             the pipes are already idle.
+    //!          Commands of the same type in one sequence must be identical, and an
+    //!          MI_FLUSH_DW only matches without post sync operation, so no command
+    //!          with a graphics address is ever touched.
+    //!          Dropped commands are overwritten by MI_NOOP, which keeps the offsets of
+    //!          the patch list valid. They are only trimmed when they end the buffer.
+    //!
+    class EncodeCmdPeephole
+    {
+    public:
+        EncodeCmdPeephole();
+
+        virtual ~EncodeCmdPeephole() {}
+
+        //!
+        //! \brief  Run the rules on the commands added since startOffset
+        //! \param  [in] cmdBuffer
+        //!         Command buffer, startOffset must be at a command boundary
+        //! \param  [in] startOffset
+        //!         Offset in bytes of the first command to look at
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS Run(MOS_COMMAND_BUFFER &cmdBuffer, int32_t startOffset);
+
+        const EncodeCmdPeepholeStats &GetStats() const { return m_stats; }
+
+        void ResetStats() { m_stats = {}; }
+
+    protected:
+        enum CmdKind
+        {
+            cmdOther = 0,
+            cmdNoop,
+            cmdFlushDw,
+            cmdVdPipelineFlush,
+        };
+
+        //!
+        //! \brief  One decoded command
+        //!
+        struct CmdInfo
+        {
+            uint32_t dwOffset;  //!< Offset in dwords from the command buffer base
+            uint32_t dwSize;    //!< Size in dwords
+            CmdKind  kind;      //!< Command type
+            bool     removed;   //!< Replaced by MI_NOOP in this run
+        };
+
+        //!
+        //! \brief  One rule of the table
+        //!
+        struct Rule
+        {
+            uint32_t length;      //!< Number of commands in the sequence
+            CmdKind  pattern[3];  //!< Command types of the sequence
+            uint32_t drop;        //!< Index of the command to drop
+        };
+
+        static const Rule m_rules[];
+        static const uint32_t m_numRules;
+
+        //!
+        //! \brief  Decode the size and the type of the command at cmd
+        //! \return bool
+        //!         false if the header is unknown or the command runs past the end
+        //!
+        bool DecodeCmd(const uint32_t *cmd, uint32_t dwLeft, CmdInfo &info) const;
+
+        bool IsSameCmd(const uint32_t *base, const CmdInfo &a, const CmdInfo &b) const;
+
+        uint32_t               m_flushDwHeader = 0;          //!< Default MI_FLUSH_DW header
+        uint32_t               m_vdPipelineFlushHeader = 0;  //!< Default VD_PIPELINE_FLUSH header
+        std::vector<CmdInfo>   m_cmds;                       //!< Decoded commands, reused across runs
+        std::vector<uint32_t>  m_window;                     //!< Indices of the non MI_NOOP commands
+        EncodeCmdPeepholeStats m_stats;                      //!< Accumulated statistics
+    };
+}
+
+#endif // __ENCODE_CMD_PEEPHOLE_H__
@@ -0,0 +1,72 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+//!
+//! \file     encode_cmd_template.cpp
+//! \brief    Implements the recorded block of address free commands
+//!
+#include "encode_cmd_template.h"
+#include "encode_utils.h"
+
+namespace encode
+{
+    bool EncodeCmdTemplate::IsValid(const void *key, uint32_t keySize) const
+    {
+        return m_valid &&
+               m_key.size() == keySize &&
+               memcmp(m_key.data(), key, keySize) == 0;
+    }
+
+    MOS_STATUS EncodeCmdTemplate::Replay(MOS_COMMAND_BUFFER &cmdBuffer)
+    {
+        ENCODE_FUNC_CALL();
+
+        ENCODE_CHK_COND_RETURN(!m_valid, "Replaying an invalid command template");
+
+        ENCODE_CHK_STATUS_RETURN(Mos_AddCommand(&cmdBuffer, m_cmds.data(), (uint32_t)m_cmds.size()));
+        m_hitCount++;
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    void EncodeCmdTemplate::BeginRecord(const MOS_COMMAND_BUFFER &cmdBuffer)
+    {
+        m_valid       = false;
+        m_startOffset = cmdBuffer.iOffset;
+    }
+
+    MOS_STATUS EncodeCmdTemplate::EndRecord(const MOS_COMMAND_BUFFER &cmdBuffer, const void *key, uint32_t keySize)
+    {
+        ENCODE_FUNC_CALL();
+
+        ENCODE_CHK_NULL_RETURN(cmdBuffer.pCmdBase);
+        ENCODE_CHK_NULL_RETURN(key);
+        ENCODE_CHK_COND_RETURN(cmdBuffer.iOffset < m_startOffset, "Command buffer is rewound while recording");
+
+        const uint8_t *start = (const uint8_t *)cmdBuffer.pCmdBase + m_startOffset;
+        m_cmds.assign(start, start + (cmdBuffer.iOffset - m_startOffset));
+        m_key.assign((const uint8_t *)key, (const uint8_t *)key + keySize);
+        m_valid = true;
+        m_missCount++;
+
+        return MOS_STATUS_SUCCESS;
+    }
+}
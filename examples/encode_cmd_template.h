@@ -0,0 +1,104 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+//!
+//! \file     encode_cmd_template.h
+//! \brief    Defines a recorded block of address free commands which can be replayed
+//!
+
+#ifndef __ENCODE_CMD_TEMPLATE_H__
+#define __ENCODE_CMD_TEMPLATE_H__
+
+#include <vector>
+#include "mos_os.h"
+
+namespace encode
+{
+    //!
+    //! \class  EncodeCmdTemplate
+    //! \brief  Keeps the bytes of a command block together with the inputs it was built from
+    //! \details Only commands without graphics addresses may be recorded, since a replayed
+    //!          block does not register any patch list entry.
+    //!
+    class EncodeCmdTemplate
+    {
+    public:
+        //!
+        //! \brief  Check if the recorded block was built from the given key
+        //! \param  [in] key
+        //!         Inputs of the block
+        //! \param  [in] keySize
+        //!         Size of the key in bytes
+        //! \return bool
+        //!         true if the block can be replayed
+        //!
+        bool IsValid(const void *key, uint32_t keySize) const;
+
+        //!
+        //! \brief  Copy the recorded block into the command buffer
+        //! \param  [in] cmdBuffer
+        //!         Command buffer
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS Replay(MOS_COMMAND_BUFFER &cmdBuffer);
+
+        //!
+        //! \brief  Mark the start of the block in the command buffer
+        //! \param  [in] cmdBuffer
+        //!         Command buffer
+        //! \return void
+        //!
+        void BeginRecord(const MOS_COMMAND_BUFFER &cmdBuffer);
+
+        //!
+        //! \brief  Save the commands added since BeginRecord() together with the key
+        //! \param  [in] cmdBuffer
+        //!         Command buffer
+        //! \param  [in] key
+        //!         Inputs of the block
+        //! \param  [in] keySize
+        //!         Size of the key in bytes
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS EndRecord(const MOS_COMMAND_BUFFER &cmdBuffer, const void *key, uint32_t keySize);
+
+        //!
+        //! \brief  Drop the recorded block
+        //! \return void
+        //!
+        void Invalidate() { m_valid = false; }
+
+        uint32_t GetHitCount() const { return m_hitCount; }
+        uint32_t GetMissCount() const { return m_missCount; }
+
+    protected:
+        std::vector<uint8_t> m_key;              //!< Inputs of the recorded block
+        std::vector<uint8_t> m_cmds;             //!< Recorded commands
+        int32_t              m_startOffset = 0;  //!< Offset of the block being recorded
+        bool                 m_valid = false;    //!< Recorded block is usable
+        uint32_t             m_hitCount = 0;     //!< Number of replays
+        uint32_t             m_missCount = 0;    //!< Number of recordings
+    };
+}
+
+#endif // __ENCODE_CMD_TEMPLATE_H__
@@ -0,0 +1,126 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+//!
+//! \file     encode_cmd_walker.h
+//! \brief    Defines the helpers to walk the commands of a built command buffer
+//!
+
+#ifndef __ENCODE_CMD_WALKER_H__
+#define __ENCODE_CMD_WALKER_H__
+
+#include "mos_defs.h"
+
+namespace encode
+{
+    //!
+    //! \class  EncodeCmdWalker
+    //! \brief  Decodes the size of the MI and video commands found in VDBOX command buffers
+    //!
+    class EncodeCmdWalker
+    {
+    public:
+        static constexpr uint32_t m_miOpcodeMask    = 0xff800000;  //!< Type and opcode of MI commands
+        static constexpr uint32_t m_videoOpcodeMask = 0xffff0000;  //!< Type, pipeline and opcodes of video commands
+
+        //!
+        //! \brief  Get the size of the command at cmd
+        //! \param  [in] cmd
+        //!         First dword of the command
+        //! \param  [in] dwLeft
+        //!         Dwords left in the buffer from cmd on
+        //! \param  [out] dwSize
+        //!         Size of the command in dwords
+        //! \return bool
+        //!         false if the header is unknown or the command runs past the end
+        //!
+        static bool GetCmdSize(const uint32_t *cmd, uint32_t dwLeft, uint32_t &dwSize)
+        {
+            uint32_t header = cmd[0];
+            uint32_t type   = header >> 29;
+
+            if (type == 0)
+            {
+                // MI commands below opcode 0x10 are single dword
+                uint32_t opcode = (header >> 23) & 0x3f;
+                dwSize          = (opcode < 0x10) ? 1 : (header & 0xff) + 2;
+            }
+            else if (type == 3)
+            {
+                uint32_t pipeline = (header >> 27) & 0x3;
+                if (pipeline == 1)
+                {
+                    // MFX_WAIT
+                    dwSize = 1;
+                }
+                else if (pipeline == 2)
+                {
+                    // Video commands carry a 12 bit length
+                    dwSize = (header & 0xfff) + 2;
+                }
+                else
+                {
+                    dwSize = (header & 0xff) + 2;
+                }
+            }
+            else
+            {
+                return false;
+            }
+
+            return dwSize <= dwLeft;
+        }
+
+        //!
+        //! \brief  Check if the header is an MI_NOOP
+        //!
+        static bool IsMiNoop(uint32_t header)
+        {
+            return (header & m_miOpcodeMask) == 0;
+        }
+
+        //!
+        //! \brief  Check if the header is an MI command with the opcode of miHeader
+        //!
+        static bool IsMiCmd(uint32_t header, uint32_t miHeader)
+        {
+            return (header & m_miOpcodeMask) == (miHeader & m_miOpcodeMask);
+        }
+
+        //!
+        //! \brief  Check if the header is a video command with the opcodes of videoHeader
+        //!
+        static bool IsVideoCmd(uint32_t header, uint32_t videoHeader)
+        {
+            return (header & m_videoOpcodeMask) == (videoHeader & m_videoOpcodeMask);
+        }
+
+        //!
+        //! \brief  Check if two headers have the same type and opcodes
+        //!
+        static bool IsSameCmd(uint32_t header, uint32_t otherHeader)
+        {
+            return (header >> 29) == 0 ? IsMiCmd(header, otherHeader) : IsVideoCmd(header, otherHeader);
+        }
+    };
+}
+
+#endif // __ENCODE_CMD_WALKER_H__
@@ -0,0 +1,82 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+//!
+//! \file     encode_content_hash.h
+//! \brief    Defines the hash used to tell whether the inputs of a built batch changed
+//!
+
+#ifndef __ENCODE_CONTENT_HASH_H__
+#define __ENCODE_CONTENT_HASH_H__
+
+#include "mos_defs.h"
+
+namespace encode
+{
+    //!
+    //! \class  EncodeContentHash
+    //! \brief  64 bit FNV-1a hash of the bytes added to it
+    //! \details Structures are hashed as they are in memory, so they have to be zeroed
+    //!          before they are filled, like the MHW params are.
+    //!
+    class EncodeContentHash
+    {
+    public:
+        static constexpr uint64_t m_offsetBasis = 0xcbf29ce484222325ull;  //!< FNV-1a 64 bit offset basis
+        static constexpr uint64_t m_prime       = 0x100000001b3ull;       //!< FNV-1a 64 bit prime
+
+        //!
+        //! \brief  Add bytes to the hash
+        //! \param  [in] data
+        //!         Bytes to add, may be nullptr if size is 0
+        //! \param  [in] size
+        //!         Number of bytes
+        //! \return void
+        //!
+        void Add(const void *data, size_t size)
+        {
+            const uint8_t *bytes = (const uint8_t *)data;
+            for (size_t i = 0; i < size; i++)
+            {
+                m_hash = (m_hash ^ bytes[i]) * m_prime;
+            }
+        }
+
+        //!
+        //! \brief  Add the memory of a value to the hash
+        //! \param  [in] value
+        //!         Value to add
+        //! \return void
+        //!
+        template <typename T>
+        void Add(const T &value)
+        {
+            Add(&value, sizeof(T));
+        }
+
+        uint64_t Get() const { return m_hash; }
+
+    protected:
+        uint64_t m_hash = m_offsetBasis;  //!< Hash of the bytes added so far
+    };
+}
+
+#endif // __ENCODE_CONTENT_HASH_H__
@@ -0,0 +1,217 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+//!
+//! \file     encode_deferred_patch_list.cpp
+//! \brief    Implements the per thread patch list calls of command buffers built on worker threads
+//!
+#include "encode_deferred_patch_list.h"
+#include "encode_utils.h"
+#include <algorithm>
+
+namespace encode
+{
+    std::mutex                                     EncodeDeferredPatchList::m_hookMutex;
+    std::vector<EncodeDeferredPatchList::HookedOs> EncodeDeferredPatchList::m_hooks;
+    thread_local EncodeDeferredPatchList          *EncodeDeferredPatchList::m_boundList = nullptr;
+
+    bool EncodeDeferredPatchList::Hook(PMOS_INTERFACE osInterface)
+    {
+        if (osInterface == nullptr || !osInterface->bUsesPatchList ||
+            osInterface->pfnRegisterResource == nullptr ||
+            osInterface->pfnGetResourceAllocationIndex == nullptr ||
+            osInterface->pfnSetPatchEntry == nullptr)
+        {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(m_hookMutex);
+        for (auto &hook : m_hooks)
+        {
+            if (hook.osInterface == osInterface)
+            {
+                return false;
+            }
+        }
+
+        m_hooks.push_back({osInterface,
+            osInterface->pfnRegisterResource,
+            osInterface->pfnGetResourceAllocationIndex,
+            osInterface->pfnSetPatchEntry});
+        osInterface->pfnRegisterResource           = RegisterResource;
+        osInterface->pfnGetResourceAllocationIndex = GetResourceAllocationIndex;
+        osInterface->pfnSetPatchEntry              = SetPatchEntry;
+
+        return true;
+    }
+
+    void EncodeDeferredPatchList::Unhook(PMOS_INTERFACE osInterface)
+    {
+        std::lock_guard<std::mutex> lock(m_hookMutex);
+        for (auto hook = m_hooks.begin(); hook != m_hooks.end(); hook++)
+        {
+            if (hook->osInterface == osInterface)
+            {
+                osInterface->pfnRegisterResource           = hook->registerResource;
+                osInterface->pfnGetResourceAllocationIndex = hook->getAllocationIndex;
+                osInterface->pfnSetPatchEntry              = hook->setPatchEntry;
+                m_hooks.erase(hook);
+                return;
+            }
+        }
+    }
+
+    void EncodeDeferredPatchList::Bind(PMOS_INTERFACE osInterface)
+    {
+        m_osInterface = osInterface;
+        m_calls.clear();
+        m_resources.clear();
+        m_boundList = this;
+    }
+
+    void EncodeDeferredPatchList::Unbind()
+    {
+        if (m_boundList == this)
+        {
+            m_boundList = nullptr;
+        }
+    }
+
+    MOS_STATUS EncodeDeferredPatchList::Commit()
+    {
+        ENCODE_FUNC_CALL();
+
+        if (m_calls.empty())
+        {
+            return MOS_STATUS_SUCCESS;
+        }
+        ENCODE_CHK_NULL_RETURN(m_osInterface);
+        ENCODE_CHK_COND_RETURN(m_boundList != nullptr, "Deferred patch list committed from a bound thread");
+
+        for (auto &call : m_calls)
+        {
+            if (!call.patchEntry)
+            {
+                ENCODE_CHK_STATUS_RETURN(m_osInterface->pfnRegisterResource(
+                    m_osInterface, call.resource, call.write, call.writeRender));
+                continue;
+            }
+
+            int32_t allocationIndex = m_osInterface->pfnGetResourceAllocationIndex(m_osInterface, call.params.presResource);
+            ENCODE_CHK_COND_RETURN(allocationIndex < 0, "Patch entry resource is not registered");
+            call.params.uiAllocationIndex = (uint32_t)allocationIndex;
+            ENCODE_CHK_STATUS_RETURN(m_osInterface->pfnSetPatchEntry(m_osInterface, &call.params));
+        }
+
+        m_calls.clear();
+        m_resources.clear();
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    EncodeDeferredPatchList *EncodeDeferredPatchList::GetBoundList(PMOS_INTERFACE osInterface)
+    {
+        // Only the bound thread touches its list, no lock is needed
+        return (m_boundList != nullptr && m_boundList->m_osInterface == osInterface) ? m_boundList : nullptr;
+    }
+
+    bool EncodeDeferredPatchList::GetHookedOs(PMOS_INTERFACE osInterface, HookedOs &hookedOs)
+    {
+        std::lock_guard<std::mutex> lock(m_hookMutex);
+        for (auto &hook : m_hooks)
+        {
+            if (hook.osInterface == osInterface)
+            {
+                hookedOs = hook;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    MOS_STATUS EncodeDeferredPatchList::RegisterResource(
+        PMOS_INTERFACE osInterface,
+        PMOS_RESOURCE  resource,
+        int32_t        write,
+        int32_t        writeRender)
+    {
+        EncodeDeferredPatchList *list = GetBoundList(osInterface);
+        if (list == nullptr)
+        {
+            HookedOs hookedOs = {};
+            ENCODE_CHK_COND_RETURN(!GetHookedOs(osInterface, hookedOs), "OS interface is not hooked");
+            return hookedOs.registerResource(osInterface, resource, write, writeRender);
+        }
+
+        ENCODE_CHK_NULL_RETURN(resource);
+        Call call = {};
+        call.patchEntry  = false;
+        call.resource    = resource;
+        call.write       = write;
+        call.writeRender = writeRender;
+        list->m_calls.push_back(call);
+
+        if (std::find(list->m_resources.begin(), list->m_resources.end(), resource) == list->m_resources.end())
+        {
+            list->m_resources.push_back(resource);
+        }
+        return MOS_STATUS_SUCCESS;
+    }
+
+    int32_t EncodeDeferredPatchList::GetResourceAllocationIndex(PMOS_INTERFACE osInterface, PMOS_RESOURCE resource)
+    {
+        EncodeDeferredPatchList *list = GetBoundList(osInterface);
+        if (list == nullptr)
+        {
+            HookedOs hookedOs = {};
+            if (!GetHookedOs(osInterface, hookedOs))
+            {
+                return -1;
+            }
+            return hookedOs.getAllocationIndex(osInterface, resource);
+        }
+
+        // Replaced by the index of the OS interface in Commit()
+        auto found = std::find(list->m_resources.begin(), list->m_resources.end(), resource);
+        return found == list->m_resources.end() ? -1 : (int32_t)(found - list->m_resources.begin());
+    }
+
+    MOS_STATUS EncodeDeferredPatchList::SetPatchEntry(PMOS_INTERFACE osInterface, PMOS_PATCH_ENTRY_PARAMS params)
+    {
+        ENCODE_CHK_NULL_RETURN(params);
+
+        EncodeDeferredPatchList *list = GetBoundList(osInterface);
+        if (list == nullptr)
+        {
+            HookedOs hookedOs = {};
+            ENCODE_CHK_COND_RETURN(!GetHookedOs(osInterface, hookedOs), "OS interface is not hooked");
+            return hookedOs.setPatchEntry(osInterface, params);
+        }
+
+        // The command buffer params points to outlives the build
+        Call call = {};
+        call.patchEntry = true;
+        call.params     = *params;
+        list->m_calls.push_back(call);
+
+        return MOS_STATUS_SUCCESS;
+    }
+}
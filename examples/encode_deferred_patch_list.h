@@ -0,0 +1,143 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+//!
+//! \file     encode_deferred_patch_list.h
+//! \brief    Defines the per thread patch list calls of command buffers built on worker threads
+//!
+
+#ifndef __ENCODE_DEFERRED_PATCH_LIST_H__
+#define __ENCODE_DEFERRED_PATCH_LIST_H__
+
+#include <mutex>
+#include <vector>
+#include "mos_os.h"
+
+namespace encode
+{
+    //!
+    //! \class  EncodeDeferredPatchList
+    //! \brief  Keeps the patch list calls of one command buffer built on a worker thread
+    //! \details The resource list and the patch list of the OS interface are not thread
+    //!          safe. While the OS interface is hooked, the calls of a thread bound to a
+    //!          list are kept in the list instead, the allocation indices it hands out
+    //!          only count within the list. Commit() adds the calls to the OS interface
+    //!          on the submitting thread, with the allocation indices of the OS interface.
+    //!          Calls of threads which are not bound go to the OS interface directly.
+    //!
+    class EncodeDeferredPatchList
+    {
+    public:
+        //!
+        //! \brief  Replace the patch list functions of the OS interface
+        //! \param  [in] osInterface
+        //!         OS interface
+        //! \return bool
+        //!         false if the OS interface has no patch list or is already hooked
+        //!
+        static bool Hook(PMOS_INTERFACE osInterface);
+
+        //!
+        //! \brief  Restore the patch list functions of the OS interface
+        //! \param  [in] osInterface
+        //!         OS interface given to Hook()
+        //! \return void
+        //!
+        static void Unhook(PMOS_INTERFACE osInterface);
+
+        //!
+        //! \brief  Keep the calls the current thread makes into the OS interface
+        //! \details Drops the calls left from a failed build.
+        //! \param  [in] osInterface
+        //!         Hooked OS interface
+        //! \return void
+        //!
+        void Bind(PMOS_INTERFACE osInterface);
+
+        //!
+        //! \brief  Let the calls of the current thread go to the OS interface again
+        //! \return void
+        //!
+        void Unbind();
+
+        //!
+        //! \brief  Add the kept calls to the OS interface in the order they were made
+        //! \details Runs on the submitting thread, which is not bound to a list.
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS Commit();
+
+    protected:
+        using RegisterResourceFunc   = MOS_STATUS (*)(PMOS_INTERFACE, PMOS_RESOURCE, int32_t, int32_t);
+        using GetAllocationIndexFunc = int32_t (*)(PMOS_INTERFACE, PMOS_RESOURCE);
+        using SetPatchEntryFunc      = MOS_STATUS (*)(PMOS_INTERFACE, PMOS_PATCH_ENTRY_PARAMS);
+
+        //!
+        //! \brief  Patch list functions replaced by Hook()
+        //!
+        struct HookedOs
+        {
+            PMOS_INTERFACE         osInterface;
+            RegisterResourceFunc   registerResource;
+            GetAllocationIndexFunc getAllocationIndex;
+            SetPatchEntryFunc      setPatchEntry;
+        };
+
+        //!
+        //! \brief  Resource registration or patch entry kept in the list
+        //!
+        struct Call
+        {
+            bool                   patchEntry;   //!< Patch entry, else a resource registration
+            PMOS_RESOURCE          resource;     //!< Registered resource
+            int32_t                write;        //!< Resource is written
+            int32_t                writeRender;  //!< Resource is written by the render engine
+            MOS_PATCH_ENTRY_PARAMS params;       //!< Patch entry params, without a valid allocation index
+        };
+
+        static MOS_STATUS RegisterResource(PMOS_INTERFACE osInterface, PMOS_RESOURCE resource, int32_t write, int32_t writeRender);
+
+        static int32_t GetResourceAllocationIndex(PMOS_INTERFACE osInterface, PMOS_RESOURCE resource);
+
+        static MOS_STATUS SetPatchEntry(PMOS_INTERFACE osInterface, PMOS_PATCH_ENTRY_PARAMS params);
+
+        //!
+        //! \brief  Get the list bound to the current thread for the OS interface
+        //!
+        static EncodeDeferredPatchList *GetBoundList(PMOS_INTERFACE osInterface);
+
+        //!
+        //! \brief  Get the replaced functions of the OS interface
+        //!
+        static bool GetHookedOs(PMOS_INTERFACE osInterface, HookedOs &hookedOs);
+
+        static std::mutex                         m_hookMutex;  //!< Guards m_hooks
+        static std::vector<HookedOs>              m_hooks;      //!< Hooked OS interfaces
+        static thread_local EncodeDeferredPatchList *m_boundList;  //!< List bound to the current thread
+
+        PMOS_INTERFACE             m_osInterface = nullptr;  //!< OS interface the calls are kept for
+        std::vector<Call>          m_calls;                  //!< Kept calls in order
+        std::vector<PMOS_RESOURCE> m_resources;              //!< Registered resources, indexed by the list's allocation index
+    };
+}
+
+#endif // __ENCODE_DEFERRED_PATCH_LIST_H__
@@ -0,0 +1,55 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+//!
+//! \file     encode_fence_wait.cpp
+//! \brief    Defines the CPU wait for a GPU submission fence
+//!
+#include "encode_fence_wait.h"
+#include "encode_utils.h"
+#include <chrono>
+#include <thread>
+
+namespace encode
+{
+    MOS_STATUS EncodeFenceWait::Wait(const FenceQuery &query, uint32_t fence, uint32_t timeoutUs, uint64_t &waitedUs)
+    {
+        ENCODE_FUNC_CALL();
+
+        ENCODE_CHK_COND_RETURN(!query, "No query of the completed fence");
+
+        waitedUs   = 0;
+        auto start = std::chrono::steady_clock::now();
+        while (!IsDone(fence, query()))
+        {
+            if (waitedUs >= timeoutUs)
+            {
+                ENCODE_ASSERTMESSAGE("Fence %d is not completed after %d us", fence, timeoutUs);
+                return MOS_STATUS_UNKNOWN;
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+            waitedUs = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count();
+        }
+
+        return MOS_STATUS_SUCCESS;
+    }
+}
@@ -0,0 +1,78 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+//!
+//! \file     encode_fence_wait.h
+//! \brief    Defines the CPU wait for a GPU submission fence
+//!
+
+#ifndef __ENCODE_FENCE_WAIT_H__
+#define __ENCODE_FENCE_WAIT_H__
+
+#include <functional>
+#include "mos_defs.h"
+
+namespace encode
+{
+    //!
+    //! \class  EncodeFenceWait
+    //! \brief  Waits until the GPU status sync tag reaches the fence of a submission
+    //! \details The fences are the status tags of the GPU context, as written by the
+    //!          submissions. They wrap around, a fence is done when the completed fence
+    //!          is not behind it.
+    //!
+    class EncodeFenceWait
+    {
+    public:
+        using FenceQuery = std::function<uint32_t()>;
+
+        //!
+        //! \brief  Check if a fence is completed
+        //! \param  [in] fence
+        //!         Fence of the submission
+        //! \param  [in] completedFence
+        //!         Fence of the last completed submission
+        //! \return bool
+        //!
+        static bool IsDone(uint32_t fence, uint32_t completedFence)
+        {
+            return (int32_t)(completedFence - fence) >= 0;
+        }
+
+        //!
+        //! \brief  Wait until a fence is completed
+        //! \param  [in] query
+        //!         Returns the fence of the last completed submission
+        //! \param  [in] fence
+        //!         Fence of the submission
+        //! \param  [in] timeoutUs
+        //!         Time after which the wait fails
+        //! \param  [out] waitedUs
+        //!         Time spent waiting
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if the fence is completed, MOS_STATUS_UNKNOWN after
+        //!         the timeout
+        //!
+        static MOS_STATUS Wait(const FenceQuery &query, uint32_t fence, uint32_t timeoutUs, uint64_t &waitedUs);
+    };
+}
+
+#endif // __ENCODE_FENCE_WAIT_H__
@@ -0,0 +1,242 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+//!
+//! \file     encode_frame_dependency_tracker.cpp
+//! \brief    Implements the tracker of the frame dependencies of frame parallel encoding
+//!
+#include "encode_frame_dependency_tracker.h"
+#include "encode_utils.h"
+
+namespace encode
+{
+    EncodeFrameDependencyTracker::EncodeFrameDependencyTracker(uint32_t numEngines) :
+        m_numEngines(MOS_MIN(MOS_MAX(numEngines, 1), m_maxEngines))
+    {
+    }
+
+    EncodeFrameDependencyTracker::~EncodeFrameDependencyTracker()
+    {
+        ENCODE_ASSERT(m_syncBuffer == nullptr);
+    }
+
+    MOS_STATUS EncodeFrameDependencyTracker::Init(PMOS_INTERFACE osInterface)
+    {
+        ENCODE_FUNC_CALL();
+
+        ENCODE_CHK_NULL_RETURN(osInterface);
+
+        if (m_syncBuffer != nullptr)
+        {
+            return MOS_STATUS_SUCCESS;
+        }
+
+        MOS_ALLOC_GFXRES_PARAMS allocParams;
+        MOS_ZeroMemory(&allocParams, sizeof(allocParams));
+        allocParams.Type     = MOS_GFXRES_BUFFER;
+        allocParams.TileType = MOS_TILE_LINEAR;
+        allocParams.Format   = Format_Buffer;
+        allocParams.dwBytes  = m_maxEngines * m_syncSlotSize;
+        allocParams.pBufName = "FrameParallelSyncBuffer";
+
+        m_syncBuffer = MOS_New(MOS_RESOURCE);
+        ENCODE_CHK_NULL_RETURN(m_syncBuffer);
+        MOS_ZeroMemory(m_syncBuffer, sizeof(MOS_RESOURCE));
+
+        MOS_STATUS status = osInterface->pfnAllocateResource(osInterface, &allocParams, m_syncBuffer);
+        if (status != MOS_STATUS_SUCCESS)
+        {
+            MOS_Delete(m_syncBuffer);
+            return status;
+        }
+
+        // Zeroed, so the first frame of each engine finds nothing signaled
+        MOS_LOCK_PARAMS lockFlags;
+        MOS_ZeroMemory(&lockFlags, sizeof(lockFlags));
+        lockFlags.WriteOnly = 1;
+        uint8_t *data = (uint8_t *)osInterface->pfnLockResource(osInterface, m_syncBuffer, &lockFlags);
+        ENCODE_CHK_NULL_RETURN(data);
+        MOS_ZeroMemory(data, allocParams.dwBytes);
+        ENCODE_CHK_STATUS_RETURN(osInterface->pfnUnlockResource(osInterface, m_syncBuffer));
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    MOS_STATUS EncodeFrameDependencyTracker::Destroy(PMOS_INTERFACE osInterface)
+    {
+        ENCODE_FUNC_CALL();
+
+        ENCODE_CHK_NULL_RETURN(osInterface);
+
+        if (m_syncBuffer != nullptr)
+        {
+            osInterface->pfnFreeResource(osInterface, m_syncBuffer);
+            MOS_Delete(m_syncBuffer);
+        }
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    uint32_t EncodeFrameDependencyTracker::SelectEngine(bool dependsOnPrevious) const
+    {
+        // Running after the previous frame on another engine gains nothing
+        if (dependsOnPrevious && m_prevSeq != 0)
+        {
+            return m_prevEngine;
+        }
+
+        uint32_t engine = 0;
+        for (uint32_t i = 1; i < m_numEngines; i++)
+        {
+            if (m_engineLastUse[i] < m_engineLastUse[engine])
+            {
+                engine = i;
+            }
+        }
+        return engine;
+    }
+
+    MOS_STATUS EncodeFrameDependencyTracker::Dispatch(
+        uint32_t             engine,
+        uint8_t              recon,
+        const uint8_t       *refs,
+        uint32_t             numRefs,
+        bool                 dependsOnPrevious,
+        EncodeFrameDispatch &dispatch)
+    {
+        ENCODE_FUNC_CALL();
+
+        ENCODE_CHK_COND_RETURN(engine >= m_numEngines, "Engine %d is out of range", engine);
+        ENCODE_CHK_COND_RETURN(recon >= m_maxSurfaces, "Reconstructed surface %d is out of range", recon);
+        ENCODE_CHK_COND_RETURN(numRefs > 0 && refs == nullptr, "Reference list is missing");
+
+        dispatch        = {};
+        dispatch.engine = engine;
+        dispatch.seq    = m_engineSeq[engine] + 1;
+
+        // Read after write of the references
+        for (uint32_t i = 0; i < numRefs; i++)
+        {
+            ENCODE_CHK_COND_RETURN(refs[i] >= m_maxSurfaces, "Reference surface %d is out of range", refs[i]);
+            auto &ref = m_surfaces[refs[i]];
+            if (ref.writerSeq != 0)
+            {
+                AddWait(dispatch, ref.writerEngine, ref.writerSeq);
+            }
+        }
+
+        // Write after write and write after read of the reconstructed surface
+        auto &surface = m_surfaces[recon];
+        if (surface.writerSeq != 0)
+        {
+            AddWait(dispatch, surface.writerEngine, surface.writerSeq);
+        }
+        for (uint32_t i = 0; i < m_numEngines; i++)
+        {
+            if (surface.readerSeq[i] != 0)
+            {
+                AddWait(dispatch, i, surface.readerSeq[i]);
+            }
+        }
+
+        if (dependsOnPrevious && m_prevSeq != 0)
+        {
+            AddWait(dispatch, m_prevEngine, m_prevSeq);
+        }
+
+        // Record the frame only after all the checks passed
+        m_undoSeq           = dispatch.seq;
+        m_undoEngine        = engine;
+        m_undoEngineLastUse = m_engineLastUse[engine];
+        m_undoPrevEngine    = m_prevEngine;
+        m_undoPrevSeq       = m_prevSeq;
+        m_undoRecon         = recon;
+        m_undoReconState    = surface;
+        m_undoStats         = m_stats;
+        m_undoRefs.assign(refs, refs + numRefs);
+        m_undoRefReaderSeq.resize(numRefs);
+        for (uint32_t i = 0; i < numRefs; i++)
+        {
+            m_undoRefReaderSeq[i] = m_surfaces[refs[i]].readerSeq[engine];
+        }
+
+        m_engineSeq[engine]     = dispatch.seq;
+        m_engineLastUse[engine] = ++m_stats.frames;
+        m_prevEngine = engine;
+        m_prevSeq    = dispatch.seq;
+
+        for (uint32_t i = 0; i < numRefs; i++)
+        {
+            m_surfaces[refs[i]].readerSeq[engine] = dispatch.seq;
+        }
+        surface.writerEngine = engine;
+        surface.writerSeq    = dispatch.seq;
+        MOS_ZeroMemory(surface.readerSeq, sizeof(surface.readerSeq));
+
+        uint32_t numWaits = 0;
+        for (uint32_t i = 0; i < m_numEngines; i++)
+        {
+            numWaits += dispatch.waitSeq[i] != 0 ? 1 : 0;
+        }
+        m_stats.waits += numWaits;
+        m_stats.independentFrames += numWaits == 0 ? 1 : 0;
+        m_stats.engineFrames[engine]++;
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    MOS_STATUS EncodeFrameDependencyTracker::Cancel(const EncodeFrameDispatch &dispatch)
+    {
+        ENCODE_FUNC_CALL();
+
+        ENCODE_CHK_COND_RETURN(
+            dispatch.seq == 0 || dispatch.seq != m_undoSeq || dispatch.engine != m_undoEngine ||
+                m_engineSeq[dispatch.engine] != dispatch.seq,
+            "Frame %d of engine %d is not the last dispatched frame", dispatch.seq, dispatch.engine);
+
+        // Restored in the reverse order of Dispatch(), a reference may repeat
+        m_surfaces[m_undoRecon] = m_undoReconState;
+        for (uint32_t i = (uint32_t)m_undoRefs.size(); i > 0; i--)
+        {
+            m_surfaces[m_undoRefs[i - 1]].readerSeq[m_undoEngine] = m_undoRefReaderSeq[i - 1];
+        }
+
+        m_engineSeq[m_undoEngine]     = m_undoSeq - 1;
+        m_engineLastUse[m_undoEngine] = m_undoEngineLastUse;
+        m_prevEngine = m_undoPrevEngine;
+        m_prevSeq    = m_undoPrevSeq;
+        m_stats      = m_undoStats;
+        m_undoSeq    = 0;
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    void EncodeFrameDependencyTracker::Reset()
+    {
+        for (auto &surface : m_surfaces)
+        {
+            surface = {};
+        }
+        MOS_ZeroMemory(m_engineLastUse, sizeof(m_engineLastUse));
+        m_prevSeq = 0;
+        m_undoSeq = 0;
+    }
+}
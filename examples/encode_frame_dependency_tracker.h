@@ -0,0 +1,217 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+//!
+//! \file     encode_frame_dependency_tracker.h
+//! \brief    Defines the tracker of the frame dependencies of frame parallel encoding
+//!
+
+#ifndef __ENCODE_FRAME_DEPENDENCY_TRACKER_H__
+#define __ENCODE_FRAME_DEPENDENCY_TRACKER_H__
+
+#include <vector>
+#include "mos_os.h"
+
+namespace encode
+{
+    //!
+    //! \struct EncodeFrameDispatch
+    //! \brief  Engine of a frame and the frames of other engines it has to wait for
+    //!
+    struct EncodeFrameDispatch
+    {
+        static constexpr uint32_t m_maxEngines = 4;
+
+        uint32_t engine                = 0;   //!< VDBOX the frame runs on
+        uint32_t seq                   = 0;   //!< Sequence number the frame signals on its engine, never 0
+        uint32_t waitSeq[m_maxEngines] = {};  //!< Sequence number to wait for on each engine, 0 for none
+    };
+
+    //!
+    //! \struct EncodeFrameDependencyStats
+    //! \brief  Statistics of the frame dependency tracker
+    //!
+    struct EncodeFrameDependencyStats
+    {
+        uint64_t frames            = 0;   //!< Dispatched frames
+        uint64_t independentFrames = 0;   //!< Frames without a wait on another engine
+        uint64_t waits             = 0;   //!< Waits on other engines
+        uint64_t engineFrames[EncodeFrameDispatch::m_maxEngines] = {};  //!< Frames of each engine
+    };
+
+    //!
+    //! \class  EncodeFrameDependencyTracker
+    //! \brief  Spreads the frames of a stream over VDBOXes in legacy single pipe mode
+    //! \details Each engine runs its frames in order and signals their sequence number
+    //!          in its slot of the sync buffer. From the reference lists the tracker
+    //!          knows which engine last wrote a surface and which frames still read it,
+    //!          and a frame waits for the writer of each reference, and for the last
+    //!          writer and readers of its reconstructed surface, when they ran on
+    //!          another engine. Frames the BRC links to the previous frame also wait
+    //!          for it. Waits for frames the GPU already completed pass at once.
+    //!          One tracker is shared by the packets of the engines, each packet with its
+    //!          own GPU context and buffers.
+    //!
+    class EncodeFrameDependencyTracker
+    {
+    public:
+        static constexpr uint32_t m_maxEngines  = EncodeFrameDispatch::m_maxEngines;
+        static constexpr uint32_t m_maxSurfaces = 128;  //!< 7 bit FrameIdx of CODEC_PICTURE
+
+        //!
+        //! \brief  Constructor of class EncodeFrameDependencyTracker
+        //! \param  [in] numEngines
+        //!         Number of VDBOXes, clamped to 1 to m_maxEngines
+        //!
+        EncodeFrameDependencyTracker(uint32_t numEngines);
+
+        virtual ~EncodeFrameDependencyTracker();
+
+        //!
+        //! \brief  Allocate the zeroed sync buffer, one cache line per engine
+        //! \param  [in] osInterface
+        //!         OS interface
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS Init(PMOS_INTERFACE osInterface);
+
+        //!
+        //! \brief  Free the sync buffer, the GPU must be done with it
+        //! \param  [in] osInterface
+        //!         OS interface
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS Destroy(PMOS_INTERFACE osInterface);
+
+        //!
+        //! \brief  Choose the engine of the next frame
+        //! \details The engine used least recently, or the engine of the previous frame if
+        //!          the frame depends on it anyway.
+        //! \param  [in] dependsOnPrevious
+        //!         The frame has to wait for the previous frame
+        //! \return uint32_t
+        //!
+        uint32_t SelectEngine(bool dependsOnPrevious) const;
+
+        //!
+        //! \brief  Record a frame and get the frames it waits for
+        //! \param  [in] engine
+        //!         Engine of the frame
+        //! \param  [in] recon
+        //!         FrameIdx of the reconstructed surface
+        //! \param  [in] refs
+        //!         FrameIdx of each reference
+        //! \param  [in] numRefs
+        //!         Number of references
+        //! \param  [in] dependsOnPrevious
+        //!         The frame has to wait for the previous frame
+        //! \param  [out] dispatch
+        //!         Sequence number and waits of the frame
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS Dispatch(
+            uint32_t             engine,
+            uint8_t              recon,
+            const uint8_t       *refs,
+            uint32_t             numRefs,
+            bool                 dependsOnPrevious,
+            EncodeFrameDispatch &dispatch);
+
+        //!
+        //! \brief  Undo the last Dispatch(), used when the frame fails before its signal is submitted
+        //! \details Frames which wait for the sequence number of the canceled frame would never
+        //!          be released, so only the last dispatched frame can be canceled, and its
+        //!          sequence number is given to the next frame of the engine.
+        //! \param  [in] dispatch
+        //!         Dispatch of the frame
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS Cancel(const EncodeFrameDispatch &dispatch);
+
+        //!
+        //! \brief  Forget the surface history, e.g. when the DPB is flushed
+        //! \details Sequence numbers keep growing, so the sync buffer stays valid.
+        //! \return void
+        //!
+        void Reset();
+
+        uint32_t GetNumEngines() const { return m_numEngines; }
+        PMOS_RESOURCE GetSyncBuffer() const { return m_syncBuffer; }
+        const EncodeFrameDependencyStats &GetStats() const { return m_stats; }
+
+        static uint32_t GetSyncOffset(uint32_t engine)
+        {
+            // One cache line per engine
+            return engine * m_syncSlotSize;
+        }
+
+    protected:
+        static constexpr uint32_t m_syncSlotSize = 64;
+
+        //!
+        //! \brief  Last writer and readers of a surface
+        //!
+        struct Surface
+        {
+            uint32_t writerEngine            = 0;   //!< Engine of the last writer
+            uint32_t writerSeq               = 0;   //!< Sequence number of the last writer, 0 if none
+            uint32_t readerSeq[m_maxEngines] = {};  //!< Last reader on each engine, 0 if none
+        };
+
+        //!
+        //! \brief  Add a wait unless the frame runs on the same engine
+        //!
+        static void AddWait(EncodeFrameDispatch &dispatch, uint32_t engine, uint32_t seq)
+        {
+            if (engine != dispatch.engine && seq > dispatch.waitSeq[engine])
+            {
+                dispatch.waitSeq[engine] = seq;
+            }
+        }
+
+        uint32_t                   m_numEngines;                        //!< Number of VDBOXes
+        Surface                    m_surfaces[m_maxSurfaces];           //!< State of each FrameIdx
+        uint32_t                   m_engineSeq[m_maxEngines] = {};      //!< Last sequence number of each engine
+        uint64_t                   m_engineLastUse[m_maxEngines] = {};  //!< Frame count at the last dispatch of each engine
+        uint32_t                   m_prevEngine = 0;                    //!< Engine of the previous frame
+        uint32_t                   m_prevSeq = 0;                       //!< Sequence number of the previous frame, 0 if none
+        PMOS_RESOURCE              m_syncBuffer = nullptr;              //!< Last completed sequence number of each engine
+        EncodeFrameDependencyStats m_stats;                             //!< Statistics
+
+        // State replaced by the last Dispatch(), restored by Cancel()
+        uint32_t                   m_undoSeq = 0;                       //!< Sequence number of the last dispatch, 0 if it cannot be undone
+        uint32_t                   m_undoEngine = 0;                    //!< Engine of the last dispatch
+        uint64_t                   m_undoEngineLastUse = 0;             //!< Frame count of the engine before the dispatch
+        uint32_t                   m_undoPrevEngine = 0;                //!< Engine of the previous frame before the dispatch
+        uint32_t                   m_undoPrevSeq = 0;                   //!< Sequence number of the previous frame before the dispatch
+        uint8_t                    m_undoRecon = 0;                     //!< Reconstructed surface of the dispatch
+        Surface                    m_undoReconState;                    //!< Reconstructed surface state before the dispatch
+        std::vector<uint8_t>       m_undoRefs;                          //!< References of the dispatch
+        std::vector<uint32_t>      m_undoRefReaderSeq;                  //!< Reader of each reference on the engine before the dispatch
+        EncodeFrameDependencyStats m_undoStats;                         //!< Statistics before the dispatch
+    };
+}
+
+#endif // __ENCODE_FRAME_DEPENDENCY_TRACKER_H__
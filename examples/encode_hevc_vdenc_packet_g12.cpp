@@ -33,416 +33,2385 @@
 #include "encode_status_report_defs.h"
 #include "encode_tile.h"
 #include "encode_hevc_brc.h"
+#include "encode_cmd_walker.h"
+
+//!
+//! \brief  Run a feature interface through the per frame feature snapshot
+//! \details Skipped when the feature is not registered, same as RUN_FEATURE_INTERFACE
+//!
+#define RUN_FRAME_FEATURE_INTERFACE(_feature, _featureInterface, ...)     \
+    {                                                                     \
+        if (m_frameFeatures._feature != nullptr)                          \
+        {                                                                 \
+            m_frameFeatures._feature->_featureInterface(__VA_ARGS__);     \
+        }                                                                 \
+    }
 
 namespace encode
 {
-    MOS_STATUS HevcVdencPktG12::AllocateResources()
+    HevcVdencPktG12::~HevcVdencPktG12()
+    {
+        WaitForResources();
+        m_pakSliceBatchRing.Destroy(m_osInterface);
+        m_cmdOverflowRing.Destroy(m_osInterface);
+        m_pipeStartBatchRing.Destroy(m_osInterface);
+        MOS_Delete(m_tileBatchWorkerPool);
+        ReleaseSharedResources();
+    }
+
+    MOS_STATUS HevcVdencPktG12::AllocateSharedResource(
+        uint32_t                 resourceClass,
+        MOS_ALLOC_GFXRES_PARAMS &allocParams,
+        PMOS_RESOURCE           &resource)
+    {
+        ENCODE_FUNC_CALL();
+
+        auto &pool   = EncodeSharedResourcePool::GetInstance();
+        void *device = EncodeSharedResourcePool::GetDeviceKey(m_osInterface);
+
+        if (!pool.IsEnabled() || device == nullptr)
+        {
+            resource = m_allocator->AllocateResource(allocParams, false);
+            m_resourceInventory.Add(resource, allocParams, false);
+            return MOS_STATUS_SUCCESS;
+        }
+
+        EncodeSharedResourceKey key;
+        GetSharedResourceKey(device, resourceClass, allocParams.dwBytes, key);
+
+        ENCODE_CHK_STATUS_RETURN(pool.Acquire(m_osInterface, key, allocParams, resource));
+        m_sharedResources.push_back(resource);
+        m_resourceInventory.Add(resource, allocParams, true);
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    void HevcVdencPktG12::GetSharedResourceKey(
+        void                    *device,
+        uint32_t                 resourceClass,
+        uint32_t                 size,
+        EncodeSharedResourceKey &key) const
+    {
+        MOS_ZeroMemory(&key, sizeof(key));
+        key.device        = device;
+        key.resourceClass = resourceClass;
+        key.width         = m_picBufferConfig.width;
+        key.height        = m_picBufferConfig.height;
+        key.bitDepth      = m_picBufferConfig.bitDepth;
+        key.chromaFormat  = m_picBufferConfig.chromaFormat;
+        key.lcuSize       = m_basicFeature->m_maxLCUSize;
+        key.size          = size;
+    }
+
+    MOS_STATUS HevcVdencPktG12::PrewarmSharedResources(
+        const HevcVdencPicBufferConfigG12 &config,
+        uint32_t                           numSessions)
     {
         ENCODE_FUNC_CALL();
 
+        auto &pool   = EncodeSharedResourcePool::GetInstance();
+        void *device = EncodeSharedResourcePool::GetDeviceKey(m_osInterface);
+        ENCODE_CHK_COND_RETURN(!pool.IsEnabled() || device == nullptr, "The shared resource pool is not enabled");
+
+        // The sizes are computed for the profile, then the packet config is restored
+        HevcVdencPicBufferConfigG12 packetConfig = m_picBufferConfig;
+        m_picBufferConfig = config;
+
         MOS_STATUS eStatus = MOS_STATUS_SUCCESS;
-        HevcVdencPkt::AllocateResources();
+        for (uint32_t resourceClass = 0; resourceClass < sharedResourceNum && eStatus == MOS_STATUS_SUCCESS; resourceClass++)
+        {
+            HevcVdencPicBufferInfoG12 info;
+            uint32_t                  size = 0;
+            eStatus = GetPictureBufferInfo(resourceClass, info);
+            if (eStatus == MOS_STATUS_SUCCESS)
+            {
+                eStatus = GetPictureBufferSize(resourceClass, size);
+            }
+            if (eStatus != MOS_STATUS_SUCCESS)
+            {
+                break;
+            }
+
+            MOS_ALLOC_GFXRES_PARAMS allocParamsForBufferLinear;
+            MOS_ZeroMemory(&allocParamsForBufferLinear, sizeof(MOS_ALLOC_GFXRES_PARAMS));
+            allocParamsForBufferLinear.Type = MOS_GFXRES_BUFFER;
+            allocParamsForBufferLinear.TileType = MOS_TILE_LINEAR;
+            allocParamsForBufferLinear.Format = Format_Buffer;
+            allocParamsForBufferLinear.dwBytes = size;
+            allocParamsForBufferLinear.pBufName = info.name;
+
+            EncodeSharedResourceKey key;
+            GetSharedResourceKey(device, resourceClass, size, key);
+            eStatus = pool.Prewarm(m_osInterface, key, allocParamsForBufferLinear, numSessions);
+        }
+
+        m_picBufferConfig = packetConfig;
+        return eStatus;
+    }
+
+    MOS_STATUS HevcVdencPktG12::GetPictureBufferInfo(uint32_t resourceClass, HevcVdencPicBufferInfoG12 &info)
+    {
+        info.scratch = scratchBufferNum;
+
+        switch (resourceClass)
+        {
+        case sharedPakStreamOut:
+            info.name     = "Pak StreamOut Buffer";
+            info.resource = &m_resStreamOutBuffer[0];
+            break;
+        case sharedMetadataLine:
+            info.name     = "MetadataLineBuffer";
+            info.resource = &m_resMetadataLineBuffer;
+            info.scratch  = scratchMetadataLine;
+            break;
+        case sharedMetadataTileLine:
+            info.name     = "MetadataTileLineBuffer";
+            info.resource = &m_resMetadataTileLineBuffer;
+            info.scratch  = scratchMetadataTileLine;
+            break;
+        case sharedMetadataTileColumn:
+            info.name     = "MetadataTileColumnBuffer";
+            info.resource = &m_resMetadataTileColumnBuffer;
+            info.scratch  = scratchMetadataTileColumn;
+            break;
+        case sharedSseSrcPixelRowStore:
+            info.name     = "SseSrcPixelRowStoreBuffer";
+            info.resource = &m_resSSESrcPixelRowStoreBuffer;
+            info.scratch  = scratchSseSrcPixelRowStore;
+            break;
+        case sharedPakCuLevelStreamOut:
+            info.name     = "PAK CU Level Streamout Data";
+            info.resource = &m_resPakcuLevelStreamOutData;
+            break;
+        case sharedLcuIldbStreamOut:
+            info.name     = "LcuILDBStreamOutBuffer";
+            info.resource = &m_resLCUIldbStreamOutBuffer;
+            info.scratch  = scratchLcuIldbStreamOut;
+            break;
+        default:
+            ENCODE_ASSERTMESSAGE("Invalid picture buffer %d.", resourceClass);
+            return MOS_STATUS_INVALID_PARAMETER;
+        }
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    MOS_STATUS HevcVdencPktG12::GetPictureBufferSize(uint32_t resourceClass, uint32_t &size)
+    {
+        ENCODE_FUNC_CALL();
+
+        MHW_VDBOX_HCP_INTERNAL_BUFFER_TYPE bufferType;
+        switch (resourceClass)
+        {
+        case sharedPakStreamOut:
+            size = GetPakStreamOutSize();
+            return MOS_STATUS_SUCCESS;
+        case sharedMetadataLine:
+            bufferType = MHW_VDBOX_HCP_INTERNAL_BUFFER_META_LINE;
+            break;
+        case sharedMetadataTileLine:
+            bufferType = MHW_VDBOX_HCP_INTERNAL_BUFFER_META_TILE_LINE;
+            break;
+        case sharedMetadataTileColumn:
+            bufferType = MHW_VDBOX_HCP_INTERNAL_BUFFER_META_TILE_COL;
+            break;
+        case sharedSseSrcPixelRowStore:
+        {
+            uint32_t widthAlignedMaxLCU = MOS_ALIGN_CEIL(m_picBufferConfig.width, m_basicFeature->m_maxLCUSize);
+            uint32_t maxTileColumns     = MOS_ROUNDUP_DIVIDE(m_picBufferConfig.width, CODECHAL_HEVC_MIN_TILE_SIZE);
+            size = 2 * m_basicFeature->m_sizeOfSseSrcPixelRowStoreBufferPerLcu * (widthAlignedMaxLCU + 3 * maxTileColumns);
+            return MOS_STATUS_SUCCESS;
+        }
+        case sharedPakCuLevelStreamOut:
+        {
+            uint32_t frameWidthInCus  = CODECHAL_GET_WIDTH_IN_BLOCKS(m_picBufferConfig.width, CODECHAL_HEVC_MIN_CU_SIZE);
+            uint32_t frameHeightInCus = CODECHAL_GET_WIDTH_IN_BLOCKS(m_picBufferConfig.height, CODECHAL_HEVC_MIN_CU_SIZE);
+            // PAK CU Level Streamout Data:   DW57-59 in HCP pipe buffer address command
+            // One CU has 16-byte. But, each tile needs to be aliged to the cache line
+            size = MOS_ALIGN_CEIL(frameWidthInCus * frameHeightInCus * 16, CODECHAL_CACHELINE_SIZE);
+            return MOS_STATUS_SUCCESS;
+        }
+        case sharedLcuIldbStreamOut:
+            // TODO: Allocate the buffer size according to B-spec
+            // This is not enabled with HCP_PIPE_MODE_SELECT yet, placeholder here
+            size = CODECHAL_CACHELINE_SIZE;
+            return MOS_STATUS_SUCCESS;
+        default:
+            ENCODE_ASSERTMESSAGE("Invalid picture buffer %d.", resourceClass);
+            return MOS_STATUS_INVALID_PARAMETER;
+        }
+
         MHW_VDBOX_HCP_BUFFER_SIZE_PARAMS hcpBufSizeParam;
         MOS_ZeroMemory(&hcpBufSizeParam, sizeof(hcpBufSizeParam));
 
-        hcpBufSizeParam.ucMaxBitDepth = m_basicFeature->m_bitDepth;
-        hcpBufSizeParam.ucChromaFormat = m_basicFeature->m_chromaFormat;
+        hcpBufSizeParam.ucMaxBitDepth = m_picBufferConfig.bitDepth;
+        hcpBufSizeParam.ucChromaFormat = m_picBufferConfig.chromaFormat;
         // We should move the buffer allocation to picture level if the size is dependent on LCU size
         hcpBufSizeParam.dwCtbLog2SizeY = 6; //assume Max LCU size
-        hcpBufSizeParam.dwPicWidth = MOS_ALIGN_CEIL(m_basicFeature->m_frameWidth, m_basicFeature->m_maxLCUSize);
-        hcpBufSizeParam.dwPicHeight = MOS_ALIGN_CEIL(m_basicFeature->m_frameHeight, m_basicFeature->m_maxLCUSize);
+        hcpBufSizeParam.dwPicWidth = MOS_ALIGN_CEIL(m_picBufferConfig.width, m_basicFeature->m_maxLCUSize);
+        hcpBufSizeParam.dwPicHeight = MOS_ALIGN_CEIL(m_picBufferConfig.height, m_basicFeature->m_maxLCUSize);
+
+        MOS_STATUS eStatus = (MOS_STATUS)m_hcpInterface->GetHevcBufferSize(bufferType, &hcpBufSizeParam);
+        if (eStatus != MOS_STATUS_SUCCESS)
+        {
+            ENCODE_ASSERTMESSAGE("Failed to get the size for picture buffer %d.", resourceClass);
+            return eStatus;
+        }
+
+        size = hcpBufSizeParam.dwBufferSize;
+        return MOS_STATUS_SUCCESS;
+    }
+
+    MOS_STATUS HevcVdencPktG12::AllocatePictureBuffer(uint32_t resourceClass, uint32_t minSize)
+    {
+        ENCODE_FUNC_CALL();
+
+        HevcVdencPicBufferInfoG12 info;
+        ENCODE_CHK_STATUS_RETURN(GetPictureBufferInfo(resourceClass, info));
+
+        uint32_t size = 0;
+        ENCODE_CHK_STATUS_RETURN(GetPictureBufferSize(resourceClass, size));
+        size = MOS_MAX(size, minSize);
 
         MOS_ALLOC_GFXRES_PARAMS allocParamsForBufferLinear;
         MOS_ZeroMemory(&allocParamsForBufferLinear, sizeof(MOS_ALLOC_GFXRES_PARAMS));
         allocParamsForBufferLinear.Type = MOS_GFXRES_BUFFER;
         allocParamsForBufferLinear.TileType = MOS_TILE_LINEAR;
         allocParamsForBufferLinear.Format = Format_Buffer;
+        allocParamsForBufferLinear.dwBytes = size;
+        allocParamsForBufferLinear.pBufName = info.name;
 
-        // PAK stream-out buffer
-        allocParamsForBufferLinear.dwBytes = CODECHAL_HEVC_PAK_STREAMOUT_SIZE;
-        allocParamsForBufferLinear.pBufName = "Pak StreamOut Buffer";
-        m_resStreamOutBuffer[0] = m_allocator->AllocateResource(allocParamsForBufferLinear,false);
-
-        // Metadata Line buffer
-        eStatus = (MOS_STATUS)m_hcpInterface->GetHevcBufferSize(
-            MHW_VDBOX_HCP_INTERNAL_BUFFER_META_LINE,
-            &hcpBufSizeParam);
-        if (eStatus != MOS_STATUS_SUCCESS)
+        if (info.scratch != scratchBufferNum)
         {
-            ENCODE_ASSERTMESSAGE("Failed to get the size for Metadata Line Buffer.");
-            return eStatus;
+            ENCODE_CHK_STATUS_RETURN(AllocateScratchResource(info.scratch, resourceClass, allocParamsForBufferLinear, *info.resource));
+        }
+        else
+        {
+            ENCODE_CHK_STATUS_RETURN(AllocateSharedResource(resourceClass, allocParamsForBufferLinear, *info.resource));
+            ENCODE_CHK_NULL_RETURN(*info.resource);
         }
-        allocParamsForBufferLinear.dwBytes = hcpBufSizeParam.dwBufferSize;
-        allocParamsForBufferLinear.pBufName = "MetadataLineBuffer";
-        m_resMetadataLineBuffer = m_allocator->AllocateResource(allocParamsForBufferLinear,false);
 
-        // Metadata Tile Line buffer
-        eStatus = (MOS_STATUS)m_hcpInterface->GetHevcBufferSize(
-            MHW_VDBOX_HCP_INTERNAL_BUFFER_META_TILE_LINE,
-            &hcpBufSizeParam);
-        if (eStatus != MOS_STATUS_SUCCESS)
+        m_picBufferCapacity[resourceClass] = size;
+        return MOS_STATUS_SUCCESS;
+    }
+
+    MOS_STATUS HevcVdencPktG12::AllocateOptionalBuffers(uint32_t buffers)
+    {
+        ENCODE_FUNC_CALL();
+
+        buffers &= ~m_optionalBuffersAllocated;
+        if (buffers == 0)
         {
-            ENCODE_ASSERTMESSAGE("Failed to get the size for Metadata Tile Line Buffer.");
-            return eStatus;
+            return MOS_STATUS_SUCCESS;
         }
-        allocParamsForBufferLinear.dwBytes = hcpBufSizeParam.dwBufferSize;
-        allocParamsForBufferLinear.pBufName = "MetadataTileLineBuffer";
-        m_resMetadataTileLineBuffer = m_allocator->AllocateResource(allocParamsForBufferLinear,false);
 
-        // Metadata Tile Column buffer
-        eStatus = (MOS_STATUS)m_hcpInterface->GetHevcBufferSize(
-            MHW_VDBOX_HCP_INTERNAL_BUFFER_META_TILE_COL,
-            &hcpBufSizeParam);
-        if (eStatus != MOS_STATUS_SUCCESS)
+        if (buffers & optionalLcuIldbStreamOut)
         {
-            ENCODE_ASSERTMESSAGE("Failed to get the size for Metadata Tile Column Buffer.");
-            return eStatus;
+            ENCODE_CHK_STATUS_RETURN(AllocatePictureBuffer(sharedLcuIldbStreamOut));
         }
-        allocParamsForBufferLinear.dwBytes = hcpBufSizeParam.dwBufferSize;
-        allocParamsForBufferLinear.pBufName = "MetadataTileColumnBuffer";
-        m_resMetadataTileColumnBuffer = m_allocator->AllocateResource(allocParamsForBufferLinear,false);
-
-        // Lcu ILDB StreamOut buffer
-        // TODO: Allocate the buffer size according to B-spec
-        // This is not enabled with HCP_PIPE_MODE_SELECT yet, placeholder here
-        allocParamsForBufferLinear.dwBytes = CODECHAL_CACHELINE_SIZE;
-        allocParamsForBufferLinear.pBufName = "LcuILDBStreamOutBuffer";
-        m_resLCUIldbStreamOutBuffer = m_allocator->AllocateResource(allocParamsForBufferLinear,false);
-
-        // Allocate SSE Source Pixel Row Store Buffer
-        uint32_t maxTileColumns    = MOS_ROUNDUP_DIVIDE(m_basicFeature->m_frameWidth, CODECHAL_HEVC_MIN_TILE_SIZE);
-        allocParamsForBufferLinear.dwBytes  = 2 * m_basicFeature->m_sizeOfSseSrcPixelRowStoreBufferPerLcu * (m_basicFeature->m_widthAlignedMaxLCU + 3 * maxTileColumns);
-        allocParamsForBufferLinear.pBufName = "SseSrcPixelRowStoreBuffer";
-        m_resSSESrcPixelRowStoreBuffer = m_allocator->AllocateResource(allocParamsForBufferLinear,false);
-
-        uint32_t frameWidthInCus = CODECHAL_GET_WIDTH_IN_BLOCKS(m_basicFeature->m_frameWidth, CODECHAL_HEVC_MIN_CU_SIZE);
-        uint32_t frameHeightInCus = CODECHAL_GET_WIDTH_IN_BLOCKS(m_basicFeature->m_frameHeight, CODECHAL_HEVC_MIN_CU_SIZE);
-        uint32_t frameWidthInLCUs = CODECHAL_GET_WIDTH_IN_BLOCKS(m_basicFeature->m_frameWidth, CODECHAL_HEVC_MAX_LCU_SIZE_G10);
-        uint32_t frameHeightInLCUs = CODECHAL_GET_WIDTH_IN_BLOCKS(m_basicFeature->m_frameHeight, CODECHAL_HEVC_MAX_LCU_SIZE_G10);
-        // PAK CU Level Streamout Data:   DW57-59 in HCP pipe buffer address command
-        // One CU has 16-byte. But, each tile needs to be aliged to the cache line
-        auto size = MOS_ALIGN_CEIL(frameWidthInCus * frameHeightInCus * 16, CODECHAL_CACHELINE_SIZE);
-        allocParamsForBufferLinear.dwBytes = size;
-        allocParamsForBufferLinear.pBufName = "PAK CU Level Streamout Data";
-        m_resPakcuLevelStreamOutData = m_allocator->AllocateResource(allocParamsForBufferLinear,false);
 
+        if (buffers & optionalSseSrcPixelRowStore)
+        {
+            ENCODE_CHK_STATUS_RETURN(AllocatePictureBuffer(sharedSseSrcPixelRowStore));
+        }
 
-        //TODO:Check nullptr for all the allocated resources.
-        return eStatus;
+        if (buffers & optionalPakCuLevelStreamOut)
+        {
+            ENCODE_CHK_STATUS_RETURN(AllocatePictureBuffer(sharedPakCuLevelStreamOut));
+        }
 
+        m_optionalBuffersAllocated |= buffers;
+
+        return MOS_STATUS_SUCCESS;
     }
 
-    MOS_STATUS HevcVdencPktG12::Prepare()
+    MOS_STATUS HevcVdencPktG12::CheckOptionalBuffers(const MHW_VDBOX_PIPE_BUF_ADDR_PARAMS &pipeBufAddrParams)
     {
         ENCODE_FUNC_CALL();
 
-        HevcVdencPkt::Prepare();
+        const struct
+        {
+            PMOS_RESOURCE programmed;
+            uint32_t      buffer;
+            uint32_t      resourceClass;
+        } optionalBuffers[] = {
+            {pipeBufAddrParams.presSseSrcPixelRowStoreBuffer, optionalSseSrcPixelRowStore, sharedSseSrcPixelRowStore},
+            {pipeBufAddrParams.presLcuILDBStreamOutBuffer,    optionalLcuIldbStreamOut,    sharedLcuIldbStreamOut},
+            {pipeBufAddrParams.presPakCuLevelStreamoutBuffer, optionalPakCuLevelStreamOut, sharedPakCuLevelStreamOut},
+        };
+
+        for (auto &optional : optionalBuffers)
+        {
+            if (optional.programmed == nullptr)
+            {
+                continue;
+            }
 
-        //ENCODE_CHK_STATUS_RETURN(m_trackedBuf->AllocateForCurrFrame());
-        //m_resMbCodeSurface = *m_trackedBuf->GetCurrMbCodeBuffer();
-        //if (m_trackedBuf->GetCurrMvDataBuffer())
-        //{
-        //    m_resMvDataSurface = *m_trackedBuf->GetCurrMvDataBuffer();
-        //}
+            uint32_t size = 0;
+            ENCODE_CHK_STATUS_RETURN(GetPictureBufferSize(optional.resourceClass, size));
+            ENCODE_CHK_COND_RETURN(!(m_optionalBuffersAllocated & optional.buffer) || m_picBufferCapacity[optional.resourceClass] < size,
+                "Optional buffer 0x%x is programmed but not allocated, it has to be requested", optional.buffer);
+        }
 
         return MOS_STATUS_SUCCESS;
     }
 
-    MOS_STATUS HevcVdencPktG12::Submit(
-        MOS_COMMAND_BUFFER* commandBuffer,
-        uint8_t packetPhase)
+    MOS_STATUS HevcVdencPktG12::AllocateScratchResource(
+        HevcVdencScratchBufferG12  scratch,
+        uint32_t                   resourceClass,
+        MOS_ALLOC_GFXRES_PARAMS   &allocParams,
+        PMOS_RESOURCE             &resource)
     {
         ENCODE_FUNC_CALL();
 
-        MOS_COMMAND_BUFFER &cmdBuffer = *commandBuffer;
-        ENCODE_CHK_STATUS_RETURN(Mos_Solo_PreProcessEncode(m_osInterface, &m_basicFeature->m_resBitstreamBuffer, &m_basicFeature->m_reconSurface));
+        if (!m_scratchReserving)
+        {
+            return AllocateSharedResource(resourceClass, allocParams, resource);
+        }
 
-        ENCODE_CHK_STATUS_RETURN(PatchPictureLevelCommands(packetPhase, cmdBuffer));
+        m_scratchIndices[scratch] = m_scratchSubAllocator.Reserve(allocParams.dwBytes);
+        m_scratchTargets[scratch] = &resource;
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    MOS_STATUS HevcVdencPktG12::AllocateScratchBuffers()
+    {
+        ENCODE_FUNC_CALL();
 
-        bool tileEnabled = false;
-        RUN_FEATURE_INTERFACE(EncodeTile, FeatureIDs::encodeTile, IsEnabled, tileEnabled);
-        if (!tileEnabled)
+        if (!m_scratchReserving)
         {
-            ENCODE_CHK_STATUS_RETURN(PatchSliceLevelCommands(cmdBuffer, packetPhase));
+            return MOS_STATUS_SUCCESS;
+        }
+        m_scratchReserving = false;
+
+        ENCODE_CHK_STATUS_RETURN(m_scratchSubAllocator.Allocate(m_allocator, "HevcScratchBuffers"));
+
+        MOS_ALLOC_GFXRES_PARAMS allocParams;
+        MOS_ZeroMemory(&allocParams, sizeof(MOS_ALLOC_GFXRES_PARAMS));
+        allocParams.TileType = MOS_TILE_LINEAR;
+        allocParams.dwBytes  = MOS_ALIGN_CEIL(m_scratchSubAllocator.GetTotalSize(), CODECHAL_PAGE_SIZE);
+        allocParams.pBufName = "HevcScratchBuffers";
+        m_resourceInventory.Add(m_scratchSubAllocator.GetBacking(), allocParams, false);
+
+        // Buffers of a lazy session which are not reserved get their own allocation later
+        for (uint32_t i = 0; i < scratchBufferNum; i++)
+        {
+            if (m_scratchTargets[i] != nullptr)
+            {
+                m_scratchBuffers[i]  = m_scratchSubAllocator.Get(m_scratchIndices[i]);
+                *m_scratchTargets[i] = m_scratchBuffers[i].resource;
+            }
+        }
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    MOS_STATUS HevcVdencPktG12::ResetScratchBuffers()
+    {
+        ENCODE_FUNC_CALL();
+
+        m_resourceInventory.Remove(m_scratchSubAllocator.GetBacking());
+        ENCODE_CHK_STATUS_RETURN(m_scratchSubAllocator.Reset(m_allocator));
+        MOS_ZeroMemory(m_scratchBuffers, sizeof(m_scratchBuffers));
+        MOS_ZeroMemory(m_scratchTargets, sizeof(m_scratchTargets));
+        m_scratchReserving = true;
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    bool HevcVdencPktG12::IsScratchSubAllocActive() const
+    {
+        // The stock G12 HCP interface ignores the offsets, the packed buffers would overlap
+        return m_scratchSubAllocEnabled &&
+               dynamic_cast<MhwVdboxHcpBufOffsetInterfaceG12 *>(m_hcpInterface) != nullptr;
+    }
+
+    MOS_STATUS HevcVdencPktG12::FreeSharedResource(PMOS_RESOURCE &resource)
+    {
+        ENCODE_FUNC_CALL();
+
+        if (resource == nullptr)
+        {
+            return MOS_STATUS_SUCCESS;
+        }
+
+        m_resourceInventory.Remove(resource);
+
+        auto leased = std::find(m_sharedResources.begin(), m_sharedResources.end(), resource);
+        if (leased != m_sharedResources.end())
+        {
+            m_sharedResources.erase(leased);
+            ENCODE_CHK_STATUS_RETURN(EncodeSharedResourcePool::GetInstance().Release(m_osInterface, resource));
         }
         else
         {
-            ENCODE_CHK_STATUS_RETURN(PatchTileLevelCommands(cmdBuffer, packetPhase));
+            ENCODE_CHK_STATUS_RETURN(m_allocator->DestroyResource(resource));
+        }
+
+        resource = nullptr;
+        return MOS_STATUS_SUCCESS;
+    }
+
+    uint32_t HevcVdencPktG12::GetPakStreamOutSize() const
+    {
+        uint32_t frameWidthInMinCus  = CODECHAL_GET_WIDTH_IN_BLOCKS(m_picBufferConfig.width, CODECHAL_HEVC_MIN_CU_SIZE);
+        uint32_t frameHeightInMinCus = CODECHAL_GET_WIDTH_IN_BLOCKS(m_picBufferConfig.height, CODECHAL_HEVC_MIN_CU_SIZE);
+
+        return MOS_ALIGN_CEIL(frameWidthInMinCus * frameHeightInMinCus * m_pakStreamOutBytesPerMinCu, CODECHAL_PAGE_SIZE);
+    }
+
+    MOS_STATUS HevcVdencPktG12::Reconfigure(
+        uint32_t width,
+        uint32_t height,
+        uint8_t  bitDepth,
+        uint8_t  chromaFormat)
+    {
+        ENCODE_FUNC_CALL();
+
+        if (width == m_picBufferConfig.width && height == m_picBufferConfig.height &&
+            bitDepth == m_picBufferConfig.bitDepth && chromaFormat == m_picBufferConfig.chromaFormat)
+        {
+            return MOS_STATUS_SUCCESS;
+        }
+
+        m_picBufferConfig.width        = width;
+        m_picBufferConfig.height       = height;
+        m_picBufferConfig.bitDepth     = bitDepth;
+        m_picBufferConfig.chromaFormat = chromaFormat;
+
+        // Only the buffers which outgrow their capacity are reallocated, smaller sizes keep the buffer
+        uint32_t grow   = 0;
+        uint32_t packed = 0;
+        for (uint32_t resourceClass = 0; resourceClass < sharedResourceNum; resourceClass++)
+        {
+            if (m_picBufferCapacity[resourceClass] == 0)
+            {
+                continue;
+            }
+
+            HevcVdencPicBufferInfoG12 info;
+            ENCODE_CHK_STATUS_RETURN(GetPictureBufferInfo(resourceClass, info));
+            if (info.scratch != scratchBufferNum && m_scratchTargets[info.scratch] != nullptr)
+            {
+                packed |= (1 << resourceClass);
+            }
+
+            uint32_t size = 0;
+            ENCODE_CHK_STATUS_RETURN(GetPictureBufferSize(resourceClass, size));
+            if (size > m_picBufferCapacity[resourceClass])
+            {
+                grow |= (1 << resourceClass);
+            }
+        }
+
+        if (grow == 0)
+        {
+            return MOS_STATUS_SUCCESS;
+        }
+
+        // The submitted frames may still read or write the buffers which are replaced
+        ENCODE_CHK_STATUS_RETURN(WaitForSubmissions());
+
+        // The packed buffers share one backing resource, so they are packed again together
+        if (grow & packed)
+        {
+            ENCODE_CHK_STATUS_RETURN(ResetScratchBuffers());
+
+            for (uint32_t resourceClass = 0; resourceClass < sharedResourceNum; resourceClass++)
+            {
+                if (packed & (1 << resourceClass))
+                {
+                    ENCODE_CHK_STATUS_RETURN(AllocatePictureBuffer(resourceClass, m_picBufferCapacity[resourceClass]));
+                }
+            }
+
+            ENCODE_CHK_STATUS_RETURN(AllocateScratchBuffers());
+        }
+
+        for (uint32_t resourceClass = 0; resourceClass < sharedResourceNum; resourceClass++)
+        {
+            if ((grow & ~packed) & (1 << resourceClass))
+            {
+                HevcVdencPicBufferInfoG12 info;
+                ENCODE_CHK_STATUS_RETURN(GetPictureBufferInfo(resourceClass, info));
+                ENCODE_CHK_STATUS_RETURN(FreeSharedResource(*info.resource));
+                ENCODE_CHK_STATUS_RETURN(AllocatePictureBuffer(resourceClass));
+            }
+        }
+
+        // Templates and replayed passes carry no addresses, but were built for the old frame size
+        InvalidatePictureCmdTemplates();
+        m_passReplay.Invalidate();
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    void HevcVdencPktG12::ReleaseSharedResources()
+    {
+        auto &pool = EncodeSharedResourcePool::GetInstance();
+        for (auto resource : m_sharedResources)
+        {
+            pool.Release(m_osInterface, resource);
+            m_resourceInventory.Remove(resource);
+        }
+        m_sharedResources.clear();
+    }
+
+    MOS_STATUS HevcVdencPktG12::AllocateResources()
+    {
+        ENCODE_FUNC_CALL();
+
+        if (!m_asyncAllocation)
+        {
+            return AllocatePacketResources();
+        }
+
+        ENCODE_CHK_COND_RETURN(m_allocThread.joinable(), "Resource allocation is already running");
+        m_allocStatus = MOS_STATUS_SUCCESS;
+        m_allocThread = std::thread([this]() { m_allocStatus = AllocatePacketResources(); });
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    MOS_STATUS HevcVdencPktG12::WaitForResources()
+    {
+        if (m_allocThread.joinable())
+        {
+            m_allocThread.join();
+        }
+
+        return m_allocStatus;
+    }
+
+    MOS_STATUS HevcVdencPktG12::AllocatePacketResources()
+    {
+        ENCODE_FUNC_CALL();
+
+        ENCODE_CHK_STATUS_RETURN(HevcVdencPkt::AllocateResources());
+
+        m_picBufferConfig.width        = m_basicFeature->m_frameWidth;
+        m_picBufferConfig.height       = m_basicFeature->m_frameHeight;
+        m_picBufferConfig.bitDepth     = m_basicFeature->m_bitDepth;
+        m_picBufferConfig.chromaFormat = m_basicFeature->m_chromaFormat;
+
+        // PAK stream-out buffer
+        ENCODE_CHK_STATUS_RETURN(AllocatePictureBuffer(sharedPakStreamOut));
+
+        if (IsScratchSubAllocActive())
+        {
+            // A new set of buffers, the previous backing resource is no longer referenced
+            ENCODE_CHK_STATUS_RETURN(ResetScratchBuffers());
+        }
+
+        // Metadata Line, Tile Line and Tile Column buffers
+        ENCODE_CHK_STATUS_RETURN(AllocatePictureBuffer(sharedMetadataLine));
+        ENCODE_CHK_STATUS_RETURN(AllocatePictureBuffer(sharedMetadataTileLine));
+        ENCODE_CHK_STATUS_RETURN(AllocatePictureBuffer(sharedMetadataTileColumn));
+
+        // Lazy sessions allocate the optional buffers once a consumer asks for them, the buffers
+        // an earlier allocation materialized are still programmed and are allocated again
+        uint32_t optionalBuffers = m_lazyOptionalBuffers ? (m_optionalBufferRequests | m_optionalBuffersAllocated) : optionalBufferAll;
+        m_optionalBuffersAllocated = 0;
+        ENCODE_CHK_STATUS_RETURN(AllocateOptionalBuffers(optionalBuffers));
+
+        ENCODE_CHK_STATUS_RETURN(AllocateScratchBuffers());
+
+        //TODO:Check nullptr for all the allocated resources.
+        return MOS_STATUS_SUCCESS;
+
+    }
+
+    MOS_STATUS HevcVdencPktG12::Prepare()
+    {
+        ENCODE_FUNC_CALL();
+
+        // Blocks only the first frame of a session which allocates in the background
+        ENCODE_CHK_STATUS_RETURN(WaitForResources());
+
+        HevcVdencPkt::Prepare();
+
+        ENCODE_CHK_STATUS_RETURN(ResolveG12Interfaces());
+
+        ENCODE_CHK_STATUS_RETURN(UpdateFrameFeatures());
+
+        // Fails an unsupported pipe count before the frame takes any slot or engine
+        uint32_t walkerNumberOfPipes = 0;
+        ENCODE_CHK_STATUS_RETURN(GetWalkerNumberOfPipes(m_pipeline->GetPipeNum(), walkerNumberOfPipes));
+
+        // The slot buffers are written by this frame, so its previous reader has to be done
+        if (m_recycledSlotTracking)
+        {
+            ENCODE_CHK_STATUS_RETURN(m_recycledSlots.WaitSlot(m_pipeline->m_currRecycledBufIdx));
+        }
+
+        // Later passes run on the same engine after the first one
+        if (m_pipeline->IsFirstPass())
+        {
+            // A shared build left by a frame which did not submit all its pipes
+            ResetSharedPipeBuild();
+
+            m_frameDispatch = {};
+            if (IsFrameParallelActive())
+            {
+                ENCODE_CHK_STATUS_RETURN(DispatchFrameParallel());
+            }
+        }
+
+        MOS_STATUS status = PrepareFrame();
+        if (status != MOS_STATUS_SUCCESS)
+        {
+            CancelFrameParallel();
+            ResetSharedPipeBuild();
+        }
+
+        return status;
+    }
+
+    MOS_STATUS HevcVdencPktG12::PrepareFrame()
+    {
+        ENCODE_FUNC_CALL();
+
+        SelectTileBatchBuilder();
+
+        // Surfaces may change with every frame
+        m_picSurfacesKeyValid = false;
+
+        if (m_frameFeatures.tileEnabled)
+        {
+            ENCODE_CHK_STATUS_RETURN(BuildSliceTileMap());
+
+            // Tile columns are split over the pipes by cost, a pipe may encode several columns
+            ENCODE_CHK_STATUS_RETURN(m_tileColumnScheduler.Schedule(
+                m_sliceTileMap.tileColumnCtus, MOS_MAX(1, (uint32_t)m_pipeline->GetNumPipes())));
+        }
+
+        if (m_basicFeature->m_resolutionChanged)
+        {
+            ENCODE_CHK_STATUS_RETURN(Reconfigure(
+                m_basicFeature->m_frameWidth,
+                m_basicFeature->m_frameHeight,
+                m_basicFeature->m_bitDepth,
+                m_basicFeature->m_chromaFormat));
+        }
+
+        if (m_lazyOptionalBuffers)
+        {
+            ENCODE_CHK_STATUS_RETURN(AllocateOptionalBuffers(m_optionalBufferRequests));
+        }
+
+        // Templates are kept for one sequence, the keys catch any change within it
+        if (m_basicFeature->m_newSeq || m_basicFeature->m_resolutionChanged)
+        {
+            InvalidatePictureCmdTemplates();
+            m_passReplay.Invalidate();
+        }
+
+        //ENCODE_CHK_STATUS_RETURN(m_trackedBuf->AllocateForCurrFrame());
+        //m_resMbCodeSurface = *m_trackedBuf->GetCurrMbCodeBuffer();
+        //if (m_trackedBuf->GetCurrMvDataBuffer())
+        //{
+        //    m_resMvDataSurface = *m_trackedBuf->GetCurrMvDataBuffer();
+        //}
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    MOS_STATUS HevcVdencPktG12::UpdateFrameFeatures()
+    {
+        ENCODE_FUNC_CALL();
+
+        ENCODE_CHK_NULL_RETURN(m_featureManager);
+
+        m_frameFeatures = {};
+        m_frameFeatures.brc  = static_cast<HEVCEncodeBRC *>(m_featureManager->GetFeature(FeatureIDs::hevcBrcFeature));
+        m_frameFeatures.tile = static_cast<EncodeTile *>(m_featureManager->GetFeature(FeatureIDs::encodeTile));
+        m_frameFeatures.roi  = static_cast<HevcVdencRoi *>(m_featureManager->GetFeature(FeatureIDs::hevcVdencRoiFeature));
+
+        if (m_frameFeatures.roi != nullptr)
+        {
+            m_frameFeatures.roiEnabled = m_frameFeatures.roi->IsEnabled();
+        }
+
+        if (m_frameFeatures.tile != nullptr)
+        {
+            m_frameFeatures.tile->IsEnabled(m_frameFeatures.tileEnabled);
+        }
+
+        if (m_frameFeatures.brc != nullptr)
+        {
+            m_frameFeatures.brcEnabled        = m_frameFeatures.brc->IsBRCEnabled();
+            m_frameFeatures.acqpEnabled       = m_frameFeatures.brc->IsACQPEnabled();
+            m_frameFeatures.brcUpdateRequired = m_frameFeatures.brc->IsBRCUpdateRequired();
+            m_frameFeatures.vdenc2ndLevelBatchBuffer =
+                m_frameFeatures.brc->GetVdenc2ndLevelBatchBuffer(m_pipeline->m_currRecycledBufIdx);
+        }
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    MOS_STATUS HevcVdencPktG12::Submit(
+        MOS_COMMAND_BUFFER* commandBuffer,
+        uint8_t packetPhase)
+    {
+        ENCODE_FUNC_CALL();
+
+        ENCODE_CHK_NULL_RETURN(commandBuffer);
+
+        MOS_STATUS status = SubmitPass(*commandBuffer, packetPhase);
+        if (status != MOS_STATUS_SUCCESS)
+        {
+            CancelFrameParallel();
+            ResetSharedPipeBuild();
+        }
+
+        return status;
+    }
+
+    MOS_STATUS HevcVdencPktG12::SubmitPass(MOS_COMMAND_BUFFER &cmdBuffer, uint8_t packetPhase)
+    {
+        ENCODE_FUNC_CALL();
+
+        // Parameters of the previous submission are no longer referenced
+        m_paramArena.Reset();
+
+        ENCODE_CHK_STATUS_RETURN(Mos_Solo_PreProcessEncode(m_osInterface, &m_basicFeature->m_resBitstreamBuffer, &m_basicFeature->m_reconSurface));
+
+        int32_t packetStartOffset = cmdBuffer.iOffset;
+
+        if (m_frameDispatch.seq != 0)
+        {
+            ENCODE_CHK_STATUS_RETURN(SetFrameParallelEngineHint(cmdBuffer));
+        }
+
+        // The command buffer points at the primary buffer again, also when the pass failed
+        MOS_STATUS status         = PatchPassCommands(cmdBuffer, packetPhase);
+        MOS_STATUS overflowStatus = EndCmdOverflow(cmdBuffer, status == MOS_STATUS_SUCCESS);
+        ENCODE_CHK_STATUS_RETURN(status);
+        ENCODE_CHK_STATUS_RETURN(overflowStatus);
+
+        if (m_recycledSlotTracking && m_pipeline->IsLastPass() && m_pipeline->IsLastPipe())
+        {
+            m_recycledSlots.Retire(m_pipeline->m_currRecycledBufIdx, GetSubmissionFence());
+        }
+
+        m_lastSubmissionFence = GetSubmissionFence();
+        m_submissionPending   = true;
+
+        // Every buffer of the packet is programmed by HCP_PIPE_BUF_ADDR_STATE
+        if (m_resourceInventory.IsEnabled())
+        {
+            m_resourceInventory.TouchAll(m_basicFeature->m_frameNum);
+        }
+
+        if (m_cmdSizeCheckEnabled)
+        {
+            CheckCmdSize((uint32_t)(cmdBuffer.iOffset - packetStartOffset) + m_cmdOverflowBytes);
+        }
+
+        // Overflow batch buffers are left as built, the primary buffer ends with the chain to them
+        if (m_cmdPeepholeEnabled)
+        {
+            ENCODE_CHK_STATUS_RETURN(m_cmdPeephole.Run(cmdBuffer, packetStartOffset));
+        }
+
+        ENCODE_CHK_STATUS_RETURN(Mos_Solo_PreProcessEncode(m_osInterface, &m_basicFeature->m_resBitstreamBuffer, &m_basicFeature->m_reconSurface));
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    MOS_STATUS HevcVdencPktG12::PatchPassCommands(MOS_COMMAND_BUFFER &cmdBuffer, uint8_t packetPhase)
+    {
+        ENCODE_FUNC_CALL();
+
+        ENCODE_CHK_STATUS_RETURN(PatchPictureLevelCommands(packetPhase, cmdBuffer));
+
+        if (!m_frameFeatures.tileEnabled)
+        {
+            ENCODE_CHK_STATUS_RETURN(PatchSliceLevelCommands(cmdBuffer, packetPhase));
+        }
+        else
+        {
+            ENCODE_CHK_STATUS_RETURN(PatchTileLevelCommands(cmdBuffer, packetPhase));
+        }
+
+        ENCODE_CHK_STATUS_RETURN(AddFrameParallelSignal(cmdBuffer));
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    MOS_STATUS HevcVdencPktG12::AddSlicesCommands(MOS_COMMAND_BUFFER &cmdBuffer, PMHW_BATCH_BUFFER vdenc2ndLevelBatchBuffer)
+    {
+        ENCODE_FUNC_CALL();
+
+        MHW_VDBOX_HEVC_SLICE_STATE_G12 sliceStateParams;
+        SetHcpSliceStateCommonParams(sliceStateParams);
+
+        // starting location for executing slice level cmds
+        vdenc2ndLevelBatchBuffer->dwOffset = m_hwInterface->m_vdencBatchBuffer1stGroupSize + m_hwInterface->m_vdencBatchBuffer2ndGroupSize;
+
+        PCODEC_ENCODER_SLCDATA slcData = m_basicFeature->m_slcData;
+        for (uint32_t startLcu = 0, slcCount = 0; slcCount < m_basicFeature->m_numSlices; slcCount++)
+        {
+            if (m_pipeline->IsFirstPass())
+            {
+                slcData[slcCount].CmdOffset = startLcu * (m_hcpInterface->GetHcpPakObjSize()) * sizeof(uint32_t);
+            }
+            //TODO:combine below 2 functions
+            SetHcpSliceStateParams(sliceStateParams, slcData, slcCount);
+
+            ENCODE_CHK_STATUS_RETURN(ReserveCmdSpace(cmdBuffer, m_sliceCmdSize));
+
+            uint32_t sliceBatchOffset = vdenc2ndLevelBatchBuffer->dwOffset;
+            ENCODE_CHK_STATUS_RETURN(SendHwSliceEncodeCommand(sliceStateParams, cmdBuffer));
+
+            startLcu += m_hevcSliceParams[slcCount].NumLCUsInSlice;
+
+            m_batchBufferForPakSlicesStartOffset = (uint32_t)m_batchBufferForPakSlices[m_basicFeature->m_currPakSliceIdx].iCurrent;
+            if (m_frameFeatures.acqpEnabled || m_frameFeatures.brcEnabled)
+            {
+                // save offset for next 2nd level batch buffer usage
+                // This is because we don't know how many times HCP_WEIGHTOFFSET_STATE & HCP_PAK_INSERT_OBJECT will be inserted for each slice
+                // dwVdencBatchBufferPerSliceConstSize: constant size for each slice
+                // m_vdencBatchBufferPerSliceVarSize:   variable size for each slice
+                vdenc2ndLevelBatchBuffer->dwOffset += m_hwInterface->m_vdencBatchBufferPerSliceConstSize + m_basicFeature->m_vdencBatchBufferPerSliceVarSize[slcCount];
+            }
+
+            ENCODE_CHK_STATUS_RETURN(WaitVdencDone(cmdBuffer));
+
+            // Any batch start of the slice was added at the offset the slice began with
+            m_passReplay.AddSegments(cmdBuffer, sliceBatchOffset);
+        }
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    MOS_STATUS HevcVdencPktG12::BuildPassReplayCmds(uint32_t passType)
+    {
+        ENCODE_FUNC_CALL();
+
+        m_passReplayCmds.clear();
+        if (!m_passReplay.NeedPassCmds(passType))
+        {
+            return MOS_STATUS_SUCCESS;
+        }
+
+        if (m_passReplayScratch.empty())
+        {
+            m_passReplayScratch.resize(CODECHAL_PAGE_SIZE / sizeof(uint32_t));
+        }
+
+        MHW_VDBOX_HEVC_SLICE_STATE_G12 sliceStateParams;
+        SetHcpSliceStateCommonParams(sliceStateParams);
+
+        PCODEC_ENCODER_SLCDATA slcData = m_basicFeature->m_slcData;
+        for (uint32_t slcCount = 0; slcCount < m_basicFeature->m_numSlices; slcCount++)
+        {
+            SetHcpSliceStateParams(sliceStateParams, slcData, slcCount);
+
+            // HCP_SLICE_STATE has no address, the scratch buffer takes no patch list entry
+            MOS_COMMAND_BUFFER scratch;
+            MOS_ZeroMemory(&scratch, sizeof(scratch));
+            scratch.pCmdBase   = m_passReplayScratch.data();
+            scratch.pCmdPtr    = scratch.pCmdBase;
+            scratch.iRemaining = (int32_t)(m_passReplayScratch.size() * sizeof(uint32_t));
+            ENCODE_CHK_STATUS_RETURN(m_hcpInterface->AddHcpSliceStateCmd(&scratch, &sliceStateParams));
+
+            m_passReplayCmds.insert(m_passReplayCmds.end(), scratch.pCmdBase, scratch.pCmdPtr);
+        }
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    MOS_STATUS HevcVdencPktG12::PatchPictureLevelCommands(const uint8_t &packetPhase, MOS_COMMAND_BUFFER  &cmdBuffer)
+    {
+        ENCODE_FUNC_CALL();
+
+        ENCODE_CHK_STATUS_RETURN(ReserveCmdSpace(cmdBuffer, m_pictureCmdSize));
+
+        ENCODE_CHK_STATUS_RETURN(m_miInterface->SetWatchdogTimerThreshold(m_basicFeature->m_frameWidth, m_basicFeature->m_frameHeight));
+
+        SetPerfTag(CODECHAL_ENCODE_PERFTAG_CALL_PAK_ENGINE, (uint16_t)m_basicFeature->m_mode, m_basicFeature->m_pictureCodingType);
+
+        ENCODE_CHK_NULL_RETURN(m_frameFeatures.brc);
+
+        // Reset multi-pipe sync semaphores
+        auto scalability = m_pipeline->GetMediaScalability();
+        ENCODE_CHK_STATUS_RETURN(scalability->ResetSemaphore(syncOnePipeWaitOthers, 0, &cmdBuffer));
+
+        if ((m_pipeline->IsFirstPass() && !m_frameFeatures.acqpEnabled))
+        {
+            ENCODE_CHK_STATUS_RETURN(AddForceWakeup(cmdBuffer));
+
+            // Send command buffer header at the beginning (OS dependent)
+            ENCODE_CHK_STATUS_RETURN(SendPrologCmds(cmdBuffer));
+        }
+
+        ENCODE_CHK_STATUS_RETURN(AddFrameParallelWaits(cmdBuffer));
+
+        if (m_pipeline->IsFirstPipe())
+        {
+            ENCODE_CHK_STATUS_RETURN(StartStatusReport(statusReportMfx, &cmdBuffer));
+        }
+
+        ENCODE_CHK_STATUS_RETURN(AddPictureHcpCommands(cmdBuffer));
+
+        ENCODE_CHK_STATUS_RETURN(AddPictureVdencCommands(cmdBuffer));
+
+        ENCODE_CHK_STATUS_RETURN(AddPicStateWithNoTile(cmdBuffer));
+        return MOS_STATUS_SUCCESS;
+    }
+
+    MOS_STATUS HevcVdencPktG12::PatchSliceLevelCommands(MOS_COMMAND_BUFFER  &cmdBuffer, uint8_t packetPhase)
+    {
+        ENCODE_FUNC_CALL();
+
+        if (m_hevcPicParams->tiles_enabled_flag)
+        {
+            return MOS_STATUS_SUCCESS;
+        }
+
+        auto vdenc2ndLevelBatchBuffer = m_frameFeatures.vdenc2ndLevelBatchBuffer;
+        ENCODE_CHK_NULL_RETURN(vdenc2ndLevelBatchBuffer);
+
+        // PAK slice batch buffers move on with each pass, so such frames are always built in full
+        uint32_t passType         = m_pakOnlyPass ? 1 : 0;
+        bool     passReplayActive = m_passReplayEnabled && !m_useBatchBufferForPakSlices;
+        bool     pakSliceRing     = m_pakSliceBatchRingEnabled && m_useBatchBufferForPakSlices;
+
+        // Recorded and replayed regions have to be in one buffer, a region which continued
+        // in an overflow batch buffer is not used
+        if (passReplayActive)
+        {
+            ENCODE_CHK_STATUS_RETURN(ReserveCmdSpace(cmdBuffer, m_basicFeature->m_numSlices * m_sliceCmdSize));
+        }
+        uint32_t *slicesCmdBase = cmdBuffer.pCmdBase;
+
+        // The values of the pass dependent dwords come from the pass commands of this frame
+        bool replay = passReplayActive && !m_pipeline->IsFirstPass() && m_passReplay.CanReplay(passType);
+        if (replay)
+        {
+            ENCODE_CHK_STATUS_RETURN(BuildPassReplayCmds(passType));
+            replay = m_passReplay.SetPassCmds(passType, m_passReplayCmds);
+        }
+
+        if (pakSliceRing)
+        {
+            // The PAK slice batch is put back also when a slice fails
+            if (m_pipeline->IsFirstPass())
+            {
+                m_passReplay.DiscardRecord();
+            }
+            ENCODE_CHK_STATUS_RETURN(BeginPakSliceBatch());
+            MOS_STATUS status = AddSlicesCommands(cmdBuffer, vdenc2ndLevelBatchBuffer);
+            ENCODE_CHK_STATUS_RETURN(EndPakSliceBatch(status == MOS_STATUS_SUCCESS));
+            ENCODE_CHK_STATUS_RETURN(status);
+        }
+        else if (replay)
+        {
+            ENCODE_CHK_STATUS_RETURN(ReserveCmdSpace(cmdBuffer, m_passReplay.GetRegionSize()));
+            ENCODE_CHK_STATUS_RETURN(m_passReplay.Replay(cmdBuffer, passType, m_miInterface, vdenc2ndLevelBatchBuffer));
+            m_batchBufferForPakSlicesStartOffset = (uint32_t)m_batchBufferForPakSlices[m_basicFeature->m_currPakSliceIdx].iCurrent;
+        }
+        else if (passReplayActive && m_pipeline->IsFirstPass())
+        {
+            // The patch list is watched until EndRecord(), also when a slice fails
+            m_passReplay.BeginRecord(m_osInterface, cmdBuffer);
+            MOS_STATUS status = AddSlicesCommands(cmdBuffer, vdenc2ndLevelBatchBuffer);
+            m_passReplay.EndRecord(cmdBuffer, vdenc2ndLevelBatchBuffer->dwOffset);
+            ENCODE_CHK_STATUS_RETURN(status);
+            if (cmdBuffer.pCmdBase != slicesCmdBase)
+            {
+                m_passReplay.DiscardRecord();
+            }
+        }
+        else if (passReplayActive && m_passReplay.NeedLearn(passType))
+        {
+            m_passReplay.BeginLearn(cmdBuffer);
+            ENCODE_CHK_STATUS_RETURN(AddSlicesCommands(cmdBuffer, vdenc2ndLevelBatchBuffer));
+            if (cmdBuffer.pCmdBase == slicesCmdBase)
+            {
+                ENCODE_CHK_STATUS_RETURN(BuildPassReplayCmds(passType));
+                m_passReplay.EndLearn(cmdBuffer, passType, m_passReplayCmds);
+            }
+        }
+        else
+        {
+            if (m_pipeline->IsFirstPass())
+            {
+                m_passReplay.DiscardRecord();
+            }
+            ENCODE_CHK_STATUS_RETURN(AddSlicesCommands(cmdBuffer, vdenc2ndLevelBatchBuffer));
+        }
+
+        if (m_useBatchBufferForPakSlices && !pakSliceRing)
+        {
+            ENCODE_CHK_STATUS_RETURN(Mhw_UnlockBb(
+                m_osInterface,
+                &m_batchBufferForPakSlices[m_basicFeature->m_currPakSliceIdx],
+                m_lastTaskInPhase));
+        }
+
+        ENCODE_CHK_STATUS_RETURN(ReserveCmdSpace(cmdBuffer, m_tailCmdSize));
+
+        // Insert end of sequence/stream if set
+        if (m_basicFeature->m_lastPicInSeq || m_basicFeature->m_lastPicInStream)
+        {
+            ENCODE_CHK_STATUS_RETURN(InsertSeqStreamEnd(cmdBuffer));
+        }
+        //TODO: combine below 3 functions
+        ENCODE_CHK_STATUS_RETURN(EnsureAllCommandsExecuted(cmdBuffer));
+
+        ENCODE_CHK_STATUS_RETURN(WaitHevcDone(cmdBuffer));
+
+        ENCODE_CHK_STATUS_RETURN(EnsureAllCommandsExecuted(cmdBuffer));
+
+        ENCODE_CHK_STATUS_RETURN(ReadSseStatistics(cmdBuffer));
+        ENCODE_CHK_STATUS_RETURN(ReadSliceSize(cmdBuffer));
+
+        ENCODE_CHK_STATUS_RETURN(EndStatusReport(statusReportMfx, &cmdBuffer));
+
+        if (m_pipeline->IsLastPass() && m_pipeline->IsFirstPipe())
+        {
+            ENCODE_CHK_STATUS_RETURN(UpdateStatusReport(statusReportGlobalCount, &cmdBuffer));
+        }
+
+        // Reset parameters for next PAK execution
+        if (false == m_pipeline->IsFrameTrackingEnabled() && m_pipeline->IsLastPass() && m_pipeline->IsLastPipe())
+        {
+            UpdateParameters();
+        }
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    uint32_t HevcVdencPktG12::GetSubmissionFence()
+    {
+        // The status tag the GPU writes when the current submission completes
+        return m_osInterface->pfnGetGpuStatusTag(m_osInterface, m_osInterface->CurrentGpuContextOrdinal);
+    }
+
+    uint32_t HevcVdencPktG12::GetCompletedFence()
+    {
+        return m_osInterface->pfnGetGpuStatusSyncTag(m_osInterface, m_osInterface->CurrentGpuContextOrdinal);
+    }
+
+    MOS_STATUS HevcVdencPktG12::WaitForSubmissions()
+    {
+        ENCODE_FUNC_CALL();
+
+        if (!m_submissionPending)
+        {
+            return MOS_STATUS_SUCCESS;
+        }
+
+        uint64_t waitedUs = 0;
+        ENCODE_CHK_STATUS_RETURN(EncodeFenceWait::Wait(
+            [this]() { return GetCompletedFence(); },
+            m_lastSubmissionFence,
+            m_submissionWaitTimeoutUs,
+            waitedUs));
+        m_submissionPending = false;
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    MOS_STATUS HevcVdencPktG12::SetRecycledSlotTracking(bool enable)
+    {
+        ENCODE_FUNC_CALL();
+
+        m_recycledSlotTracking = enable;
+        if (enable)
+        {
+            m_recycledSlots.SetFenceQuery([this]() { return GetCompletedFence(); });
+        }
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    MOS_STATUS HevcVdencPktG12::SetTileRowSync(bool enable)
+    {
+        ENCODE_FUNC_CALL();
+
+        if (enable && m_tileRowSyncBuffer == nullptr)
+        {
+            ENCODE_CHK_NULL_RETURN(m_allocator);
+
+            MOS_ALLOC_GFXRES_PARAMS allocParams;
+            MOS_ZeroMemory(&allocParams, sizeof(allocParams));
+            allocParams.Type     = MOS_GFXRES_BUFFER;
+            allocParams.TileType = MOS_TILE_LINEAR;
+            allocParams.Format   = Format_Buffer;
+            allocParams.dwBytes  = (m_maxTileRows + 1) * m_maxNumPipes * CODECHAL_CACHELINE_SIZE;
+            allocParams.pBufName = "TileRowSyncBuffer";
+
+            // Zeroed, so the first frame finds nothing to wait for
+            m_tileRowSyncBuffer = m_allocator->AllocateResource(allocParams, true);
+            ENCODE_CHK_NULL_RETURN(m_tileRowSyncBuffer);
+            m_resourceInventory.Add(m_tileRowSyncBuffer, allocParams, false);
+        }
+
+        m_tileRowSyncEnabled = enable;
+        m_tileRowSyncPrevSeq = 0;
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    bool HevcVdencPktG12::IsTileRowSyncActive() const
+    {
+        return m_tileRowSyncEnabled &&
+               m_tileRowSyncBuffer != nullptr &&
+               m_frameFeatures.tileEnabled &&
+               m_pipeline->GetPipeNum() > 1;
+    }
+
+    uint32_t HevcVdencPktG12::GetTileRowSyncSeq() const
+    {
+        return m_basicFeature->m_frameNum + 1;
+    }
+
+    uint32_t HevcVdencPktG12::GetTileRowSyncGrid(uint32_t numTileRows) const
+    {
+        return (numTileRows << 8) | (m_pipeline->GetPipeNum() & 0xff);
+    }
+
+    MOS_STATUS HevcVdencPktG12::AddTileRowSyncWaits(
+        MOS_COMMAND_BUFFER &cmdBuffer,
+        uint32_t            row,
+        uint32_t            numPipes,
+        uint32_t            seq,
+        uint32_t            pipe)
+    {
+        ENCODE_FUNC_CALL();
+
+        ENCODE_CHK_COND_RETURN(row > m_maxTileRows || numPipes > m_maxNumPipes, "Tile row sync slot is out of range");
+
+        MHW_MI_SEMAPHORE_WAIT_PARAMS semaphoreParams;
+        for (uint32_t otherPipe = 0; otherPipe < numPipes; otherPipe++)
+        {
+            // A pipe runs its own frames in order
+            if (otherPipe == pipe)
+            {
+                continue;
+            }
+
+            MOS_ZeroMemory(&semaphoreParams, sizeof(semaphoreParams));
+            semaphoreParams.presSemaphoreMem   = m_tileRowSyncBuffer;
+            semaphoreParams.dwResourceOffset   = GetTileRowSyncOffset(row, otherPipe);
+            semaphoreParams.bPollingWaitMode   = true;
+            semaphoreParams.dwSemaphoreData    = seq;
+            semaphoreParams.dwCompareOperation = MHW_MI_SAD_GREATER_THAN_OR_EQUAL_SDD;
+            ENCODE_CHK_STATUS_RETURN(m_miInterface->AddMiSemaphoreWaitCmd(&cmdBuffer, &semaphoreParams));
+        }
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    MOS_STATUS HevcVdencPktG12::AddTileRowWait(
+        MOS_COMMAND_BUFFER &cmdBuffer,
+        uint32_t            tileRow,
+        uint32_t            numTileRows,
+        uint32_t            pipe)
+    {
+        ENCODE_FUNC_CALL();
+
+        // Later passes follow the first one on the same pipe
+        if (!IsTileRowSyncActive() || !m_pipeline->IsFirstPass())
+        {
+            return MOS_STATUS_SUCCESS;
+        }
+
+        // The previous frame either waited for all the pipes or was never submitted
+        uint32_t prevSeq = m_tileRowSyncPrevSeq;
+        if (prevSeq == 0 || prevSeq + 1 != GetTileRowSyncSeq())
+        {
+            return MOS_STATUS_SUCCESS;
+        }
+
+        if (m_tileRowSyncPrevGrid != GetTileRowSyncGrid(numTileRows))
+        {
+            // Rows of another grid do not match, the first row waits for the whole frame
+            if (tileRow == 0)
+            {
+                uint32_t prevPipes = m_tileRowSyncPrevGrid & 0xff;
+                ENCODE_CHK_STATUS_RETURN(AddTileRowSyncWaits(
+                    cmdBuffer, m_maxTileRows, MOS_MAX(prevPipes, (uint32_t)m_pipeline->GetPipeNum()), prevSeq, pipe));
+            }
+            return MOS_STATUS_SUCCESS;
+        }
+
+        // Motion search reads the reference below the tile row, up to the margin
+        auto    &lcuRowToTileRow = m_sliceTileMap.lcuRowToTileRow;
+        uint32_t lcuSize         = 1 << (m_hevcSeqParams->log2_max_coding_block_size_minus3 + 3);
+        uint32_t marginInLcu     = MOS_ROUNDUP_DIVIDE(m_tileRowSyncMarginInPixels, lcuSize);
+        ENCODE_CHK_COND_RETURN(lcuRowToTileRow.empty(), "Slice to tile map is not built");
+
+        auto getDepRow = [&](uint32_t row) {
+            uint32_t lastLcuRow = 0;
+            for (uint32_t y = 0; y < lcuRowToTileRow.size(); y++)
+            {
+                lastLcuRow = (lcuRowToTileRow[y] == row) ? y : lastLcuRow;
+            }
+            return lcuRowToTileRow[MOS_MIN(lastLcuRow + marginInLcu, (uint32_t)lcuRowToTileRow.size() - 1)];
+        };
+
+        // Rows up to the dependency of the row above are already waited for
+        uint32_t depRow = getDepRow(tileRow);
+        if (tileRow > 0 && getDepRow(tileRow - 1) >= depRow)
+        {
+            return MOS_STATUS_SUCCESS;
+        }
+
+        return AddTileRowSyncWaits(cmdBuffer, depRow, m_pipeline->GetPipeNum(), prevSeq, pipe);
+    }
+
+    MOS_STATUS HevcVdencPktG12::AddTileRowSignal(MOS_COMMAND_BUFFER &cmdBuffer, uint32_t row, uint32_t pipe)
+    {
+        ENCODE_FUNC_CALL();
+
+        // Only the last pass leaves the final reconstructed rows
+        if (!IsTileRowSyncActive() || !m_pipeline->IsLastPass())
+        {
+            return MOS_STATUS_SUCCESS;
+        }
+
+        ENCODE_CHK_COND_RETURN(row > m_maxTileRows, "Tile row sync slot is out of range");
+
+        // Post sync write of the flush lands after the writes of the tile row
+        MHW_MI_FLUSH_DW_PARAMS flushDwParams;
+        MOS_ZeroMemory(&flushDwParams, sizeof(flushDwParams));
+        flushDwParams.pOsResource      = m_tileRowSyncBuffer;
+        flushDwParams.dwResourceOffset = GetTileRowSyncOffset(row, pipe);
+        flushDwParams.dwDataDW1        = GetTileRowSyncSeq();
+        ENCODE_CHK_STATUS_RETURN(m_miInterface->AddMiFlushDwCmd(&cmdBuffer, &flushDwParams));
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    MOS_STATUS HevcVdencPktG12::SetFrameParallel(EncodeFrameDependencyTracker *tracker, uint32_t engine)
+    {
+        ENCODE_FUNC_CALL();
+
+        if (tracker != nullptr)
+        {
+            ENCODE_CHK_COND_RETURN(engine >= tracker->GetNumEngines(), "Engine %d is out of range", engine);
+            ENCODE_CHK_STATUS_RETURN(tracker->Init(m_osInterface));
+        }
+
+        m_frameParallelTracker = tracker;
+        m_frameParallelEngine  = engine;
+        m_frameDispatch        = {};
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    bool HevcVdencPktG12::IsFrameParallelActive() const
+    {
+        return m_frameParallelTracker != nullptr &&
+               m_pipeline->GetPipeNum() <= 1;
+    }
+
+    MOS_STATUS HevcVdencPktG12::DispatchFrameParallel()
+    {
+        ENCODE_FUNC_CALL();
+
+        ENCODE_CHK_NULL_RETURN(m_hevcPicParams);
+        ENCODE_CHK_NULL_RETURN(m_hevcSliceParams);
+
+        // Only the references the slices use, the DPB may keep frames for later pictures
+        bool used[CODEC_MAX_NUM_REF_FRAME_HEVC] = {};
+        for (uint32_t slcCount = 0; slcCount < m_basicFeature->m_numSlices; slcCount++)
+        {
+            auto    &slcParams = m_hevcSliceParams[slcCount];
+            uint32_t numRefs[2] = {};
+            if (slcParams.slice_type != encodeHevcISlice)
+            {
+                numRefs[0] = slcParams.num_ref_idx_l0_active_minus1 + 1;
+            }
+            if (slcParams.slice_type == encodeHevcBSlice)
+            {
+                numRefs[1] = slcParams.num_ref_idx_l1_active_minus1 + 1;
+            }
+
+            for (uint32_t list = 0; list < 2; list++)
+            {
+                for (uint32_t i = 0; i < MOS_MIN(numRefs[list], (uint32_t)CODEC_MAX_NUM_REF_FRAME_HEVC); i++)
+                {
+                    auto refIdx = slcParams.RefPicList[list][i].FrameIdx;
+                    if (!CodecHal_PictureIsInvalid(slcParams.RefPicList[list][i]) && refIdx < CODEC_MAX_NUM_REF_FRAME_HEVC)
+                    {
+                        used[refIdx] = true;
+                    }
+                }
+            }
+        }
+
+        uint8_t  refs[CODEC_MAX_NUM_REF_FRAME_HEVC];
+        uint32_t numRefs = 0;
+        for (auto i = 0; i < CODEC_MAX_NUM_REF_FRAME_HEVC; i++)
+        {
+            if (used[i] && !CodecHal_PictureIsInvalid(m_hevcPicParams->RefFrameList[i]))
+            {
+                refs[numRefs++] = m_hevcPicParams->RefFrameList[i].FrameIdx;
+            }
+        }
+
+        // The BRC update reads the statistics of the previous frame
+        return m_frameParallelTracker->Dispatch(
+            m_frameParallelEngine,
+            m_hevcPicParams->CurrReconstructedPic.FrameIdx,
+            refs,
+            numRefs,
+            m_frameFeatures.brcEnabled,
+            m_frameDispatch);
+    }
+
+    void HevcVdencPktG12::CancelFrameParallel()
+    {
+        ENCODE_FUNC_CALL();
+
+        if (m_frameDispatch.seq == 0)
+        {
+            return;
+        }
+
+        // Frames waiting for a sequence number which is never signaled would hang
+        if (m_frameParallelTracker->Cancel(m_frameDispatch) != MOS_STATUS_SUCCESS)
+        {
+            ENCODE_ASSERTMESSAGE("Failed frame %d of engine %d could not be canceled", m_frameDispatch.seq, m_frameDispatch.engine);
+        }
+        m_frameDispatch = {};
+    }
+
+    MOS_STATUS HevcVdencPktG12::SetFrameParallelEngineHint(MOS_COMMAND_BUFFER &cmdBuffer)
+    {
+        ENCODE_FUNC_CALL();
+
+        // Without virtual engine the OS picks the engine, the waits still hold
+        MOS_CMD_BUF_ATTRI_VE *attriVe = (MOS_CMD_BUF_ATTRI_VE *)cmdBuffer.Attributes.pAttriVe;
+        if (attriVe == nullptr)
+        {
+            return MOS_STATUS_SUCCESS;
+        }
+
+        attriVe->bUseVirtualEngineHint               = true;
+        attriVe->VEngineHintParams.BatchBufferCount  = 1;
+        attriVe->VEngineHintParams.EngineInstance[0] = (uint8_t)m_frameDispatch.engine;
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    MOS_STATUS HevcVdencPktG12::AddFrameParallelWaits(MOS_COMMAND_BUFFER &cmdBuffer)
+    {
+        ENCODE_FUNC_CALL();
+
+        // Later passes follow the first one on the same engine
+        if (m_frameDispatch.seq == 0 || !m_pipeline->IsFirstPass())
+        {
+            return MOS_STATUS_SUCCESS;
+        }
+
+        MHW_MI_SEMAPHORE_WAIT_PARAMS semaphoreParams;
+        for (uint32_t engine = 0; engine < m_frameParallelTracker->GetNumEngines(); engine++)
+        {
+            if (m_frameDispatch.waitSeq[engine] == 0)
+            {
+                continue;
+            }
+
+            MOS_ZeroMemory(&semaphoreParams, sizeof(semaphoreParams));
+            semaphoreParams.presSemaphoreMem   = m_frameParallelTracker->GetSyncBuffer();
+            semaphoreParams.dwResourceOffset   = EncodeFrameDependencyTracker::GetSyncOffset(engine);
+            semaphoreParams.bPollingWaitMode   = true;
+            semaphoreParams.dwSemaphoreData    = m_frameDispatch.waitSeq[engine];
+            semaphoreParams.dwCompareOperation = MHW_MI_SAD_GREATER_THAN_OR_EQUAL_SDD;
+            ENCODE_CHK_STATUS_RETURN(m_miInterface->AddMiSemaphoreWaitCmd(&cmdBuffer, &semaphoreParams));
+        }
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    MOS_STATUS HevcVdencPktG12::AddFrameParallelSignal(MOS_COMMAND_BUFFER &cmdBuffer)
+    {
+        ENCODE_FUNC_CALL();
+
+        // Only the last pass leaves the final reconstructed frame
+        if (m_frameDispatch.seq == 0 || !m_pipeline->IsLastPass())
+        {
+            return MOS_STATUS_SUCCESS;
+        }
+
+        MHW_MI_FLUSH_DW_PARAMS flushDwParams;
+        MOS_ZeroMemory(&flushDwParams, sizeof(flushDwParams));
+        flushDwParams.pOsResource      = m_frameParallelTracker->GetSyncBuffer();
+        flushDwParams.dwResourceOffset = EncodeFrameDependencyTracker::GetSyncOffset(m_frameDispatch.engine);
+        flushDwParams.dwDataDW1        = m_frameDispatch.seq;
+        ENCODE_CHK_STATUS_RETURN(m_miInterface->AddMiFlushDwCmd(&cmdBuffer, &flushDwParams));
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    MOS_STATUS HevcVdencPktG12::BeginPakSliceBatch()
+    {
+        ENCODE_FUNC_CALL();
+
+        auto &pakSliceBatch = m_batchBufferForPakSlices[m_basicFeature->m_currPakSliceIdx];
+
+        // All the passes of a frame write the same buffer
+        if (m_pakSliceRingBatch == nullptr)
+        {
+            ENCODE_CHK_STATUS_RETURN(m_pakSliceBatchRing.Acquire(
+                m_osInterface,
+                pakSliceBatch.iSize,
+                GetCompletedFence(),
+                m_pakSliceRingBatch));
+        }
+
+        // The base packet maps the PAK slice batch for each pass. The ring keeps its own
+        // buffer mapped, the PAK slice batch is never submitted and is unmapped at once.
+        if (pakSliceBatch.bLocked)
+        {
+            ENCODE_CHK_STATUS_RETURN(Mhw_UnlockBb(m_osInterface, &pakSliceBatch, false));
+        }
+
+        m_pakSliceBatchSaved = pakSliceBatch;
+        pakSliceBatch        = *m_pakSliceRingBatch;
+
+        // Later passes append to the commands of the earlier ones
+        m_batchBufferForPakSlicesStartOffset = (uint32_t)pakSliceBatch.iCurrent;
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    MOS_STATUS HevcVdencPktG12::EndPakSliceBatch(bool submitted)
+    {
+        ENCODE_FUNC_CALL();
+
+        ENCODE_CHK_NULL_RETURN(m_pakSliceRingBatch);
+
+        auto &pakSliceBatch  = m_batchBufferForPakSlices[m_basicFeature->m_currPakSliceIdx];
+        *m_pakSliceRingBatch = pakSliceBatch;
+        pakSliceBatch        = m_pakSliceBatchSaved;
+
+        // A failed frame is not submitted, its buffer can be handed out again at once
+        if (!submitted)
+        {
+            m_pakSliceBatchRing.Retire(m_pakSliceRingBatch, GetCompletedFence());
+            m_pakSliceRingBatch = nullptr;
+        }
+        else if (m_pipeline->IsLastPass() && m_pipeline->IsLastPipe())
+        {
+            m_pakSliceBatchRing.Retire(m_pakSliceRingBatch, GetSubmissionFence());
+            m_pakSliceRingBatch = nullptr;
+        }
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    MOS_STATUS HevcVdencPktG12::Construct3rdLevelBatch()
+    {
+        ENCODE_FUNC_CALL();
+
+        MOS_STATUS eStatus = MOS_STATUS_SUCCESS;
+
+        MHW_VDBOX_HEVC_PIC_STATE_G12 picStateParams;
+        SetHcpPicStateParams(picStateParams);
+
+        // Begin patching 3rd level batch cmds
+        MOS_COMMAND_BUFFER constructedCmdBuf;
+        RUN_FRAME_FEATURE_INTERFACE(tile, BeginPatch3rdLevelBatch, constructedCmdBuf);
+
+        PMHW_BATCH_BUFFER thirdLevelBatchBuffer = nullptr;
+        uint64_t          picBatchHash          = 0;
+        bool              reuse                 = false;
+        if (IsBatchReuseActive())
+        {
+            RUN_FRAME_FEATURE_INTERFACE(tile, GetThirdLevelBatchBuffer, thirdLevelBatchBuffer);
+            ENCODE_CHK_NULL_RETURN(thirdLevelBatchBuffer);
+
+            picBatchHash = GetPicBatchHash(picStateParams);
+            auto built   = m_batchContentHashes.find(thirdLevelBatchBuffer);
+            reuse        = (built != m_batchContentHashes.end()) && (built->second == picBatchHash);
+            if (reuse)
+            {
+                m_batchReuseStats.thirdLevelHits++;
+            }
+            else
+            {
+                // Content is undefined until the batch is completed below
+                m_batchContentHashes.erase(thirdLevelBatchBuffer);
+                m_batchReuseStats.thirdLevelMisses++;
+            }
+        }
+
+        if (!reuse)
+        {
+            ENCODE_CHK_STATUS_RETURN(AddVdencCmd1Cmd(&constructedCmdBuf, true, m_basicFeature->m_ref.IsLowDelay()));
+
+            ENCODE_CHK_STATUS_RETURN(m_hcpInterface->AddHcpPicStateCmd(&constructedCmdBuf, &picStateParams));
+
+            ENCODE_CHK_STATUS_RETURN(AddVdencCmd2Cmd(&constructedCmdBuf, true, m_basicFeature->m_ref.IsLowDelay()));
+
+            // set MI_BATCH_BUFFER_END command
+            ENCODE_CHK_STATUS_RETURN(m_miInterface->AddMiBatchBufferEnd(&constructedCmdBuf, nullptr));
+        }
+
+        // End patching 3rd level batch cmds
+        RUN_FRAME_FEATURE_INTERFACE(tile, EndPatch3rdLevelBatch);
+
+        if (thirdLevelBatchBuffer != nullptr && !reuse)
+        {
+            m_batchContentHashes[thirdLevelBatchBuffer] = picBatchHash;
+        }
+
+        return eStatus;
+    }
+
+    uint64_t HevcVdencPktG12::GetPicBatchHash(const MHW_VDBOX_HEVC_PIC_STATE_G12 &picStateParams)
+    {
+        ENCODE_FUNC_CALL();
+
+        EncodeContentHash hash;
+
+        // The params point to the DDI params, their content is hashed instead of the pointers
+        const CODEC_HEVC_ENCODE_PICTURE_PARAMS  *ddiPicParams = picStateParams.pHevcEncPicParams ? picStateParams.pHevcEncPicParams : m_hevcPicParams;
+        const CODEC_HEVC_ENCODE_SEQUENCE_PARAMS *ddiSeqParams = picStateParams.pHevcEncSeqParams ? picStateParams.pHevcEncSeqParams : m_hevcSeqParams;
+
+        // Surfaces are programmed by the primary buffer, the commands of the batch only see
+        // the reference slots and the POC distances
+        CODEC_HEVC_ENCODE_PICTURE_PARAMS picParams = *ddiPicParams;
+        picParams.StatusReportFeedbackNumber    = 0;
+        picParams.CurrOriginalPic.FrameIdx      = 0;
+        picParams.CurrReconstructedPic.FrameIdx = 0;
+        for (auto i = 0; i < CODEC_MAX_NUM_REF_FRAME_HEVC; i++)
+        {
+            picParams.RefFrameList[i].FrameIdx = 0;
+            picParams.RefFramePOCList[i] -= picParams.CurrPicOrderCnt;
+        }
+        picParams.CurrPicOrderCnt = 0;
+        hash.Add(picParams);
+        hash.Add(*ddiSeqParams);
+
+        // VDENC CMD1 and CMD2 read the first slice
+        hash.Add(m_hevcSliceParams[0]);
+        hash.Add(m_basicFeature->m_ref.GetRefIdxMapping(), CODEC_MAX_NUM_REF_FRAME_HEVC * sizeof(*m_basicFeature->m_ref.GetRefIdxMapping()));
+        hash.Add(m_basicFeature->m_ref.IsLowDelay());
+        hash.Add(m_pakOnlyPass);
+        hash.Add(m_streamInEnabled);
+
+        // Fields are hashed one by one, the params hold pointers and padding
+        hash.Add((uint32_t)picStateParams.Mode);
+        hash.Add((uint32_t)picStateParams.bSAOEnable);
+        hash.Add((uint32_t)picStateParams.bNotFirstPass);
+        hash.Add((uint32_t)picStateParams.bHevcRdoqEnabled);
+        hash.Add((uint32_t)picStateParams.bUseVDEnc);
+        hash.Add((uint32_t)picStateParams.sseEnabledInVmeEncode);
+        hash.Add((uint32_t)picStateParams.bRDOQIntraTUDisable);
+        hash.Add((uint32_t)picStateParams.wRDOQIntraTUThreshold);
+        hash.Add((uint32_t)picStateParams.bTransformSkipEnable);
+        hash.Add((uint32_t)picStateParams.ucRecNotFilteredID);
+        hash.Add((uint32_t)picStateParams.IBCControl);
+        hash.Add((uint32_t)picStateParams.PartialFrameUpdateEnable);
+
+        return hash.Get();
+    }
+
+    uint64_t HevcVdencPktG12::GetFrameBatchHash()
+    {
+        ENCODE_FUNC_CALL();
+
+        EncodeContentHash hash;
+        uint32_t          numSlices = m_basicFeature->m_numSlices;
+        PCODEC_ENCODER_SLCDATA slcData = m_basicFeature->m_slcData;
+
+        hash.Add(*m_hevcSeqParams);
+        hash.Add(*m_hevcPicParams);
+        hash.Add(m_hevcSliceParams, numSlices * sizeof(m_hevcSliceParams[0]));
+        hash.Add(slcData, numSlices * sizeof(slcData[0]));
+        hash.Add(m_roundingIntra);
+        hash.Add(m_roundingInter);
+
+        // Packed headers are inserted by the slice commands, they precede the last slice header
+        BSBuffer &bsBuffer  = m_basicFeature->m_bsBuffer;
+        uint32_t  headerEnd = 0;
+        for (uint32_t slcCount = 0; slcCount < numSlices; slcCount++)
+        {
+            headerEnd = MOS_MAX(headerEnd, slcData[slcCount].SliceOffset + MOS_ROUNDUP_DIVIDE(slcData[slcCount].BitSize, 8));
+        }
+        if (bsBuffer.pBase != nullptr)
+        {
+            hash.Add(bsBuffer.pBase, MOS_MIN(headerEnd, bsBuffer.BufferSize));
+        }
+
+        return hash.Get();
+    }
+
+    bool HevcVdencPktG12::IsBatchReuseActive() const
+    {
+        // PAK slice batch buffer is appended per frame, so the tile batches start it at another offset
+        return m_batchReuseEnabled &&
+               m_frameFeatures.tileEnabled &&
+               !m_frameFeatures.roiEnabled &&
+               !m_useBatchBufferForPakSlices;
+    }
+
+    MOS_STATUS HevcVdencPktG12::CheckTileBatchReuse(HevcVdencTileBatchContextG12 &tileCtx)
+    {
+        ENCODE_FUNC_CALL();
+
+        tileCtx.reuse       = false;
+        tileCtx.contentHash = 0;
+
+        if (!IsBatchReuseActive())
+        {
+            return MOS_STATUS_SUCCESS;
+        }
+        ENCODE_CHK_NULL_RETURN(tileCtx.batchBuffer);
+
+        PMHW_BATCH_BUFFER picStateBatch = m_frameFeatures.vdenc2ndLevelBatchBuffer;
+        if (!m_frameFeatures.brcUpdateRequired)
+        {
+            RUN_FRAME_FEATURE_INTERFACE(tile, GetThirdLevelBatchBuffer, picStateBatch);
+        }
+        ENCODE_CHK_NULL_RETURN(picStateBatch);
+
+        EncodeContentHash hash;
+        hash.Add(m_frameBatchHash);
+        hash.Add(m_pipeline->GetCurrentPass());
+        hash.Add(m_pipeline->GetNumPipes());
+        hash.Add(m_frameFeatures.brcUpdateRequired);
+        hash.Add(m_frameFeatures.vdenc2ndLevelBatchBuffer);
+        hash.Add(picStateBatch);
+        auto picStateBuilt = m_batchContentHashes.find(picStateBatch);
+        hash.Add(picStateBuilt != m_batchContentHashes.end() ? picStateBuilt->second : 0);
+        hash.Add(tileCtx.pipeModeSelectParams);
+        hash.Add(tileCtx.tileCodingParams);
+        hash.Add(tileCtx.sliceStates.data(), tileCtx.sliceStates.size() * sizeof(tileCtx.sliceStates[0]));
+        tileCtx.contentHash = hash.Get();
+
+        auto built    = m_batchContentHashes.find(tileCtx.batchBuffer);
+        tileCtx.reuse = (built != m_batchContentHashes.end()) && (built->second == tileCtx.contentHash);
+        if (!tileCtx.reuse)
+        {
+            // Content is undefined until FinishOneTileBatch()
+            m_batchContentHashes.erase(tileCtx.batchBuffer);
+            m_batchReuseStats.tileMisses++;
+            return MOS_STATUS_SUCCESS;
+        }
+
+        // The kept batch starts these batches, they are not registered by building it
+        ENCODE_CHK_STATUS_RETURN(m_osInterface->pfnRegisterResource(
+            m_osInterface, &picStateBatch->OsResource, false, false));
+        if (m_frameFeatures.vdenc2ndLevelBatchBuffer != nullptr && m_frameFeatures.vdenc2ndLevelBatchBuffer != picStateBatch)
+        {
+            ENCODE_CHK_STATUS_RETURN(m_osInterface->pfnRegisterResource(
+                m_osInterface, &m_frameFeatures.vdenc2ndLevelBatchBuffer->OsResource, false, false));
+        }
+        m_batchReuseStats.tileHits++;
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    void HevcVdencPktG12::SetBatchReuse(bool enable)
+    {
+        m_batchReuseEnabled = enable;
+        m_batchContentHashes.clear();
+    }
+
+    MOS_STATUS HevcVdencPktG12::PrepareSlicesInTile(
+        HevcVdencTileBatchContextG12 &tileCtx)
+    {
+        ENCODE_FUNC_CALL();
+
+        PCODEC_ENCODER_SLCDATA         slcData = m_basicFeature->m_slcData;
+        MHW_VDBOX_HEVC_SLICE_STATE_G12 sliceState;
+        SetHcpSliceStateCommonParams(sliceState);
+
+        // clear() keeps the capacity, so no allocation once the tile states warmed up
+        tileCtx.sliceStates.clear();
+
+        uint32_t tileIdx = tileCtx.tileRow * m_sliceTileMap.numTileColumns + tileCtx.tileCol;
+        ENCODE_CHK_COND_RETURN(tileIdx + 1 >= m_sliceTileMap.tileSliceOffsets.size(),
+            "Slice to tile map is not built for the tile");
+
+        for (uint32_t i = m_sliceTileMap.tileSliceOffsets[tileIdx]; i < m_sliceTileMap.tileSliceOffsets[tileIdx + 1]; i++)
+        {
+            uint32_t slcCount = m_sliceTileMap.tileSlices[i];
+
+            ENCODE_CHK_STATUS_RETURN(SetHcpSliceStateParamsInTile(
+                sliceState, slcData, (uint16_t)slcCount, m_sliceTileMap.sliceLastInTile[slcCount] != 0));
+            tileCtx.sliceStates.push_back(sliceState);
+        }  // end of slice
+
+        if (tileCtx.sliceStates.empty())
+        {
+            // One tile must have at least one slice
+            ENCODE_ASSERT(false);
+            return MOS_STATUS_INVALID_PARAMETER;
+        }
+        return MOS_STATUS_SUCCESS;
+    }
+
+    MOS_STATUS HevcVdencPktG12::AddSlicesCommandsInTile(
+        MOS_COMMAND_BUFFER           &cmdBuffer,
+        HevcVdencTileBatchContextG12 &tileCtx)
+    {
+        ENCODE_FUNC_CALL();
+
+        for (uint32_t i = 0; i < tileCtx.sliceStates.size(); i++)
+        {
+            ENCODE_CHK_STATUS_RETURN(SendHwSliceEncodeCommand(tileCtx.sliceStates[i], cmdBuffer));
+
+            // Send VD_PIPELINE_FLUSH command  for each slice
+            ENCODE_CHK_STATUS_RETURN(WaitHevcVdencDone(cmdBuffer));
+        }  // end of slice
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    MOS_STATUS HevcVdencPktG12::BuildSliceTileMap()
+    {
+        ENCODE_FUNC_CALL();
+
+        ENCODE_CHK_NULL_RETURN(m_frameFeatures.tile);
+        EncodeTile *tileFeature = m_frameFeatures.tile;
+
+        uint8_t numTileColumns = 1;
+        uint8_t numTileRows    = 1;
+        tileFeature->GetTileRowColumns(numTileRows, numTileColumns);
+        uint32_t numTiles = numTileRows * numTileColumns;
+
+        uint32_t shift       = m_hevcSeqParams->log2_max_coding_block_size_minus3 - m_hevcSeqParams->log2_min_coding_block_size_minus3;
+        uint32_t residual    = (1 << shift) - 1;
+        uint32_t widthInLcu  = (m_hevcSeqParams->wFrameWidthInMinCbMinus1 + 1 + residual) >> shift;
+        uint32_t heightInLcu = (m_hevcSeqParams->wFrameHeightInMinCbMinus1 + 1 + residual) >> shift;
+
+        // Map every LCU column/row to its tile column/row, tile starts are ascending
+        auto &map          = m_sliceTileMap;
+        map.numTileColumns = numTileColumns;
+        map.lcuColToTileCol.resize(widthInLcu);
+        map.lcuRowToTileRow.resize(heightInLcu);
+        map.tileColumnCtus.resize(numTileColumns);
+
+        EncodeTileData tileData = {};
+        for (uint32_t col = 0, x = 0; col < numTileColumns; col++)
+        {
+            uint32_t endX = widthInLcu;
+            if (col + 1 < numTileColumns)
+            {
+                ENCODE_CHK_STATUS_RETURN(tileFeature->GetTileByIndex(tileData, col + 1));
+                endX = MOS_MIN(tileData.tileStartXInLCU, widthInLcu);
+            }
+            map.tileColumnCtus[col] = (endX > x) ? (endX - x) * heightInLcu : 0;
+            for (; x < endX; x++)
+            {
+                map.lcuColToTileCol[x] = col;
+            }
+        }
+        for (uint32_t row = 0, y = 0; row < numTileRows; row++)
+        {
+            uint32_t endY = heightInLcu;
+            if (row + 1 < numTileRows)
+            {
+                ENCODE_CHK_STATUS_RETURN(tileFeature->GetTileByIndex(tileData, (row + 1) * numTileColumns));
+                endY = MOS_MIN(tileData.tileStartYInLCU, heightInLcu);
+            }
+            for (; y < endY; y++)
+            {
+                map.lcuRowToTileRow[y] = row;
+            }
+        }
+
+        // Count the slices of each tile from the slice start LCU
+        uint32_t numSlices = m_basicFeature->m_numSlices;
+        map.tileSliceOffsets.assign(numTiles + 1, 0);
+        map.sliceTile.resize(numSlices);
+        map.sliceLastInTile.resize(numSlices);
+        map.tileSlices.resize(numSlices);
+
+        for (uint32_t slcCount = 0; slcCount < numSlices; slcCount++)
+        {
+            uint32_t startLcu = m_hevcSliceParams[slcCount].slice_segment_address;
+            uint32_t x        = startLcu % widthInLcu;
+            uint32_t y        = startLcu / widthInLcu;
+            ENCODE_CHK_COND_RETURN(y >= heightInLcu, "Slice starts outside of the frame");
+
+            uint32_t tileIdx = map.lcuRowToTileRow[y] * numTileColumns + map.lcuColToTileCol[x];
+
+            // The tile feature still decides if the slice ends its tile
+            bool sliceInTile = false;
+            bool lastInTile  = false;
+            ENCODE_CHK_STATUS_RETURN(tileFeature->GetTileByIndex(tileData, tileIdx));
+            tileFeature->IsSliceInTile(slcCount, &tileData, &sliceInTile, &lastInTile);
+            ENCODE_CHK_COND_RETURN(!sliceInTile, "Slice is not inside the tile of its start LCU");
+
+            map.sliceTile[slcCount]       = tileIdx;
+            map.sliceLastInTile[slcCount] = lastInTile;
+            map.tileSliceOffsets[tileIdx + 1]++;
+        }
+
+        for (uint32_t tileIdx = 0; tileIdx < numTiles; tileIdx++)
+        {
+            map.tileSliceOffsets[tileIdx + 1] += map.tileSliceOffsets[tileIdx];
+        }
+
+        // Slices keep their bitstream order inside each tile
+        map.tileSliceFill.assign(map.tileSliceOffsets.begin(), map.tileSliceOffsets.end() - 1);
+        for (uint32_t slcCount = 0; slcCount < numSlices; slcCount++)
+        {
+            map.tileSlices[map.tileSliceFill[map.sliceTile[slcCount]]++] = slcCount;
+        }
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    MOS_STATUS HevcVdencPktG12::PrepareOneTileBatch(
+        MOS_COMMAND_BUFFER            &cmdBuffer,
+        uint32_t                      tileRow,
+        uint32_t                      tileCol,
+        uint32_t                      tileRowPass,
+        HevcVdencTileBatchContextG12 *&tileCtx)
+    {
+        ENCODE_FUNC_CALL();
+
+        tileCtx = nullptr;
+
+        RUN_FRAME_FEATURE_INTERFACE(tile, SetCurrentTile, tileRow, tileCol, m_pipeline);
+
+        uint32_t currentPipe = m_pipeline->GetCurrentPipe();
+        uint32_t pipe        = currentPipe;
+        if (m_pipeline->GetPipeNum() > 1)
+        {
+            pipe = m_tileColumnScheduler.GetColumnPipe(tileCol);
+            if (pipe != currentPipe && !m_sharedPipeBuilding)
+            {
+                return MOS_STATUS_SUCCESS;
+            }
+        }
+
+        ENCODE_CHK_COND_RETURN(m_numTileBatchContexts >= m_tileBatchContexts.size(),
+            "Tile batch contexts are not reserved for all the tiles");
+        HevcVdencTileBatchContextG12 &curTileCtx = m_tileBatchContexts[m_numTileBatchContexts];
+
+        curTileCtx.tileRow     = tileRow;
+        curTileCtx.tileCol     = tileCol;
+        curTileCtx.tileRowPass = tileRowPass;
+        curTileCtx.pipe        = pipe;
+
+        // Begin patching tile level batch cmds
+        MOS_ZeroMemory(&curTileCtx.tileBatchBuf, sizeof(curTileCtx.tileBatchBuf));
+        RUN_FRAME_FEATURE_INTERFACE(tile, BeginPatchTileLevelBatch,
+            tileRowPass, curTileCtx.tileBatchBuf);
+
+        // Add batch buffer start for tile
+        PMHW_BATCH_BUFFER tileLevelBatchBuffer = nullptr;
+        RUN_FRAME_FEATURE_INTERFACE(tile, GetTileLevelBatchBuffer, 
+            tileLevelBatchBuffer);
+        ENCODE_CHK_NULL_RETURN(tileLevelBatchBuffer);
+        if (pipe == currentPipe)
+        {
+            ENCODE_CHK_STATUS_RETURN(m_miInterface->AddMiBatchBufferStartCmd(&cmdBuffer, tileLevelBatchBuffer));
+        }
+        curTileCtx.batchBuffer = tileLevelBatchBuffer;
+
+        // Every tile starts from the frame level params, VdencPipeModeSelect() updates its own copy
+        curTileCtx.pipeModeSelectParams = m_pipeModeSelectParams;
+        if (pipe != currentPipe)
+        {
+            // Engine mode is the only pipe mode select field which differs between the pipes
+            curTileCtx.pipeModeSelectParams.MultiEngineMode = GetMultiEngineMode(pipe, m_pipeline->GetPipeNum());
+        }
+
+        curTileCtx.tileCodingParams = {};
+        RUN_FRAME_FEATURE_INTERFACE(tile, SetHcpTileCodingParams, m_pipeline->GetNumPipes(), curTileCtx.tileCodingParams);
+
+        ENCODE_CHK_STATUS_RETURN(PrepareSlicesInTile(curTileCtx));
+
+        ENCODE_CHK_STATUS_RETURN(CheckTileBatchReuse(curTileCtx));
+
+        m_numTileBatchContexts++;
+        tileCtx = &curTileCtx;
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    template <bool multiPipe, bool brcUpdate>
+    MOS_STATUS HevcVdencPktG12::BuildOneTileBatchT(
+        HevcVdencTileBatchContextG12 &tileCtx)
+    {
+        ENCODE_FUNC_CALL();
+
+        // Batch buffer already holds the commands of the tile
+        if (tileCtx.reuse)
+        {
+            return MOS_STATUS_SUCCESS;
+        }
+
+        MOS_COMMAND_BUFFER &constructTileBatchBuf = tileCtx.tileBatchBuf;
+
+        // HCP Lock for multiple pipe mode
+        if (multiPipe)
+        {
+            MHW_MI_VD_CONTROL_STATE_PARAMS vdControlStateParams;
+            MOS_ZeroMemory(&vdControlStateParams, sizeof(MHW_MI_VD_CONTROL_STATE_PARAMS));
+            vdControlStateParams.scalableModePipeLock = true;
+            ENCODE_CHK_STATUS_RETURN(m_miInterfaceG12->AddMiVdControlStateCmd(
+                &constructTileBatchBuf, &vdControlStateParams));
+        }
+
+        ENCODE_CHK_STATUS_RETURN(VdencPipeModeSelect(tileCtx.pipeModeSelectParams, constructTileBatchBuf));
+
+        ENCODE_CHK_STATUS_RETURN(m_hcpInterfaceG12->AddHcpPipeModeSelectCmd(&constructTileBatchBuf, &tileCtx.pipeModeSelectParams));
+
+        ENCODE_CHK_STATUS_RETURN(AddPicStateWithTileT<brcUpdate>(constructTileBatchBuf));
+
+        ENCODE_CHK_STATUS_RETURN(m_hcpInterfaceG12->AddHcpTileCodingCmd(&constructTileBatchBuf, &tileCtx.tileCodingParams));
+
+        ENCODE_CHK_STATUS_RETURN(AddSlicesCommandsInTile(constructTileBatchBuf, tileCtx));
+
+        //HCP unLock for multiple pipe mode
+        if (multiPipe)
+        {
+            MHW_MI_VD_CONTROL_STATE_PARAMS vdControlStateParams;
+            MOS_ZeroMemory(&vdControlStateParams, sizeof(MHW_MI_VD_CONTROL_STATE_PARAMS));
+            vdControlStateParams.scalableModePipeUnlock = true;
+            ENCODE_CHK_STATUS_RETURN(m_miInterfaceG12->AddMiVdControlStateCmd(
+                &constructTileBatchBuf, &vdControlStateParams));
+        }
+
+        ENCODE_CHK_STATUS_RETURN(WaitHevcDone(constructTileBatchBuf));
+
+        ENCODE_CHK_STATUS_RETURN(EnsureAllCommandsExecuted(constructTileBatchBuf));
+
+        // Add batch buffer end at the end of each tile batch, 2nd level batch buffer
+        ENCODE_CHK_STATUS_RETURN(m_miInterfaceG12->AddMiBatchBufferEnd(&constructTileBatchBuf, nullptr));
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    void HevcVdencPktG12::SelectTileBatchBuilder()
+    {
+        bool multiPipe = m_pipeline->GetNumPipes() > 1;
+        bool brcUpdate = m_frameFeatures.brcUpdateRequired;
+
+        if (multiPipe)
+        {
+            m_buildOneTileBatch = brcUpdate ? &HevcVdencPktG12::BuildOneTileBatchT<true, true>
+                                            : &HevcVdencPktG12::BuildOneTileBatchT<true, false>;
+        }
+        else
+        {
+            m_buildOneTileBatch = brcUpdate ? &HevcVdencPktG12::BuildOneTileBatchT<false, true>
+                                            : &HevcVdencPktG12::BuildOneTileBatchT<false, false>;
+        }
+    }
+
+    MOS_STATUS HevcVdencPktG12::ResolveG12Interfaces()
+    {
+        ENCODE_FUNC_CALL();
+
+        if (m_miInterfaceG12 != nullptr)
+        {
+            return MOS_STATUS_SUCCESS;
         }
 
-        ENCODE_CHK_STATUS_RETURN(Mos_Solo_PreProcessEncode(m_osInterface, &m_basicFeature->m_resBitstreamBuffer, &m_basicFeature->m_reconSurface));
+        m_miInterfaceG12    = dynamic_cast<MhwMiInterfaceG12 *>(m_miInterface);
+        m_hcpInterfaceG12   = dynamic_cast<MhwVdboxHcpInterfaceG12 *>(m_hcpInterface);
+        m_vdencInterfaceG12 = dynamic_cast<MhwVdboxVdencInterfaceG12X *>(m_vdencInterface);
+        m_hcpBufOffsetInterface = dynamic_cast<MhwVdboxHcpBufOffsetInterfaceG12 *>(m_hcpInterface);
+        ENCODE_CHK_NULL_RETURN(m_hcpInterfaceG12);
+        ENCODE_CHK_NULL_RETURN(m_vdencInterfaceG12);
+        // Checked last, it tells the interfaces are resolved
+        ENCODE_CHK_NULL_RETURN(m_miInterfaceG12);
 
         return MOS_STATUS_SUCCESS;
     }
 
-    MOS_STATUS HevcVdencPktG12::PatchPictureLevelCommands(const uint8_t &packetPhase, MOS_COMMAND_BUFFER  &cmdBuffer)
+    MOS_STATUS HevcVdencPktG12::FinishOneTileBatch(
+        HevcVdencTileBatchContextG12 &tileCtx)
     {
         ENCODE_FUNC_CALL();
 
-        ENCODE_CHK_STATUS_RETURN(m_miInterface->SetWatchdogTimerThreshold(m_basicFeature->m_frameWidth, m_basicFeature->m_frameHeight));
-
-        SetPerfTag(CODECHAL_ENCODE_PERFTAG_CALL_PAK_ENGINE, (uint16_t)m_basicFeature->m_mode, m_basicFeature->m_pictureCodingType);
-
-        auto feature = static_cast<HEVCEncodeBRC*>(m_featureManager->GetFeature(FeatureIDs::hevcBrcFeature));
-        ENCODE_CHK_NULL_RETURN(feature);
-
-        // Reset multi-pipe sync semaphores
-        auto scalability = m_pipeline->GetMediaScalability();
-        ENCODE_CHK_STATUS_RETURN(scalability->ResetSemaphore(syncOnePipeWaitOthers, 0, &cmdBuffer));
-
-        if ((m_pipeline->IsFirstPass() && !feature->IsACQPEnabled()))
-        {
-            ENCODE_CHK_STATUS_RETURN(AddForceWakeup(cmdBuffer));
-
-            // Send command buffer header at the beginning (OS dependent)
-            ENCODE_CHK_STATUS_RETURN(SendPrologCmds(cmdBuffer));
-        }
+        // End patching tile level batch cmds
+        RUN_FRAME_FEATURE_INTERFACE(tile, SetCurrentTile, tileCtx.tileRow, tileCtx.tileCol, m_pipeline);
+        RUN_FRAME_FEATURE_INTERFACE(tile, EndPatchTileLevelBatch);
 
-        if (m_pipeline->IsFirstPipe())
+        if (IsBatchReuseActive() && !tileCtx.reuse)
         {
-            ENCODE_CHK_STATUS_RETURN(StartStatusReport(statusReportMfx, &cmdBuffer));
+            m_batchContentHashes[tileCtx.batchBuffer] = tileCtx.contentHash;
         }
 
-        ENCODE_CHK_STATUS_RETURN(AddPictureHcpCommands(cmdBuffer));
-
-        ENCODE_CHK_STATUS_RETURN(AddPictureVdencCommands(cmdBuffer));
-
-        ENCODE_CHK_STATUS_RETURN(AddPicStateWithNoTile(cmdBuffer));
         return MOS_STATUS_SUCCESS;
     }
 
-    MOS_STATUS HevcVdencPktG12::PatchSliceLevelCommands(MOS_COMMAND_BUFFER  &cmdBuffer, uint8_t packetPhase)
+    MOS_STATUS HevcVdencPktG12::AddOneTileCommands(
+        MOS_COMMAND_BUFFER &cmdBuffer,
+        uint32_t tileRow,
+        uint32_t tileCol,
+        uint32_t tileRowPass)
     {
         ENCODE_FUNC_CALL();
 
-        if (m_hevcPicParams->tiles_enabled_flag)
+        HevcVdencTileBatchContextG12 *tileCtx = nullptr;
+        ENCODE_CHK_STATUS_RETURN(PrepareOneTileBatch(cmdBuffer, tileRow, tileCol, tileRowPass, tileCtx));
+        if (tileCtx == nullptr)
         {
+            // Tile is encoded by another pipe
             return MOS_STATUS_SUCCESS;
         }
-        MHW_VDBOX_HEVC_SLICE_STATE_G12 sliceStateParams;
-        SetHcpSliceStateCommonParams(sliceStateParams);
 
-        auto feature = static_cast<HEVCEncodeBRC*>(m_featureManager->GetFeature(FeatureIDs::hevcBrcFeature));
-        ENCODE_CHK_NULL_RETURN(feature);
-        auto vdenc2ndLevelBatchBuffer = feature->GetVdenc2ndLevelBatchBuffer(m_pipeline->m_currRecycledBufIdx);
+        ENCODE_CHK_STATUS_RETURN(BuildOneTileBatch(*tileCtx));
 
-        // starting location for executing slice level cmds
-        vdenc2ndLevelBatchBuffer->dwOffset = m_hwInterface->m_vdencBatchBuffer1stGroupSize + m_hwInterface->m_vdencBatchBuffer2ndGroupSize;
+        ENCODE_CHK_STATUS_RETURN(FinishOneTileBatch(*tileCtx));
 
-        PCODEC_ENCODER_SLCDATA slcData = m_basicFeature->m_slcData;
-        for (uint32_t startLcu = 0, slcCount = 0; slcCount < m_basicFeature->m_numSlices; slcCount++)
-        {
-            if (m_pipeline->IsFirstPass())
-            {
-                slcData[slcCount].CmdOffset = startLcu * (m_hcpInterface->GetHcpPakObjSize()) * sizeof(uint32_t);
-            }
-            //TODO:combine below 2 functions
-            SetHcpSliceStateParams(sliceStateParams, slcData, slcCount);
+        return MOS_STATUS_SUCCESS;
+    }
 
-            ENCODE_CHK_STATUS_RETURN(SendHwSliceEncodeCommand(sliceStateParams, cmdBuffer));
+    bool HevcVdencPktG12::IsParallelTileBatchActive() const
+    {
+        // PAK slice batch buffer is appended slice by slice, so it has to be built in order
+        return m_parallelTileBatchEnabled &&
+               m_tileBatchWorkerPool != nullptr &&
+               !m_useBatchBufferForPakSlices;
+    }
 
-            startLcu += m_hevcSliceParams[slcCount].NumLCUsInSlice;
+    MOS_STATUS HevcVdencPktG12::BuildTileBatchesInParallel()
+    {
+        ENCODE_FUNC_CALL();
+        ENCODE_CHK_NULL_RETURN(m_tileBatchWorkerPool);
 
-            m_batchBufferForPakSlicesStartOffset = (uint32_t)m_batchBufferForPakSlices[m_basicFeature->m_currPakSliceIdx].iCurrent;
-            if (feature->IsACQPEnabled() || feature->IsBRCEnabled())
+        // Without the hook the patch list calls of the workers would race
+        if (!EncodeDeferredPatchList::Hook(m_osInterface))
+        {
+            for (uint32_t i = 0; i < m_numTileBatchContexts; i++)
             {
-                // save offset for next 2nd level batch buffer usage
-                // This is because we don't know how many times HCP_WEIGHTOFFSET_STATE & HCP_PAK_INSERT_OBJECT will be inserted for each slice
-                // dwVdencBatchBufferPerSliceConstSize: constant size for each slice
-                // m_vdencBatchBufferPerSliceVarSize:   variable size for each slice
-                vdenc2ndLevelBatchBuffer->dwOffset += m_hwInterface->m_vdencBatchBufferPerSliceConstSize + m_basicFeature->m_vdencBatchBufferPerSliceVarSize[slcCount];
+                ENCODE_CHK_STATUS_RETURN(BuildOneTileBatch(m_tileBatchContexts[i]));
             }
-
-            ENCODE_CHK_STATUS_RETURN(WaitVdencDone(cmdBuffer));
+            return MOS_STATUS_SUCCESS;
         }
 
-        if (m_useBatchBufferForPakSlices)
+        if (m_tileBatchTasks.size() != m_numTileBatchContexts)
         {
-            ENCODE_CHK_STATUS_RETURN(Mhw_UnlockBb(
-                m_osInterface,
-                &m_batchBufferForPakSlices[m_basicFeature->m_currPakSliceIdx],
-                m_lastTaskInPhase));
+            m_tileBatchTasks.resize(m_numTileBatchContexts);
         }
-
-        // Insert end of sequence/stream if set
-        if (m_basicFeature->m_lastPicInSeq || m_basicFeature->m_lastPicInStream)
+        for (uint32_t i = 0; i < m_numTileBatchContexts; i++)
         {
-            ENCODE_CHK_STATUS_RETURN(InsertSeqStreamEnd(cmdBuffer));
+            HevcVdencTileBatchContextG12 *tileCtx = &m_tileBatchContexts[i];
+            m_tileBatchTasks[i] = [this, tileCtx]() {
+                tileCtx->patchList.Bind(m_osInterface);
+                MOS_STATUS status = BuildOneTileBatch(*tileCtx);
+                tileCtx->patchList.Unbind();
+                return status;
+            };
         }
-        //TODO: combine below 3 functions
-        ENCODE_CHK_STATUS_RETURN(EnsureAllCommandsExecuted(cmdBuffer));
 
-        ENCODE_CHK_STATUS_RETURN(WaitHevcDone(cmdBuffer));
+        MOS_STATUS status = m_tileBatchWorkerPool->Run(m_tileBatchTasks);
+        EncodeDeferredPatchList::Unhook(m_osInterface);
+        ENCODE_CHK_STATUS_RETURN(status);
 
-        ENCODE_CHK_STATUS_RETURN(EnsureAllCommandsExecuted(cmdBuffer));
+        // Same order as a serial build within each batch buffer
+        for (uint32_t i = 0; i < m_numTileBatchContexts; i++)
+        {
+            ENCODE_CHK_STATUS_RETURN(m_tileBatchContexts[i].patchList.Commit());
+        }
 
-        ENCODE_CHK_STATUS_RETURN(ReadSseStatistics(cmdBuffer));
-        ENCODE_CHK_STATUS_RETURN(ReadSliceSize(cmdBuffer));
+        return MOS_STATUS_SUCCESS;
+    }
 
-        ENCODE_CHK_STATUS_RETURN(EndStatusReport(statusReportMfx, &cmdBuffer));
+    MOS_STATUS HevcVdencPktG12::SetParallelTileBatch(bool enable, uint32_t numThreads)
+    {
+        ENCODE_FUNC_CALL();
 
-        if (m_pipeline->IsLastPass() && m_pipeline->IsFirstPipe())
+        if (!enable)
         {
-            ENCODE_CHK_STATUS_RETURN(UpdateStatusReport(statusReportGlobalCount, &cmdBuffer));
+            MOS_Delete(m_tileBatchWorkerPool);
+            m_parallelTileBatchEnabled = false;
+            return MOS_STATUS_SUCCESS;
         }
 
-        // Reset parameters for next PAK execution
-        if (false == m_pipeline->IsFrameTrackingEnabled() && m_pipeline->IsLastPass() && m_pipeline->IsLastPipe())
+        if (numThreads == 0)
         {
-            UpdateParameters();
+            // The submitting thread builds tiles as well
+            uint32_t numCores = std::thread::hardware_concurrency();
+            numThreads = (numCores > 1) ? (numCores - 1) : 1;
+        }
+
+        if (m_tileBatchWorkerPool == nullptr || m_tileBatchWorkerPool->GetNumThreads() != numThreads)
+        {
+            MOS_Delete(m_tileBatchWorkerPool);
+            m_tileBatchWorkerPool = MOS_New(EncodeWorkerPool, numThreads);
+            ENCODE_CHK_NULL_RETURN(m_tileBatchWorkerPool);
         }
 
+        m_parallelTileBatchEnabled = true;
         return MOS_STATUS_SUCCESS;
     }
 
-    MOS_STATUS HevcVdencPktG12::Construct3rdLevelBatch()
+    MOS_STATUS HevcVdencPktG12::SetSharedPipeBuild(bool enable)
     {
         ENCODE_FUNC_CALL();
 
-        MOS_STATUS eStatus = MOS_STATUS_SUCCESS;
+        m_sharedPipeBuildEnabled = enable;
+        ResetSharedPipeBuild();
 
-        MHW_VDBOX_HEVC_PIC_STATE_G12 picStateParams;
-        SetHcpPicStateParams(picStateParams);
+        return MOS_STATUS_SUCCESS;
+    }
 
-        // Begin patching 3rd level batch cmds
-        MOS_COMMAND_BUFFER constructedCmdBuf;
-        RUN_FEATURE_INTERFACE(EncodeTile, FeatureIDs::encodeTile, BeginPatch3rdLevelBatch, constructedCmdBuf);
+    bool HevcVdencPktG12::IsSharedPipeBuildActive() const
+    {
+        // PAK slice batch buffer is appended in the order of the pipes
+        return m_sharedPipeBuildEnabled &&
+               m_pipeline->GetPipeNum() > 1 &&
+               !m_useBatchBufferForPakSlices;
+    }
+
+    MOS_STATUS HevcVdencPktG12::AddSharedTileBatchStarts(MOS_COMMAND_BUFFER &cmdBuffer, uint32_t numTileRows, uint32_t pipe)
+    {
+        ENCODE_FUNC_CALL();
+
+        // Tile states are kept in tile row order
+        uint32_t i = 0;
+        for (uint32_t tileRow = 0; tileRow < numTileRows; tileRow++)
+        {
+            ENCODE_CHK_STATUS_RETURN(AddTileRowWait(cmdBuffer, tileRow, numTileRows, pipe));
+            for (; i < m_numTileBatchContexts && m_tileBatchContexts[i].tileRow == tileRow; i++)
+            {
+                auto &tileCtx = m_tileBatchContexts[i];
+                if (tileCtx.pipe == pipe)
+                {
+                    ENCODE_CHK_STATUS_RETURN(m_miInterface->AddMiBatchBufferStartCmd(&cmdBuffer, tileCtx.batchBuffer));
+                }
+            }
+            ENCODE_CHK_STATUS_RETURN(AddTileRowSignal(cmdBuffer, tileRow, pipe));
+        }
 
-        ENCODE_CHK_STATUS_RETURN(AddVdencCmd1Cmd(&constructedCmdBuf, true, m_basicFeature->m_ref.IsLowDelay()));
+        return MOS_STATUS_SUCCESS;
+    }
 
-        ENCODE_CHK_STATUS_RETURN(m_hcpInterface->AddHcpPicStateCmd(&constructedCmdBuf, &picStateParams));
+    MOS_STATUS HevcVdencPktG12::BuildOnePipeStartBatch(uint32_t pipe, uint32_t numTileRows)
+    {
+        ENCODE_FUNC_CALL();
 
-        ENCODE_CHK_STATUS_RETURN(AddVdencCmd2Cmd(&constructedCmdBuf, true, m_basicFeature->m_ref.IsLowDelay()));
+        PMHW_BATCH_BUFFER batchBuffer = m_pipeStartBatches[pipe];
+        ENCODE_CHK_NULL_RETURN(batchBuffer);
+        ENCODE_CHK_NULL_RETURN(batchBuffer->pData);
 
-        // set MI_BATCH_BUFFER_END command
-        ENCODE_CHK_STATUS_RETURN(m_miInterface->AddMiBatchBufferEnd(&constructedCmdBuf, nullptr));
+        // The chain back is added by the Submit() of the pipe
+        MOS_COMMAND_BUFFER pipeCmdBuffer;
+        MOS_ZeroMemory(&pipeCmdBuffer, sizeof(pipeCmdBuffer));
+        pipeCmdBuffer.OsResource = batchBuffer->OsResource;
+        pipeCmdBuffer.pCmdBase   = (uint32_t *)batchBuffer->pData;
+        pipeCmdBuffer.pCmdPtr    = pipeCmdBuffer.pCmdBase;
+        pipeCmdBuffer.iRemaining = batchBuffer->iSize - m_cmdChainReserve;
 
-        // End patching 3rd level batch cmds
-        RUN_FEATURE_INTERFACE(EncodeTile, FeatureIDs::encodeTile, EndPatch3rdLevelBatch);
+        ENCODE_CHK_STATUS_RETURN(AddSharedTileBatchStarts(pipeCmdBuffer, numTileRows, pipe));
 
-        return eStatus;
+        batchBuffer->iCurrent = pipeCmdBuffer.iOffset;
+
+        return MOS_STATUS_SUCCESS;
     }
 
-    MOS_STATUS HevcVdencPktG12::AddSlicesCommandsInTile(
-        MOS_COMMAND_BUFFER &cmdBuffer)
+    MOS_STATUS HevcVdencPktG12::BuildPipeStartBatches(uint32_t numTileRows, uint32_t numPipes)
     {
         ENCODE_FUNC_CALL();
 
-        PCODEC_ENCODER_SLCDATA         slcData = m_basicFeature->m_slcData;
-        MHW_VDBOX_HEVC_SLICE_STATE_G12 sliceState;
-        SetHcpSliceStateCommonParams(sliceState);
+        ENCODE_CHK_COND_RETURN(numPipes > m_maxNumPipes, "%d pipes are not supported", numPipes);
 
-        uint32_t slcCount, sliceNumInTile = 0;
-        for (slcCount = 0; slcCount < m_basicFeature->m_numSlices; slcCount++)
+        uint32_t batchStartSize = mhw_mi_g12_X::MI_BATCH_BUFFER_START_CMD::byteSize;
+        uint32_t rowSyncSize    = 0;
+        if (IsTileRowSyncActive())
         {
-            bool sliceInTile  = false;
-            m_lastSliceInTile = false;
-
-            EncodeTileData curTileData = {};
-            RUN_FEATURE_INTERFACE(EncodeTile, FeatureIDs::encodeTile, GetCurrentTile, curTileData);
-            RUN_FEATURE_INTERFACE(EncodeTile, FeatureIDs::encodeTile, IsSliceInTile, 
-                slcCount, &curTileData, &sliceInTile, &m_lastSliceInTile);
+            rowSyncSize = (numTileRows + 1) * (m_maxNumPipes * mhw_mi_g12_X::MI_SEMAPHORE_WAIT_CMD::byteSize +
+                                                  mhw_mi_g12_X::MI_FLUSH_DW_CMD::byteSize);
+        }
 
-            if (!sliceInTile)
+        for (uint32_t pipe = 1; pipe < numPipes; pipe++)
+        {
+            uint32_t numTileStarts = 0;
+            for (uint32_t i = 0; i < m_numTileBatchContexts; i++)
             {
-                continue;
+                numTileStarts += (m_tileBatchContexts[i].pipe == pipe) ? 1 : 0;
             }
 
-            SetHcpSliceStateParams(sliceState, slcData, (uint16_t)slcCount);
-            ENCODE_CHK_STATUS_RETURN(SendHwSliceEncodeCommand(sliceState, cmdBuffer));
+            uint32_t size = MOS_ALIGN_CEIL(numTileStarts * batchStartSize + rowSyncSize + m_cmdChainReserve, CODECHAL_CACHELINE_SIZE);
+            ENCODE_CHK_STATUS_RETURN(m_pipeStartBatchRing.Acquire(m_osInterface, size, GetCompletedFence(), m_pipeStartBatches[pipe]));
+        }
 
-            // Send VD_PIPELINE_FLUSH command  for each slice
-            ENCODE_CHK_STATUS_RETURN(WaitHevcVdencDone(cmdBuffer));
+        // A single later pipe gains nothing from a worker, without the hook the patch
+        // list calls of the workers would race
+        if (!IsParallelTileBatchActive() || numPipes <= 2 || !EncodeDeferredPatchList::Hook(m_osInterface))
+        {
+            for (uint32_t pipe = 1; pipe < numPipes; pipe++)
+            {
+                ENCODE_CHK_STATUS_RETURN(BuildOnePipeStartBatch(pipe, numTileRows));
+            }
+            return MOS_STATUS_SUCCESS;
+        }
 
-            sliceNumInTile++;
-        }  // end of slice
+        if (m_pipeStartTasks.size() != numPipes - 1)
+        {
+            m_pipeStartTasks.resize(numPipes - 1);
+        }
+        for (uint32_t pipe = 1; pipe < numPipes; pipe++)
+        {
+            EncodeDeferredPatchList *patchList = &m_pipeStartPatchLists[pipe];
+            m_pipeStartTasks[pipe - 1] = [this, patchList, pipe, numTileRows]() {
+                patchList->Bind(m_osInterface);
+                MOS_STATUS status = BuildOnePipeStartBatch(pipe, numTileRows);
+                patchList->Unbind();
+                return status;
+            };
+        }
+
+        MOS_STATUS status = m_tileBatchWorkerPool->Run(m_pipeStartTasks);
+        EncodeDeferredPatchList::Unhook(m_osInterface);
+        ENCODE_CHK_STATUS_RETURN(status);
 
-        if (0 == sliceNumInTile)
+        // Same order as a serial build of the pipes
+        for (uint32_t pipe = 1; pipe < numPipes; pipe++)
         {
-            // One tile must have at least one slice
-            ENCODE_ASSERT(false);
-            return MOS_STATUS_INVALID_PARAMETER;
+            ENCODE_CHK_STATUS_RETURN(m_pipeStartPatchLists[pipe].Commit());
         }
+
         return MOS_STATUS_SUCCESS;
     }
 
-    MOS_STATUS HevcVdencPktG12::AddOneTileCommands(
-        MOS_COMMAND_BUFFER &cmdBuffer,
-        uint32_t tileRow,
-        uint32_t tileCol,
-        uint32_t tileRowPass)
+    MOS_STATUS HevcVdencPktG12::AddPipeStartBatch(MOS_COMMAND_BUFFER &cmdBuffer)
     {
         ENCODE_FUNC_CALL();
-        auto eStatus = MOS_STATUS_SUCCESS;
 
-        RUN_FEATURE_INTERFACE(EncodeTile, FeatureIDs::encodeTile, SetCurrentTile, tileRow, tileCol, m_pipeline);
-
-        if ((m_pipeline->GetPipeNum() > 1) && (tileCol != m_pipeline->GetCurrentPipe()))
-        {
-            return MOS_STATUS_SUCCESS;
-        }
+        uint32_t pipe = m_pipeline->GetCurrentPipe();
+        ENCODE_CHK_COND_RETURN(pipe >= m_maxNumPipes || m_pipeStartBatches[pipe] == nullptr,
+            "Pipe %d has no batch buffer of the shared build", pipe);
+        PMHW_BATCH_BUFFER batchBuffer = m_pipeStartBatches[pipe];
+
+        // A pipe without tiles and row waits reserves nothing for its tile batch starts
+        ENCODE_CHK_STATUS_RETURN(ReserveCmdSpace(cmdBuffer, mhw_mi_g12_X::MI_BATCH_BUFFER_START_CMD::byteSize));
+        ENCODE_CHK_STATUS_RETURN(AddChainedBatchStart(cmdBuffer, batchBuffer));
+
+        // The pipe continues in the primary buffer right after the chain
+        MOS_COMMAND_BUFFER pipeCmdBuffer;
+        MOS_ZeroMemory(&pipeCmdBuffer, sizeof(pipeCmdBuffer));
+        pipeCmdBuffer.OsResource = batchBuffer->OsResource;
+        pipeCmdBuffer.pCmdBase   = (uint32_t *)batchBuffer->pData;
+        pipeCmdBuffer.pCmdPtr    = pipeCmdBuffer.pCmdBase + batchBuffer->iCurrent / sizeof(uint32_t);
+        pipeCmdBuffer.iOffset    = batchBuffer->iCurrent;
+        pipeCmdBuffer.iRemaining = batchBuffer->iSize - batchBuffer->iCurrent;
+
+        MOS_ZeroMemory(&m_pipeStartReturn, sizeof(m_pipeStartReturn));
+        m_pipeStartReturn.OsResource = cmdBuffer.OsResource;
+        m_pipeStartReturn.iSize      = cmdBuffer.iOffset + cmdBuffer.iRemaining;
+        m_pipeStartReturn.dwOffset   = cmdBuffer.iOffset;
+        ENCODE_CHK_STATUS_RETURN(AddChainedBatchStart(pipeCmdBuffer, &m_pipeStartReturn));
+        batchBuffer->iCurrent = pipeCmdBuffer.iOffset;
+
+        // Read by the submission of the primary buffer
+        m_pipeStartBatchRing.Retire(batchBuffer, GetSubmissionFence());
+        m_pipeStartBatches[pipe] = nullptr;
 
-        // Begin patching tile level batch cmds
-        MOS_COMMAND_BUFFER constructTileBatchBuf = {};
-        RUN_FEATURE_INTERFACE(EncodeTile, FeatureIDs::encodeTile, BeginPatchTileLevelBatch,
-            tileRowPass, constructTileBatchBuf);
+        return MOS_STATUS_SUCCESS;
+    }
 
-        // Add batch buffer start for tile
-        PMHW_BATCH_BUFFER tileLevelBatchBuffer = nullptr;
-        RUN_FEATURE_INTERFACE(EncodeTile, FeatureIDs::encodeTile, GetTileLevelBatchBuffer, 
-            tileLevelBatchBuffer);
-        ENCODE_CHK_STATUS_RETURN(m_miInterface->AddMiBatchBufferStartCmd(&cmdBuffer, tileLevelBatchBuffer));
+    void HevcVdencPktG12::ResetSharedPipeBuild()
+    {
+        m_sharedPipeBuildFrame = 0;
 
-        // HCP Lock for multiple pipe mode
-        if (m_pipeline->GetNumPipes() > 1)
+        // Not chained by any submission
+        for (auto &batchBuffer : m_pipeStartBatches)
         {
-            MHW_MI_VD_CONTROL_STATE_PARAMS vdControlStateParams;
-            MOS_ZeroMemory(&vdControlStateParams, sizeof(MHW_MI_VD_CONTROL_STATE_PARAMS));
-            vdControlStateParams.scalableModePipeLock = true;
-            MhwMiInterfaceG12 *miInterface = dynamic_cast<MhwMiInterfaceG12*>(m_miInterface);
-            ENCODE_CHK_NULL_RETURN(miInterface);
-            ENCODE_CHK_STATUS_RETURN(miInterface->AddMiVdControlStateCmd(
-                &constructTileBatchBuf, &vdControlStateParams));
+            if (batchBuffer != nullptr)
+            {
+                m_pipeStartBatchRing.Retire(batchBuffer, GetCompletedFence());
+                batchBuffer = nullptr;
+            }
         }
+    }
 
-        ENCODE_CHK_STATUS_RETURN(VdencPipeModeSelect(m_pipeModeSelectParams, constructTileBatchBuf));
+    MOS_STATUS HevcVdencPktG12::BuildTileLevelBatches(
+        MOS_COMMAND_BUFFER &cmdBuffer,
+        uint32_t            numTileRows,
+        uint32_t            numTileColumns)
+    {
+        ENCODE_FUNC_CALL();
 
-        ENCODE_CHK_STATUS_RETURN(m_hcpInterface->AddHcpPipeModeSelectCmd(&constructTileBatchBuf, &m_pipeModeSelectParams));
+        if (IsBatchReuseActive())
+        {
+            // Tile feature reallocates its batches when the grid changes
+            uint32_t tileGrid = (numTileRows << 16) | (numTileColumns << 8) | m_NumPassesForTileReplay;
+            if (tileGrid != m_batchReuseTileGrid)
+            {
+                m_batchContentHashes.clear();
+                m_batchReuseTileGrid = tileGrid;
+            }
+        }
 
-        ENCODE_CHK_STATUS_RETURN(AddPicStateWithTile(constructTileBatchBuf));
+        ENCODE_CHK_STATUS_RETURN(Construct3rdLevelBatch());
 
-        MHW_VDBOX_HCP_TILE_CODING_PARAMS_G12 curTileCodingParams = {};
-        RUN_FEATURE_INTERFACE(EncodeTile, FeatureIDs::encodeTile, SetHcpTileCodingParams, m_pipeline->GetNumPipes(), curTileCodingParams);
-        
-        MhwVdboxHcpInterfaceG12 *hcpInterface = dynamic_cast<MhwVdboxHcpInterfaceG12 *>(m_hcpInterface);
-        ENCODE_CHK_NULL_RETURN(hcpInterface);
-        ENCODE_CHK_STATUS_RETURN(hcpInterface->AddHcpTileCodingCmd(&constructTileBatchBuf, &curTileCodingParams));
+        if (IsBatchReuseActive())
+        {
+            m_frameBatchHash = GetFrameBatchHash();
+        }
 
-        ENCODE_CHK_STATUS_RETURN(AddSlicesCommandsInTile(constructTileBatchBuf));
+        SetHcpPipeModeSelectParams(m_pipeModeSelectParams);
 
-        //HCP unLock for multiple pipe mode
-        if (m_pipeline->GetNumPipes() > 1)
+        uint32_t numTiles = numTileRows * numTileColumns * m_NumPassesForTileReplay;
+        if (m_tileBatchContexts.size() < numTiles)
         {
-            MHW_MI_VD_CONTROL_STATE_PARAMS vdControlStateParams;
-            MOS_ZeroMemory(&vdControlStateParams, sizeof(MHW_MI_VD_CONTROL_STATE_PARAMS));
-            vdControlStateParams.scalableModePipeUnlock = true;
-            MhwMiInterfaceG12 *miInterface = dynamic_cast<MhwMiInterfaceG12*>(m_miInterface);
-            ENCODE_CHK_NULL_RETURN(miInterface);
-            ENCODE_CHK_STATUS_RETURN(miInterface->AddMiVdControlStateCmd(
-                &constructTileBatchBuf, &vdControlStateParams));
+            m_tileBatchContexts.resize(numTiles);
         }
+        m_numTileBatchContexts = 0;
 
-        ENCODE_CHK_STATUS_RETURN(WaitHevcDone(constructTileBatchBuf));
-
-        ENCODE_CHK_STATUS_RETURN(EnsureAllCommandsExecuted(constructTileBatchBuf));
+        if (IsParallelTileBatchActive() && numTiles > 1)
+        {
+            // Primary buffer and tile feature state are touched in tile order on this thread,
+            // only the tile level batches themselves are built by the workers
+            for (uint32_t tileRow = 0; tileRow < numTileRows; tileRow++)
+            {
+                ENCODE_CHK_STATUS_RETURN(AddTileRowWait(cmdBuffer, tileRow, numTileRows, m_pipeline->GetCurrentPipe()));
+                for (uint32_t tileRowPass = 0; tileRowPass < m_NumPassesForTileReplay; tileRowPass++)
+                {
+                    for (uint32_t tileCol = 0; tileCol < numTileColumns; tileCol++)
+                    {
+                        HevcVdencTileBatchContextG12 *tileCtx = nullptr;
+                        ENCODE_CHK_STATUS_RETURN(PrepareOneTileBatch(
+                            cmdBuffer,
+                            tileRow,
+                            tileCol,
+                            tileRowPass,
+                            tileCtx));
+                    }
+                }
+                ENCODE_CHK_STATUS_RETURN(AddTileRowSignal(cmdBuffer, tileRow, m_pipeline->GetCurrentPipe()));
+            }
 
-        // Add batch buffer end at the end of each tile batch, 2nd level batch buffer
-        ENCODE_CHK_STATUS_RETURN(m_miInterface->AddMiBatchBufferEnd(&constructTileBatchBuf, nullptr));
+            ENCODE_CHK_STATUS_RETURN(BuildTileBatchesInParallel());
 
-        // End patching tile level batch cmds
-        RUN_FEATURE_INTERFACE(EncodeTile, FeatureIDs::encodeTile, EndPatchTileLevelBatch);
+            for (uint32_t i = 0; i < m_numTileBatchContexts; i++)
+            {
+                ENCODE_CHK_STATUS_RETURN(FinishOneTileBatch(m_tileBatchContexts[i]));
+            }
+        }
+        else
+        {
+            for (uint32_t tileRow = 0; tileRow < numTileRows; tileRow++)
+            {
+                ENCODE_CHK_STATUS_RETURN(AddTileRowWait(cmdBuffer, tileRow, numTileRows, m_pipeline->GetCurrentPipe()));
+                for (uint32_t tileRowPass = 0; tileRowPass < m_NumPassesForTileReplay; tileRowPass++)
+                {
+                    for (uint32_t tileCol = 0; tileCol < numTileColumns; tileCol++)
+                    {
+                        ENCODE_CHK_STATUS_RETURN(AddOneTileCommands(
+                            cmdBuffer,
+                            tileRow,
+                            tileCol,
+                            tileRowPass));
+                    }
+                }
+                ENCODE_CHK_STATUS_RETURN(AddTileRowSignal(cmdBuffer, tileRow, m_pipeline->GetCurrentPipe()));
+            }
+        }
 
-        return eStatus;
+        return MOS_STATUS_SUCCESS;
     }
 
     MOS_STATUS HevcVdencPktG12::PatchTileLevelCommands(MOS_COMMAND_BUFFER &cmdBuffer, uint8_t packetPhase)
@@ -455,29 +2424,50 @@ namespace encode
             return MOS_STATUS_INVALID_PARAMETER;
         }
 
-        ENCODE_CHK_STATUS_RETURN(Construct3rdLevelBatch());
-
-        SetHcpPipeModeSelectParams(m_pipeModeSelectParams);
-
         uint8_t numTileColumns = 1;
         uint8_t numTileRows    = 1;
-        RUN_FEATURE_INTERFACE(EncodeTile, FeatureIDs::encodeTile, GetTileRowColumns, numTileRows, numTileColumns);
+        RUN_FRAME_FEATURE_INTERFACE(tile, GetTileRowColumns, numTileRows, numTileColumns);
 
-        for (uint32_t tileRow = 0; tileRow < numTileRows; tileRow++)
+        ENCODE_CHK_STATUS_RETURN(ReserveCmdSpace(cmdBuffer, m_tileStartsCmdSize));
+
+        // The first pipe of the pass built the batches of this pipe
+        bool sharedPipeBuild = IsSharedPipeBuildActive();
+        if (sharedPipeBuild && !m_pipeline->IsFirstPipe() &&
+            m_sharedPipeBuildFrame == m_basicFeature->m_frameNum + 1 &&
+            m_sharedPipeBuildPass == m_pipeline->GetCurrentPass())
         {
-            for (uint32_t tileRowPass = 0; tileRowPass < m_NumPassesForTileReplay; tileRowPass++)
+            ENCODE_CHK_STATUS_RETURN(AddPipeStartBatch(cmdBuffer));
+            if (m_pipeline->IsLastPipe())
             {
-                for (uint32_t tileCol = 0; tileCol < numTileColumns; tileCol++)
-                {
-                    ENCODE_CHK_STATUS_RETURN(AddOneTileCommands(
-                        cmdBuffer,
-                        tileRow,
-                        tileCol,
-                        tileRowPass));
-                }
+                ResetSharedPipeBuild();
+            }
+        }
+        else
+        {
+            // A build of an earlier frame or pass is not used by any pipe anymore
+            ResetSharedPipeBuild();
+
+            m_sharedPipeBuilding = sharedPipeBuild && m_pipeline->IsFirstPipe();
+            eStatus = BuildTileLevelBatches(cmdBuffer, numTileRows, numTileColumns);
+            if (eStatus == MOS_STATUS_SUCCESS && m_sharedPipeBuilding)
+            {
+                eStatus = BuildPipeStartBatches(numTileRows, m_pipeline->GetPipeNum());
+            }
+            if (eStatus == MOS_STATUS_SUCCESS && m_sharedPipeBuilding)
+            {
+                m_sharedPipeBuildFrame = m_basicFeature->m_frameNum + 1;
+                m_sharedPipeBuildPass  = m_pipeline->GetCurrentPass();
             }
+            m_sharedPipeBuilding = false;
+            if (eStatus != MOS_STATUS_SUCCESS)
+            {
+                ResetSharedPipeBuild();
+            }
+            ENCODE_CHK_STATUS_RETURN(eStatus);
         }
 
+        ENCODE_CHK_STATUS_RETURN(ReserveCmdSpace(cmdBuffer, m_tailCmdSize));
+
         // Insert end of sequence/stream if set
         if ((m_basicFeature->m_lastPicInSeq || m_basicFeature->m_lastPicInStream) && m_pipeline->IsLastPipe())
         {
@@ -488,17 +2478,41 @@ namespace encode
         MHW_MI_VD_CONTROL_STATE_PARAMS vdControlStateParams;
         MOS_ZeroMemory(&vdControlStateParams, sizeof(MHW_MI_VD_CONTROL_STATE_PARAMS));
         vdControlStateParams.memoryImplicitFlush = true;
-        MhwMiInterfaceG12 *miInterface = dynamic_cast<MhwMiInterfaceG12*>(m_miInterface);
-        ENCODE_CHK_NULL_RETURN(miInterface);
-        ENCODE_CHK_STATUS_RETURN(miInterface->AddMiVdControlStateCmd(&cmdBuffer, &vdControlStateParams));
+        ENCODE_CHK_STATUS_RETURN(m_miInterfaceG12->AddMiVdControlStateCmd(&cmdBuffer, &vdControlStateParams));
 
         ENCODE_CHK_STATUS_RETURN(WaitHevcDone(cmdBuffer));
 
         ENCODE_CHK_STATUS_RETURN(EnsureAllCommandsExecuted(cmdBuffer));
 
-        // Wait all pipe cmds done for the packet
-        auto scalability = m_pipeline->GetMediaScalability();
-        ENCODE_CHK_STATUS_RETURN(scalability->SyncPipe(syncOnePipeWaitOthers, 0, &cmdBuffer));
+        if (IsTileRowSyncActive() && m_pipeline->IsLastPass())
+        {
+            // Only the pipe integrating the frame waits for the others, the next frame
+            // waits per tile row in AddTileRowWait()
+            ENCODE_CHK_STATUS_RETURN(AddTileRowSignal(cmdBuffer, m_maxTileRows, m_pipeline->GetCurrentPipe()));
+            if (m_pipeline->IsFirstPipe())
+            {
+                ENCODE_CHK_STATUS_RETURN(AddTileRowSyncWaits(
+                    cmdBuffer, m_maxTileRows, m_pipeline->GetPipeNum(), GetTileRowSyncSeq(), m_pipeline->GetCurrentPipe()));
+            }
+
+            if (m_pipeline->IsLastPipe())
+            {
+                m_tileRowSyncPrevSeq  = GetTileRowSyncSeq();
+                m_tileRowSyncPrevGrid = GetTileRowSyncGrid(numTileRows);
+            }
+        }
+        else
+        {
+            // Wait all pipe cmds done for the packet
+            auto scalability = m_pipeline->GetMediaScalability();
+            ENCODE_CHK_STATUS_RETURN(scalability->SyncPipe(syncOnePipeWaitOthers, 0, &cmdBuffer));
+
+            if (m_pipeline->IsLastPipe() && m_pipeline->IsLastPass())
+            {
+                // Frame is not signaled per tile row, the next one cannot wait on it
+                m_tileRowSyncPrevSeq = 0;
+            }
+        }
 
         // post-operations are done by pak integrate pkt
 
@@ -539,7 +2553,8 @@ namespace encode
         ENCODE_FUNC_CALL();
 
         void *cmdParams = nullptr;
-        PMHW_VDBOX_VDENC_CMD2_STATE_EXT hevcImgStateParams = MOS_New(MHW_VDBOX_VDENC_CMD2_STATE_EXT);
+        // Released by the next arena reset, so the early returns below do not leak
+        PMHW_VDBOX_VDENC_CMD2_STATE_EXT hevcImgStateParams = m_paramArena.New<MHW_VDBOX_VDENC_CMD2_STATE_EXT>();
         ENCODE_CHK_NULL_RETURN(hevcImgStateParams);
 
         bool panicEnabled = false;//(m_brcEnabled) && (m_panicEnable) && (GetCurrentPass() == 1) && !m_pakOnlyPass;
@@ -555,7 +2570,7 @@ namespace encode
         //TODO:(m_brcEnabled && hevcImgStateParams->pHevcEncSeqParams->MBBRC != 2/*mbBrcDisabled*/);
         hevcImgStateParams->bPanicEnabled           = panicEnabled;
         hevcImgStateParams->bStreamInEnabled        = m_streamInEnabled;
-        RUN_FEATURE_INTERFACE(HevcVdencRoi, FeatureIDs::hevcVdencRoiFeature, SetVdencCmd2Cmd, hevcImgStateParams);
+        RUN_FRAME_FEATURE_INTERFACE(roi, SetVdencCmd2Cmd, hevcImgStateParams);
         hevcImgStateParams->bTileReplayEnable       = false;//m_tileReplayEnabled;
         hevcImgStateParams->bIsLowDelayB            = isLowDelayB;
         hevcImgStateParams->bCaptureModeEnable      = false;//m_captureModeEnable;
@@ -564,7 +2579,6 @@ namespace encode
         hevcImgStateParams->pInputParams            = cmdParams;
 
         ENCODE_CHK_STATUS_RETURN(m_vdencInterface->AddVdencCmd2Cmd(cmdBuffer, nullptr, hevcImgStateParams));
-        MOS_Delete(hevcImgStateParams);
         return MOS_STATUS_SUCCESS;
     }
 
@@ -573,20 +2587,17 @@ namespace encode
     {
         ENCODE_FUNC_CALL();
 
-        bool tileEnabled = false;
-        RUN_FEATURE_INTERFACE(EncodeTile, FeatureIDs::encodeTile, IsEnabled, tileEnabled);
-        if (tileEnabled)
+        if (m_frameFeatures.tileEnabled)
         {
             return MOS_STATUS_SUCCESS;
         }
 
         MHW_VDBOX_HEVC_PIC_STATE_G12 picStateParams;
         SetHcpPicStateParams(picStateParams);
-        auto brcFeature = static_cast<HEVCEncodeBRC*>(m_featureManager->GetFeature(FeatureIDs::hevcBrcFeature));
-        ENCODE_CHK_NULL_RETURN(brcFeature);
-        auto vdenc2ndLevelBatchBuffer = brcFeature->GetVdenc2ndLevelBatchBuffer(m_pipeline->m_currRecycledBufIdx);
+        ENCODE_CHK_NULL_RETURN(m_frameFeatures.brc);
+        auto vdenc2ndLevelBatchBuffer = m_frameFeatures.vdenc2ndLevelBatchBuffer;
 
-        if (brcFeature->IsBRCUpdateRequired())
+        if (m_frameFeatures.brcUpdateRequired)
         {
             ENCODE_CHK_STATUS_RETURN(m_miInterface->AddMiBatchBufferStartCmd(&cmdBuffer, vdenc2ndLevelBatchBuffer));
         }
@@ -613,20 +2624,26 @@ namespace encode
     {
         ENCODE_FUNC_CALL();
 
-        bool tileEnabled = false;
-        RUN_FEATURE_INTERFACE(EncodeTile, FeatureIDs::encodeTile, IsEnabled, tileEnabled);
-        if (!tileEnabled)
+        if (!m_frameFeatures.tileEnabled)
         {
             return MOS_STATUS_SUCCESS;
         }
 
+        return m_frameFeatures.brcUpdateRequired ? AddPicStateWithTileT<true>(cmdBuffer) : AddPicStateWithTileT<false>(cmdBuffer);
+    }
+
+    template <bool brcUpdate>
+    MOS_STATUS HevcVdencPktG12::AddPicStateWithTileT(
+        MOS_COMMAND_BUFFER &cmdBuffer)
+    {
+        ENCODE_FUNC_CALL();
+
         MHW_VDBOX_HEVC_PIC_STATE_G12 picStateParams;
         SetHcpPicStateParams(picStateParams);
-        auto brcFeature = static_cast<HEVCEncodeBRC *>(m_featureManager->GetFeature(FeatureIDs::hevcBrcFeature));
-        ENCODE_CHK_NULL_RETURN(brcFeature);
-        auto vdenc2ndLevelBatchBuffer = brcFeature->GetVdenc2ndLevelBatchBuffer(m_pipeline->m_currRecycledBufIdx);
+        ENCODE_CHK_NULL_RETURN(m_frameFeatures.brc);
+        auto vdenc2ndLevelBatchBuffer = m_frameFeatures.vdenc2ndLevelBatchBuffer;
 
-        if (brcFeature->IsBRCUpdateRequired())
+        if (brcUpdate)
         {
             ENCODE_CHK_STATUS_RETURN(m_miInterface->AddMiBatchBufferStartCmd(&cmdBuffer, vdenc2ndLevelBatchBuffer));
         }
@@ -635,7 +2652,7 @@ namespace encode
         {
             // 3nd level batch buffer start
             PMHW_BATCH_BUFFER thirdLevelBatchBuffer = nullptr;
-            RUN_FEATURE_INTERFACE(EncodeTile, FeatureIDs::encodeTile, GetThirdLevelBatchBuffer, thirdLevelBatchBuffer);
+            RUN_FRAME_FEATURE_INTERFACE(tile, GetThirdLevelBatchBuffer, thirdLevelBatchBuffer);
             ENCODE_CHK_STATUS_RETURN(m_miInterface->AddMiBatchBufferStartCmd(&cmdBuffer, thirdLevelBatchBuffer));
         }
 
@@ -697,25 +2714,9 @@ namespace encode
         vdencWalkerStateParams.pHevcEncPicParams = params.pEncodeHevcPicParams;
         vdencWalkerStateParams.pEncodeHevcSliceParams = params.pEncodeHevcSliceParams;
 
-        switch (m_pipeline->GetPipeNum())
-        {
-        case 0:
-        case 1:
-            vdencWalkerStateParams.dwNumberOfPipes = VDENC_PIPE_SINGLE_PIPE;
-            break;
-        case 2:
-            vdencWalkerStateParams.dwNumberOfPipes = VDENC_PIPE_TWO_PIPE;
-            break;
-        case 4:
-            vdencWalkerStateParams.dwNumberOfPipes = VDENC_PIPE_FOUR_PIPE;
-            break;
-        default:
-            vdencWalkerStateParams.dwNumberOfPipes = VDENC_PIPE_INVALID;
-            ENCODE_ASSERT(false);
-            break;
-        }
-        
-        RUN_FEATURE_INTERFACE(EncodeTile, FeatureIDs::encodeTile, SetVdencWalkerStateParams, vdencWalkerStateParams);
+        ENCODE_CHK_STATUS_RETURN(GetWalkerNumberOfPipes(m_pipeline->GetPipeNum(), vdencWalkerStateParams.dwNumberOfPipes));
+
+        RUN_FRAME_FEATURE_INTERFACE(tile, SetVdencWalkerStateParams, vdencWalkerStateParams);
 
         ENCODE_CHK_STATUS_RETURN(m_vdencInterface->AddVdencWalkerStateCmd(&cmdBuffer, &vdencWalkerStateParams));
 
@@ -730,7 +2731,7 @@ namespace encode
 
         if (m_pipeline->GetNumPipes() > 1)
         {
-            RUN_FEATURE_INTERFACE(EncodeTile, FeatureIDs::encodeTile, SetHcpPipeBufAddrParams, pipeBufAddrParams);
+            RUN_FRAME_FEATURE_INTERFACE(tile, SetHcpPipeBufAddrParams, pipeBufAddrParams);
         }
 
         // Set up the recon not filtered surface for IBC
@@ -773,11 +2774,33 @@ namespace encode
         MHW_VDBOX_PIPE_BUF_ADDR_PARAMS_G12 pipeBufAddrParams;
 
         ENCODE_CHK_STATUS_RETURN(VdencPipeModeSelect(m_pipeModeSelectParams, cmdBuffer));
-        ENCODE_CHK_STATUS_RETURN(SetVdencSurfaces(cmdBuffer));
+        ENCODE_CHK_STATUS_RETURN(AddVdencSurfaces(cmdBuffer));
         ENCODE_CHK_STATUS_RETURN(AddVdencPipeBufAddrCmd(pipeBufAddrParams, cmdBuffer));
         return MOS_STATUS_SUCCESS;
     }
 
+    MOS_STATUS HevcVdencPktG12::AddVdencSurfaces(MOS_COMMAND_BUFFER &cmdBuffer)
+    {
+        ENCODE_FUNC_CALL();
+
+        if (!m_pictureCmdTemplatesEnabled)
+        {
+            return SetVdencSurfaces(cmdBuffer);
+        }
+
+        const HevcVdencPicSurfacesKeyG12 &key = GetPicSurfacesKey();
+        if (m_vdencSurfacesTemplate.IsValid(&key, sizeof(key)))
+        {
+            return m_vdencSurfacesTemplate.Replay(cmdBuffer);
+        }
+
+        m_vdencSurfacesTemplate.BeginRecord(cmdBuffer);
+        ENCODE_CHK_STATUS_RETURN(SetVdencSurfaces(cmdBuffer));
+        ENCODE_CHK_STATUS_RETURN(m_vdencSurfacesTemplate.EndRecord(cmdBuffer, &key, sizeof(key)));
+
+        return MOS_STATUS_SUCCESS;
+    }
+
     MOS_STATUS HevcVdencPktG12::SetVdencPipeBufAddrParams(
         MHW_VDBOX_PIPE_BUF_ADDR_PARAMS& pipeBufAddrParams)
    {
@@ -785,7 +2808,7 @@ namespace encode
 
         HevcVdencPkt::SetVdencPipeBufAddrParams(pipeBufAddrParams);
 
-        RUN_FEATURE_INTERFACE(EncodeTile, FeatureIDs::encodeTile, SetVdencPipeBufAddrParams, pipeBufAddrParams);
+        RUN_FRAME_FEATURE_INTERFACE(tile, SetVdencPipeBufAddrParams, pipeBufAddrParams);
         
 //TODO:  comment out 
         /*
@@ -830,13 +2853,28 @@ namespace encode
     {
         ENCODE_FUNC_CALL();
 
-        MHW_VDBOX_PIPE_BUF_ADDR_PARAMS_G12 pipeBufAddrParams = {};
+        MHW_VDBOX_PIPE_BUF_ADDR_PARAMS_OFFSET_G12 pipeBufAddrParams = {};
         SetHcpPipeBufAddrParams(pipeBufAddrParams);
 #ifdef _MMC_SUPPORTED
         //m_mmcState->SetPipeBufAddr(m_pipeBufAddrParams);
 #endif
 
-        ENCODE_CHK_STATUS_RETURN(m_hcpInterface->AddHcpPipeBufAddrCmd(&cmdBuffer, &pipeBufAddrParams));
+        ENCODE_CHK_STATUS_RETURN(CheckOptionalBuffers(pipeBufAddrParams));
+
+        // Buffers are only packed with an HCP interface which programs the offsets
+        if (m_hcpBufOffsetInterface == nullptr)
+        {
+            ENCODE_CHK_STATUS_RETURN(m_hcpInterface->AddHcpPipeBufAddrCmd(&cmdBuffer, &pipeBufAddrParams));
+            return MOS_STATUS_SUCCESS;
+        }
+
+        // Offsets of the buffers which are not packed stay 0
+        pipeBufAddrParams.dwMetadataLineBufferOffset        = m_scratchBuffers[scratchMetadataLine].offset;
+        pipeBufAddrParams.dwMetadataTileLineBufferOffset    = m_scratchBuffers[scratchMetadataTileLine].offset;
+        pipeBufAddrParams.dwMetadataTileColumnBufferOffset  = m_scratchBuffers[scratchMetadataTileColumn].offset;
+        pipeBufAddrParams.dwLcuILDBStreamOutBufferOffset    = m_scratchBuffers[scratchLcuIldbStreamOut].offset;
+        pipeBufAddrParams.dwSseSrcPixelRowStoreBufferOffset = m_scratchBuffers[scratchSseSrcPixelRowStore].offset;
+        ENCODE_CHK_STATUS_RETURN(m_hcpBufOffsetInterface->AddHcpPipeBufAddrCmdWithOffsets(&cmdBuffer, &pipeBufAddrParams));
 
         return MOS_STATUS_SUCCESS;
     }
@@ -854,10 +2892,194 @@ namespace encode
 
         ENCODE_CHK_STATUS_RETURN(AddHcpIndObjBaseAddrCmd(cmdBuffer));
 
+        ENCODE_CHK_STATUS_RETURN(AddHcpQmCmds(cmdBuffer));
+        return MOS_STATUS_SUCCESS;
+    }
+
+    MOS_STATUS HevcVdencPktG12::AddHcpQmCmds(MOS_COMMAND_BUFFER &cmdBuffer)
+    {
+        ENCODE_FUNC_CALL();
+
+        if (!m_pictureCmdTemplatesEnabled)
+        {
+            return AddHcpQmStateCmd(cmdBuffer);
+        }
+
+        m_qmKey.scalingListEnable = m_hevcSeqParams->scaling_list_enable_flag;
+        m_qmKey.iqMatrixPresent   = (m_basicFeature->m_hevcIqMatrixParams != nullptr);
+        if (m_basicFeature->m_hevcIqMatrixParams != nullptr)
+        {
+            m_qmKey.iqMatrix = *m_basicFeature->m_hevcIqMatrixParams;
+        }
+        else
+        {
+            MOS_ZeroMemory(&m_qmKey.iqMatrix, sizeof(m_qmKey.iqMatrix));
+        }
+
+        if (m_hcpQmTemplate.IsValid(&m_qmKey, sizeof(m_qmKey)))
+        {
+            return m_hcpQmTemplate.Replay(cmdBuffer);
+        }
+
+        m_hcpQmTemplate.BeginRecord(cmdBuffer);
         ENCODE_CHK_STATUS_RETURN(AddHcpQmStateCmd(cmdBuffer));
+        ENCODE_CHK_STATUS_RETURN(m_hcpQmTemplate.EndRecord(cmdBuffer, &m_qmKey, sizeof(m_qmKey)));
+
         return MOS_STATUS_SUCCESS;
     }
 
+    EncodeCmdTemplate *HevcVdencPktG12::GetHcpPipeModeTemplate()
+    {
+        if (!m_pictureCmdTemplatesEnabled)
+        {
+            return nullptr;
+        }
+
+        // Pipe mode select differs between the pipes and between the first and the later passes
+        uint32_t slot = m_pipeline->GetCurrentPipe() * 2 + (m_pipeline->IsFirstPass() ? 0 : 1);
+        return (slot < m_maxPipeModeTemplates) ? &m_hcpPipeModeTemplates[slot] : nullptr;
+    }
+
+    void HevcVdencPktG12::GetPipeModeKey(const MHW_VDBOX_PIPE_MODE_SELECT_PARAMS_G12 &params, HevcVdencPipeModeKeyG12 &key)
+    {
+        key.mode                       = params.Mode;
+        key.streamOutEnabled           = params.bStreamOutEnabled;
+        key.streamInEnabled            = params.bStreamInEnabled;
+        key.shortFormatInUse           = params.bShortFormatInUse;
+        key.saoFirstPass               = params.bSaoFirstPass;
+        key.deblockerStreamOutEnable   = params.bDeblockerStreamOutEnable;
+        key.vdencEnabled               = params.bVdencEnabled;
+        key.vdencStreamInEnable        = params.bVdencStreamInEnable;
+        key.vdencBitDepthMinus8        = params.ucVdencBitDepthMinus8;
+        key.pakThresholdCheckEnable    = params.bPakThresholdCheckEnable;
+        key.pakObjCmdStreamOutEnable   = params.bVdencPakObjCmdStreamOutEnable;
+        key.tlbPrefetchEnable          = params.bTlbPrefetchEnable;
+        key.chromaType                 = params.ChromaType;
+        key.format                     = params.Format;
+        key.iFrame                     = params.isIFrame;
+        key.ibcEnabled                 = params.bIBCEnabled;
+        key.tileBasedReplayMode        = params.bTileBasedReplayMode;
+        key.wirelessEncodeEnabled      = params.bWirelessEncodeEnabled;
+        key.wirelessSessionId          = params.ucWirelessSessionId;
+        key.rgbEncodingMode            = params.bRGBEncodingMode;
+        key.brcEnabled                 = params.bBRCEnabled;
+        key.streamingBufferEnabled     = params.bStreamingBufferEnabled;
+        key.randomAccess               = params.bIsRandomAccess;
+        key.pipeWorkMode               = params.PipeWorkMode;
+        key.multiEngineMode            = params.MultiEngineMode;
+        key.rdoqEnable                 = params.bRdoqEnable;
+        key.advancedRateControlEnable  = params.bAdvancedRateControlEnable;
+        key.pakFrameStreamOutEnable    = params.pakFrmLvlStrmoutEnable;
+        key.pakPipelineStreamOutEnable = params.pakPiplnStrmoutEnabled;
+        key.dynamicSliceEnable         = params.bDynamicSliceEnable;
+        key.mediaSoftResetCounter      = params.dwMediaSoftResetCounterValue;
+    }
+
+    const HevcVdencPicSurfacesKeyG12 &HevcVdencPktG12::GetPicSurfacesKey()
+    {
+        if (m_picSurfacesKeyValid)
+        {
+            return m_picSurfacesKey;
+        }
+
+        auto fillSurfaceKey = [](const MOS_SURFACE *surface, HevcVdencSurfaceKeyG12 &surfaceKey) {
+            if (surface == nullptr)
+            {
+                return;
+            }
+            surfaceKey.width           = surface->dwWidth;
+            surfaceKey.height          = surface->dwHeight;
+            surfaceKey.pitch           = surface->dwPitch;
+            surfaceKey.format          = surface->Format;
+            surfaceKey.tileType        = surface->TileType;
+            surfaceKey.uOffset         = surface->UPlaneOffset.iYOffset;
+            surfaceKey.vOffset         = surface->VPlaneOffset.iYOffset;
+            surfaceKey.compressed      = surface->bIsCompressed;
+            surfaceKey.compressionMode = surface->CompressionMode;
+        };
+
+        // Surfaces are keyed from the params their commands are built from
+        auto fillParamsKey = [&fillSurfaceKey](const MHW_VDBOX_SURFACE_PARAMS &params, HevcVdencSurfaceKeyG12 &surfaceKey) {
+            fillSurfaceKey(params.psSurface, surfaceKey);
+            surfaceKey.actualWidth    = params.dwActualWidth;
+            surfaceKey.actualHeight   = params.dwActualHeight;
+            surfaceKey.reconHeight    = params.dwReconSurfHeight;
+            surfaceKey.chromaType     = params.ChromaType;
+            surfaceKey.bitDepthLuma   = params.ucBitDepthLumaMinus8;
+            surfaceKey.bitDepthChroma = params.ucBitDepthChromaMinus8;
+            surfaceKey.mmcState       = params.mmcState;
+            surfaceKey.mmcSkipMask    = params.mmcSkipMask;
+        };
+
+        HevcVdencPicSurfacesKeyG12 &key = m_picSurfacesKey;
+        key = {};
+        key.frameWidth     = m_basicFeature->m_frameWidth;
+        key.frameHeight    = m_basicFeature->m_frameHeight;
+        key.bitDepthLuma   = m_hevcSeqParams->bit_depth_luma_minus8;
+        key.bitDepthChroma = m_hevcSeqParams->bit_depth_chroma_minus8;
+        key.chromaFormat   = m_hevcSeqParams->chroma_format_idc;
+
+        MHW_VDBOX_SURFACE_PARAMS surfaceParams;
+        MOS_ZeroMemory(&surfaceParams, sizeof(surfaceParams));
+        SetHcpSrcSurfaceParams(surfaceParams);
+        fillParamsKey(surfaceParams, key.hcpSrcSurface);
+
+        MOS_ZeroMemory(&surfaceParams, sizeof(surfaceParams));
+        SetHcpReconSurfaceParams(surfaceParams);
+        fillParamsKey(surfaceParams, key.hcpReconSurface);
+
+        MOS_ZeroMemory(&surfaceParams, sizeof(surfaceParams));
+        SetVdencSurfaceParams(surfaceParams);
+        fillParamsKey(surfaceParams, key.vdencSrcSurface);
+
+        MOS_ZeroMemory(&surfaceParams, sizeof(surfaceParams));
+        SetVdencReconSurfaceParams(surfaceParams);
+        fillParamsKey(surfaceParams, key.vdencRefSurface);
+
+        MHW_VDBOX_SURFACE_PARAMS dsSurfaceParams[2];
+        MOS_ZeroMemory(dsSurfaceParams, sizeof(dsSurfaceParams));
+        SetVdencDSSurfaceParams(dsSurfaceParams);
+        fillParamsKey(dsSurfaceParams[0], key.vdencDsSurfaces[0]);
+        fillParamsKey(dsSurfaceParams[1], key.vdencDsSurfaces[1]);
+
+        m_picSurfacesKeyValid = true;
+        return m_picSurfacesKey;
+    }
+
+    void HevcVdencPktG12::InvalidatePictureCmdTemplates()
+    {
+        for (auto &pipeModeTemplate : m_hcpPipeModeTemplates)
+        {
+            pipeModeTemplate.Invalidate();
+        }
+        m_hcpSurfacesTemplate.Invalidate();
+        m_hcpQmTemplate.Invalidate();
+        m_vdencSurfacesTemplate.Invalidate();
+        m_picSurfacesKeyValid = false;
+
+        // Tile level and 3rd level batches are rebuilt along with the templates
+        m_batchContentHashes.clear();
+    }
+
+    void HevcVdencPktG12::SetCmdPeephole(bool enable)
+    {
+        m_cmdPeepholeEnabled = enable;
+        m_cmdPeephole.ResetStats();
+    }
+
+    void HevcVdencPktG12::SetPassReplay(bool enable)
+    {
+        m_passReplayEnabled = enable;
+        m_passReplay.DiscardRecord();
+        m_passReplay.Invalidate();
+    }
+
+    void HevcVdencPktG12::SetPictureCmdTemplates(bool enable)
+    {
+        m_pictureCmdTemplatesEnabled = enable;
+        InvalidatePictureCmdTemplates();
+    }
+
     MOS_STATUS HevcVdencPktG12::AddHcpPipeModeSelect(
         MOS_COMMAND_BUFFER &cmdBuffer)
     {
@@ -866,26 +3088,80 @@ namespace encode
         MHW_VDBOX_VDENC_CONTROL_STATE_PARAMS  vdencControlStateParams;
         MHW_MI_VD_CONTROL_STATE_PARAMS        vdControlStateParams;
 
+        // Params are used by the later commands of the frame, so they are set even when the template is replayed
+        SetHcpPipeModeSelectParams(m_pipeModeSelectParams);
+
+        HevcVdencPipeModeKeyG12 key;
+        EncodeCmdTemplate *pipeModeTemplate = GetHcpPipeModeTemplate();
+        if (pipeModeTemplate != nullptr)
+        {
+            GetPipeModeKey(m_pipeModeSelectParams, key);
+            if (pipeModeTemplate->IsValid(&key, sizeof(key)))
+            {
+                return pipeModeTemplate->Replay(cmdBuffer);
+            }
+            pipeModeTemplate->BeginRecord(cmdBuffer);
+        }
+
         //set up VDENC_CONTROL_STATE command
         MOS_ZeroMemory(&vdencControlStateParams, sizeof(MHW_VDBOX_VDENC_CONTROL_STATE_PARAMS));
         vdencControlStateParams.bVdencInitialization = true;
-        ENCODE_CHK_STATUS_RETURN(
-            static_cast<MhwVdboxVdencInterfaceG12X*>(m_vdencInterface)->AddVdencControlStateCmd(&cmdBuffer, &vdencControlStateParams));
+        ENCODE_CHK_STATUS_RETURN(m_vdencInterfaceG12->AddVdencControlStateCmd(&cmdBuffer, &vdencControlStateParams));
 
         //set up VD_CONTROL_STATE command
         MOS_ZeroMemory(&vdControlStateParams, sizeof(MHW_MI_VD_CONTROL_STATE_PARAMS));
         vdControlStateParams.initialization = true;
-        MhwMiInterfaceG12 *miInterface = dynamic_cast<MhwMiInterfaceG12 *>(m_miInterface);
-        ENCODE_CHK_NULL_RETURN(miInterface);
-        ENCODE_CHK_STATUS_RETURN(miInterface->AddMiVdControlStateCmd(&cmdBuffer, &vdControlStateParams));
-
-        SetHcpPipeModeSelectParams(m_pipeModeSelectParams);
+        ENCODE_CHK_STATUS_RETURN(m_miInterfaceG12->AddMiVdControlStateCmd(&cmdBuffer, &vdControlStateParams));
 
         ENCODE_CHK_STATUS_RETURN(m_hcpInterface->AddHcpPipeModeSelectCmd(&cmdBuffer, &m_pipeModeSelectParams));
 
+        if (pipeModeTemplate != nullptr)
+        {
+            ENCODE_CHK_STATUS_RETURN(pipeModeTemplate->EndRecord(cmdBuffer, &key, sizeof(key)));
+        }
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    MOS_STATUS HevcVdencPktG12::GetWalkerNumberOfPipes(uint32_t numPipes, uint32_t &numberOfPipes)
+    {
+        ENCODE_FUNC_CALL();
+
+        switch (numPipes)
+        {
+        case 0:
+        case 1:
+            numberOfPipes = VDENC_PIPE_SINGLE_PIPE;
+            break;
+        case 2:
+            numberOfPipes = VDENC_PIPE_TWO_PIPE;
+            break;
+        case 4:
+            numberOfPipes = VDENC_PIPE_FOUR_PIPE;
+            break;
+        default:
+            // The other values of the field are invalid, 3 pipes included
+            numberOfPipes = VDENC_PIPE_INVALID;
+            ENCODE_ASSERTMESSAGE("Pipe number %d is not supported", numPipes);
+            return MOS_STATUS_INVALID_PARAMETER;
+        }
+
         return MOS_STATUS_SUCCESS;
     }
 
+    MHW_VDBOX_HCP_MULTI_ENGINE_MODE HevcVdencPktG12::GetMultiEngineMode(uint32_t pipe, uint32_t numPipes)
+    {
+        if (numPipes <= 1)
+        {
+            return MHW_VDBOX_HCP_MULTI_ENGINE_MODE_FE_LEGACY;
+        }
+        if (pipe == 0)
+        {
+            return MHW_VDBOX_HCP_MULTI_ENGINE_MODE_LEFT;
+        }
+        return (pipe + 1 >= numPipes) ? MHW_VDBOX_HCP_MULTI_ENGINE_MODE_RIGHT : MHW_VDBOX_HCP_MULTI_ENGINE_MODE_MIDDLE;
+    }
+
     void HevcVdencPktG12::SetHcpPipeModeSelectParams(MHW_VDBOX_PIPE_MODE_SELECT_PARAMS& vdboxPipeModeSelectParams)
     {
         ENCODE_FUNC_CALL();
@@ -897,19 +3173,8 @@ namespace encode
         if (m_pipeline->GetPipeNum() > 1)
         {
             // Running in the multiple VDBOX mode
-            if (m_pipeline->IsFirstPipe())
-            {
-                pipeModeSelectParams.MultiEngineMode = MHW_VDBOX_HCP_MULTI_ENGINE_MODE_LEFT;
-            }
-            else if (m_pipeline->IsLastPipe())
-            {
-                pipeModeSelectParams.MultiEngineMode = MHW_VDBOX_HCP_MULTI_ENGINE_MODE_RIGHT;
-            }
-            else
-            {
-                pipeModeSelectParams.MultiEngineMode = MHW_VDBOX_HCP_MULTI_ENGINE_MODE_MIDDLE;
-            }
-            pipeModeSelectParams.PipeWorkMode = MHW_VDBOX_HCP_PIPE_WORK_MODE_CODEC_BE;
+            pipeModeSelectParams.MultiEngineMode = GetMultiEngineMode(m_pipeline->GetCurrentPipe(), m_pipeline->GetPipeNum());
+            pipeModeSelectParams.PipeWorkMode    = MHW_VDBOX_HCP_PIPE_WORK_MODE_CODEC_BE;
         }
         else
         {
@@ -917,7 +3182,7 @@ namespace encode
             pipeModeSelectParams.PipeWorkMode = MHW_VDBOX_HCP_PIPE_WORK_MODE_LEGACY;
         }
 
-        RUN_FEATURE_INTERFACE(EncodeTile, FeatureIDs::encodeTile, SetHcpPipeModeSelectParams, pipeModeSelectParams);
+        RUN_FRAME_FEATURE_INTERFACE(tile, SetHcpPipeModeSelectParams, pipeModeSelectParams);
         // In single pipe mode, if TileBasedReplayMode is enabled, the bit stream for each tile will not be continuous
         if (m_hevcPicParams->tiles_enabled_flag)
         {
@@ -933,14 +3198,23 @@ namespace encode
             pipeModeSelectParams.bStreamingBufferEnabled = true;
         }
 
-        RUN_FEATURE_INTERFACE(HEVCEncodeBRC, FeatureIDs::hevcBrcFeature,
-            SetHcpPipeModeSelectParams, pipeModeSelectParams);
+        RUN_FRAME_FEATURE_INTERFACE(brc, SetHcpPipeModeSelectParams, pipeModeSelectParams);
     }
 
     MOS_STATUS HevcVdencPktG12::AddHcpSurfaces(MOS_COMMAND_BUFFER &cmdBuffer)
     {
         ENCODE_FUNC_CALL();
 
+        if (m_pictureCmdTemplatesEnabled)
+        {
+            const HevcVdencPicSurfacesKeyG12 &key = GetPicSurfacesKey();
+            if (m_hcpSurfacesTemplate.IsValid(&key, sizeof(key)))
+            {
+                return m_hcpSurfacesTemplate.Replay(cmdBuffer);
+            }
+            m_hcpSurfacesTemplate.BeginRecord(cmdBuffer);
+        }
+
         ENCODE_CHK_STATUS_RETURN(HevcVdencPkt::AddHcpSurfaces(cmdBuffer));
 
         // Add the surface state for reference picture, GEN12 HW change (GEN:HAS:1209978040)
@@ -948,6 +3222,11 @@ namespace encode
         SetHcpReconSurfaceParams(reconSurfaceParams);
         reconSurfaceParams.ucSurfaceStateId = CODECHAL_HCP_REF_SURFACE_ID;
         ENCODE_CHK_STATUS_RETURN(m_hcpInterface->AddHcpSurfaceCmd(&cmdBuffer, &reconSurfaceParams));
+
+        if (m_pictureCmdTemplatesEnabled)
+        {
+            ENCODE_CHK_STATUS_RETURN(m_hcpSurfacesTemplate.EndRecord(cmdBuffer, &m_picSurfacesKey, sizeof(m_picSurfacesKey)));
+        }
         return MOS_STATUS_SUCCESS;
     }
 
@@ -1002,8 +3281,7 @@ namespace encode
         // For dynamic slice, 2nd pass is still VDEnc + PAK pass, not PAK only pass.
         sliceStateParams.bIntraRefFetchDisable = m_pakOnlyPass;
 
-        RUN_FEATURE_INTERFACE(HEVCEncodeBRC, FeatureIDs::hevcBrcFeature,
-            SetHcpSliceStateCommonParams, sliceStateParams, m_pipeline->m_currRecycledBufIdx);
+        RUN_FRAME_FEATURE_INTERFACE(brc, SetHcpSliceStateCommonParams, sliceStateParams, m_pipeline->m_currRecycledBufIdx);
     }
 
     MOS_STATUS HevcVdencPktG12::SetHcpSliceStateParams(
@@ -1013,9 +3291,20 @@ namespace encode
     {
         ENCODE_FUNC_CALL();
 
+        return SetHcpSliceStateParamsInTile(sliceStateParams, slcData, currSlcIdx, m_lastSliceInTile);
+    }
+
+    MOS_STATUS HevcVdencPktG12::SetHcpSliceStateParamsInTile(
+        MHW_VDBOX_HEVC_SLICE_STATE  &sliceStateParams,
+        PCODEC_ENCODER_SLCDATA      slcData,
+        uint32_t                    currSlcIdx,
+        bool                        lastSliceInTile)
+    {
+        ENCODE_FUNC_CALL();
+
         HevcVdencPkt::SetHcpSliceStateParams(sliceStateParams, slcData, currSlcIdx);
 
-        RUN_FEATURE_INTERFACE(EncodeTile, FeatureIDs::encodeTile, SetHcpSliceStateParams, sliceStateParams, m_lastSliceInTile);
+        RUN_FRAME_FEATURE_INTERFACE(tile, SetHcpSliceStateParams, sliceStateParams, lastSliceInTile);
         return MOS_STATUS_SUCCESS;
     }
 
@@ -1092,7 +3381,295 @@ namespace encode
                 &m_defaultPicturePatchListSize,
                 &stateCmdSizeParams));
 
+        uint32_t hcpSliceSize           = 0;
+        uint32_t hcpSlicePatchListSize  = 0;
+        ENCODE_CHK_STATUS_RETURN(
+            m_hwInterface->GetHxxPrimitiveCommandSize(
+                CODECHAL_ENCODE_MODE_HEVC,
+                &hcpSliceSize,
+                &hcpSlicePatchListSize,
+                false));
+
+        uint32_t vdencSliceSize          = 0;
+        uint32_t vdencSlicePatchListSize = 0;
+        ENCODE_CHK_STATUS_RETURN(
+            m_vdencInterface->GetVdencPrimitiveCommandSize(
+                CODECHAL_ENCODE_MODE_HEVC,
+                &vdencSliceSize,
+                &vdencSlicePatchListSize));
+
+        m_sliceCmdSize       = hcpSliceSize + vdencSliceSize;
+        m_slicePatchListSize = hcpSlicePatchListSize + vdencSlicePatchListSize;
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    MOS_STATUS HevcVdencPktG12::EstimatePassCommandSize(uint32_t &commandBufferSize, uint32_t &patchListSize)
+    {
+        ENCODE_FUNC_CALL();
+
+        ENCODE_CHK_NULL_RETURN(m_featureManager);
+
+        // Read from the features, the size may be asked before Prepare() takes the frame snapshot
+        bool    tileEnabled    = false;
+        uint8_t numTileRows    = 1;
+        uint8_t numTileColumns = 1;
+        auto    tile           = static_cast<EncodeTile *>(m_featureManager->GetFeature(FeatureIDs::encodeTile));
+        if (tile != nullptr)
+        {
+            tile->IsEnabled(tileEnabled);
+            if (tileEnabled)
+            {
+                ENCODE_CHK_STATUS_RETURN(tile->GetTileRowColumns(numTileRows, numTileColumns));
+            }
+        }
+
+        uint32_t numPipes = MOS_MAX(1, (uint32_t)m_pipeline->GetNumPipes());
+
+        // Patch list entries of the MI commands, one per address they carry
+        constexpr uint32_t sdiPatches        = 1;  // MI_STORE_DATA_IMM
+        constexpr uint32_t srmPatches        = 1;  // MI_STORE_REGISTER_MEM
+        constexpr uint32_t flushPatches      = 1;  // MI_FLUSH_DW with post sync write
+        constexpr uint32_t copyMemMemPatches = 2;  // MI_COPY_MEM_MEM source and destination
+        constexpr uint32_t atomicPatches     = 1;  // MI_ATOMIC
+        constexpr uint32_t semaphorePatches  = 1;  // MI_SEMAPHORE_WAIT
+        constexpr uint32_t batchStartPatches = 1;  // MI_BATCH_BUFFER_START
+
+        // Frame start: semaphore reset of every pipe, force wakeup, watchdog start and the
+        // prolog with the frame tracking tag and the generic register setup
+        uint32_t headSize =
+            numPipes * mhw_mi_g12_X::MI_STORE_DATA_IMM_CMD::byteSize +
+            mhw_mi_g12_X::MI_FORCE_WAKEUP_CMD::byteSize +
+            6 * mhw_mi_g12_X::MI_LOAD_REGISTER_IMM_CMD::byteSize +
+            mhw_mi_g12_X::MI_STORE_DATA_IMM_CMD::byteSize +
+            mhw_mi_g12_X::MI_FLUSH_DW_CMD::byteSize;
+        uint32_t headPatchListSize = numPipes * sdiPatches + sdiPatches + flushPatches;
+
+        // Status report start and end with the PAK registers, the SSE and slice size reads,
+        // and the global count update of the last pass
+        uint32_t statusSize =
+            2 * mhw_mi_g12_X::MI_STORE_DATA_IMM_CMD::byteSize +
+            2 * mhw_mi_g12_X::MI_STORE_REGISTER_MEM_CMD::byteSize +
+            mhw_mi_g12_X::MI_FLUSH_DW_CMD::byteSize +
+            8 * mhw_mi_g12_X::MI_STORE_REGISTER_MEM_CMD::byteSize +
+            6 * mhw_mi_g12_X::MI_STORE_REGISTER_MEM_CMD::byteSize +
+            2 * mhw_mi_g12_X::MI_COPY_MEM_MEM_CMD::byteSize + mhw_mi_g12_X::MI_STORE_REGISTER_MEM_CMD::byteSize +
+            mhw_mi_g12_X::MI_FLUSH_DW_CMD::byteSize +
+            mhw_mi_g12_X::MI_STORE_DATA_IMM_CMD::byteSize + mhw_mi_g12_X::MI_ATOMIC_CMD::byteSize;
+        uint32_t statusPatchListSize =
+            2 * sdiPatches +
+            2 * srmPatches +
+            flushPatches +
+            8 * srmPatches +
+            6 * srmPatches +
+            2 * copyMemMemPatches + srmPatches +
+            flushPatches +
+            sdiPatches + atomicPatches;
+
+        // Frame end: stream end, flushes, memory implicit flush, the sync of every pipe and
+        // the watchdog stop
+        uint32_t tailSize =
+            mhw_vdbox_hcp_g12_X::HCP_PAK_INSERT_OBJECT_CMD::byteSize + 2 * sizeof(uint32_t) +
+            2 * mhw_mi_g12_X::MI_FLUSH_DW_CMD::byteSize +
+            mhw_vdbox_vdenc_g12_X::VD_PIPELINE_FLUSH_CMD::byteSize +
+            mhw_mi_g12_X::VD_CONTROL_STATE_CMD::byteSize +
+            numPipes * (mhw_mi_g12_X::MI_SEMAPHORE_WAIT_CMD::byteSize + mhw_mi_g12_X::MI_ATOMIC_CMD::byteSize) +
+            mhw_mi_g12_X::MI_LOAD_REGISTER_IMM_CMD::byteSize;
+        uint32_t tailPatchListSize = numPipes * (semaphorePatches + atomicPatches);
+
+        // Each part is reserved by ReserveCmdSpace() before it is added
+        m_pictureCmdSize    = m_defaultPictureStatesSize + headSize + statusSize;
+        m_tileStartsCmdSize = 0;
+        m_tailCmdSize       = tailSize + statusSize;
+
+        commandBufferSize = m_defaultPictureStatesSize + headSize + statusSize + tailSize + m_cmdChainReserve;
+        patchListSize     = m_defaultPicturePatchListSize + headPatchListSize + statusPatchListSize + tailPatchListSize;
+
+        if (tileEnabled)
+        {
+            // Slice commands live in the tile level batches, each pipe only starts its own tiles
+            uint32_t numColumnsInPipe = numTileColumns;
+            if (numPipes > 1 && m_tileColumnScheduler.GetNumColumns() == numTileColumns)
+            {
+                numColumnsInPipe = m_tileColumnScheduler.GetMaxColumnsPerPipe();
+            }
+            uint32_t numTilesInPipe = numTileRows * numColumnsInPipe * m_NumPassesForTileReplay;
+            m_tileStartsCmdSize = numTilesInPipe * mhw_mi_g12_X::MI_BATCH_BUFFER_START_CMD::byteSize;
+            patchListSize      += numTilesInPipe * batchStartPatches;
+
+            if (IsTileRowSyncActive())
+            {
+                // Wait and signal of each tile row, and of the frame
+                m_tileStartsCmdSize += (numTileRows + 1) *
+                    (numPipes * mhw_mi_g12_X::MI_SEMAPHORE_WAIT_CMD::byteSize + mhw_mi_g12_X::MI_FLUSH_DW_CMD::byteSize);
+                patchListSize       += (numTileRows + 1) * (numPipes * semaphorePatches + flushPatches);
+            }
+            commandBufferSize += m_tileStartsCmdSize;
+        }
+        else
+        {
+            commandBufferSize += m_basicFeature->m_numSlices * m_sliceCmdSize;
+            patchListSize     += m_basicFeature->m_numSlices * m_slicePatchListSize;
+        }
+
+        if (IsFrameParallelActive())
+        {
+            // Waits for the other engines and the frame signal
+            uint32_t numEngines = m_frameParallelTracker->GetNumEngines();
+            m_pictureCmdSize  += numEngines * mhw_mi_g12_X::MI_SEMAPHORE_WAIT_CMD::byteSize;
+            m_tailCmdSize     += mhw_mi_g12_X::MI_FLUSH_DW_CMD::byteSize;
+            commandBufferSize += numEngines * mhw_mi_g12_X::MI_SEMAPHORE_WAIT_CMD::byteSize + mhw_mi_g12_X::MI_FLUSH_DW_CMD::byteSize;
+            patchListSize     += numEngines * semaphorePatches + flushPatches;
+        }
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    MOS_STATUS HevcVdencPktG12::CalculateCommandSize(
+        uint32_t &commandBufferSize,
+        uint32_t &requestedPatchListSize)
+    {
+        ENCODE_FUNC_CALL();
+
+        uint32_t passCmdSize       = 0;
+        uint32_t passPatchListSize = 0;
+        ENCODE_CHK_STATUS_RETURN(EstimatePassCommandSize(passCmdSize, passPatchListSize));
+
+        // All the passes go into one command buffer in single task phase mode
+        uint32_t numPasses = m_pipeline->IsSingleTaskPhaseSupported() ? MOS_MAX(1, (uint32_t)m_pipeline->GetPassNum()) : 1;
+
+        // The margin covers the commands whose size follows the content, such as the inserted
+        // headers, a pass which still does not fit continues in an overflow batch buffer.
+        // 4K align since allocation is in chunks of 4K bytes
+        uint32_t cmdSize       = passCmdSize * numPasses;
+        commandBufferSize      = MOS_ALIGN_CEIL(cmdSize + MOS_MIN(cmdSize / 16, CODECHAL_PAGE_SIZE), CODECHAL_PAGE_SIZE);
+        requestedPatchListSize = (passPatchListSize + m_cmdOverflowPatchListSize) * numPasses;
+        m_passCmdSizeEstimate  = passCmdSize;
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    void HevcVdencPktG12::CheckCmdSize(uint32_t writtenSize)
+    {
+        if (m_passCmdSizeEstimate == 0)
+        {
+            // No estimate was asked for this frame
+            return;
+        }
+
+        m_cmdSizeStats.checkedSubmits++;
+        m_cmdSizeStats.maxWritten  = MOS_MAX(m_cmdSizeStats.maxWritten, writtenSize);
+        m_cmdSizeStats.maxEstimate = MOS_MAX(m_cmdSizeStats.maxEstimate, m_passCmdSizeEstimate);
+
+        if (writtenSize > m_passCmdSizeEstimate)
+        {
+            ENCODE_ASSERTMESSAGE("Packet wrote %d bytes while %d bytes were estimated", writtenSize, m_passCmdSizeEstimate);
+            m_cmdSizeStats.overruns++;
+        }
+    }
+
+    MOS_STATUS HevcVdencPktG12::AddChainedBatchStart(MOS_COMMAND_BUFFER &cmdBuffer, PMHW_BATCH_BUFFER batchBuffer)
+    {
+        ENCODE_FUNC_CALL();
+
+        uint32_t *cmd = cmdBuffer.pCmdPtr;
+        ENCODE_CHK_STATUS_RETURN(m_miInterface->AddMiBatchBufferStartCmd(&cmdBuffer, batchBuffer));
+
+        // Clear the second level bit, the commands continue in the batch buffer and do not return
+        constexpr uint32_t miBatchBufferStartHeader = 0x31 << 23;
+        constexpr uint32_t secondLevelBatchBuffer   = 1 << 22;
+        if (EncodeCmdWalker::IsMiCmd(cmd[0], miBatchBufferStartHeader))
+        {
+            cmd[0] &= ~secondLevelBatchBuffer;
+        }
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    MOS_STATUS HevcVdencPktG12::ReserveCmdSpace(MOS_COMMAND_BUFFER &cmdBuffer, uint32_t size)
+    {
+        ENCODE_FUNC_CALL();
+
+        if (cmdBuffer.iRemaining >= (int32_t)(size + m_cmdChainReserve))
+        {
+            return MOS_STATUS_SUCCESS;
+        }
+
+        // A whole pass fits into one overflow batch buffer as long as the estimate holds
+        uint32_t overflowSize = MOS_ALIGN_CEIL(MOS_MAX(size, m_passCmdSizeEstimate) + m_cmdChainReserve, CODECHAL_PAGE_SIZE);
+
+        PMHW_BATCH_BUFFER overflow = nullptr;
+        ENCODE_CHK_STATUS_RETURN(m_cmdOverflowRing.Acquire(m_osInterface, overflowSize, GetCompletedFence(), overflow));
+
+        MOS_STATUS status = AddChainedBatchStart(cmdBuffer, overflow);
+        if (status != MOS_STATUS_SUCCESS)
+        {
+            // Not read by any submission
+            m_cmdOverflowRing.Retire(overflow, GetCompletedFence());
+            return status;
+        }
+
+        if (!m_cmdOverflowActive)
+        {
+            // The pass returns to the primary buffer right after the chain
+            m_cmdOverflowBatches.clear();
+            m_cmdOverflowPrimary = cmdBuffer;
+            m_cmdOverflowActive  = true;
+        }
+        else
+        {
+            m_cmdOverflowBatches.back()->iCurrent = cmdBuffer.iOffset;
+        }
+        m_cmdOverflowBatches.push_back(overflow);
+
+        ENCODE_NORMALMESSAGE("Command buffer has %d bytes left while %d bytes are needed, continuing in an overflow batch buffer",
+            cmdBuffer.iRemaining, size);
+
+        cmdBuffer.OsResource = overflow->OsResource;
+        cmdBuffer.pCmdBase   = (uint32_t *)overflow->pData;
+        cmdBuffer.pCmdPtr    = cmdBuffer.pCmdBase;
+        cmdBuffer.iOffset    = 0;
+        cmdBuffer.iRemaining = overflow->iSize;
+
         return MOS_STATUS_SUCCESS;
     }
+
+    MOS_STATUS HevcVdencPktG12::EndCmdOverflow(MOS_COMMAND_BUFFER &cmdBuffer, bool chainBack)
+    {
+        ENCODE_FUNC_CALL();
+
+        if (!m_cmdOverflowActive)
+        {
+            m_cmdOverflowBatches.clear();
+            m_cmdOverflowBytes = 0;
+            return MOS_STATUS_SUCCESS;
+        }
+
+        MOS_STATUS status = MOS_STATUS_SUCCESS;
+        if (chainBack)
+        {
+            MOS_ZeroMemory(&m_cmdOverflowReturn, sizeof(m_cmdOverflowReturn));
+            m_cmdOverflowReturn.OsResource = m_cmdOverflowPrimary.OsResource;
+            m_cmdOverflowReturn.iSize      = m_cmdOverflowPrimary.iOffset + m_cmdOverflowPrimary.iRemaining;
+            m_cmdOverflowReturn.dwOffset   = m_cmdOverflowPrimary.iOffset;
+            status = AddChainedBatchStart(cmdBuffer, &m_cmdOverflowReturn);
+        }
+        m_cmdOverflowBatches.back()->iCurrent = cmdBuffer.iOffset;
+
+        // Overflow batch buffers are read by the submission of the primary buffer
+        uint32_t fence     = GetSubmissionFence();
+        m_cmdOverflowBytes = 0;
+        for (auto overflow : m_cmdOverflowBatches)
+        {
+            m_cmdOverflowBytes += overflow->iCurrent;
+            m_cmdOverflowRing.Retire(overflow, fence);
+        }
+
+        cmdBuffer           = m_cmdOverflowPrimary;
+        m_cmdOverflowActive = false;
+        m_cmdSizeStats.overflows++;
+
+        return status;
+    }
 }
 
@@ -32,7 +32,26 @@
 #include "mhw_vdbox_vdenc_g12_X.h"
 #include "mhw_mi_g12_X.h"
 #include "mhw_render_g12_X.h"
+#include "mhw_vdbox_hcp_buf_offset_g12.h"
 #include "encode_hevc_vdenc_packet.h"
+#include "encode_worker_pool.h"
+#include "encode_cmd_template.h"
+#include "encode_param_arena.h"
+#include "encode_cmd_peephole.h"
+#include "encode_pass_replay.h"
+#include "encode_deferred_patch_list.h"
+#include "encode_shared_resource_pool.h"
+#include "encode_linear_suballocator.h"
+#include "encode_resource_inventory.h"
+#include "encode_batch_buffer_ring.h"
+#include "encode_recycled_slot_manager.h"
+#include "encode_content_hash.h"
+#include "encode_tile_column_scheduler.h"
+#include "encode_frame_dependency_tracker.h"
+#include <algorithm>
+#include <map>
+#include <thread>
+#include <vector>
 
 namespace encode
 {
@@ -80,50 +99,945 @@ namespace encode
     };
 
 
+    //!
+    //! \struct HevcVdencTileBatchContextG12
+    //! \brief  State captured for one tile before its tile level batch is built
+    //!
+    struct HevcVdencTileBatchContextG12
+    {
+        uint32_t                                    tileRow     = 0;       //!< Tile row index
+        uint32_t                                    tileCol     = 0;       //!< Tile column index
+        uint32_t                                    tileRowPass = 0;       //!< Tile row replay pass
+        uint32_t                                    pipe        = 0;       //!< Pipe which encodes the tile
+        MOS_COMMAND_BUFFER                          tileBatchBuf = {};     //!< Tile level batch being patched
+        MHW_VDBOX_PIPE_MODE_SELECT_PARAMS_G12       pipeModeSelectParams = {};  //!< Private copy of the pipe mode select params
+        MHW_VDBOX_HCP_TILE_CODING_PARAMS_G12        tileCodingParams = {}; //!< HCP_TILE_CODING params of the tile
+        std::vector<MHW_VDBOX_HEVC_SLICE_STATE_G12> sliceStates;           //!< Slice state params of the slices in the tile, with their last slice in tile flag
+        PMHW_BATCH_BUFFER                           batchBuffer = nullptr; //!< Tile level batch buffer
+        uint64_t                                    contentHash = 0;       //!< Hash of the inputs of the tile level batch
+        EncodeDeferredPatchList                     patchList;             //!< Patch list calls of a tile level batch built on a worker thread
+        bool                                        reuse       = false;   //!< Batch buffer already holds the commands of the inputs
+    };
+
+    //!
+    //! \struct HevcVdencPipeModeKeyG12
+    //! \brief  Fields of the pipe mode select params the HCP_PIPE_MODE_SELECT command depends on
+    //! \details Template keys are compared byte by byte, so they only hold 32 bit fields
+    //!          copied one by one and have no padding. Every field the HCP and VDENC pipe
+    //!          mode select commands read is in the key.
+    //!
+    struct HevcVdencPipeModeKeyG12
+    {
+        uint32_t mode                       = 0;
+        uint32_t streamOutEnabled           = 0;
+        uint32_t streamInEnabled            = 0;
+        uint32_t shortFormatInUse           = 0;
+        uint32_t saoFirstPass               = 0;
+        uint32_t deblockerStreamOutEnable   = 0;
+        uint32_t vdencEnabled               = 0;
+        uint32_t vdencStreamInEnable        = 0;
+        uint32_t vdencBitDepthMinus8        = 0;
+        uint32_t pakThresholdCheckEnable    = 0;
+        uint32_t pakObjCmdStreamOutEnable   = 0;
+        uint32_t tlbPrefetchEnable          = 0;
+        uint32_t chromaType                 = 0;
+        uint32_t format                     = 0;
+        uint32_t iFrame                     = 0;
+        uint32_t ibcEnabled                 = 0;
+        uint32_t tileBasedReplayMode        = 0;
+        uint32_t wirelessEncodeEnabled      = 0;
+        uint32_t wirelessSessionId          = 0;
+        uint32_t rgbEncodingMode            = 0;
+        uint32_t brcEnabled                 = 0;
+        uint32_t streamingBufferEnabled     = 0;
+        uint32_t randomAccess               = 0;
+        uint32_t pipeWorkMode               = 0;
+        uint32_t multiEngineMode            = 0;
+        uint32_t rdoqEnable                 = 0;
+        uint32_t advancedRateControlEnable  = 0;
+        uint32_t pakFrameStreamOutEnable    = 0;
+        uint32_t pakPipelineStreamOutEnable = 0;
+        uint32_t dynamicSliceEnable         = 0;
+        uint32_t mediaSoftResetCounter      = 0;
+    };
+
+    //!
+    //! \struct HevcVdencSurfaceKeyG12
+    //! \brief  Surface fields the picture level surface state commands depend on
+    //!
+    struct HevcVdencSurfaceKeyG12
+    {
+        uint32_t width           = 0;
+        uint32_t height          = 0;
+        uint32_t pitch           = 0;
+        uint32_t format          = 0;
+        uint32_t tileType        = 0;
+        int32_t  uOffset         = 0;
+        int32_t  vOffset         = 0;
+        uint32_t compressed      = 0;
+        uint32_t compressionMode = 0;
+        uint32_t actualWidth     = 0;  //!< Fields of the surface params, 0 for a plain surface
+        uint32_t actualHeight    = 0;
+        uint32_t reconHeight     = 0;
+        uint32_t chromaType      = 0;
+        uint32_t bitDepthLuma    = 0;
+        uint32_t bitDepthChroma  = 0;
+        uint32_t mmcState        = 0;
+        uint32_t mmcSkipMask     = 0;
+    };
+
+    //!
+    //! \struct HevcVdencPicSurfacesKeyG12
+    //! \brief  Inputs of the picture level HCP/VDENC surface state commands
+    //! \details Covers the source and recon surface states of HCP, the source and reference
+    //!          surface states of VDENC, and the 8x/4x downscaled reference surfaces of VDENC.
+    //!          Each one is keyed from the params its command is built from, MMC state included.
+    //!          The HCP reference surface state is built from the recon params as well.
+    //!
+    struct HevcVdencPicSurfacesKeyG12
+    {
+        uint32_t               frameWidth     = 0;
+        uint32_t               frameHeight    = 0;
+        uint32_t               bitDepthLuma   = 0;
+        uint32_t               bitDepthChroma = 0;
+        uint32_t               chromaFormat   = 0;
+        HevcVdencSurfaceKeyG12 hcpSrcSurface;
+        HevcVdencSurfaceKeyG12 hcpReconSurface;
+        HevcVdencSurfaceKeyG12 vdencSrcSurface;
+        HevcVdencSurfaceKeyG12 vdencRefSurface;
+        HevcVdencSurfaceKeyG12 vdencDsSurfaces[2];
+    };
+
+    //!
+    //! \struct HevcVdencQmKeyG12
+    //! \brief  Inputs of the HCP_QM_STATE/HCP_FQM_STATE commands
+    //!
+    struct HevcVdencQmKeyG12
+    {
+        uint32_t                       scalingListEnable = 0;
+        uint32_t                       iqMatrixPresent   = 0;
+        CODECHAL_HEVC_IQ_MATRIX_PARAMS iqMatrix          = {};
+    };
+
+    static_assert(sizeof(HevcVdencPipeModeKeyG12) == 31 * sizeof(uint32_t), "Pipe mode key has padding");
+    static_assert(sizeof(HevcVdencSurfaceKeyG12) == 17 * sizeof(uint32_t), "Surface key has padding");
+    static_assert(sizeof(HevcVdencPicSurfacesKeyG12) == 5 * sizeof(uint32_t) + 6 * sizeof(HevcVdencSurfaceKeyG12),
+        "Surface key has padding");
+    static_assert(sizeof(HevcVdencQmKeyG12) == 2 * sizeof(uint32_t) + sizeof(CODECHAL_HEVC_IQ_MATRIX_PARAMS),
+        "QM key has padding");
+
+    class HEVCEncodeBRC;
+    class EncodeTile;
+    class HevcVdencRoi;
+
+    //!
+    //! \struct HevcVdencFrameFeaturesG12
+    //! \brief  Features and feature flags of the current frame, resolved once in Prepare()
+    //!
+    struct HevcVdencFrameFeaturesG12
+    {
+        HEVCEncodeBRC    *brc                      = nullptr;  //!< BRC feature
+        EncodeTile       *tile                     = nullptr;  //!< Tile feature
+        HevcVdencRoi     *roi                      = nullptr;  //!< ROI feature
+        PMHW_BATCH_BUFFER vdenc2ndLevelBatchBuffer = nullptr;  //!< VDENC 2nd level batch of the recycled buffer index
+        bool              tileEnabled              = false;    //!< Tile is enabled
+        bool              roiEnabled               = false;    //!< ROI is enabled
+        bool              brcEnabled               = false;    //!< BRC is enabled
+        bool              acqpEnabled              = false;    //!< ACQP is enabled
+        bool              brcUpdateRequired        = false;    //!< HuC BRC update writes the picture states
+    };
+
+    //!
+    //! \struct HevcVdencSliceTileMapG12
+    //! \brief  Slices of every tile of the current frame, in CSR layout
+    //! \details The slices of tile i are tileSlices[tileSliceOffsets[i]] up to
+    //!          tileSlices[tileSliceOffsets[i + 1] - 1].
+    //!
+    struct HevcVdencSliceTileMapG12
+    {
+        uint32_t              numTileColumns = 0;  //!< Tile columns of the frame
+        std::vector<uint32_t> tileSliceOffsets;    //!< First entry of each tile in tileSlices, numTiles + 1 entries
+        std::vector<uint32_t> tileSlices;          //!< Slice indices grouped by tile
+        std::vector<uint32_t> sliceTile;           //!< Tile index of each slice
+        std::vector<uint8_t>  sliceLastInTile;     //!< Slice is the last one of its tile
+        std::vector<uint32_t> lcuColToTileCol;     //!< Tile column of each LCU column
+        std::vector<uint32_t> lcuRowToTileRow;     //!< Tile row of each LCU row
+        std::vector<uint32_t> tileColumnCtus;      //!< CTU count of each tile column
+        std::vector<uint32_t> tileSliceFill;       //!< Scratch fill positions
+    };
+
+    //!
+    //! \struct HevcVdencCmdSizeStatsG12
+    //! \brief  Estimated against written primary command buffer bytes
+    //!
+    struct HevcVdencCmdSizeStatsG12
+    {
+        uint32_t checkedSubmits = 0;  //!< Submissions checked
+        uint32_t overruns       = 0;  //!< Submissions which wrote more than estimated
+        uint32_t maxWritten     = 0;  //!< Largest submission in bytes
+        uint32_t maxEstimate    = 0;  //!< Largest per pass estimate in bytes
+        uint32_t overflows      = 0;  //!< Submissions which continued in an overflow batch buffer
+    };
+
+    //!
+    //! \struct HevcVdencBatchReuseStatsG12
+    //! \brief  Batches kept from an earlier frame against batches built again
+    //!
+    struct HevcVdencBatchReuseStatsG12
+    {
+        uint64_t thirdLevelHits   = 0;  //!< 3rd level batches reused
+        uint64_t thirdLevelMisses = 0;  //!< 3rd level batches built
+        uint64_t tileHits         = 0;  //!< Tile level batches reused
+        uint64_t tileMisses       = 0;  //!< Tile level batches built
+    };
+
+    //!
+    //! \enum   HevcVdencSharedResourceG12
+    //! \brief  Packet buffers which can be leased from EncodeSharedResourcePool
+    //!
+    enum HevcVdencSharedResourceG12
+    {
+        sharedPakStreamOut = 0,
+        sharedMetadataLine,
+        sharedMetadataTileLine,
+        sharedMetadataTileColumn,
+        sharedSseSrcPixelRowStore,
+        sharedPakCuLevelStreamOut,
+        sharedLcuIldbStreamOut,
+        sharedResourceNum
+    };
+
+    //!
+    //! \enum   HevcVdencOptionalBufferG12
+    //! \brief  Picture buffers which are only needed by some consumers
+    //!
+    enum HevcVdencOptionalBufferG12
+    {
+        optionalSseSrcPixelRowStore = 1 << 0,  //!< SSE and PSNR reporting
+        optionalLcuIldbStreamOut    = 1 << 1,  //!< LCU ILDB stream-out, not programmed yet
+        optionalPakCuLevelStreamOut = 1 << 2,  //!< PAK CU level stream-out consumers
+        optionalBufferAll           = optionalSseSrcPixelRowStore | optionalLcuIldbStreamOut | optionalPakCuLevelStreamOut
+    };
+
+    //!
+    //! \enum   HevcVdencScratchBufferG12
+    //! \brief  Small picture buffers which can be packed into one resource
+    //!
+    enum HevcVdencScratchBufferG12
+    {
+        scratchMetadataLine = 0,
+        scratchMetadataTileLine,
+        scratchMetadataTileColumn,
+        scratchLcuIldbStreamOut,
+        scratchSseSrcPixelRowStore,
+        scratchBufferNum
+    };
+
+    //!
+    //! \struct HevcVdencPicBufferConfigG12
+    //! \brief  Frame parameters the picture buffer sizes depend on
+    //!
+    struct HevcVdencPicBufferConfigG12
+    {
+        uint32_t width        = 0;
+        uint32_t height       = 0;
+        uint8_t  bitDepth     = 0;
+        uint8_t  chromaFormat = 0;
+    };
+
+    //!
+    //! \struct HevcVdencPicBufferInfoG12
+    //! \brief  Name, packed slot and member of a picture buffer
+    //!
+    struct HevcVdencPicBufferInfoG12
+    {
+        const char               *name     = nullptr;
+        HevcVdencScratchBufferG12 scratch  = scratchBufferNum;  //!< scratchBufferNum if the buffer is never packed
+        PMOS_RESOURCE            *resource = nullptr;
+    };
+
+    class HevcVdencPktG12Bench;
+
     class HevcVdencPktG12 : public HevcVdencPkt
     {
+        friend class HevcVdencPktG12Bench;
+
     public:
         HevcVdencPktG12(MediaPipeline *pipeline, MediaTask *task, CodechalHwInterface *hwInterface) :
             HevcVdencPkt(pipeline, task, hwInterface) { }
 
-        virtual ~HevcVdencPktG12() {}
+        virtual ~HevcVdencPktG12();
+
+        //!
+        //! \brief  Prepare the parameters for command submission
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        virtual MOS_STATUS Prepare() override;
+
+        //!
+        //! \brief  Add the command sequence into the commandBuffer and
+        //!         and return to the caller task
+        //! \param  [in] commandBuffer
+        //!         Pointer to the command buffer which is allocated by caller
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        virtual MOS_STATUS Submit(
+            MOS_COMMAND_BUFFER* commandBuffer,
+            uint8_t packetPhase = otherPacket) override;
+
+        void SetHcpPicStateParams(MHW_VDBOX_HEVC_PIC_STATE& picStateParams);
+        MOS_STATUS AddVdencCmd1Cmd(PMOS_COMMAND_BUFFER cmdBuffer, bool addToBatchBufferHuCBRC, bool isLowDelayB);
+        MOS_STATUS AddVdencCmd2Cmd(PMOS_COMMAND_BUFFER cmdBuffer, bool addToBatchBufferHuCBRC, bool isLowDelayB);
+
+        virtual MOS_STATUS CalculatePictureStateCommandSize() override;
+
+        //!
+        //! \brief  Calculate the command buffer and patch list sizes of the current frame
+        //! \details The sizes follow the slice count, the tile grid, the pipes and the passes
+        //!          of the frame. Tile frames only start their tile level batches from the
+        //!          primary buffer, so their size does not grow with the slice count.
+        //!          A margin of at most a page is added, a pass which still does not fit
+        //!          continues in an overflow batch buffer, see ReserveCmdSpace().
+        //! \param  [out] commandBufferSize
+        //!         Command buffer size in bytes
+        //! \param  [out] requestedPatchListSize
+        //!         Number of patch list entries
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        virtual MOS_STATUS CalculateCommandSize(
+            uint32_t &commandBufferSize,
+            uint32_t &requestedPatchListSize) override;
+
+        //!
+        //! \brief  Enable or disable checking the size estimate against each submission
+        //! \details A submission which writes more than estimated asserts and is counted
+        //!          as an overrun. The commands of the overflow batch buffers are counted
+        //!          as written.
+        //! \param  [in] enable
+        //!         true to check the written bytes
+        //! \return void
+        //!
+        void SetCmdSizeCheck(bool enable) { m_cmdSizeCheckEnabled = enable; }
+
+        //!
+        //! \brief  Get the statistics of the size check
+        //! \return const HevcVdencCmdSizeStatsG12 &
+        //!
+        const HevcVdencCmdSizeStatsG12 &GetCmdSizeStats() const { return m_cmdSizeStats; }
+
+        //!
+        //! \brief  Enable or disable packing the small picture buffers into one resource
+        //! \details Takes effect on the next AllocateResources(). The buffers are only packed
+        //!          if the HCP interface implements MhwVdboxHcpBufOffsetInterfaceG12, the
+        //!          stock G12 interface would program every buffer at offset 0.
+        //! \param  [in] enable
+        //!         true to sub-allocate the buffers of HevcVdencScratchBufferG12
+        //! \return void
+        //!
+        void SetScratchSubAllocation(bool enable) { m_scratchSubAllocEnabled = enable; }
+
+        //!
+        //! \brief  Enable or disable allocating the optional buffers on demand
+        //! \details Takes effect on the next AllocateResources(). A lazy session only
+        //!          allocates the buffers given to RequestOptionalBuffers(), so every
+        //!          consumer of them has to ask before its first frame. A frame which
+        //!          programs a buffer that was not requested fails.
+        //! \param  [in] enable
+        //!         true to defer the optional buffers
+        //! \return void
+        //!
+        void SetLazyOptionalBuffers(bool enable) { m_lazyOptionalBuffers = enable; }
+
+        //!
+        //! \brief  Ask for optional buffers, they are allocated by the next Prepare()
+        //! \param  [in] buffers
+        //!         Mask of HevcVdencOptionalBufferG12
+        //! \return void
+        //!
+        void RequestOptionalBuffers(uint32_t buffers) { m_optionalBufferRequests |= buffers; }
+
+        //!
+        //! \brief  Get the optional buffers which are not allocated
+        //! \return uint32_t
+        //!         Mask of HevcVdencOptionalBufferG12
+        //!
+        uint32_t GetUnmaterializedOptionalBuffers() const { return optionalBufferAll & ~m_optionalBuffersAllocated; }
+
+        //!
+        //! \brief  Resize the picture buffers for a new frame size or format
+        //! \details Only the buffers which outgrow their capacity are reallocated, the others
+        //!          are kept. Prepare() calls it when the basic feature reports a resolution
+        //!          change, a caller can also call it ahead of the switch. Before a buffer is
+        //!          replaced it waits for the last submission of the packet.
+        //! \param  [in] width
+        //!         Frame width in pixels
+        //! \param  [in] height
+        //!         Frame height in pixels
+        //! \param  [in] bitDepth
+        //!         Maximum bit depth
+        //! \param  [in] chromaFormat
+        //!         HCP chroma format
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS Reconfigure(
+            uint32_t width,
+            uint32_t height,
+            uint8_t  bitDepth,
+            uint8_t  chromaFormat);
+
+        //!
+        //! \brief  Get the allocated size of a picture buffer
+        //! \param  [in] resourceClass
+        //!         Buffer, one of HevcVdencSharedResourceG12
+        //! \return uint32_t
+        //!         Size in bytes, 0 if the buffer is not allocated
+        //!
+        uint32_t GetPictureBufferCapacity(uint32_t resourceClass) const
+        {
+            return resourceClass < sharedResourceNum ? m_picBufferCapacity[resourceClass] : 0;
+        }
+
+        //!
+        //! \brief  Enable or disable allocating the resources on a background thread
+        //! \details Takes effect on the next AllocateResources(), which then returns at once.
+        //!          The first Prepare() waits for the allocation, and the packet must not be
+        //!          used by the caller before it.
+        //! \param  [in] enable
+        //!         true to allocate in the background
+        //! \return void
+        //!
+        void SetAsyncAllocation(bool enable) { m_asyncAllocation = enable; }
+
+        //!
+        //! \brief  Wait for a background allocation to finish
+        //! \return MOS_STATUS
+        //!         Status of the allocation, MOS_STATUS_SUCCESS if none was started
+        //!
+        MOS_STATUS WaitForResources();
+
+        //!
+        //! \brief  Allocate the picture buffers of a profile into the shared resource pool
+        //! \details Sessions of the profile on the same adapter then lease the buffers
+        //!          instead of allocating them. The buffers are kept until
+        //!          EncodeSharedResourcePool::DrainWarm(). Packed scratch buffers are not pooled,
+        //!          so the sessions have to keep scratch sub-allocation off to use them.
+        //! \param  [in] config
+        //!         Frame size and format of the profile
+        //! \param  [in] numSessions
+        //!         Number of sessions to keep buffers ready for
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS PrewarmSharedResources(
+            const HevcVdencPicBufferConfigG12 &config,
+            uint32_t                           numSessions);
+
+        //!
+        //! \brief  Enable or disable the mapped ring for the PAK slice batch buffers
+        //! \details The slice commands of a frame go to a ring buffer which stays mapped, so
+        //!          they are no longer unlocked per frame. A ring buffer is reused once the
+        //!          GPU status tag shows its frame completed, and the ring grows while all
+        //!          its buffers are in flight. The PAK slice batch of the base packet is
+        //!          then never read by the GPU, so mapping it does not wait.
+        //! \param  [in] enable
+        //!         true to use the ring
+        //! \return void
+        //!
+        void SetPakSliceBatchRing(bool enable) { m_pakSliceBatchRingEnabled = enable; }
+
+        //!
+        //! \brief  Get the ring of the PAK slice batch buffers
+        //! \return const EncodeBatchBufferRing &
+        //!
+        const EncodeBatchBufferRing &GetPakSliceBatchRing() const { return m_pakSliceBatchRing; }
+
+        //!
+        //! \brief  Enable or disable checking the recycled buffer slot against the GPU
+        //! \details Prepare() waits until the previous frame using m_currRecycledBufIdx
+        //!          is completed, and the wait time is recorded in the slot statistics.
+        //!          The index itself comes from the round robin of the pipeline, the BRC
+        //!          packets of the frame use it before this packet is prepared.
+        //! \param  [in] enable
+        //!         true to track the slots
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS SetRecycledSlotTracking(bool enable);
+
+        //!
+        //! \brief  Get the manager of the recycled buffer slots
+        //! \return const EncodeRecycledSlotManager &
+        //!
+        const EncodeRecycledSlotManager &GetRecycledSlotManager() const { return m_recycledSlots; }
+
+        //!
+        //! \brief  Enable or disable reusing the tile level and 3rd level batches
+        //! \details A batch buffer is not patched again when the hash of the inputs of its
+        //!          commands equals the hash of the inputs it was last built from. The
+        //!          batches it starts are registered again for the frame instead.
+        //! \param  [in] enable
+        //!         true to reuse the batches
+        //! \return void
+        //!
+        void SetBatchReuse(bool enable);
+
+        //!
+        //! \brief  Get the statistics of the batch reuse
+        //! \return const HevcVdencBatchReuseStatsG12 &
+        //!
+        const HevcVdencBatchReuseStatsG12 &GetBatchReuseStats() const { return m_batchReuseStats; }
+
+        //!
+        //! \brief  Get the scheduler of the tile columns over the pipes
+        //! \details The pipeline can feed the per pipe cycle counts of the status report to
+        //!          UpdatePipeCycles(), the next frames are then split by measured cost.
+        //! \return EncodeTileColumnScheduler &
+        //!
+        EncodeTileColumnScheduler &GetTileColumnScheduler() { return m_tileColumnScheduler; }
+
+        //!
+        //! \brief  Get the VDENC_WALKER_STATE number of pipes of a pipe count
+        //! \details The field only has the single, two and four pipe modes, so 3 pipes
+        //!          and more than m_maxNumPipes are rejected.
+        //! \param  [in] numPipes
+        //!         Number of pipes, 0 is taken as 1
+        //! \param  [out] numberOfPipes
+        //!         Value of the field, VDENC_PIPE_INVALID if the count is not supported
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        static MOS_STATUS GetWalkerNumberOfPipes(uint32_t numPipes, uint32_t &numberOfPipes);
+
+        //!
+        //! \brief  Get the HCP multi engine mode of a pipe
+        //! \details The first pipe is the left engine, the last one the right engine and
+        //!          all the pipes between are middle engines.
+        //! \param  [in] pipe
+        //!         Pipe index
+        //! \param  [in] numPipes
+        //!         Number of pipes
+        //! \return MHW_VDBOX_HCP_MULTI_ENGINE_MODE
+        //!
+        static MHW_VDBOX_HCP_MULTI_ENGINE_MODE GetMultiEngineMode(uint32_t pipe, uint32_t numPipes);
+
+        static constexpr uint32_t m_maxNumPipes = 4;  //!< Pipes the walker state and the pipe mode templates support
+
+        //!
+        //! \brief  Enable or disable syncing the pipes per tile row
+        //! \details Each pipe signals its tile rows of the last pass, and the first pass of the
+        //!          next frame waits per tile row for the rows of the other pipes it
+        //!          references, instead of a frame barrier. Only the first pipe still waits
+        //!          for the frame of the others, the PAK integration reads all of them.
+        //! \param  [in] enable
+        //!         true to sync per tile row
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS SetTileRowSync(bool enable);
+
+        //!
+        //! \brief  Bind the packet to a VDBOX of frame parallel encoding
+        //! \details The frames of a stream are spread over several packets, one per engine
+        //!          with its own GPU context, which share the tracker. The pipeline picks the
+        //!          packet of EncodeFrameDependencyTracker::SelectEngine() for each frame.
+        //!          The packet pins its submissions to the engine, waits for the frames of
+        //!          other engines its references depend on, and signals its frames. Only
+        //!          frames in legacy single pipe mode are dispatched, a frame split over
+        //!          the pipes by tile columns encodes as before.
+        //! \param  [in] tracker
+        //!         Tracker shared by the packets of the stream, nullptr to disable. The
+        //!         caller owns it and destroys it once the engines are idle.
+        //! \param  [in] engine
+        //!         Engine of this packet
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS SetFrameParallel(EncodeFrameDependencyTracker *tracker, uint32_t engine);
+
+        //!
+        //! \brief  Get the engine, sequence number and waits of the current frame
+        //! \return const EncodeFrameDispatch &
+        //!
+        const EncodeFrameDispatch &GetFrameDispatch() const { return m_frameDispatch; }
+
+        //!
+        //! \brief  Get the inventory of the buffers allocated by this packet
+        //! \details Lists the name, size, tiling, creation time and last use frame of each
+        //!          buffer. The buffers of HevcVdencPkt are not listed.
+        //! \return EncodeResourceInventory &
+        //!
+        EncodeResourceInventory &GetResourceInventory() { return m_resourceInventory; }
+
+        //!
+        //! \brief  Enable or disable building the tile level batches on worker threads
+        //! \details The primary command buffer keeps the ordered MI_BATCH_BUFFER_START
+        //!          chain, and every tile batch gets the same commands as in serial mode.
+        //! \param  [in] enable
+        //!         true to build the tile batches in parallel
+        //! \param  [in] numThreads
+        //!         Number of worker threads, 0 to derive it from the host CPU count
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS SetParallelTileBatch(bool enable, uint32_t numThreads = 0);
+
+        //!
+        //! \brief  Enable or disable building the batches of all the pipes once per pass
+        //! \details In multi-pipe tile mode the Submit() of the first pipe builds the 3rd
+        //!          level batch and the tile level batches of every pipe, in parallel if
+        //!          SetParallelTileBatch() is enabled. The tile row waits, tile batch starts
+        //!          and row signals of each later pipe go to a batch buffer of that pipe,
+        //!          the pipes are built on the worker threads as well. The Submit() of each
+        //!          later pipe only adds its picture level commands and a chain to its batch
+        //!          buffer. The pipes of a frame must be submitted together, first pipe first.
+        //! \param  [in] enable
+        //!         true to share the batch building between the pipes
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS SetSharedPipeBuild(bool enable);
+
+        //!
+        //! \brief  Enable or disable replaying the recorded picture level command templates
+        //! \details Pipe mode select, surface state and QM state commands carry no graphics
+        //!          address, so they are recorded once and copied on later frames as long
+        //!          as their inputs are unchanged. Address commands are always rebuilt.
+        //!          Templates are disabled by default.
+        //! \param  [in] enable
+        //!         true to use the templates
+        //! \return void
+        //!
+        void SetPictureCmdTemplates(bool enable);
+
+        //!
+        //! \brief  Enable or disable the peephole pass over the commands of each submission
+        //! \details See EncodeCmdPeephole for the rule table. Enabling or disabling the
+        //!          pass clears its statistics.
+        //! \param  [in] enable
+        //!         true to drop the redundant flush commands
+        //! \return void
+        //!
+        void SetCmdPeephole(bool enable);
+
+        //!
+        //! \brief  Get the statistics of the peephole pass
+        //! \return const EncodeCmdPeepholeStats &
+        //!
+        const EncodeCmdPeepholeStats &GetCmdPeepholeStats() const { return m_cmdPeephole.GetStats(); }
+
+        //!
+        //! \brief  Enable or disable building the later passes from the first pass
+        //! \details Applies to the slice level commands of frames without tiles and PAK slice
+        //!          batch buffers. The pass dependent dwords are learned once per pass type,
+        //!          the later frames replay from their second pass on. See EncodePassReplay.
+        //! \param  [in] enable
+        //!         true to replay the first pass slice commands in the later passes
+        //! \return void
+        //!
+        void SetPassReplay(bool enable);
+
+        //!
+        //! \brief  Get the number of passes built by replay
+        //! \return uint32_t
+        //!
+        uint32_t GetPassReplayCount() const { return m_passReplay.GetReplayCount(); }
+
+    protected:
+        MOS_STATUS PatchSliceLevelCommands(MOS_COMMAND_BUFFER &cmdBuffer, uint8_t packetPhase);
+
+        //!
+        //! \brief  Add the slice commands of all the slices of a frame without tiles
+        //! \param  [in] cmdBuffer
+        //!         Command buffer
+        //! \param  [in] vdenc2ndLevelBatchBuffer
+        //!         VDENC 2nd level batch buffer started by each slice
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS AddSlicesCommands(MOS_COMMAND_BUFFER &cmdBuffer, PMHW_BATCH_BUFFER vdenc2ndLevelBatchBuffer);
+
+        //!
+        //! \brief  Build the pass commands of the current pass into m_passReplayCmds
+        //! \details The pass commands are the HCP_SLICE_STATE of each slice, which carry the
+        //!          pass dependent IntraRefFetchDisable. They are built from the slice params
+        //!          without the other slice commands, see EncodePassReplay.
+        //! \param  [in] passType
+        //!         Pass type of the current pass
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS BuildPassReplayCmds(uint32_t passType);
+        MOS_STATUS PatchTileLevelCommands(MOS_COMMAND_BUFFER &cmdBuffer, uint8_t packetPhase);
+
+        //!
+        //! \brief  Build the 3rd level batch and the tile level batches, and start the
+        //!         tile batches of the current pipe
+        //! \details With m_sharedPipeBuilding set the batches of all the pipes are built.
+        //! \param  [in] cmdBuffer
+        //!         Primary command buffer
+        //! \param  [in] numTileRows
+        //!         Tile rows of the frame
+        //! \param  [in] numTileColumns
+        //!         Tile columns of the frame
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS BuildTileLevelBatches(MOS_COMMAND_BUFFER &cmdBuffer, uint32_t numTileRows, uint32_t numTileColumns);
+
+        MOS_STATUS AddOneTileCommands(
+            MOS_COMMAND_BUFFER  &cmdBuffer,
+            uint32_t            tileRow,
+            uint32_t            tileCol,
+            uint32_t            tileRowPass);
+
+        MOS_STATUS AddSlicesCommandsInTile(
+            MOS_COMMAND_BUFFER           &cmdBuffer,
+            HevcVdencTileBatchContextG12 &tileCtx);
+
+        //!
+        //! \brief  Begin the tile level batch of one tile and capture its state
+        //! \details Runs on the calling thread. Adds the MI_BATCH_BUFFER_START of the
+        //!          tile to the primary command buffer.
+        //! \param  [in] cmdBuffer
+        //!         Primary command buffer
+        //! \param  [in] tileRow
+        //!         Tile row index
+        //! \param  [in] tileCol
+        //!         Tile column index
+        //! \param  [in] tileRowPass
+        //!         Tile row replay pass
+        //! \param  [out] tileCtx
+        //!         Captured tile state, nullptr if the tile is not encoded by the current pipe
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS PrepareOneTileBatch(
+            MOS_COMMAND_BUFFER            &cmdBuffer,
+            uint32_t                      tileRow,
+            uint32_t                      tileCol,
+            uint32_t                      tileRowPass,
+            HevcVdencTileBatchContextG12 *&tileCtx);
+
+        //!
+        //! \brief  Capture the slice state params of the slices in the current tile
+        //! \param  [in] tileCtx
+        //!         Tile state to fill
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS PrepareSlicesInTile(
+            HevcVdencTileBatchContextG12 &tileCtx);
+
+        //!
+        //! \brief  Add the commands of one tile into its tile level batch
+        //! \details Writes only the tile's own batch and reads the packet state, so the
+        //!          tile batches can be built concurrently. The patch list calls of a build
+        //!          on a worker thread are kept in tileCtx.patchList.
+        //! \param  [in] tileCtx
+        //!         Captured tile state
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS BuildOneTileBatch(
+            HevcVdencTileBatchContextG12 &tileCtx)
+        {
+            return (this->*m_buildOneTileBatch)(tileCtx);
+        }
+
+        //!
+        //! \brief  Tile level batch builder for one pipe and BRC mode
+        //! \details Instantiated for each combination and selected in Prepare(), so the
+        //!          per tile loop neither branches on the mode nor casts the interfaces.
+        //! \param  [in] tileCtx
+        //!         Captured tile state
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        template <bool multiPipe, bool brcUpdate>
+        MOS_STATUS BuildOneTileBatchT(
+            HevcVdencTileBatchContextG12 &tileCtx);
+
+        //!
+        //! \brief  Select the tile level batch builder for the current frame
+        //! \return void
+        //!
+        void SelectTileBatchBuilder();
+
+        //!
+        //! \brief  Resolve the G12 MHW interfaces of the packet
+        //! \details The interfaces are fixed once the packet is created, so they are
+        //!          checked once and kept as typed pointers.
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS ResolveG12Interfaces();
+
+        //!
+        //! \brief  Estimate the primary command buffer size of one pass
+        //! \param  [out] commandBufferSize
+        //!         Command buffer size in bytes
+        //! \param  [out] patchListSize
+        //!         Number of patch list entries
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS EstimatePassCommandSize(uint32_t &commandBufferSize, uint32_t &patchListSize);
+
+        //!
+        //! \brief  Compare the bytes written by a submission with the estimate
+        //! \param  [in] writtenSize
+        //!         Bytes written by the submission, with the overflow batch buffers
+        //! \return void
+        //!
+        void CheckCmdSize(uint32_t writtenSize);
+
+        //!
+        //! \brief  Make sure the next commands fit into the command buffer
+        //! \details When less than size bytes are left, the commands continue in a batch
+        //!          buffer of m_cmdOverflowRing, chained from the current buffer by a first
+        //!          level MI_BATCH_BUFFER_START. The command buffer is pointed at the batch
+        //!          buffer, and the view of the primary buffer is kept for EndCmdOverflow().
+        //!          MOS can neither grow an acquired command buffer nor withdraw patch
+        //!          entries, so the pass is continued rather than built again.
+        //! \param  [in, out] cmdBuffer
+        //!         Command buffer the commands are added to
+        //! \param  [in] size
+        //!         Bytes the next commands take at most
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS ReserveCmdSpace(MOS_COMMAND_BUFFER &cmdBuffer, uint32_t size);
+
+        //!
+        //! \brief  Point the command buffer at the primary buffer again after an overflow
+        //! \details The last overflow batch buffer chains back to the primary buffer right
+        //!          after the MI_BATCH_BUFFER_START which left it, so the commands added by
+        //!          the framework follow the pass. The overflow batch buffers are retired
+        //!          with the fence of the submission.
+        //! \param  [in, out] cmdBuffer
+        //!         Command buffer of the pass
+        //! \param  [in] chainBack
+        //!         false if the pass failed, the view is restored without the chain
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS EndCmdOverflow(MOS_COMMAND_BUFFER &cmdBuffer, bool chainBack);
+
+        //!
+        //! \brief  Add a MI_BATCH_BUFFER_START which does not return
+        //! \param  [in] cmdBuffer
+        //!         Command buffer
+        //! \param  [in] batchBuffer
+        //!         Batch buffer to continue in, at its dwOffset
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS AddChainedBatchStart(MOS_COMMAND_BUFFER &cmdBuffer, PMHW_BATCH_BUFFER batchBuffer);
+
+        //!
+        //! \brief  Add the picture, slice or tile and frame parallel commands of one pass
+        //! \param  [in] cmdBuffer
+        //!         Primary command buffer
+        //! \param  [in] packetPhase
+        //!         Phase of the packet
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS PatchPassCommands(MOS_COMMAND_BUFFER &cmdBuffer, uint8_t packetPhase);
+
+        //!
+        //! \brief  End patching the tile level batch of one tile
+        //! \param  [in] tileCtx
+        //!         Captured tile state
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS FinishOneTileBatch(
+            HevcVdencTileBatchContextG12 &tileCtx);
+
+        //!
+        //! \brief  Build all the prepared tile level batches on the worker pool
+        //! \details The patch list calls of each tile are added to the OS interface
+        //!          after all the builds finished, in tile order.
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS BuildTileBatchesInParallel();
+
+        //!
+        //! \brief  Check if the tile level batches of this frame are built in parallel
+        //! \return bool
+        //!         true if the parallel mode is enabled and usable for this frame
+        //!
+        bool IsParallelTileBatchActive() const;
+
+        //!
+        //! \brief  Check if the batches of all the pipes are built by the first pipe
+        //! \return bool
+        //!         true if the shared build is enabled and usable for this frame
+        //!
+        bool IsSharedPipeBuildActive() const;
+
+        //!
+        //! \brief  Add the tile row waits, tile batch starts and row signals of a pipe
+        //! \details Only reads the tile states, so the pipes can be added on worker threads.
+        //! \param  [in] cmdBuffer
+        //!         Command buffer of the pipe
+        //! \param  [in] numTileRows
+        //!         Tile rows of the frame
+        //! \param  [in] pipe
+        //!         Pipe whose tiles are started
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS AddSharedTileBatchStarts(MOS_COMMAND_BUFFER &cmdBuffer, uint32_t numTileRows, uint32_t pipe);
+
+        //!
+        //! \brief  Build the tile batch starts of the later pipes into their batch buffers
+        //! \details Each pipe is a task of the tile batch worker pool when the parallel tile
+        //!          batch build is active, else the pipes are built in turn.
+        //! \param  [in] numTileRows
+        //!         Tile rows of the frame
+        //! \param  [in] numPipes
+        //!         Pipes of the frame
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS BuildPipeStartBatches(uint32_t numTileRows, uint32_t numPipes);
 
         //!
-        //! \brief  Prepare the parameters for command submission
+        //! \brief  Build the tile batch starts of one pipe into m_pipeStartBatches
+        //! \details Room for the chain back to the primary buffer is left at the end.
+        //! \param  [in] pipe
+        //!         Pipe to build
+        //! \param  [in] numTileRows
+        //!         Tile rows of the frame
         //! \return MOS_STATUS
         //!         MOS_STATUS_SUCCESS if success, else fail reason
         //!
-        virtual MOS_STATUS Prepare() override;
+        MOS_STATUS BuildOnePipeStartBatch(uint32_t pipe, uint32_t numTileRows);
 
         //!
-        //! \brief  Add the command sequence into the commandBuffer and
-        //!         and return to the caller task
-        //! \param  [in] commandBuffer
-        //!         Pointer to the command buffer which is allocated by caller
+        //! \brief  Chain the primary buffer of the current pipe through its batch buffer
+        //! \details The batch buffer built by the first pipe chains back to the primary
+        //!          buffer right after the chain, so its tile batches stay 2nd level.
+        //! \param  [in] cmdBuffer
+        //!         Primary command buffer
         //! \return MOS_STATUS
         //!         MOS_STATUS_SUCCESS if success, else fail reason
         //!
-        virtual MOS_STATUS Submit(
-            MOS_COMMAND_BUFFER* commandBuffer,
-            uint8_t packetPhase = otherPacket) override;
-
-        void SetHcpPicStateParams(MHW_VDBOX_HEVC_PIC_STATE& picStateParams);
-        MOS_STATUS AddVdencCmd1Cmd(PMOS_COMMAND_BUFFER cmdBuffer, bool addToBatchBufferHuCBRC, bool isLowDelayB);
-        MOS_STATUS AddVdencCmd2Cmd(PMOS_COMMAND_BUFFER cmdBuffer, bool addToBatchBufferHuCBRC, bool isLowDelayB);
-
-        virtual MOS_STATUS CalculatePictureStateCommandSize() override;
-
-    protected:
-        MOS_STATUS PatchSliceLevelCommands(MOS_COMMAND_BUFFER &cmdBuffer, uint8_t packetPhase);
-        MOS_STATUS PatchTileLevelCommands(MOS_COMMAND_BUFFER &cmdBuffer, uint8_t packetPhase);
-        MOS_STATUS AddOneTileCommands(
-            MOS_COMMAND_BUFFER  &cmdBuffer,
-            uint32_t            tileRow,
-            uint32_t            tileCol,
-            uint32_t            tileRowPass);
+        MOS_STATUS AddPipeStartBatch(MOS_COMMAND_BUFFER &cmdBuffer);
 
-        MOS_STATUS AddSlicesCommandsInTile(
-            MOS_COMMAND_BUFFER &cmdBuffer);
+        //!
+        //! \brief  Drop the shared build, so that no later pipe uses it
+        //! \details Batch buffers of the later pipes which were not chained are handed back.
+        //! \return void
+        //!
+        void ResetSharedPipeBuild();
 
         void UpdateParameters();
 
@@ -133,6 +1047,10 @@ namespace encode
         MOS_STATUS AddPicStateWithTile(
             MOS_COMMAND_BUFFER &cmdBuffer);
 
+        template <bool brcUpdate>
+        MOS_STATUS AddPicStateWithTileT(
+            MOS_COMMAND_BUFFER &cmdBuffer);
+
         /******************************************************************
         Picture Level related
         *******************************************************************/
@@ -181,15 +1099,551 @@ namespace encode
             PCODEC_ENCODER_SLCDATA      slcData,
             uint32_t                    currSlcIdx) override;
 
+        //!
+        //! \brief  Set the slice state params of a slice in a tile
+        //! \details Takes the last slice in tile flag as an argument rather than from
+        //!          m_lastSliceInTile, so the tile states do not share it.
+        //! \param  [out] sliceStateParams
+        //!         Slice state params
+        //! \param  [in] slcData
+        //!         Slice data of the frame
+        //! \param  [in] currSlcIdx
+        //!         Slice index
+        //! \param  [in] lastSliceInTile
+        //!         Slice is the last one of its tile
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS SetHcpSliceStateParamsInTile(
+            MHW_VDBOX_HEVC_SLICE_STATE  &sliceStateParams,
+            PCODEC_ENCODER_SLCDATA      slcData,
+            uint32_t                    currSlcIdx,
+            bool                        lastSliceInTile);
+
+        //!
+        //! \brief  Get the fence the GPU signals when the current submission completes
+        //! \return uint32_t
+        //!
+        uint32_t GetSubmissionFence();
+
+        //!
+        //! \brief  Get the fence of the last completed submission
+        //! \return uint32_t
+        //!
+        uint32_t GetCompletedFence();
+
+        //!
+        //! \brief  Wait until the GPU completed the last submission of the packet
+        //! \details Called before the packet frees or replaces a buffer which the
+        //!          submitted commands may still use.
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, MOS_STATUS_UNKNOWN if the GPU did not
+        //!         complete it within m_submissionWaitTimeoutUs
+        //!
+        MOS_STATUS WaitForSubmissions();
+
+        //!
+        //! \brief  Put a mapped ring buffer in place of the PAK slice batch of the frame
+        //! \details The PAK slice batch mapped by the base packet is unmapped, the slice
+        //!          commands go to the ring buffer only.
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS BeginPakSliceBatch();
+
+        //!
+        //! \brief  Restore the PAK slice batch, and retire the ring buffer after the last pass
+        //! \param  [in] submitted
+        //!         false if the slice commands failed, the ring buffer is then retired at once
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS EndPakSliceBatch(bool submitted);
+
         MOS_STATUS Construct3rdLevelBatch();
 
-        virtual MOS_STATUS AllocateResources();
+        //!
+        //! \brief  Hash the inputs of the 3rd level batch
+        //! \details The POC and the surface indices only enter the picture commands
+        //!          relative to the references, so they are hashed as such. The params
+        //!          are hashed field by field and the DDI params they point to by content.
+        //! \param  [in] picStateParams
+        //!         HCP_PIC_STATE params of the frame
+        //! \return uint64_t
+        //!
+        uint64_t GetPicBatchHash(const MHW_VDBOX_HEVC_PIC_STATE_G12 &picStateParams);
+
+        //!
+        //! \brief  Hash the frame inputs shared by all the tile level batches
+        //! \details Covers all the slice params, the slice data and the packed headers.
+        //! \return uint64_t
+        //!
+        uint64_t GetFrameBatchHash();
+
+        //!
+        //! \brief  Decide whether the tile level batch of a prepared tile can be kept
+        //! \details Registers the batches started by a kept tile level batch for the frame.
+        //! \param  [in] tileCtx
+        //!         Prepared tile
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS CheckTileBatchReuse(HevcVdencTileBatchContextG12 &tileCtx);
+
+        //!
+        //! \brief  Batch reuse is enabled and applies to the current frame
+        //! \return bool
+        //!
+        bool IsBatchReuseActive() const;
+
+        //!
+        //! \brief  Tile row sync is enabled and applies to the current frame
+        //! \return bool
+        //!
+        bool IsTileRowSyncActive() const;
+
+        //!
+        //! \brief  Wait for the previous frame rows a tile row references on the other pipes
+        //! \param  [in] cmdBuffer
+        //!         Primary command buffer
+        //! \param  [in] tileRow
+        //!         Tile row about to be encoded
+        //! \param  [in] numTileRows
+        //!         Tile rows of the frame
+        //! \param  [in] pipe
+        //!         Pipe encoding the tile row
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS AddTileRowWait(MOS_COMMAND_BUFFER &cmdBuffer, uint32_t tileRow, uint32_t numTileRows, uint32_t pipe);
+
+        //!
+        //! \brief  Signal that a pipe completed a tile row, m_maxTileRows for the frame
+        //! \param  [in] cmdBuffer
+        //!         Primary command buffer
+        //! \param  [in] row
+        //!         Tile row
+        //! \param  [in] pipe
+        //!         Pipe which encoded the tile row
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS AddTileRowSignal(MOS_COMMAND_BUFFER &cmdBuffer, uint32_t row, uint32_t pipe);
+
+        //!
+        //! \brief  Wait until the other pipes signaled a row of a frame
+        //! \param  [in] cmdBuffer
+        //!         Primary command buffer
+        //! \param  [in] row
+        //!         Tile row, m_maxTileRows for the frame
+        //! \param  [in] numPipes
+        //!         Pipes to wait for
+        //! \param  [in] seq
+        //!         Sequence number of the frame
+        //! \param  [in] pipe
+        //!         Pipe which waits, it runs its own frames in order
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS AddTileRowSyncWaits(MOS_COMMAND_BUFFER &cmdBuffer, uint32_t row, uint32_t numPipes, uint32_t seq, uint32_t pipe);
+
+        //!
+        //! \brief  Get the sequence number signaled by the current frame, never 0
+        //! \return uint32_t
+        //!
+        uint32_t GetTileRowSyncSeq() const;
+
+        //!
+        //! \brief  Get the tile rows and pipes of the current frame
+        //! \return uint32_t
+        //!
+        uint32_t GetTileRowSyncGrid(uint32_t numTileRows) const;
+
+        static uint32_t GetTileRowSyncOffset(uint32_t row, uint32_t pipe)
+        {
+            // One cache line per slot
+            return (row * m_maxNumPipes + pipe) * CODECHAL_CACHELINE_SIZE;
+        }
+
+        //!
+        //! \brief  Frame parallel encoding is enabled and applies to the current frame
+        //! \return bool
+        //!
+        bool IsFrameParallelActive() const;
+
+        //!
+        //! \brief  Record the current frame and its references in the tracker
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS DispatchFrameParallel();
+
+        //!
+        //! \brief  Undo the dispatch of the current frame after an error
+        //! \details The frame no longer waits or signals, the tracker hands its sequence
+        //!          number to the next frame of the engine.
+        //! \return void
+        //!
+        void CancelFrameParallel();
+
+        //!
+        //! \brief  Prepare the current frame after its frame parallel dispatch
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS PrepareFrame();
+
+        //!
+        //! \brief  Add the commands of the current pass, called by Submit()
+        //! \param  [in] cmdBuffer
+        //!         Command buffer
+        //! \param  [in] packetPhase
+        //!         Phase of the packet
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS SubmitPass(MOS_COMMAND_BUFFER &cmdBuffer, uint8_t packetPhase);
+
+        //!
+        //! \brief  Pin the command buffer to the engine of the packet
+        //! \param  [in] cmdBuffer
+        //!         Primary command buffer
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS SetFrameParallelEngineHint(MOS_COMMAND_BUFFER &cmdBuffer);
+
+        //!
+        //! \brief  Wait for the frames of other engines the current frame depends on
+        //! \param  [in] cmdBuffer
+        //!         Primary command buffer
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS AddFrameParallelWaits(MOS_COMMAND_BUFFER &cmdBuffer);
+
+        //!
+        //! \brief  Signal that the engine completed the current frame
+        //! \param  [in] cmdBuffer
+        //!         Primary command buffer
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS AddFrameParallelSignal(MOS_COMMAND_BUFFER &cmdBuffer);
+
+        //!
+        //! \brief  Resolve the features and the feature flags of the current frame
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS UpdateFrameFeatures();
+
+        //!
+        //! \brief  Build the slice to tile map of the current frame
+        //! \details Each slice is placed by its start LCU, so the cost is linear in
+        //!          the number of slices and the frame size in LCUs.
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS BuildSliceTileMap();
+
+        //!
+        //! \brief  Add the VDENC surface state commands, replaying the template if possible
+        //! \param  [in] cmdBuffer
+        //!         Command buffer
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS AddVdencSurfaces(MOS_COMMAND_BUFFER &cmdBuffer);
+
+        //!
+        //! \brief  Add the HCP QM/FQM state commands, replaying the template if possible
+        //! \param  [in] cmdBuffer
+        //!         Command buffer
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS AddHcpQmCmds(MOS_COMMAND_BUFFER &cmdBuffer);
+
+        //!
+        //! \brief  Get the pipe mode select template of the current pipe and pass
+        //! \return EncodeCmdTemplate*
+        //!         Template, nullptr if templates are disabled or the slot is out of range
+        //!
+        EncodeCmdTemplate *GetHcpPipeModeTemplate();
+
+        //!
+        //! \brief  Get the key of the picture level surface state commands
+        //! \details Built once per frame, from the same setters as the commands. Prepare()
+        //!          drops the key of the previous frame.
+        //! \return const HevcVdencPicSurfacesKeyG12 &
+        //!
+        const HevcVdencPicSurfacesKeyG12 &GetPicSurfacesKey();
+
+        //!
+        //! \brief  Fill the key of the pipe mode select template from the params
+        //! \param  [in] params
+        //!         Pipe mode select params of the current pipe and pass
+        //! \param  [out] key
+        //!         Key to fill
+        //! \return void
+        //!
+        static void GetPipeModeKey(const MHW_VDBOX_PIPE_MODE_SELECT_PARAMS_G12 &params, HevcVdencPipeModeKeyG12 &key);
+
+        //!
+        //! \brief  Drop all the recorded picture level command templates
+        //! \return void
+        //!
+        void InvalidatePictureCmdTemplates();
+
+        //!
+        //! \brief  Allocate the resources, on a background thread if async allocation is on
+        //! \details A failure of the background allocation is returned by WaitForResources().
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        virtual MOS_STATUS AllocateResources() override;
+
+        //!
+        //! \brief  Allocate the resources of HevcVdencPkt and of this packet
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS AllocatePacketResources();
+
+        //!
+        //! \brief  Get the shared pool key of a picture buffer for m_picBufferConfig
+        //! \param  [in] device
+        //!         Adapter key from EncodeSharedResourcePool::GetDeviceKey()
+        //! \param  [in] resourceClass
+        //!         Buffer class, one of HevcVdencSharedResourceG12
+        //! \param  [in] size
+        //!         Size in bytes
+        //! \param  [out] key
+        //!         Key of the buffer
+        //! \return void
+        //!
+        void GetSharedResourceKey(
+            void                    *device,
+            uint32_t                 resourceClass,
+            uint32_t                 size,
+            EncodeSharedResourceKey &key) const;
+
+        //!
+        //! \brief  Allocate a frame scratch buffer, leased from the shared pool when it is enabled
+        //! \param  [in] resourceClass
+        //!         Buffer class, one of HevcVdencSharedResourceG12
+        //! \param  [in] allocParams
+        //!         Allocation params
+        //! \param  [out] resource
+        //!         Allocated buffer
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS AllocateSharedResource(
+            uint32_t                 resourceClass,
+            MOS_ALLOC_GFXRES_PARAMS &allocParams,
+            PMOS_RESOURCE           &resource);
+
+        //!
+        //! \brief  Allocate a small picture buffer, or reserve its range when packing is on
+        //! \param  [in] scratch
+        //!         Buffer, one of HevcVdencScratchBufferG12
+        //! \param  [in] resourceClass
+        //!         Class in the shared pool, used when packing is off
+        //! \param  [in] allocParams
+        //!         Allocation params
+        //! \param  [out] resource
+        //!         Allocated buffer, set by AllocateScratchBuffers() when packing is on
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS AllocateScratchResource(
+            HevcVdencScratchBufferG12  scratch,
+            uint32_t                   resourceClass,
+            MOS_ALLOC_GFXRES_PARAMS   &allocParams,
+            PMOS_RESOURCE             &resource);
+
+        //!
+        //! \brief  Get the name, packed slot and member of a picture buffer
+        //! \param  [in] resourceClass
+        //!         Buffer, one of HevcVdencSharedResourceG12
+        //! \param  [out] info
+        //!         Buffer info
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS GetPictureBufferInfo(uint32_t resourceClass, HevcVdencPicBufferInfoG12 &info);
+
+        //!
+        //! \brief  Get the size of a picture buffer for m_picBufferConfig
+        //! \param  [in] resourceClass
+        //!         Buffer, one of HevcVdencSharedResourceG12
+        //! \param  [out] size
+        //!         Size in bytes
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS GetPictureBufferSize(uint32_t resourceClass, uint32_t &size);
+
+        //!
+        //! \brief  Allocate a picture buffer for m_picBufferConfig and record its capacity
+        //! \param  [in] resourceClass
+        //!         Buffer, one of HevcVdencSharedResourceG12
+        //! \param  [in] minSize
+        //!         Minimum size in bytes, used to keep the capacity when repacking
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS AllocatePictureBuffer(uint32_t resourceClass, uint32_t minSize = 0);
+
+        //!
+        //! \brief  Allocate the optional buffers which are not allocated yet
+        //! \param  [in] buffers
+        //!         Mask of HevcVdencOptionalBufferG12
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS AllocateOptionalBuffers(uint32_t buffers);
+
+        //!
+        //! \brief  Check that the optional buffers the HCP commands point at are allocated
+        //! \details The base packet decides which buffers a frame programs. In a lazy session
+        //!          a buffer which was not requested, or left from an allocation for a smaller
+        //!          frame, fails the frame instead of being written by the hardware.
+        //! \param  [in] pipeBufAddrParams
+        //!         Buffer addresses of the frame
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS CheckOptionalBuffers(const MHW_VDBOX_PIPE_BUF_ADDR_PARAMS &pipeBufAddrParams);
+
+        //!
+        //! \brief  Allocate the backing resource of the reserved small picture buffers
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS AllocateScratchBuffers();
+
+        //!
+        //! \brief  Free the backing resource of the packed buffers and start a new set
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS ResetScratchBuffers();
+
+        //!
+        //! \brief  Check if the small picture buffers are packed on the next allocation
+        //! \return bool
+        //!         true if enabled and the HCP interface programs the buffer offsets
+        //!
+        bool IsScratchSubAllocActive() const;
+
+        //!
+        //! \brief  Free a buffer from AllocateSharedResource()
+        //! \param  [in, out] resource
+        //!         Buffer to free, set to nullptr
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS FreeSharedResource(PMOS_RESOURCE &resource);
+
+        //!
+        //! \brief  Give back all the buffers leased from the shared pool
+        //! \return void
+        //!
+        void ReleaseSharedResources();
+
+        //!
+        //! \brief  Get the PAK stream-out size of the frame size in m_picBufferConfig
+        //! \details Scaled from CODECHAL_HEVC_PAK_STREAMOUT_SIZE, which holds a 4Kx4K frame
+        //!          of minimum size CUs.
+        //! \return uint32_t
+        //!         Size in bytes, page aligned
+        //!
+        uint32_t GetPakStreamOutSize() const;
 
         static constexpr uint32_t m_VdboxVDENCRegBase[4] = M_VDBOX_VDENC_REG_BASE;
         static constexpr uint32_t m_NumPassesForTileReplay = 1; // todo: Change when enabling tile replay 
 
         MHW_VDBOX_PIPE_MODE_SELECT_PARAMS_G12 m_pipeModeSelectParams = {};
 
+        HevcVdencFrameFeaturesG12   m_frameFeatures;                       //!< Feature snapshot of the current frame
+
+        using BuildTileBatchFunc = MOS_STATUS (HevcVdencPktG12::*)(HevcVdencTileBatchContextG12 &);
+        BuildTileBatchFunc          m_buildOneTileBatch = nullptr;         //!< Tile batch builder of the current frame, set in Prepare()
+
+        MhwMiInterfaceG12          *m_miInterfaceG12 = nullptr;            //!< G12 MI interface
+        MhwVdboxHcpInterfaceG12    *m_hcpInterfaceG12 = nullptr;           //!< G12 HCP interface
+        MhwVdboxVdencInterfaceG12X *m_vdencInterfaceG12 = nullptr;         //!< G12 VDENC interface
+        MhwVdboxHcpBufOffsetInterfaceG12 *m_hcpBufOffsetInterface = nullptr;  //!< HCP interface which programs the buffer offsets, can be nullptr
+        HevcVdencSliceTileMapG12    m_sliceTileMap;                        //!< Slice to tile map of the current frame
+        EncodeTileColumnScheduler   m_tileColumnScheduler;                 //!< Pipe of each tile column of the current frame
+        EncodeParamArena            m_paramArena;                          //!< MHW params which live for one submission
+
+        bool                        m_cmdPeepholeEnabled = false;          //!< Run the peephole pass on each submission
+        EncodeCmdPeephole           m_cmdPeephole;                         //!< Peephole pass over the primary command buffer
+
+        uint32_t                    m_sliceCmdSize = 0;                    //!< Primary buffer bytes of one slice
+        uint32_t                    m_slicePatchListSize = 0;              //!< Patch list entries of one slice
+        uint32_t                    m_passCmdSizeEstimate = 0;             //!< Estimate of one pass of the current frame
+        uint32_t                    m_pictureCmdSize = 0;                  //!< Estimate of the commands before the slices or tiles
+        uint32_t                    m_tileStartsCmdSize = 0;               //!< Estimate of the tile batch starts and their syncs
+        uint32_t                    m_tailCmdSize = 0;                     //!< Estimate of the commands after the slices or tiles
+        bool                        m_cmdSizeCheckEnabled = false;         //!< Check the estimate on each submission
+        HevcVdencCmdSizeStatsG12    m_cmdSizeStats;                        //!< Statistics of the size check
+
+        //! Kept free in every command buffer for the MI_BATCH_BUFFER_START to an overflow batch buffer
+        static constexpr uint32_t   m_cmdChainReserve = CODECHAL_CACHELINE_SIZE;
+        //! Patch list entries of the chain to an overflow batch buffer and back
+        static constexpr uint32_t   m_cmdOverflowPatchListSize = 2;
+        EncodeBatchBufferRing       m_cmdOverflowRing;                     //!< Batch buffers taking the commands of a full command buffer
+        std::vector<PMHW_BATCH_BUFFER> m_cmdOverflowBatches;               //!< Overflow batch buffers of the last pass, in chain order
+        bool                        m_cmdOverflowActive = false;           //!< Command buffer points at an overflow batch buffer
+        MOS_COMMAND_BUFFER          m_cmdOverflowPrimary = {};             //!< Primary buffer view after the chain to the overflow
+        MHW_BATCH_BUFFER            m_cmdOverflowReturn = {};              //!< Primary buffer as the target of the chain back
+        uint32_t                    m_cmdOverflowBytes = 0;                //!< Bytes of the overflow batch buffers of the last pass
+
+        std::vector<PMOS_RESOURCE>  m_sharedResources;                     //!< Buffers leased from the shared pool
+        EncodeResourceInventory     m_resourceInventory;                   //!< Buffers allocated by this packet
+
+        bool                        m_asyncAllocation = false;             //!< Allocate the resources in the background
+        std::thread                 m_allocThread;                         //!< Thread of the background allocation
+        MOS_STATUS                  m_allocStatus = MOS_STATUS_SUCCESS;    //!< Status of the background allocation
+        HevcVdencPicBufferConfigG12 m_picBufferConfig;                     //!< Frame parameters of the picture buffers
+        uint32_t                    m_picBufferCapacity[sharedResourceNum] = {};  //!< Allocated sizes of the picture buffers
+
+        bool                        m_lazyOptionalBuffers = false;         //!< Allocate the optional buffers on demand
+        uint32_t                    m_optionalBufferRequests = 0;          //!< Optional buffers asked by consumers
+        uint32_t                    m_optionalBuffersAllocated = 0;        //!< Optional buffers which are allocated
+
+        uint32_t                    m_lastSubmissionFence = 0;             //!< Fence of the last submission
+        bool                        m_submissionPending = false;           //!< m_lastSubmissionFence may not be completed
+        static constexpr uint32_t   m_submissionWaitTimeoutUs = 1000000;   //!< Wait limit of WaitForSubmissions()
+
+        bool                        m_scratchSubAllocEnabled = false;      //!< Pack the small picture buffers
+        bool                        m_scratchReserving = false;            //!< AllocateResources() reserves the packed buffers
+        EncodeLinearSubAllocator    m_scratchSubAllocator;                 //!< Backing resource of the packed buffers
+        EncodeSubAllocation         m_scratchBuffers[scratchBufferNum];    //!< Ranges of the packed buffers
+        uint32_t                    m_scratchIndices[scratchBufferNum] = {};  //!< Suballocator indices of the packed buffers
+        PMOS_RESOURCE              *m_scratchTargets[scratchBufferNum] = {};  //!< Members set to the backing resource
+
+        //! PAK stream-out bytes of one minimum size CU, CODECHAL_HEVC_PAK_STREAMOUT_SIZE holds 4Kx4K of 8x8 CUs
+        static constexpr uint32_t   m_pakStreamOutBytesPerMinCu = CODECHAL_HEVC_PAK_STREAMOUT_SIZE / ((4096 / 8) * (4096 / 8));
+
+        bool                        m_pakSliceBatchRingEnabled = false;    //!< Write the PAK slice commands to m_pakSliceBatchRing
+        EncodeBatchBufferRing       m_pakSliceBatchRing;                   //!< Mapped PAK slice batch buffers
+        PMHW_BATCH_BUFFER           m_pakSliceRingBatch = nullptr;         //!< Ring buffer of the current frame
+        MHW_BATCH_BUFFER            m_pakSliceBatchSaved = {};             //!< PAK slice batch replaced by the ring buffer
+
+        bool                        m_recycledSlotTracking = false;        //!< Check the recycled slot against the GPU
+        EncodeRecycledSlotManager   m_recycledSlots{CODECHAL_ENCODE_RECYCLED_BUFFER_NUM};  //!< Fences of the recycled slots
+
+        bool                        m_passReplayEnabled = false;           //!< Build the later passes from the first pass
+        EncodePassReplay            m_passReplay;                          //!< First pass slice commands of the current frame
+        std::vector<uint32_t>       m_passReplayCmds;                      //!< Pass commands of the current pass
+        std::vector<uint32_t>       m_passReplayScratch;                   //!< Command memory the pass commands are built in
+
         // SCC related
         bool                        m_enableSCC = false;                   //!< Flag to indicate if HEVC SCC is enabled.
         unsigned char               m_slotForRecNotFiltered = 0;           //!< Slot for not filtered reconstructed surface
@@ -215,6 +1669,55 @@ namespace encode
         // 3rd Level Batch buffer
         uint32_t                    m_thirdLBSize = 0;                     //!< Size of the 3rd level batch buffer
         MHW_BATCH_BUFFER            m_thirdLevelBatchBuffer;               //!< 3rd level batch buffer
+
+        // Parallel tile batch construction
+        bool                        m_parallelTileBatchEnabled = false;    //!< Build tile level batches on worker threads
+        EncodeWorkerPool           *m_tileBatchWorkerPool = nullptr;       //!< Worker pool for the tile level batches
+        std::vector<HevcVdencTileBatchContextG12> m_tileBatchContexts;     //!< Tile states of the current frame, reused across frames
+        uint32_t                    m_numTileBatchContexts = 0;            //!< Number of valid tile states
+        std::vector<EncodeWorkerPool::Task> m_tileBatchTasks;              //!< Tasks of the worker pool, reused across frames
+
+        // Batches of all the pipes built once per pass
+        bool                        m_sharedPipeBuildEnabled = false;      //!< The first pipe builds the batches of every pipe
+        bool                        m_sharedPipeBuilding = false;          //!< The current Submit() prepares the tiles of all the pipes
+        uint32_t                    m_sharedPipeBuildFrame = 0;            //!< Frame number + 1 of the shared build, 0 if none
+        uint32_t                    m_sharedPipeBuildPass = 0;             //!< Pass of the shared build
+        EncodeBatchBufferRing       m_pipeStartBatchRing;                  //!< Batch buffers of the tile batch starts of the later pipes
+        PMHW_BATCH_BUFFER           m_pipeStartBatches[m_maxNumPipes] = {};  //!< Batch buffer of each later pipe, null once chained
+        EncodeDeferredPatchList     m_pipeStartPatchLists[m_maxNumPipes];  //!< Patch list calls of each later pipe built on a worker thread
+        std::vector<EncodeWorkerPool::Task> m_pipeStartTasks;              //!< Tasks of the worker pool for the later pipes
+        MHW_BATCH_BUFFER            m_pipeStartReturn = {};                //!< Primary buffer as the target of the chain back
+
+        // Reuse of the tile level and 3rd level batches across frames
+        bool                        m_batchReuseEnabled = false;           //!< Keep the batches whose inputs did not change
+        std::map<PMHW_BATCH_BUFFER, uint64_t> m_batchContentHashes;        //!< Hash of the inputs each batch buffer was built from
+        uint64_t                    m_frameBatchHash = 0;                  //!< Hash of the frame inputs of the tile level batches
+        uint32_t                    m_batchReuseTileGrid = 0;              //!< Tile rows, columns and replay passes of the kept batches
+        HevcVdencBatchReuseStatsG12 m_batchReuseStats;                     //!< Statistics of the batch reuse
+
+        // Tile row synchronization of the pipes
+        static constexpr uint32_t   m_maxTileRows = 22;                    //!< HEVC limit of the tile rows
+        static constexpr uint32_t   m_tileRowSyncMarginInPixels = 256;     //!< Reference rows below a tile row read by the motion search
+        bool                        m_tileRowSyncEnabled = false;          //!< Sync the pipes per tile row instead of per frame
+        PMOS_RESOURCE               m_tileRowSyncBuffer = nullptr;         //!< Last signaled frame of each tile row and pipe
+        uint32_t                    m_tileRowSyncPrevSeq = 0;              //!< Sequence number of the previous frame, 0 if it did not signal
+        uint32_t                    m_tileRowSyncPrevGrid = 0;             //!< Tile rows and pipes of the previous frame
+
+        // Frame parallel encoding over several VDBOXes
+        EncodeFrameDependencyTracker *m_frameParallelTracker = nullptr;    //!< Tracker shared by the packets of the engines
+        uint32_t                    m_frameParallelEngine = 0;             //!< Engine of this packet
+        EncodeFrameDispatch         m_frameDispatch;                       //!< Sequence number and waits of the current frame
+
+        // Picture level command templates, one pipe mode select template per pipe and pass type
+        static constexpr uint32_t   m_maxPipeModeTemplates = 8;
+        bool                        m_pictureCmdTemplatesEnabled = false;  //!< Replay the picture level command templates
+        EncodeCmdTemplate           m_hcpPipeModeTemplates[m_maxPipeModeTemplates];  //!< VD/VDENC control and HCP_PIPE_MODE_SELECT
+        EncodeCmdTemplate           m_hcpSurfacesTemplate;                 //!< HCP_SURFACE_STATE commands
+        EncodeCmdTemplate           m_hcpQmTemplate;                       //!< HCP_QM_STATE and HCP_FQM_STATE commands
+        EncodeCmdTemplate           m_vdencSurfacesTemplate;               //!< VDENC source/reference/downscaled surface states
+        HevcVdencQmKeyG12           m_qmKey;                               //!< Scratch key of the QM commands
+        HevcVdencPicSurfacesKeyG12  m_picSurfacesKey;                      //!< Surface key of the current frame
+        bool                        m_picSurfacesKeyValid = false;         //!< m_picSurfacesKey is built for the current frame
     };
 
 }
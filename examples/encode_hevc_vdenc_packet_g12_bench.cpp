@@ -0,0 +1,1798 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+//!
+//! \file     encode_hevc_vdenc_packet_g12_bench.cpp
+//! \brief    Host-only benchmark of the HEVC VDENC G12 packet command building
+//! \details  The benchmark runs the packet on top of the recording MHW interfaces
+//!           (mhw_cmd_recorder_g12.h) and a host MOS interface whose resources live
+//!           in system memory, so no GPU is needed.
+//!           The benchmark has no build target of its own. It is built in a media driver
+//!           tree whose encode sources include the files of this directory, as an
+//!           executable of this file and mhw_cmd_recorder_g12.cpp linked with the
+//!           object libraries of iHD_drv_video, e.g. in media_driver/CMakeLists.txt
+//!               add_executable(encode_hevc_vdenc_packet_g12_bench
+//!                   encode_hevc_vdenc_packet_g12_bench.cpp mhw_cmd_recorder_g12.cpp)
+//!               target_link_libraries(encode_hevc_vdenc_packet_g12_bench
+//!                   <object libraries of iHD_drv_video> pthread)
+//!           with the include directories of iHD_drv_video, and run as
+//!               encode_hevc_vdenc_packet_g12_bench [frames] [1080p|4k|8k] [tile threads] [peephole] [batch reuse]
+//!           A non-zero tile thread count builds the tile level batches in parallel,
+//!           a non-zero peephole value runs the flush peephole pass on every frame,
+//!           a non-zero batch reuse value keeps unchanged tile level batches, the
+//!           tile-rt column counts the kept ones. The pipe matrix at the end shows the
+//!           walker pipe field, the engine mode (L/M/R) and the tile columns of each
+//!           pipe for 1, 2 and 4 pipes, 3 pipes have to be rejected. The frame parallel matrix spreads all-intra,
+//!           hierarchical-B and low delay GOPs over 1 to 4 VDBOXes and prints the
+//!           waits and the speedup of frames of equal cost.
+//!           The patch column counts the patch entries of a frame. The host patch list
+//!           is not thread safe, like the one of the real OS interface, and a
+//!           concurrent call into it fails the run.
+//!           The est-bytes column is the primary buffer size the packet asks for. Each
+//!           frame is checked against the estimate in hardware command bytes, see
+//!           MhwCmdRecorderG12::GetHardwareCmdSize(), and an overrun fails the run.
+//!           The last frame of each configuration is built again into a command buffer
+//!           which is too small, it has to continue in overflow batch buffers with the
+//!           same commands and patch entries.
+//!           Configurations without tiles also build a few frames with a repeated and a
+//!           PAK only pass, with and without pass replay. The builds have to be the same
+//!           and each pass type has to be learned once and replayed in the later frames.
+//!           Configurations without tiles build a few frames with the slice commands in
+//!           the PAK slice batch, with and without the mapped ring. The primary buffer and
+//!           the slice commands have to be the same, and one ring buffer has to be reused.
+//!           Every configuration builds a few frames with and without the picture level
+//!           command templates. The builds have to be the same, and each template has to
+//!           be replayed in the frames after the first one.
+//!           Tiled configurations build their last frame with the tile level batches built
+//!           serially and in parallel. The commands of the primary buffer and of the tile
+//!           level batches have to be the same, and so do the patch entries of each buffer.
+//!           Tiled configurations then spread the tiles of that frame over 2 and 4 pipes
+//!           and build the tile batch starts of the later pipes as the first pipe of a
+//!           shared build does, on the workers for 4 pipes. Each pipe batch buffer has to
+//!           match a serial build of the pipe and start each tile of the pipe once.
+//!           Every configuration then creates sessions on its pipeline. A session which
+//!           allocates in the background, packs the scratch buffers and defers the
+//!           optional buffers has to build frames before and after it asks for them,
+//!           grow its buffers for a larger frame and keep them for a smaller one. A
+//!           failed background allocation has to fail the first frame of its session,
+//!           and a session allocated after a prewarm may only lease warm buffers.
+//!           Last, frames are prepared with the recycled slot tracking. A slot still
+//!           read by the host GPU has to be waited for, or fail its frame on a timeout.
+//!
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include "encode_hevc_vdenc_packet_g12.h"
+#include "encode_hevc_vdenc_pipeline_g12.h"
+#include "codechal_hw_g12_X.h"
+#include "mhw_cmd_recorder_g12.h"
+#include "encode_cmd_walker.h"
+
+namespace encode
+{
+    //!
+    //! \class  HevcVdencPktG12Bench
+    //! \brief  Gives the benchmark access to the packet command building phases
+    //!
+    class HevcVdencPktG12Bench
+    {
+    public:
+        static MOS_STATUS PatchPictureLevelCommands(HevcVdencPktG12 &packet, MOS_COMMAND_BUFFER &cmdBuffer)
+        {
+            // Submit() resets the arena, the benchmark calls the phases directly
+            packet.m_paramArena.Reset();
+            return packet.PatchPictureLevelCommands(otherPacket, cmdBuffer);
+        }
+
+        static MOS_STATUS PatchSliceLevelCommands(HevcVdencPktG12 &packet, MOS_COMMAND_BUFFER &cmdBuffer)
+        {
+            return packet.PatchSliceLevelCommands(cmdBuffer, otherPacket);
+        }
+
+        static MOS_STATUS PatchTileLevelCommands(HevcVdencPktG12 &packet, MOS_COMMAND_BUFFER &cmdBuffer)
+        {
+            return packet.PatchTileLevelCommands(cmdBuffer, otherPacket);
+        }
+
+        static MOS_STATUS EndCmdOverflow(HevcVdencPktG12 &packet, MOS_COMMAND_BUFFER &cmdBuffer)
+        {
+            return packet.EndCmdOverflow(cmdBuffer, true);
+        }
+
+        static const std::vector<PMHW_BATCH_BUFFER> &GetCmdOverflowBatches(HevcVdencPktG12 &packet)
+        {
+            return packet.m_cmdOverflowBatches;
+        }
+
+        static const MHW_BATCH_BUFFER *GetCmdOverflowReturn(HevcVdencPktG12 &packet)
+        {
+            return &packet.m_cmdOverflowReturn;
+        }
+
+        //!
+        //! \brief  Check the estimate against the hardware size of the pass commands
+        //!
+        static MOS_STATUS CheckCmdSize(HevcVdencPktG12 &packet, MOS_COMMAND_BUFFER &cmdBuffer, int32_t startOffset)
+        {
+            if (!packet.m_cmdSizeCheckEnabled)
+            {
+                return MOS_STATUS_SUCCESS;
+            }
+
+            uint32_t hwSize = 0;
+            ENCODE_CHK_STATUS_RETURN(AddHardwareSize(
+                cmdBuffer.pCmdBase + startOffset / sizeof(uint32_t),
+                (uint32_t)(cmdBuffer.iOffset - startOffset) / sizeof(uint32_t),
+                hwSize));
+            for (auto overflow : packet.m_cmdOverflowBatches)
+            {
+                ENCODE_CHK_STATUS_RETURN(AddHardwareSize((const uint32_t *)overflow->pData, overflow->iCurrent / sizeof(uint32_t), hwSize));
+            }
+            packet.CheckCmdSize(hwSize);
+
+            return MOS_STATUS_SUCCESS;
+        }
+
+        static MOS_STATUS AddHardwareSize(const uint32_t *cmds, uint32_t dwSize, uint32_t &hwSize)
+        {
+            for (uint32_t dw = 0, cmdDw = 0, cmdSize = 0; dw < dwSize; dw += cmdDw)
+            {
+                ENCODE_CHK_COND_RETURN(!MhwCmdRecorderG12::GetHardwareCmdSize(cmds + dw, dwSize - dw, cmdDw, cmdSize),
+                    "Unknown command at dword %d", dw);
+                hwSize += cmdSize;
+            }
+            return MOS_STATUS_SUCCESS;
+        }
+
+        static MOS_STATUS RunCmdPeephole(HevcVdencPktG12 &packet, MOS_COMMAND_BUFFER &cmdBuffer, int32_t startOffset)
+        {
+            return packet.m_cmdPeepholeEnabled ? packet.m_cmdPeephole.Run(cmdBuffer, startOffset) : MOS_STATUS_SUCCESS;
+        }
+
+        //!
+        //! \brief  Make the current pass of the pipeline the given one, as its execution does
+        //!
+        static MOS_STATUS SetPass(HevcVdencPktG12 &packet, uint16_t pass, bool pakOnlyPass)
+        {
+            auto scalability = packet.m_pipeline->GetMediaScalability();
+            ENCODE_CHK_NULL_RETURN(scalability);
+
+            StateParams state = {};
+            state.currentPass = pass;
+            ENCODE_CHK_STATUS_RETURN(scalability->UpdateState(&state));
+            packet.m_pakOnlyPass = pakOnlyPass;
+
+            return MOS_STATUS_SUCCESS;
+        }
+
+        //!
+        //! \brief  Turn the pass replay on or off without dropping what it learned
+        //!
+        static void SetPassReplayActive(HevcVdencPktG12 &packet, bool active)
+        {
+            packet.m_passReplayEnabled = active;
+        }
+
+        static uint32_t GetPassReplayLearnCount(HevcVdencPktG12 &packet)
+        {
+            return packet.m_passReplay.GetLearnCount();
+        }
+
+        //!
+        //! \brief  Turn the picture level command templates on or off without dropping them
+        //!
+        static void SetPictureCmdTemplatesActive(HevcVdencPktG12 &packet, bool active)
+        {
+            packet.m_pictureCmdTemplatesEnabled = active;
+        }
+
+        //!
+        //! \brief  Get the replay count of each kind of picture level command template
+        //! \details Pipe mode select, HCP surfaces, HCP QM and VDENC surfaces, in that order.
+        //!
+        static void GetPictureCmdTemplateHits(HevcVdencPktG12 &packet, uint32_t hits[4])
+        {
+            hits[0] = 0;
+            for (auto &pipeModeTemplate : packet.m_hcpPipeModeTemplates)
+            {
+                hits[0] += pipeModeTemplate.GetHitCount();
+            }
+            hits[1] = packet.m_hcpSurfacesTemplate.GetHitCount();
+            hits[2] = packet.m_hcpQmTemplate.GetHitCount();
+            hits[3] = packet.m_vdencSurfacesTemplate.GetHitCount();
+        }
+
+        //!
+        //! \brief  Make the slice commands go to the PAK slice batch or to the primary buffer
+        //!
+        static void SetPakSliceBatchUsed(HevcVdencPktG12 &packet, bool used)
+        {
+            packet.m_useBatchBufferForPakSlices = used;
+        }
+
+        //!
+        //! \brief  Map the empty PAK slice batch of the frame, as the base packet does for a first pass
+        //!
+        static MOS_STATUS MapPakSliceBatch(HevcVdencPktG12 &packet, PMHW_BATCH_BUFFER &batchBuffer)
+        {
+            batchBuffer = &packet.m_batchBufferForPakSlices[packet.m_basicFeature->m_currPakSliceIdx];
+            if (batchBuffer->iSize == 0)
+            {
+                uint32_t size = MOS_ALIGN_CEIL(packet.m_basicFeature->m_numSlices * packet.m_sliceCmdSize, CODECHAL_PAGE_SIZE);
+                ENCODE_CHK_STATUS_RETURN(Mhw_AllocateBb(packet.m_osInterface, batchBuffer, nullptr, size));
+            }
+            if (!batchBuffer->bLocked)
+            {
+                ENCODE_CHK_STATUS_RETURN(Mhw_LockBb(packet.m_osInterface, batchBuffer));
+            }
+            batchBuffer->iCurrent   = 0;
+            batchBuffer->iRemaining = batchBuffer->iSize;
+            packet.m_batchBufferForPakSlicesStartOffset = 0;
+
+            return MOS_STATUS_SUCCESS;
+        }
+
+        //!
+        //! \brief  Get a buffer of the PAK slice batch ring
+        //!
+        static const MHW_BATCH_BUFFER *GetPakSliceRingBuffer(HevcVdencPktG12 &packet, uint32_t index)
+        {
+            auto &slots = packet.m_pakSliceBatchRing.m_slots;
+            return index < slots.size() ? &slots[index]->batchBuffer : nullptr;
+        }
+
+        //!
+        //! \brief  Append the commands of the tile level batches built in the last pass
+        //!
+        static void AppendTileBatchCmds(HevcVdencPktG12 &packet, std::vector<uint32_t> &stream)
+        {
+            for (uint32_t i = 0; i < packet.m_numTileBatchContexts; i++)
+            {
+                const MOS_COMMAND_BUFFER &tileBatchBuf = packet.m_tileBatchContexts[i].tileBatchBuf;
+                stream.insert(stream.end(), tileBatchBuf.pCmdBase, tileBatchBuf.pCmdBase + tileBatchBuf.iOffset / sizeof(uint32_t));
+            }
+        }
+
+        //!
+        //! \brief  Spread the tiles of the last pass over the pipes, by tile column
+        //! \details The host pipeline has a single pipe, the tile batch starts of the later
+        //!          pipes only read the pipe of each tile state.
+        //! \return uint32_t
+        //!         Tile rows of the last pass
+        //!
+        static uint32_t SpreadTilesOverPipes(HevcVdencPktG12 &packet, uint32_t numPipes)
+        {
+            uint32_t numTileRows    = 0;
+            uint32_t numTileColumns = 0;
+            for (uint32_t i = 0; i < packet.m_numTileBatchContexts; i++)
+            {
+                numTileRows    = MOS_MAX(numTileRows, packet.m_tileBatchContexts[i].tileRow + 1);
+                numTileColumns = MOS_MAX(numTileColumns, packet.m_tileBatchContexts[i].tileCol + 1);
+            }
+            for (uint32_t i = 0; i < packet.m_numTileBatchContexts; i++)
+            {
+                auto &tileCtx = packet.m_tileBatchContexts[i];
+                tileCtx.pipe  = tileCtx.tileCol * numPipes / numTileColumns;
+            }
+            return numTileRows;
+        }
+
+        //!
+        //! \brief  Build the tile batch starts of the later pipes as the first pipe does
+        //!
+        static MOS_STATUS BuildPipeStartBatches(HevcVdencPktG12 &packet, uint32_t numTileRows, uint32_t numPipes)
+        {
+            packet.ResetSharedPipeBuild();
+            return packet.BuildPipeStartBatches(numTileRows, numPipes);
+        }
+
+        static const MHW_BATCH_BUFFER *GetPipeStartBatch(HevcVdencPktG12 &packet, uint32_t pipe)
+        {
+            return packet.m_pipeStartBatches[pipe];
+        }
+
+        static MOS_STATUS AddSharedTileBatchStarts(HevcVdencPktG12 &packet, MOS_COMMAND_BUFFER &cmdBuffer, uint32_t numTileRows, uint32_t pipe)
+        {
+            return packet.AddSharedTileBatchStarts(cmdBuffer, numTileRows, pipe);
+        }
+
+        //!
+        //! \brief  Get the tile level batches of a pipe in the last pass
+        //!
+        static std::vector<const void *> GetTileBatchesOfPipe(HevcVdencPktG12 &packet, uint32_t pipe)
+        {
+            std::vector<const void *> batches;
+            for (uint32_t i = 0; i < packet.m_numTileBatchContexts; i++)
+            {
+                if (packet.m_tileBatchContexts[i].pipe == pipe)
+                {
+                    batches.push_back(packet.m_tileBatchContexts[i].batchBuffer);
+                }
+            }
+            return batches;
+        }
+
+        static void ResetSharedPipeBuild(HevcVdencPktG12 &packet)
+        {
+            packet.ResetSharedPipeBuild();
+        }
+
+        static const EncodeBatchBufferRing &GetPipeStartBatchRing(HevcVdencPktG12 &packet)
+        {
+            return packet.m_pipeStartBatchRing;
+        }
+
+        static const HevcVdencPicBufferConfigG12 &GetPicBufferConfig(HevcVdencPktG12 &packet)
+        {
+            return packet.m_picBufferConfig;
+        }
+
+        //!
+        //! \brief  Count the picture buffers which point at the packed scratch resource
+        //!
+        static uint32_t GetPackedScratchBuffers(HevcVdencPktG12 &packet)
+        {
+            uint32_t packed = 0;
+            for (auto target : packet.m_scratchTargets)
+            {
+                if (target != nullptr && *target != nullptr && *target == packet.m_scratchSubAllocator.GetBacking())
+                {
+                    packed++;
+                }
+            }
+            return packed;
+        }
+
+        //!
+        //! \brief  Mark every recycled slot as read by a submission, as Submit() does for its slot
+        //!
+        static void RetireRecycledSlots(HevcVdencPktG12 &packet, uint32_t fence)
+        {
+            for (uint32_t slot = 0; slot < packet.m_recycledSlots.GetNumSlots(); slot++)
+            {
+                packet.m_recycledSlots.Retire(slot, fence);
+            }
+        }
+
+        static void SetRecycledSlotStallTimeout(HevcVdencPktG12 &packet, uint32_t timeoutUs)
+        {
+            packet.m_recycledSlots.SetStallTimeout(timeoutUs);
+        }
+    };
+}
+
+using namespace encode;
+
+//!
+//! \brief  Synthetic stream configuration
+//!
+struct BenchConfig
+{
+    const char *name;
+    uint32_t    width;
+    uint32_t    height;
+    uint8_t     tileColumns;
+    uint8_t     tileRows;
+    bool        slicePerCtuRow;
+};
+
+static const BenchConfig g_benchConfigs[] =
+{
+    {"1080p", 1920, 1080, 1, 1, false},
+    {"1080p-rows", 1920, 1080, 1, 1, true},
+    {"4k", 3840, 2160, 2, 2, false},
+    {"4k-rows", 3840, 2160, 2, 1, true},
+    {"4k-3col", 3840, 2160, 3, 1, false},
+    {"8k", 7680, 4320, 5, 4, false},
+};
+
+/******************************************************************
+Host MOS interface, resources are backed by system memory
+*******************************************************************/
+//!
+//! \brief  Fails the allocations made off the main thread, as a full heap would
+//!
+static std::atomic<bool> g_hostFailBackgroundAllocations(false);
+static std::thread::id   g_hostMainThread = std::this_thread::get_id();
+
+static MOS_STATUS HostAllocateResource(PMOS_INTERFACE osInterface, PMOS_ALLOC_GFXRES_PARAMS params, PMOS_RESOURCE resource)
+{
+    if (g_hostFailBackgroundAllocations && std::this_thread::get_id() != g_hostMainThread)
+    {
+        return MOS_STATUS_NO_SPACE;
+    }
+
+    uint32_t size = params->dwBytes;
+    if (params->Type != MOS_GFXRES_BUFFER)
+    {
+        size = params->dwWidth * params->dwHeight * 4;
+    }
+
+    MOS_ZeroMemory(resource, sizeof(*resource));
+    resource->pData    = (uint8_t *)MOS_AllocAndZeroMemory(size);
+    resource->iSize    = size;
+    resource->iWidth   = params->Type == MOS_GFXRES_BUFFER ? size : params->dwWidth;
+    resource->iHeight  = params->Type == MOS_GFXRES_BUFFER ? 1 : params->dwHeight;
+    resource->iPitch   = resource->iWidth;
+    resource->Format   = params->Format;
+    resource->TileType = params->TileType;
+    return resource->pData ? MOS_STATUS_SUCCESS : MOS_STATUS_NO_SPACE;
+}
+
+static void HostFreeResource(PMOS_INTERFACE osInterface, PMOS_RESOURCE resource)
+{
+    MOS_FreeMemAndSetNull(resource->pData);
+}
+
+static void *HostLockResource(PMOS_INTERFACE osInterface, PMOS_RESOURCE resource, PMOS_LOCK_PARAMS flags)
+{
+    return resource->pData;
+}
+
+static MOS_STATUS HostUnlockResource(PMOS_INTERFACE osInterface, PMOS_RESOURCE resource)
+{
+    return MOS_STATUS_SUCCESS;
+}
+
+static uint64_t HostGetResourceGfxAddress(PMOS_INTERFACE osInterface, PMOS_RESOURCE resource)
+{
+    return (uint64_t)(uintptr_t)resource->pData;
+}
+
+static void HostResetResourceAllocationIndex(PMOS_INTERFACE osInterface, PMOS_RESOURCE resource)
+{
+}
+
+//!
+//! \brief  Status tag of the host GPU, every submission is completed at once
+//! \details The recycled slot check moves it on from another thread, as the GPU would.
+//!
+static std::atomic<uint32_t> g_hostGpuStatusTag(1);
+
+static uint32_t HostGetGpuStatusTag(PMOS_INTERFACE osInterface, MOS_GPU_CONTEXT gpuContext)
+{
+    return g_hostGpuStatusTag;
+}
+
+static uint32_t HostGetGpuStatusSyncTag(PMOS_INTERFACE osInterface, MOS_GPU_CONTEXT gpuContext)
+{
+    return g_hostGpuStatusTag;
+}
+
+//!
+//! \brief  Resource and patch lists of the host OS interface
+//! \details The lists are plain vectors as in the real OS interface, callers counts
+//!          the threads inside, so overlapping calls are counted as races.
+//!
+struct HostPatchList
+{
+    std::vector<PMOS_RESOURCE>          resources;
+    std::vector<MOS_PATCH_ENTRY_PARAMS> entries;
+    std::atomic<uint32_t>               callers{0};
+    std::atomic<uint32_t>               races{0};
+
+    void Reset()
+    {
+        resources.clear();
+        entries.clear();
+        races = 0;
+    }
+};
+
+static HostPatchList g_hostPatchList;
+
+//!
+//! \brief  Marks a call into the host patch list and detects overlapping calls
+//!
+class HostPatchListScope
+{
+public:
+    HostPatchListScope()
+    {
+        if (g_hostPatchList.callers++ != 0)
+        {
+            g_hostPatchList.races++;
+        }
+    }
+
+    ~HostPatchListScope() { g_hostPatchList.callers--; }
+};
+
+static MOS_STATUS HostRegisterResource(PMOS_INTERFACE osInterface, PMOS_RESOURCE resource, int32_t write, int32_t writeRender)
+{
+    HostPatchListScope scope;
+    auto &resources = g_hostPatchList.resources;
+    if (std::find(resources.begin(), resources.end(), resource) == resources.end())
+    {
+        resources.push_back(resource);
+    }
+    return MOS_STATUS_SUCCESS;
+}
+
+static int32_t HostGetResourceAllocationIndex(PMOS_INTERFACE osInterface, PMOS_RESOURCE resource)
+{
+    HostPatchListScope scope;
+    auto &resources = g_hostPatchList.resources;
+    auto  found     = std::find(resources.begin(), resources.end(), resource);
+    return found == resources.end() ? -1 : (int32_t)(found - resources.begin());
+}
+
+static MOS_STATUS HostSetPatchEntry(PMOS_INTERFACE osInterface, PMOS_PATCH_ENTRY_PARAMS params)
+{
+    HostPatchListScope scope;
+    if (params->uiAllocationIndex >= g_hostPatchList.resources.size())
+    {
+        return MOS_STATUS_INVALID_PARAMETER;
+    }
+    g_hostPatchList.entries.push_back(*params);
+    return MOS_STATUS_SUCCESS;
+}
+
+static MOS_STATUS HostGetResourceInfo(PMOS_INTERFACE osInterface, PMOS_RESOURCE resource, PMOS_SURFACE details)
+{
+    details->dwWidth  = resource->iWidth;
+    details->dwHeight = resource->iHeight;
+    details->dwPitch  = resource->iPitch;
+    details->Format   = resource->Format;
+    details->TileType = resource->TileType;
+    return MOS_STATUS_SUCCESS;
+}
+
+//!
+//! \brief  Adapter of the host OS interface, only its address is used as the pool key
+//! \details HostGetGmmClientContext() is only installed by the prewarm check, the host
+//!          has no GMM for the other users of the client context.
+//!
+static uint8_t g_hostAdapter;
+
+static GMM_CLIENT_CONTEXT *HostGetGmmClientContext(PMOS_INTERFACE osInterface)
+{
+    return (GMM_CLIENT_CONTEXT *)&g_hostAdapter;
+}
+
+static void HostSetPerfTag(PMOS_INTERFACE osInterface, uint32_t perfTag)
+{
+}
+
+static void HostIncPerfFrameID(PMOS_INTERFACE osInterface)
+{
+}
+
+static void HostResetPerfBufferID(PMOS_INTERFACE osInterface)
+{
+}
+
+static void InitHostOsInterface(MOS_INTERFACE &osInterface)
+{
+    MOS_ZeroMemory(&osInterface, sizeof(osInterface));
+    osInterface.bUsesPatchList            = true;
+    osInterface.pfnAllocateResource       = HostAllocateResource;
+    osInterface.pfnFreeResource           = HostFreeResource;
+    osInterface.pfnLockResource           = HostLockResource;
+    osInterface.pfnUnlockResource         = HostUnlockResource;
+    osInterface.pfnGetResourceGfxAddress  = HostGetResourceGfxAddress;
+    osInterface.pfnResetResourceAllocationIndex = HostResetResourceAllocationIndex;
+    osInterface.pfnGetGpuStatusTag        = HostGetGpuStatusTag;
+    osInterface.pfnGetGpuStatusSyncTag    = HostGetGpuStatusSyncTag;
+    osInterface.pfnRegisterResource       = HostRegisterResource;
+    osInterface.pfnGetResourceAllocationIndex = HostGetResourceAllocationIndex;
+    osInterface.pfnSetPatchEntry          = HostSetPatchEntry;
+    osInterface.pfnGetResourceInfo        = HostGetResourceInfo;
+    osInterface.pfnSetPerfTag             = HostSetPerfTag;
+    osInterface.pfnIncPerfFrameID         = HostIncPerfFrameID;
+    osInterface.pfnResetPerfBufferID      = HostResetPerfBufferID;
+}
+
+/******************************************************************
+Synthetic sequence, picture and slice parameters
+*******************************************************************/
+struct BenchParams
+{
+    CODEC_HEVC_ENCODE_SEQUENCE_PARAMS      seqParams;
+    CODEC_HEVC_ENCODE_PICTURE_PARAMS       picParams;
+    std::vector<CODEC_HEVC_ENCODE_SLICE_PARAMS> sliceParams;
+};
+
+static void InitBenchParams(const BenchConfig &config, BenchParams &params)
+{
+    const uint32_t minCbSize  = 8;
+    const uint32_t lcuSize    = 64;
+    uint32_t widthInLcu       = MOS_ROUNDUP_DIVIDE(config.width, lcuSize);
+    uint32_t heightInLcu      = MOS_ROUNDUP_DIVIDE(config.height, lcuSize);
+
+    MOS_ZeroMemory(&params.seqParams, sizeof(params.seqParams));
+    params.seqParams.wFrameWidthInMinCbMinus1            = (uint16_t)(MOS_ROUNDUP_DIVIDE(config.width, minCbSize) - 1);
+    params.seqParams.wFrameHeightInMinCbMinus1           = (uint16_t)(MOS_ROUNDUP_DIVIDE(config.height, minCbSize) - 1);
+    params.seqParams.log2_max_coding_block_size_minus3   = 3;
+    params.seqParams.log2_min_coding_block_size_minus3   = 0;
+    params.seqParams.GopPicSize                          = 1;
+    params.seqParams.RateControlMethod                   = RATECONTROL_CQP;
+    params.seqParams.TargetUsage                         = 4;
+
+    MOS_ZeroMemory(&params.picParams, sizeof(params.picParams));
+    params.picParams.CodingType                          = I_TYPE;
+    params.picParams.QpY                                 = 30;
+    params.picParams.CurrOriginalPic.FrameIdx            = 0;
+    params.picParams.CurrReconstructedPic.FrameIdx       = 0;
+    for (auto i = 0; i < CODEC_MAX_NUM_REF_FRAME_HEVC; i++)
+    {
+        params.picParams.RefFrameList[i].PicFlags        = PICTURE_INVALID;
+    }
+    params.picParams.tiles_enabled_flag                  = (config.tileColumns > 1 || config.tileRows > 1);
+    params.picParams.num_tile_columns_minus1             = config.tileColumns - 1;
+    params.picParams.num_tile_rows_minus1                = config.tileRows - 1;
+
+    // Uniform tile grid in LCU, the last column/row takes the remainder
+    for (uint32_t i = 0; i + 1 < config.tileColumns; i++)
+    {
+        params.picParams.tile_column_width[i] = (uint16_t)(widthInLcu / config.tileColumns);
+    }
+    for (uint32_t i = 0; i + 1 < config.tileRows; i++)
+    {
+        params.picParams.tile_row_height[i] = (uint16_t)(heightInLcu / config.tileRows);
+    }
+
+    // One slice per tile, or one slice per LCU row when the frame is not tiled
+    params.sliceParams.clear();
+    uint32_t numSlices = config.slicePerCtuRow ? heightInLcu : config.tileColumns * config.tileRows;
+    params.sliceParams.resize(numSlices);
+    uint32_t address = 0;
+    for (uint32_t i = 0; i < numSlices; i++)
+    {
+        CODEC_HEVC_ENCODE_SLICE_PARAMS &slice = params.sliceParams[i];
+        MOS_ZeroMemory(&slice, sizeof(slice));
+        slice.slice_type            = encodeHevcISlice;
+        slice.slice_segment_address = address;
+        slice.NumLCUsInSlice        = config.slicePerCtuRow ? widthInLcu : (widthInLcu * heightInLcu) / numSlices;
+        if (i == numSlices - 1)
+        {
+            slice.NumLCUsInSlice = widthInLcu * heightInLcu - address;
+        }
+        address += slice.NumLCUsInSlice;
+    }
+}
+
+/******************************************************************
+Benchmark
+*******************************************************************/
+struct BenchResult
+{
+    std::vector<double> pictureUs;
+    std::vector<double> sliceOrTileUs;
+    uint64_t            bytesPerFrame = 0;
+    uint32_t            cmdsPerFrame  = 0;
+    uint32_t            peepholeRemovedCmds = 0;
+    uint32_t            estimatedBytes = 0;
+    uint32_t            sizeOverruns = 0;
+    uint64_t            tileBatchReuses = 0;
+    uint32_t            patchEntries = 0;
+    uint32_t            patchListRaces = 0;
+};
+
+static double Percentile(std::vector<double> samples, double p)
+{
+    if (samples.empty())
+    {
+        return 0.0;
+    }
+    std::sort(samples.begin(), samples.end());
+    size_t idx = (size_t)(p * (samples.size() - 1));
+    return samples[idx];
+}
+
+//!
+//! \brief  Check the pipe programming of a tiled configuration for 1, 2 and 4 pipes
+//! \details Prints the walker pipe field, the engine mode and the tile columns of
+//!          every pipe, and fails if a column is not encoded exactly once, the pipes
+//!          are not in left to right order or 3 pipes are accepted.
+//!
+static MOS_STATUS RunPipeMatrix(const BenchConfig &config)
+{
+    const uint32_t lcuSize     = 64;
+    uint32_t       widthInLcu  = MOS_ROUNDUP_DIVIDE(config.width, lcuSize);
+    uint32_t       heightInLcu = MOS_ROUNDUP_DIVIDE(config.height, lcuSize);
+
+    // Same grid as InitBenchParams()
+    std::vector<uint32_t> columnCtus(config.tileColumns);
+    for (uint32_t col = 0; col < config.tileColumns; col++)
+    {
+        uint32_t width   = (col + 1 < config.tileColumns) ? widthInLcu / config.tileColumns
+                                                          : widthInLcu - (config.tileColumns - 1) * (widthInLcu / config.tileColumns);
+        columnCtus[col] = width * heightInLcu;
+    }
+
+    static const char engineNames[] = {'-', 'L', 'R', 'M'};
+
+    EncodeTileColumnScheduler scheduler;
+    for (uint32_t numPipes = 1; numPipes <= HevcVdencPktG12::m_maxNumPipes; numPipes++)
+    {
+        uint32_t numberOfPipes = 0;
+        if (numPipes == 3)
+        {
+            // The walker has no 3 pipe mode
+            ENCODE_CHK_COND_RETURN(HevcVdencPktG12::GetWalkerNumberOfPipes(numPipes, numberOfPipes) == MOS_STATUS_SUCCESS,
+                "%d pipes are not rejected", numPipes);
+            continue;
+        }
+        ENCODE_CHK_STATUS_RETURN(HevcVdencPktG12::GetWalkerNumberOfPipes(numPipes, numberOfPipes));
+        ENCODE_CHK_STATUS_RETURN(scheduler.Schedule(columnCtus, numPipes));
+
+        printf("%-12s pipes %u walker %u imbalance %5.2f |", config.name, numPipes, numberOfPipes, scheduler.GetImbalance());
+
+        uint32_t prevPipe = 0;
+        for (uint32_t col = 0; col < config.tileColumns; col++)
+        {
+            uint32_t pipe = scheduler.GetColumnPipe(col);
+            ENCODE_CHK_COND_RETURN(pipe >= numPipes || pipe < prevPipe, "Tile column %d is not scheduled in pipe order", col);
+            prevPipe = pipe;
+        }
+        ENCODE_CHK_COND_RETURN(numPipes <= config.tileColumns && prevPipe + 1 != numPipes, "A pipe has no tile column");
+
+        for (uint32_t pipe = 0; pipe < numPipes; pipe++)
+        {
+            uint32_t mode = HevcVdencPktG12::GetMultiEngineMode(pipe, numPipes);
+            printf(" %c:", mode < sizeof(engineNames) ? engineNames[mode] : '?');
+            for (uint32_t col = 0; col < config.tileColumns; col++)
+            {
+                if (scheduler.GetColumnPipe(col) == pipe)
+                {
+                    printf("%u", col);
+                }
+            }
+        }
+        printf("\n");
+    }
+
+    return MOS_STATUS_SUCCESS;
+}
+
+//!
+//! \brief  Frame of a synthetic GOP, surfaces are the POC modulo the DPB size
+//!
+struct BenchGopFrame
+{
+    uint32_t              poc;
+    std::vector<uint32_t> refs;
+};
+
+//!
+//! \brief  Spread GOPs over 1 to 4 engines with the frame dependency tracker
+//! \details Every frame takes one time unit on its engine and starts once its engine
+//!          is free and its waits are signaled. Fails if a frame starts before a
+//!          reference is written, or its surface is overwritten while still read.
+//!
+static MOS_STATUS RunFrameParallelMatrix()
+{
+    const uint32_t dpbSize   = 16;
+    const uint32_t numFrames = 64;
+
+    std::vector<BenchGopFrame> intra, hierB, lowDelay;
+    for (uint32_t i = 0; i < numFrames; i++)
+    {
+        intra.push_back({i, {}});
+        lowDelay.push_back({i, i > 0 ? std::vector<uint32_t>{i - 1} : std::vector<uint32_t>{}});
+    }
+    hierB.push_back({0, {}});
+    for (uint32_t base = 0; base + 8 <= numFrames; base += 8)
+    {
+        // Coding order of a GOP of 8 with 3 temporal layers
+        hierB.push_back({base + 8, {base}});
+        hierB.push_back({base + 4, {base, base + 8}});
+        hierB.push_back({base + 2, {base, base + 4}});
+        hierB.push_back({base + 1, {base, base + 2}});
+        hierB.push_back({base + 3, {base + 2, base + 4}});
+        hierB.push_back({base + 6, {base + 4, base + 8}});
+        hierB.push_back({base + 5, {base + 4, base + 6}});
+        hierB.push_back({base + 7, {base + 6, base + 8}});
+    }
+
+    struct Gop
+    {
+        const char                       *name;
+        const std::vector<BenchGopFrame> &frames;
+    };
+    const Gop gops[] = {{"all-intra", intra}, {"hier-b", hierB}, {"low-delay", lowDelay}};
+
+    for (auto &gop : gops)
+    {
+        for (uint32_t numEngines = 1; numEngines <= EncodeFrameDependencyTracker::m_maxEngines; numEngines++)
+        {
+            EncodeFrameDependencyTracker tracker(numEngines);
+
+            std::vector<double> engineDone[EncodeFrameDependencyTracker::m_maxEngines];
+            double              engineFree[EncodeFrameDependencyTracker::m_maxEngines] = {};
+            double              surfaceWritten[dpbSize] = {};
+            double              surfaceRead[dpbSize]    = {};
+            double              makespan = 0.0;
+
+            for (auto &frame : gop.frames)
+            {
+                uint8_t  refs[CODEC_MAX_NUM_REF_FRAME_HEVC];
+                uint32_t numRefs = 0;
+                for (auto ref : frame.refs)
+                {
+                    refs[numRefs++] = (uint8_t)(ref % dpbSize);
+                }
+                uint8_t recon = (uint8_t)(frame.poc % dpbSize);
+
+                EncodeFrameDispatch dispatch;
+                uint32_t engine = tracker.SelectEngine(false);
+                ENCODE_CHK_STATUS_RETURN(tracker.Dispatch(engine, recon, refs, numRefs, false, dispatch));
+                ENCODE_CHK_COND_RETURN(dispatch.seq != engineDone[engine].size() + 1, "Engine %d skipped a sequence number", engine);
+
+                double start = engineFree[engine];
+                for (uint32_t i = 0; i < numEngines; i++)
+                {
+                    if (dispatch.waitSeq[i] != 0)
+                    {
+                        start = MOS_MAX(start, engineDone[i][dispatch.waitSeq[i] - 1]);
+                    }
+                }
+
+                for (uint32_t i = 0; i < numRefs; i++)
+                {
+                    ENCODE_CHK_COND_RETURN(start < surfaceWritten[refs[i]], "POC %d starts before its reference is written", frame.poc);
+                }
+                ENCODE_CHK_COND_RETURN(start < surfaceWritten[recon] || start < surfaceRead[recon],
+                    "POC %d overwrites a surface still in use", frame.poc);
+
+                double end = start + 1.0;
+                for (uint32_t i = 0; i < numRefs; i++)
+                {
+                    surfaceRead[refs[i]] = MOS_MAX(surfaceRead[refs[i]], end);
+                }
+                surfaceWritten[recon] = end;
+                engineFree[engine]    = end;
+                engineDone[engine].push_back(end);
+                makespan = MOS_MAX(makespan, end);
+            }
+
+            auto &stats = tracker.GetStats();
+            printf("%-12s engines %u frames %3llu independent %3llu waits %3llu speedup %5.2f |",
+                gop.name,
+                numEngines,
+                (unsigned long long)stats.frames,
+                (unsigned long long)stats.independentFrames,
+                (unsigned long long)stats.waits,
+                gop.frames.size() / MOS_MAX(1.0, makespan));
+            for (uint32_t i = 0; i < numEngines; i++)
+            {
+                printf(" %llu", (unsigned long long)stats.engineFrames[i]);
+            }
+            printf("\n");
+        }
+    }
+
+    return MOS_STATUS_SUCCESS;
+}
+
+//!
+//! \brief  Add the picture and the slice or tile level commands of one pass
+//!
+static MOS_STATUS BuildPass(HevcVdencPktG12 &packet, MOS_COMMAND_BUFFER &cmdBuffer, bool tiled)
+{
+    ENCODE_CHK_STATUS_RETURN(HevcVdencPktG12Bench::PatchPictureLevelCommands(packet, cmdBuffer));
+    if (tiled)
+    {
+        ENCODE_CHK_STATUS_RETURN(HevcVdencPktG12Bench::PatchTileLevelCommands(packet, cmdBuffer));
+    }
+    else
+    {
+        ENCODE_CHK_STATUS_RETURN(HevcVdencPktG12Bench::PatchSliceLevelCommands(packet, cmdBuffer));
+    }
+    return HevcVdencPktG12Bench::EndCmdOverflow(packet, cmdBuffer);
+}
+
+//!
+//! \brief  Append the commands of a buffer, the MI_BATCH_BUFFER_START to the skipped targets are left out
+//!
+static MOS_STATUS AppendCmds(
+    const uint32_t                  *cmds,
+    uint32_t                         dwStart,
+    uint32_t                         dwEnd,
+    const std::vector<const void *> &skippedTargets,
+    std::vector<uint32_t>           &stream)
+{
+    for (uint32_t dw = dwStart, dwSize = 0; dw < dwEnd; dw += dwSize)
+    {
+        ENCODE_CHK_COND_RETURN(!EncodeCmdWalker::GetCmdSize(cmds + dw, dwEnd - dw, dwSize), "Unknown command at dword %d", dw);
+
+        uint32_t    offset = 0;
+        const void *target = MhwCmdRecorderG12::GetBatchStartTarget(cmds + dw, offset);
+        if (target == nullptr || std::find(skippedTargets.begin(), skippedTargets.end(), target) == skippedTargets.end())
+        {
+            stream.insert(stream.end(), cmds + dw, cmds + dw + dwSize);
+        }
+    }
+    return MOS_STATUS_SUCCESS;
+}
+
+//!
+//! \brief  Build the current frame into a command buffer which is too small for it
+//! \details The pass continues in overflow batch buffers. Without the chain between the
+//!          buffers, its commands and patch entries have to be the ones of a build into
+//!          a large enough buffer.
+//!
+static MOS_STATUS RunCmdOverflowCheck(HevcVdencPktG12 &packet, bool tiled, std::vector<uint32_t> &cmdMemory)
+{
+    // The first reservation of the pass already does not fit
+    const int32_t sizes[2] = {(int32_t)(cmdMemory.size() * sizeof(uint32_t)), 2 * CODECHAL_CACHELINE_SIZE};
+
+    std::vector<uint32_t>               streams[2];
+    std::vector<MOS_PATCH_ENTRY_PARAMS> entries[2];
+    for (uint32_t run = 0; run < 2; run++)
+    {
+        MOS_COMMAND_BUFFER cmdBuffer;
+        MOS_ZeroMemory(&cmdBuffer, sizeof(cmdBuffer));
+        cmdBuffer.pCmdBase   = cmdMemory.data();
+        cmdBuffer.pCmdPtr    = cmdMemory.data();
+        cmdBuffer.iRemaining = sizes[run];
+        g_hostPatchList.resources.clear();
+        g_hostPatchList.entries.clear();
+
+        ENCODE_CHK_STATUS_RETURN(BuildPass(packet, cmdBuffer, tiled));
+
+        auto &overflows = HevcVdencPktG12Bench::GetCmdOverflowBatches(packet);
+        ENCODE_CHK_COND_RETURN((run == 1) == overflows.empty(), "Overflow batch buffers are %s", run ? "not used" : "used");
+
+        // Primary buffer up to the chain, the overflow batch buffers in chain order, and the
+        // primary buffer from where the chain returns
+        const MHW_BATCH_BUFFER   *chainReturn = HevcVdencPktG12Bench::GetCmdOverflowReturn(packet);
+        std::vector<const void *> chainTargets(overflows.begin(), overflows.end());
+        chainTargets.push_back(chainReturn);
+
+        uint32_t dwEnd    = (uint32_t)cmdBuffer.iOffset / sizeof(uint32_t);
+        uint32_t dwReturn = overflows.empty() ? dwEnd : chainReturn->dwOffset / sizeof(uint32_t);
+        ENCODE_CHK_STATUS_RETURN(AppendCmds(cmdBuffer.pCmdBase, 0, dwReturn, chainTargets, streams[run]));
+        for (auto overflow : overflows)
+        {
+            ENCODE_CHK_STATUS_RETURN(AppendCmds((const uint32_t *)overflow->pData, 0, overflow->iCurrent / sizeof(uint32_t), chainTargets, streams[run]));
+        }
+        ENCODE_CHK_STATUS_RETURN(AppendCmds(cmdBuffer.pCmdBase, dwReturn, dwEnd, chainTargets, streams[run]));
+
+        for (auto &entry : g_hostPatchList.entries)
+        {
+            bool chained = false;
+            for (auto target : chainTargets)
+            {
+                chained |= (entry.presResource == &((const MHW_BATCH_BUFFER *)target)->OsResource);
+            }
+            if (!chained)
+            {
+                entries[run].push_back(entry);
+            }
+        }
+    }
+
+    ENCODE_CHK_COND_RETURN(streams[0] != streams[1], "Overflow build differs, %d against %d dwords",
+        (uint32_t)streams[1].size(), (uint32_t)streams[0].size());
+    ENCODE_CHK_COND_RETURN(entries[0].size() != entries[1].size(), "Overflow build has %d patch entries instead of %d",
+        (uint32_t)entries[1].size(), (uint32_t)entries[0].size());
+    for (size_t i = 0; i < entries[0].size(); i++)
+    {
+        // Patch offsets are relative to the buffer the command is in
+        ENCODE_CHK_COND_RETURN(entries[0][i].presResource != entries[1][i].presResource ||
+            entries[0][i].uiResourceOffset != entries[1][i].uiResourceOffset ||
+            entries[0][i].bWrite != entries[1][i].bWrite,
+            "Patch entry %d differs in the overflow build", (uint32_t)i);
+    }
+
+    return MOS_STATUS_SUCCESS;
+}
+
+//!
+//! \brief  Build a pass into the host command buffer and take its commands and patch entries
+//!
+static MOS_STATUS BuildPassStream(
+    HevcVdencPktG12                     &packet,
+    bool                                 tiled,
+    std::vector<uint32_t>               &cmdMemory,
+    std::vector<uint32_t>               &stream,
+    std::vector<MOS_PATCH_ENTRY_PARAMS> &entries)
+{
+    MOS_COMMAND_BUFFER cmdBuffer;
+    MOS_ZeroMemory(&cmdBuffer, sizeof(cmdBuffer));
+    cmdBuffer.pCmdBase   = cmdMemory.data();
+    cmdBuffer.pCmdPtr    = cmdMemory.data();
+    cmdBuffer.iRemaining = (int32_t)(cmdMemory.size() * sizeof(uint32_t));
+    g_hostPatchList.resources.clear();
+    g_hostPatchList.entries.clear();
+
+    ENCODE_CHK_STATUS_RETURN(BuildPass(packet, cmdBuffer, tiled));
+
+    stream.assign(cmdBuffer.pCmdBase, cmdBuffer.pCmdPtr);
+    entries = g_hostPatchList.entries;
+
+    return MOS_STATUS_SUCCESS;
+}
+
+//!
+//! \brief  Compare the patch entries of two builds
+//!
+static MOS_STATUS ComparePatchEntries(
+    const std::vector<MOS_PATCH_ENTRY_PARAMS> &entries,
+    const std::vector<MOS_PATCH_ENTRY_PARAMS> &otherEntries)
+{
+    ENCODE_CHK_COND_RETURN(entries.size() != otherEntries.size(), "Build has %d patch entries instead of %d",
+        (uint32_t)otherEntries.size(), (uint32_t)entries.size());
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        ENCODE_CHK_COND_RETURN(entries[i].presResource != otherEntries[i].presResource ||
+            entries[i].uiResourceOffset != otherEntries[i].uiResourceOffset ||
+            entries[i].uiPatchOffset != otherEntries[i].uiPatchOffset ||
+            entries[i].bWrite != otherEntries[i].bWrite,
+            "Patch entry %d differs", (uint32_t)i);
+    }
+    return MOS_STATUS_SUCCESS;
+}
+
+//!
+//! \brief  Build frames with and without the picture level command templates
+//! \details Each frame is built first in full and then with the templates, both builds
+//!          have to write the same commands and patch entries. The first frame records
+//!          the templates, every later one has to replay each of them.
+//!
+static MOS_STATUS RunPictureTemplateCheck(
+    HevcVdencPipelineG12  &pipeline,
+    HevcVdencPktG12       &packet,
+    EncoderParams         &encodeParams,
+    BenchParams           &params,
+    std::vector<uint32_t> &cmdMemory)
+{
+    const uint32_t numFrames = 3;
+    bool           tiled     = params.picParams.tiles_enabled_flag;
+
+    packet.SetPictureCmdTemplates(true);
+
+    for (uint32_t frame = 0; frame < numFrames; frame++)
+    {
+        params.picParams.CurrPicOrderCnt++;
+        ENCODE_CHK_STATUS_RETURN(pipeline.Prepare(&encodeParams));
+        ENCODE_CHK_STATUS_RETURN(packet.Prepare());
+
+        uint32_t hits[2][4] = {};
+        HevcVdencPktG12Bench::GetPictureCmdTemplateHits(packet, hits[0]);
+
+        std::vector<uint32_t>               streams[2];
+        std::vector<MOS_PATCH_ENTRY_PARAMS> entries[2];
+        for (uint32_t templates = 0; templates < 2; templates++)
+        {
+            HevcVdencPktG12Bench::SetPictureCmdTemplatesActive(packet, templates != 0);
+            ENCODE_CHK_STATUS_RETURN(BuildPassStream(packet, tiled, cmdMemory, streams[templates], entries[templates]));
+        }
+        HevcVdencPktG12Bench::GetPictureCmdTemplateHits(packet, hits[1]);
+
+        ENCODE_CHK_COND_RETURN(streams[0] != streams[1], "Frame %d differs with the templates", frame);
+        ENCODE_CHK_STATUS_RETURN(ComparePatchEntries(entries[0], entries[1]));
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            ENCODE_CHK_COND_RETURN(frame > 0 && hits[1][i] == hits[0][i], "Template %d is not replayed in frame %d", i, frame);
+        }
+    }
+
+    packet.SetPictureCmdTemplates(false);
+
+    return MOS_STATUS_SUCCESS;
+}
+
+//!
+//! \brief  Build frames with the slice commands in the PAK slice batch, with and without the ring
+//! \details Both builds have to write the same commands and patch entries into the primary
+//!          buffer, and the same slice commands into the PAK slice batch or the ring buffer.
+//!          The PAK slice batch has to stay empty with the ring. The host GPU completes every
+//!          submission at once, so all the frames have to use a single ring buffer.
+//!
+static MOS_STATUS RunPakSliceBatchRingCheck(
+    HevcVdencPipelineG12  &pipeline,
+    HevcVdencPktG12       &packet,
+    EncoderParams         &encodeParams,
+    BenchParams           &params,
+    std::vector<uint32_t> &cmdMemory)
+{
+    const uint32_t numFrames = 3;
+
+    for (uint32_t frame = 0; frame < numFrames; frame++)
+    {
+        params.picParams.CurrPicOrderCnt++;
+        ENCODE_CHK_STATUS_RETURN(pipeline.Prepare(&encodeParams));
+        ENCODE_CHK_STATUS_RETURN(packet.Prepare());
+
+        std::vector<uint32_t>               streams[2];
+        std::vector<MOS_PATCH_ENTRY_PARAMS> entries[2];
+        std::vector<uint32_t>               sliceCmds[2];
+        for (uint32_t ring = 0; ring < 2; ring++)
+        {
+            PMHW_BATCH_BUFFER pakSliceBatch = nullptr;
+            ENCODE_CHK_STATUS_RETURN(HevcVdencPktG12Bench::MapPakSliceBatch(packet, pakSliceBatch));
+            MOS_ZeroMemory(pakSliceBatch->pData, pakSliceBatch->iSize);
+
+            // The host memory of the PAK slice batch is kept after it is unmapped
+            const uint32_t *pakSliceCmds = (const uint32_t *)pakSliceBatch->OsResource.pData;
+            uint32_t        pakSliceDws  = (uint32_t)pakSliceBatch->iSize / sizeof(uint32_t);
+
+            HevcVdencPktG12Bench::SetPakSliceBatchUsed(packet, true);
+            packet.SetPakSliceBatchRing(ring != 0);
+            ENCODE_CHK_STATUS_RETURN(BuildPassStream(packet, false, cmdMemory, streams[ring], entries[ring]));
+
+            if (ring == 0)
+            {
+                sliceCmds[0].assign(pakSliceCmds, pakSliceCmds + pakSliceDws);
+                continue;
+            }
+
+            ENCODE_CHK_COND_RETURN(std::any_of(pakSliceCmds, pakSliceCmds + pakSliceDws, [](uint32_t dw) { return dw != 0; }),
+                "Frame %d wrote the PAK slice batch with the ring", frame);
+
+            auto &pakSliceRing = packet.GetPakSliceBatchRing();
+            ENCODE_CHK_COND_RETURN(pakSliceRing.GetDepth() != 1 || pakSliceRing.GetForcedReuses() != 0,
+                "PAK slice batch ring has %d buffers and %d forced reuses", pakSliceRing.GetDepth(), pakSliceRing.GetForcedReuses());
+
+            const MHW_BATCH_BUFFER *ringBuffer = HevcVdencPktG12Bench::GetPakSliceRingBuffer(packet, 0);
+            ENCODE_CHK_NULL_RETURN(ringBuffer);
+            ENCODE_CHK_NULL_RETURN(ringBuffer->pData);
+            const uint32_t *ringCmds = (const uint32_t *)ringBuffer->pData;
+            sliceCmds[1].assign(ringCmds, ringCmds + ringBuffer->iCurrent / sizeof(uint32_t));
+
+            // Nothing may follow the slice commands in the PAK slice batch
+            sliceCmds[1].resize(MOS_MAX(sliceCmds[1].size(), sliceCmds[0].size()), 0);
+        }
+        HevcVdencPktG12Bench::SetPakSliceBatchUsed(packet, false);
+        packet.SetPakSliceBatchRing(false);
+
+        ENCODE_CHK_COND_RETURN(streams[0] != streams[1], "Frame %d differs with the PAK slice batch ring", frame);
+        ENCODE_CHK_STATUS_RETURN(ComparePatchEntries(entries[0], entries[1]));
+        ENCODE_CHK_COND_RETURN(sliceCmds[0] != sliceCmds[1], "Frame %d wrote other slice commands to the ring", frame);
+    }
+
+    return MOS_STATUS_SUCCESS;
+}
+
+//!
+//! \brief  Build frames with a repeated and a PAK only pass with and without pass replay
+//! \details Each pass is built first in full and then with the pass replay, both builds
+//!          have to write the same commands and patch entries. Each pass type is learned
+//!          in the first frame and replayed in all the later ones.
+//!
+static MOS_STATUS RunPassReplayCheck(
+    HevcVdencPipelineG12  &pipeline,
+    HevcVdencPktG12       &packet,
+    EncoderParams         &encodeParams,
+    BenchParams           &params,
+    std::vector<uint32_t> &cmdMemory)
+{
+    const uint32_t numFrames = 4;
+    const bool     pakOnlyPass[] = {false, false, true};
+    const uint32_t numPasses = sizeof(pakOnlyPass) / sizeof(pakOnlyPass[0]);
+
+    packet.SetPassReplay(true);
+    uint32_t replayCount = packet.GetPassReplayCount();
+    uint32_t learnCount  = HevcVdencPktG12Bench::GetPassReplayLearnCount(packet);
+
+    for (uint32_t frame = 0; frame < numFrames; frame++)
+    {
+        params.picParams.CurrPicOrderCnt++;
+        ENCODE_CHK_STATUS_RETURN(pipeline.Prepare(&encodeParams));
+        ENCODE_CHK_STATUS_RETURN(packet.Prepare());
+
+        for (uint32_t pass = 0; pass < numPasses; pass++)
+        {
+            ENCODE_CHK_STATUS_RETURN(HevcVdencPktG12Bench::SetPass(packet, (uint16_t)pass, pakOnlyPass[pass]));
+
+            std::vector<uint32_t>               streams[2];
+            std::vector<MOS_PATCH_ENTRY_PARAMS> entries[2];
+            for (uint32_t replay = 0; replay < 2; replay++)
+            {
+                HevcVdencPktG12Bench::SetPassReplayActive(packet, replay != 0);
+                ENCODE_CHK_STATUS_RETURN(BuildPassStream(packet, false, cmdMemory, streams[replay], entries[replay]));
+            }
+
+            ENCODE_CHK_COND_RETURN(streams[0] != streams[1], "Frame %d pass %d differs with pass replay", frame, pass);
+            ENCODE_CHK_STATUS_RETURN(ComparePatchEntries(entries[0], entries[1]));
+        }
+    }
+
+    ENCODE_CHK_STATUS_RETURN(HevcVdencPktG12Bench::SetPass(packet, 0, false));
+    packet.SetPassReplay(false);
+
+    // One full build per pass type, the replay starts with the second frame
+    learnCount  = HevcVdencPktG12Bench::GetPassReplayLearnCount(packet) - learnCount;
+    replayCount = packet.GetPassReplayCount() - replayCount;
+    ENCODE_CHK_COND_RETURN(learnCount != EncodePassReplay::m_numPassTypes, "Pass replay learned %d times", learnCount);
+    ENCODE_CHK_COND_RETURN(replayCount != (numFrames - 1) * (numPasses - 1), "Pass replay replayed %d passes", replayCount);
+
+    return MOS_STATUS_SUCCESS;
+}
+
+//!
+//! \brief  Build the current frame with the tile level batches built serially and in parallel
+//! \details Both builds have to write the same commands into the primary buffer and the
+//!          tile level batches. The patch entries of each buffer have to be the same and
+//!          in the same order, the allocation indices depend on the registration order.
+//!
+static MOS_STATUS RunParallelTileBatchCheck(
+    HevcVdencPktG12       &packet,
+    std::vector<uint32_t> &cmdMemory,
+    uint32_t               tileThreads,
+    bool                   batchReuse)
+{
+    std::vector<uint32_t>               streams[2];
+    std::vector<MOS_PATCH_ENTRY_PARAMS> entries[2];
+
+    // Reused tile level batches are not built again
+    packet.SetBatchReuse(false);
+    for (uint32_t parallel = 0; parallel < 2; parallel++)
+    {
+        ENCODE_CHK_STATUS_RETURN(packet.SetParallelTileBatch(parallel != 0, tileThreads));
+        ENCODE_CHK_STATUS_RETURN(BuildPassStream(packet, true, cmdMemory, streams[parallel], entries[parallel]));
+        HevcVdencPktG12Bench::AppendTileBatchCmds(packet, streams[parallel]);
+
+        // Patch offsets are relative to the buffer of the entry
+        std::stable_sort(entries[parallel].begin(), entries[parallel].end(),
+            [](const MOS_PATCH_ENTRY_PARAMS &a, const MOS_PATCH_ENTRY_PARAMS &b) {
+                return std::less<const uint8_t *>()(a.cmdBufBase, b.cmdBufBase);
+            });
+    }
+    ENCODE_CHK_STATUS_RETURN(packet.SetParallelTileBatch(tileThreads > 0, tileThreads));
+    packet.SetBatchReuse(batchReuse);
+
+    ENCODE_CHK_COND_RETURN(streams[0] != streams[1], "Parallel tile build differs, %d against %d dwords",
+        (uint32_t)streams[1].size(), (uint32_t)streams[0].size());
+    ENCODE_CHK_COND_RETURN(entries[0].size() != entries[1].size(), "Parallel tile build has %d patch entries instead of %d",
+        (uint32_t)entries[1].size(), (uint32_t)entries[0].size());
+    for (size_t i = 0; i < entries[0].size(); i++)
+    {
+        ENCODE_CHK_COND_RETURN(entries[0][i].cmdBufBase != entries[1][i].cmdBufBase ||
+            entries[0][i].presResource != entries[1][i].presResource ||
+            entries[0][i].uiResourceOffset != entries[1][i].uiResourceOffset ||
+            entries[0][i].uiPatchOffset != entries[1][i].uiPatchOffset ||
+            entries[0][i].bWrite != entries[1][i].bWrite,
+            "Patch entry %d differs in the parallel tile build", (uint32_t)i);
+    }
+
+    return MOS_STATUS_SUCCESS;
+}
+
+//!
+//! \brief  Build the tile batch starts of the later pipes of the current frame as a shared build
+//! \details The tiles of the last frame are spread over 2 and 4 pipes. The batch buffer of
+//!          each later pipe has to hold the commands and patch entries of a serial build of
+//!          the pipe, and start each tile level batch of the pipe once. The host GPU completes
+//!          every submission at once, so the builds have to reuse the same ring buffers.
+//!
+static MOS_STATUS RunSharedPipeBuildCheck(
+    HevcVdencPktG12       &packet,
+    std::vector<uint32_t> &cmdMemory,
+    uint32_t               tileThreads,
+    bool                   batchReuse)
+{
+    const uint32_t pipeCounts[] = {2, 4, 4};
+
+    // Reused tile level batches are not built again
+    packet.SetBatchReuse(false);
+    ENCODE_CHK_STATUS_RETURN(packet.SetSharedPipeBuild(true));
+
+    std::vector<uint32_t>               stream;
+    std::vector<MOS_PATCH_ENTRY_PARAMS> entries;
+    for (uint32_t run = 0; run < sizeof(pipeCounts) / sizeof(pipeCounts[0]); run++)
+    {
+        // The last run builds the pipes on the workers
+        uint32_t numPipes = pipeCounts[run];
+        ENCODE_CHK_STATUS_RETURN(packet.SetParallelTileBatch(run == 2, tileThreads));
+        ENCODE_CHK_STATUS_RETURN(BuildPassStream(packet, true, cmdMemory, stream, entries));
+
+        uint32_t numTileRows = HevcVdencPktG12Bench::SpreadTilesOverPipes(packet, numPipes);
+        g_hostPatchList.resources.clear();
+        g_hostPatchList.entries.clear();
+        ENCODE_CHK_STATUS_RETURN(HevcVdencPktG12Bench::BuildPipeStartBatches(packet, numTileRows, numPipes));
+        std::vector<MOS_PATCH_ENTRY_PARAMS> sharedEntries = g_hostPatchList.entries;
+
+        for (uint32_t pipe = 1; pipe < numPipes; pipe++)
+        {
+            const MHW_BATCH_BUFFER *pipeBatch = HevcVdencPktG12Bench::GetPipeStartBatch(packet, pipe);
+            ENCODE_CHK_NULL_RETURN(pipeBatch);
+            ENCODE_CHK_NULL_RETURN(pipeBatch->pData);
+            const uint32_t *pipeCmds = (const uint32_t *)pipeBatch->pData;
+            uint32_t        pipeDws  = (uint32_t)pipeBatch->iCurrent / sizeof(uint32_t);
+
+            std::vector<uint32_t> serialMemory(pipeBatch->iSize / sizeof(uint32_t));
+            MOS_COMMAND_BUFFER    serialCmdBuffer;
+            MOS_ZeroMemory(&serialCmdBuffer, sizeof(serialCmdBuffer));
+            serialCmdBuffer.pCmdBase   = serialMemory.data();
+            serialCmdBuffer.pCmdPtr    = serialMemory.data();
+            serialCmdBuffer.iRemaining = pipeBatch->iSize;
+            g_hostPatchList.entries.clear();
+            ENCODE_CHK_STATUS_RETURN(HevcVdencPktG12Bench::AddSharedTileBatchStarts(packet, serialCmdBuffer, numTileRows, pipe));
+
+            ENCODE_CHK_COND_RETURN(std::vector<uint32_t>(pipeCmds, pipeCmds + pipeDws) !=
+                std::vector<uint32_t>(serialCmdBuffer.pCmdBase, serialCmdBuffer.pCmdPtr),
+                "Shared build of pipe %d of %d differs from a serial build", pipe, numPipes);
+
+            std::vector<MOS_PATCH_ENTRY_PARAMS> pipeEntries;
+            for (auto &entry : sharedEntries)
+            {
+                if (entry.cmdBufBase == (uint8_t *)pipeBatch->pData)
+                {
+                    pipeEntries.push_back(entry);
+                }
+            }
+            ENCODE_CHK_STATUS_RETURN(ComparePatchEntries(g_hostPatchList.entries, pipeEntries));
+
+            // Each tile level batch of the pipe is started once
+            std::vector<const void *> tileBatches = HevcVdencPktG12Bench::GetTileBatchesOfPipe(packet, pipe);
+            std::vector<const void *> started;
+            for (uint32_t dw = 0, dwSize = 0; dw < pipeDws; dw += dwSize)
+            {
+                ENCODE_CHK_COND_RETURN(!EncodeCmdWalker::GetCmdSize(pipeCmds + dw, pipeDws - dw, dwSize), "Unknown command at dword %d", dw);
+                uint32_t    offset = 0;
+                const void *target = MhwCmdRecorderG12::GetBatchStartTarget(pipeCmds + dw, offset);
+                if (target != nullptr)
+                {
+                    started.push_back(target);
+                }
+            }
+            std::sort(tileBatches.begin(), tileBatches.end());
+            std::sort(started.begin(), started.end());
+            ENCODE_CHK_COND_RETURN(started != tileBatches, "Pipe %d of %d starts %d tile level batches instead of %d",
+                pipe, numPipes, (uint32_t)started.size(), (uint32_t)tileBatches.size());
+        }
+
+        HevcVdencPktG12Bench::ResetSharedPipeBuild(packet);
+        HevcVdencPktG12Bench::SpreadTilesOverPipes(packet, 1);
+    }
+
+    auto &pipeStartRing = HevcVdencPktG12Bench::GetPipeStartBatchRing(packet);
+    ENCODE_CHK_COND_RETURN(pipeStartRing.GetDepth() != 3 || pipeStartRing.GetForcedReuses() != 0,
+        "Pipe start batch ring has %d buffers and %d forced reuses", pipeStartRing.GetDepth(), pipeStartRing.GetForcedReuses());
+
+    ENCODE_CHK_STATUS_RETURN(packet.SetSharedPipeBuild(false));
+    ENCODE_CHK_STATUS_RETURN(packet.SetParallelTileBatch(tileThreads > 0, tileThreads));
+    packet.SetBatchReuse(batchReuse);
+
+    return MOS_STATUS_SUCCESS;
+}
+
+//!
+//! \brief  Prepare frames with the recycled slot tracking
+//! \details Slots retired with a completed fence are free at once. A slot retired with the
+//!          next fence has to wait until the host GPU reaches it, and a slot whose fence is
+//!          never reached has to fail the frame after the stall timeout.
+//!
+static MOS_STATUS RunRecycledSlotCheck(
+    HevcVdencPipelineG12 &pipeline,
+    HevcVdencPktG12      &packet,
+    EncoderParams        &encodeParams,
+    BenchParams          &params)
+{
+    const uint32_t numFrames = 3;
+
+    ENCODE_CHK_STATUS_RETURN(packet.SetRecycledSlotTracking(true));
+    EncodeRecycledSlotStats stats = packet.GetRecycledSlotManager().GetStats();
+
+    for (uint32_t frame = 0; frame < numFrames; frame++)
+    {
+        params.picParams.CurrPicOrderCnt++;
+        ENCODE_CHK_STATUS_RETURN(pipeline.Prepare(&encodeParams));
+        ENCODE_CHK_STATUS_RETURN(packet.Prepare());
+        HevcVdencPktG12Bench::RetireRecycledSlots(packet, g_hostGpuStatusTag);
+    }
+
+    auto &slotStats = packet.GetRecycledSlotManager().GetStats();
+    ENCODE_CHK_COND_RETURN(slotStats.checks - stats.checks != numFrames || slotStats.stalls != stats.stalls,
+        "Completed slots were checked %d times with %d stalls",
+        (uint32_t)(slotStats.checks - stats.checks), (uint32_t)(slotStats.stalls - stats.stalls));
+
+    // The GPU completes the previous frame while the next one waits
+    uint32_t fence = g_hostGpuStatusTag + 1;
+    HevcVdencPktG12Bench::RetireRecycledSlots(packet, fence);
+    params.picParams.CurrPicOrderCnt++;
+    ENCODE_CHK_STATUS_RETURN(pipeline.Prepare(&encodeParams));
+    std::thread gpu([fence]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        g_hostGpuStatusTag = fence;
+    });
+    MOS_STATUS status = packet.Prepare();
+    gpu.join();
+    ENCODE_CHK_STATUS_RETURN(status);
+    ENCODE_CHK_COND_RETURN(slotStats.stalls - stats.stalls != 1 || slotStats.timeouts != stats.timeouts,
+        "Busy slot stalled %d times with %d timeouts",
+        (uint32_t)(slotStats.stalls - stats.stalls), (uint32_t)(slotStats.timeouts - stats.timeouts));
+
+    // The GPU never completes the previous frame
+    HevcVdencPktG12Bench::RetireRecycledSlots(packet, g_hostGpuStatusTag + 1);
+    HevcVdencPktG12Bench::SetRecycledSlotStallTimeout(packet, 1000);
+    params.picParams.CurrPicOrderCnt++;
+    ENCODE_CHK_STATUS_RETURN(pipeline.Prepare(&encodeParams));
+    ENCODE_CHK_COND_RETURN(packet.Prepare() == MOS_STATUS_SUCCESS, "Frame is prepared into a busy slot");
+    ENCODE_CHK_COND_RETURN(slotStats.timeouts - stats.timeouts != 1, "Busy slot timed out %d times",
+        (uint32_t)(slotStats.timeouts - stats.timeouts));
+
+    HevcVdencPktG12Bench::RetireRecycledSlots(packet, g_hostGpuStatusTag);
+    HevcVdencPktG12Bench::SetRecycledSlotStallTimeout(packet, EncodeRecycledSlotManager::m_defaultStallTimeoutUs);
+    ENCODE_CHK_STATUS_RETURN(packet.SetRecycledSlotTracking(false));
+
+    return MOS_STATUS_SUCCESS;
+}
+
+//!
+//! \brief  Build frames in a session which allocates in the background, packs the scratch
+//!         buffers and defers the optional buffers
+//! \details The session starts without optional buffers and has to build a frame, the
+//!          requested buffers are allocated by the next frame. The metadata buffers are
+//!          packed into one resource. A larger frame size has to grow the buffers, going
+//!          back to the session size has to keep them.
+//!
+static MOS_STATUS RunLazyAllocationCheck(
+    HevcVdencPipelineG12  &pipeline,
+    CodechalHwInterface   *hwInterface,
+    EncoderParams         &encodeParams,
+    BenchParams           &params,
+    std::vector<uint32_t> &cmdMemory)
+{
+    const uint32_t numPackedBuffers = 3;
+    bool           tiled            = params.picParams.tiles_enabled_flag;
+
+    // Init() allocates the resources, as for the packets of the pipeline
+    HevcVdencPktG12 *session = MOS_New(HevcVdencPktG12, &pipeline, nullptr, hwInterface);
+    ENCODE_CHK_NULL_RETURN(session);
+    session->SetAsyncAllocation(true);
+    session->SetLazyOptionalBuffers(true);
+    session->SetScratchSubAllocation(true);
+    ENCODE_CHK_STATUS_RETURN(session->Init());
+    ENCODE_CHK_STATUS_RETURN(session->WaitForResources());
+
+    ENCODE_CHK_COND_RETURN(session->GetUnmaterializedOptionalBuffers() != optionalBufferAll,
+        "Lazy session allocated the optional buffers 0x%x", optionalBufferAll & ~session->GetUnmaterializedOptionalBuffers());
+    ENCODE_CHK_COND_RETURN(HevcVdencPktG12Bench::GetPackedScratchBuffers(*session) != numPackedBuffers,
+        "Session packed %d scratch buffers", HevcVdencPktG12Bench::GetPackedScratchBuffers(*session));
+
+    std::vector<uint32_t>               stream;
+    std::vector<MOS_PATCH_ENTRY_PARAMS> entries;
+    for (uint32_t frame = 0; frame < 2; frame++)
+    {
+        // The second frame allocates the requested buffers
+        if (frame == 1)
+        {
+            session->RequestOptionalBuffers(optionalBufferAll);
+        }
+        params.picParams.CurrPicOrderCnt++;
+        ENCODE_CHK_STATUS_RETURN(pipeline.Prepare(&encodeParams));
+        ENCODE_CHK_STATUS_RETURN(session->Prepare());
+        ENCODE_CHK_STATUS_RETURN(BuildPassStream(*session, tiled, cmdMemory, stream, entries));
+    }
+    ENCODE_CHK_COND_RETURN(session->GetUnmaterializedOptionalBuffers() != 0,
+        "Requested optional buffers 0x%x are not allocated", session->GetUnmaterializedOptionalBuffers());
+
+    uint32_t                    capacities[sharedResourceNum];
+    HevcVdencPicBufferConfigG12 config = HevcVdencPktG12Bench::GetPicBufferConfig(*session);
+    for (uint32_t i = 0; i < sharedResourceNum; i++)
+    {
+        capacities[i] = session->GetPictureBufferCapacity(i);
+        ENCODE_CHK_COND_RETURN(capacities[i] == 0, "Picture buffer %d is not allocated", i);
+    }
+
+    ENCODE_CHK_STATUS_RETURN(session->Reconfigure(config.width + 256, config.height + 256, config.bitDepth, config.chromaFormat));
+    ENCODE_CHK_COND_RETURN(session->GetPictureBufferCapacity(sharedPakStreamOut) <= capacities[sharedPakStreamOut],
+        "PAK stream-out buffer did not grow with the frame size");
+    for (uint32_t i = 0; i < sharedResourceNum; i++)
+    {
+        ENCODE_CHK_COND_RETURN(session->GetPictureBufferCapacity(i) < capacities[i], "Picture buffer %d shrank", i);
+        capacities[i] = session->GetPictureBufferCapacity(i);
+    }
+
+    ENCODE_CHK_STATUS_RETURN(session->Reconfigure(config.width, config.height, config.bitDepth, config.chromaFormat));
+    for (uint32_t i = 0; i < sharedResourceNum; i++)
+    {
+        ENCODE_CHK_COND_RETURN(session->GetPictureBufferCapacity(i) != capacities[i],
+            "Picture buffer %d was reallocated for a smaller frame", i);
+    }
+    ENCODE_CHK_COND_RETURN(HevcVdencPktG12Bench::GetPackedScratchBuffers(*session) != numPackedBuffers,
+        "Session packed %d scratch buffers after growing", HevcVdencPktG12Bench::GetPackedScratchBuffers(*session));
+
+    params.picParams.CurrPicOrderCnt++;
+    ENCODE_CHK_STATUS_RETURN(pipeline.Prepare(&encodeParams));
+    ENCODE_CHK_STATUS_RETURN(session->Prepare());
+    ENCODE_CHK_STATUS_RETURN(BuildPassStream(*session, tiled, cmdMemory, stream, entries));
+
+    MOS_Delete(session);
+
+    // A background allocation which fails has to fail the first frame
+    session = MOS_New(HevcVdencPktG12, &pipeline, nullptr, hwInterface);
+    ENCODE_CHK_NULL_RETURN(session);
+    session->SetAsyncAllocation(true);
+    g_hostFailBackgroundAllocations = true;
+    MOS_STATUS initStatus = session->Init();
+    MOS_STATUS waitStatus = session->WaitForResources();
+    g_hostFailBackgroundAllocations = false;
+    ENCODE_CHK_STATUS_RETURN(initStatus);
+    ENCODE_CHK_COND_RETURN(waitStatus == MOS_STATUS_SUCCESS, "Failed background allocation is not reported");
+
+    params.picParams.CurrPicOrderCnt++;
+    ENCODE_CHK_STATUS_RETURN(pipeline.Prepare(&encodeParams));
+    ENCODE_CHK_COND_RETURN(session->Prepare() == MOS_STATUS_SUCCESS, "Frame is prepared without its resources");
+
+    MOS_Delete(session);
+
+    return MOS_STATUS_SUCCESS;
+}
+
+//!
+//! \brief  Allocate a session from buffers prewarmed in the shared resource pool
+//! \details Every picture buffer of the session has to be leased from the warm buffers,
+//!          none may be allocated. The pool frees all of them once drained.
+//!
+static MOS_STATUS RunPrewarmCheck(
+    HevcVdencPipelineG12 &pipeline,
+    HevcVdencPktG12      &packet,
+    CodechalHwInterface  *hwInterface,
+    MOS_INTERFACE        &osInterface)
+{
+    auto &pool = EncodeSharedResourcePool::GetInstance();
+    pool.SetEnabled(true);
+    osInterface.pfnGetGmmClientContext = HostGetGmmClientContext;
+
+    EncodeSharedResourcePoolStats stats = pool.GetStats();
+    ENCODE_CHK_STATUS_RETURN(packet.PrewarmSharedResources(HevcVdencPktG12Bench::GetPicBufferConfig(packet), 1));
+
+    HevcVdencPktG12 *session = MOS_New(HevcVdencPktG12, &pipeline, nullptr, hwInterface);
+    ENCODE_CHK_NULL_RETURN(session);
+    ENCODE_CHK_STATUS_RETURN(session->Init());
+
+    EncodeSharedResourcePoolStats leaseStats = pool.GetStats();
+    ENCODE_CHK_COND_RETURN(leaseStats.hits - stats.hits != sharedResourceNum || leaseStats.misses != stats.misses,
+        "Session leased %d warm buffers and allocated %d", (uint32_t)(leaseStats.hits - stats.hits),
+        (uint32_t)(leaseStats.misses - stats.misses));
+
+    MOS_Delete(session);
+    ENCODE_CHK_STATUS_RETURN(pool.DrainWarm(&osInterface));
+
+    EncodeSharedResourcePoolStats drainStats = pool.GetStats();
+    ENCODE_CHK_COND_RETURN(drainStats.releases - stats.releases != sharedResourceNum || drainStats.freeBytes != stats.freeBytes,
+        "Pool keeps %d bytes after the drain", (uint32_t)(drainStats.freeBytes - stats.freeBytes));
+
+    osInterface.pfnGetGmmClientContext = nullptr;
+    pool.SetEnabled(false);
+
+    return MOS_STATUS_SUCCESS;
+}
+
+static MOS_STATUS RunConfig(const BenchConfig &config, uint32_t frames, uint32_t tileThreads, bool peephole, bool batchReuse, BenchResult &result)
+{
+    MOS_INTERFACE     osInterface;
+    MhwCmdRecorderG12 recorder;
+    InitHostOsInterface(osInterface);
+
+    MhwInterfaces *mhwInterfaces = MOS_New(MhwInterfaces);
+    ENCODE_CHK_NULL_RETURN(mhwInterfaces);
+    mhwInterfaces->m_cpInterface    = Create_MhwCpInterface(&osInterface);
+    mhwInterfaces->m_miInterface    = MOS_New(MhwMiInterfaceG12Recorder, &recorder, mhwInterfaces->m_cpInterface, &osInterface);
+    mhwInterfaces->m_hcpInterface   = MOS_New(MhwVdboxHcpInterfaceG12Recorder, &recorder, &osInterface, mhwInterfaces->m_miInterface, mhwInterfaces->m_cpInterface);
+    mhwInterfaces->m_vdencInterface = MOS_New(MhwVdboxVdencInterfaceG12XRecorder, &recorder, &osInterface);
+
+    // The hw interface takes over the MHW interfaces, only the container is released here
+    CodechalHwInterface *hwInterface = MOS_New(CodechalHwInterfaceG12, &osInterface, CODECHAL_FUNCTION_ENC_VDENC_PAK, mhwInterfaces);
+    MOS_Delete(mhwInterfaces);
+    ENCODE_CHK_NULL_RETURN(hwInterface);
+
+    HevcVdencPipelineG12 *pipeline = MOS_New(HevcVdencPipelineG12, hwInterface, nullptr);
+    ENCODE_CHK_NULL_RETURN(pipeline);
+
+    CodechalSetting settings;
+    settings.codecFunction    = CODECHAL_FUNCTION_ENC_VDENC_PAK;
+    settings.width            = config.width;
+    settings.height           = config.height;
+    settings.mode             = CODECHAL_ENCODE_MODE_HEVC;
+    settings.standard         = CODECHAL_HEVC;
+    settings.chromaFormat     = HCP_CHROMA_FORMAT_YUV420;
+    settings.lumaChromaDepth  = CODECHAL_LUMA_CHROMA_DEPTH_8_BITS;
+    ENCODE_CHK_STATUS_RETURN(pipeline->Init(&settings));
+
+    auto packet = dynamic_cast<HevcVdencPktG12 *>(pipeline->GetOrCreate(hevcVdencPacket));
+    ENCODE_CHK_NULL_RETURN(packet);
+    ENCODE_CHK_STATUS_RETURN(packet->SetParallelTileBatch(tileThreads > 0, tileThreads));
+    g_hostPatchList.Reset();
+    packet->SetCmdPeephole(peephole);
+    packet->SetCmdSizeCheck(true);
+    packet->SetBatchReuse(batchReuse);
+
+    BenchParams params;
+    InitBenchParams(config, params);
+
+    EncoderParams encodeParams;
+    MOS_ZeroMemory(&encodeParams, sizeof(encodeParams));
+    encodeParams.ExecCodecFunction = CODECHAL_FUNCTION_ENC_VDENC_PAK;
+    encodeParams.pSeqParams        = &params.seqParams;
+    encodeParams.pPicParams        = &params.picParams;
+    encodeParams.pSliceParams      = params.sliceParams.data();
+    encodeParams.dwNumSlices       = (uint32_t)params.sliceParams.size();
+
+    // Host command buffer, large enough for the 8K worst case
+    std::vector<uint32_t> cmdMemory(16 * 1024 * 1024 / sizeof(uint32_t));
+    MOS_COMMAND_BUFFER    cmdBuffer;
+
+    for (uint32_t frame = 0; frame < frames; frame++)
+    {
+        params.picParams.CurrPicOrderCnt = frame;
+        ENCODE_CHK_STATUS_RETURN(pipeline->Prepare(&encodeParams));
+        ENCODE_CHK_STATUS_RETURN(packet->Prepare());
+
+        uint32_t commandBufferSize = 0;
+        uint32_t patchListSize     = 0;
+        ENCODE_CHK_STATUS_RETURN(packet->CalculateCommandSize(commandBufferSize, patchListSize));
+        result.estimatedBytes = commandBufferSize;
+
+        MOS_ZeroMemory(&cmdBuffer, sizeof(cmdBuffer));
+        cmdBuffer.pCmdBase   = cmdMemory.data();
+        cmdBuffer.pCmdPtr    = cmdMemory.data();
+        cmdBuffer.iRemaining = (int32_t)(cmdMemory.size() * sizeof(uint32_t));
+        recorder.Reset();
+        g_hostPatchList.resources.clear();
+        g_hostPatchList.entries.clear();
+
+        auto start = std::chrono::high_resolution_clock::now();
+        ENCODE_CHK_STATUS_RETURN(HevcVdencPktG12Bench::PatchPictureLevelCommands(*packet, cmdBuffer));
+        auto picDone = std::chrono::high_resolution_clock::now();
+        if (params.picParams.tiles_enabled_flag)
+        {
+            ENCODE_CHK_STATUS_RETURN(HevcVdencPktG12Bench::PatchTileLevelCommands(*packet, cmdBuffer));
+        }
+        else
+        {
+            ENCODE_CHK_STATUS_RETURN(HevcVdencPktG12Bench::PatchSliceLevelCommands(*packet, cmdBuffer));
+        }
+        ENCODE_CHK_STATUS_RETURN(HevcVdencPktG12Bench::EndCmdOverflow(*packet, cmdBuffer));
+        ENCODE_CHK_STATUS_RETURN(HevcVdencPktG12Bench::CheckCmdSize(*packet, cmdBuffer, 0));
+        ENCODE_CHK_STATUS_RETURN(HevcVdencPktG12Bench::RunCmdPeephole(*packet, cmdBuffer, 0));
+        auto end = std::chrono::high_resolution_clock::now();
+
+        result.pictureUs.push_back(std::chrono::duration<double, std::micro>(picDone - start).count());
+        result.sliceOrTileUs.push_back(std::chrono::duration<double, std::micro>(end - picDone).count());
+        result.bytesPerFrame = recorder.GetTotalBytes();
+        result.cmdsPerFrame  = recorder.GetTotalCmdCount();
+        result.patchEntries  = recorder.GetPatchEntryCount();
+        ENCODE_CHK_COND_RETURN(g_hostPatchList.entries.size() != result.patchEntries, "Patch list lost %u entries",
+            result.patchEntries - (uint32_t)g_hostPatchList.entries.size());
+    }
+    if (frames > 0)
+    {
+        ENCODE_CHK_STATUS_RETURN(RunCmdOverflowCheck(*packet, params.picParams.tiles_enabled_flag, cmdMemory));
+    }
+    if (frames > 0)
+    {
+        ENCODE_CHK_STATUS_RETURN(RunPictureTemplateCheck(*pipeline, *packet, encodeParams, params, cmdMemory));
+    }
+    if (frames > 0 && params.picParams.tiles_enabled_flag)
+    {
+        ENCODE_CHK_STATUS_RETURN(RunParallelTileBatchCheck(*packet, cmdMemory, tileThreads, batchReuse));
+        ENCODE_CHK_STATUS_RETURN(RunSharedPipeBuildCheck(*packet, cmdMemory, tileThreads, batchReuse));
+    }
+    if (!params.picParams.tiles_enabled_flag)
+    {
+        ENCODE_CHK_STATUS_RETURN(RunPakSliceBatchRingCheck(*pipeline, *packet, encodeParams, params, cmdMemory));
+        ENCODE_CHK_STATUS_RETURN(RunPassReplayCheck(*pipeline, *packet, encodeParams, params, cmdMemory));
+    }
+    if (frames > 0)
+    {
+        ENCODE_CHK_STATUS_RETURN(RunLazyAllocationCheck(*pipeline, hwInterface, encodeParams, params, cmdMemory));
+        ENCODE_CHK_STATUS_RETURN(RunPrewarmCheck(*pipeline, *packet, hwInterface, osInterface));
+        ENCODE_CHK_STATUS_RETURN(RunRecycledSlotCheck(*pipeline, *packet, encodeParams, params));
+    }
+    result.patchListRaces      = g_hostPatchList.races;
+    result.peepholeRemovedCmds = packet->GetCmdPeepholeStats().removedCmds / MOS_MAX(1u, frames);
+    result.sizeOverruns        = packet->GetCmdSizeStats().overruns;
+    result.tileBatchReuses     = packet->GetBatchReuseStats().tileHits;
+
+    pipeline->Destroy();
+    MOS_Delete(pipeline);
+    MOS_Delete(hwInterface);
+    return MOS_STATUS_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t    frames = argc > 1 ? (uint32_t)atoi(argv[1]) : 300;
+    const char *filter = argc > 2 ? argv[2] : nullptr;
+    uint32_t    threads = argc > 3 ? (uint32_t)atoi(argv[3]) : 0;
+    bool        peephole = argc > 4 ? atoi(argv[4]) != 0 : false;
+    bool        batchReuse = argc > 5 ? atoi(argv[5]) != 0 : false;
+
+    printf("%-12s %10s %10s %10s %10s %10s %10s %8s %8s %8s %8s %8s\n",
+        "config", "pic-avg", "pic-p99", "body-avg", "body-p99", "bytes", "est-bytes", "cmds", "patch", "peep-rm", "overrun", "tile-rt");
+
+    for (auto &config : g_benchConfigs)
+    {
+        if (filter && strncmp(config.name, filter, strlen(filter)) != 0)
+        {
+            continue;
+        }
+
+        BenchResult result;
+        MOS_STATUS  status = RunConfig(config, frames, threads, peephole, batchReuse, result);
+        if (status != MOS_STATUS_SUCCESS)
+        {
+            printf("%-12s failed with status %d\n", config.name, status);
+            return 1;
+        }
+        if (result.patchListRaces != 0)
+        {
+            printf("%-12s %u concurrent calls into the patch list\n", config.name, result.patchListRaces);
+            return 1;
+        }
+
+        double picAvg  = 0.0;
+        double bodyAvg = 0.0;
+        for (size_t i = 0; i < result.pictureUs.size(); i++)
+        {
+            picAvg  += result.pictureUs[i];
+            bodyAvg += result.sliceOrTileUs[i];
+        }
+        picAvg  /= MOS_MAX(1.0, (double)result.pictureUs.size());
+        bodyAvg /= MOS_MAX(1.0, (double)result.sliceOrTileUs.size());
+
+        printf("%-12s %10.2f %10.2f %10.2f %10.2f %10llu %10u %8u %8u %8u %8u %8llu\n",
+            config.name,
+            picAvg,
+            Percentile(result.pictureUs, 0.99),
+            bodyAvg,
+            Percentile(result.sliceOrTileUs, 0.99),
+            (unsigned long long)result.bytesPerFrame,
+            result.estimatedBytes,
+            result.cmdsPerFrame,
+            result.patchEntries,
+            result.peepholeRemovedCmds,
+            result.sizeOverruns,
+            (unsigned long long)result.tileBatchReuses);
+
+        if (result.sizeOverruns != 0)
+        {
+            printf("%-12s %u frames wrote more than estimated\n", config.name, result.sizeOverruns);
+            return 1;
+        }
+    }
+
+    printf("\n");
+    for (auto &config : g_benchConfigs)
+    {
+        if (config.tileColumns < 2 || (filter && strncmp(config.name, filter, strlen(filter)) != 0))
+        {
+            continue;
+        }
+
+        if (RunPipeMatrix(config) != MOS_STATUS_SUCCESS)
+        {
+            printf("%-12s pipe matrix failed\n", config.name);
+            return 1;
+        }
+    }
+
+    printf("\n");
+    if (RunFrameParallelMatrix() != MOS_STATUS_SUCCESS)
+    {
+        printf("frame parallel matrix failed\n");
+        return 1;
+    }
+
+    return 0;
+}
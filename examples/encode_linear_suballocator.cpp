@@ -0,0 +1,91 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+//!
+//! \file     encode_linear_suballocator.cpp
+//! \brief    Implements the suballocator of small buffers
+//!
+#include "encode_linear_suballocator.h"
+#include "encode_utils.h"
+
+namespace encode
+{
+    uint32_t EncodeLinearSubAllocator::Reserve(uint32_t size, uint32_t alignment)
+    {
+        EncodeSubAllocation range;
+        range.offset = MOS_ALIGN_CEIL(m_totalSize, alignment);
+        range.size   = size;
+
+        m_totalSize = range.offset + size;
+        m_ranges.push_back(range);
+
+        return (uint32_t)m_ranges.size() - 1;
+    }
+
+    MOS_STATUS EncodeLinearSubAllocator::Allocate(EncodeAllocator *allocator, const char *name)
+    {
+        ENCODE_FUNC_CALL();
+
+        ENCODE_CHK_NULL_RETURN(allocator);
+        ENCODE_CHK_COND_RETURN(m_backing != nullptr, "Backing resource is already allocated");
+        ENCODE_CHK_COND_RETURN(m_totalSize == 0, "No buffer is reserved");
+
+        MOS_ALLOC_GFXRES_PARAMS allocParams;
+        MOS_ZeroMemory(&allocParams, sizeof(MOS_ALLOC_GFXRES_PARAMS));
+        allocParams.Type     = MOS_GFXRES_BUFFER;
+        allocParams.TileType = MOS_TILE_LINEAR;
+        allocParams.Format   = Format_Buffer;
+        allocParams.dwBytes  = MOS_ALIGN_CEIL(m_totalSize, CODECHAL_PAGE_SIZE);
+        allocParams.pBufName = name;
+
+        m_backing = allocator->AllocateResource(allocParams, false);
+        ENCODE_CHK_NULL_RETURN(m_backing);
+
+        for (auto &range : m_ranges)
+        {
+            range.resource = m_backing;
+        }
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    EncodeSubAllocation EncodeLinearSubAllocator::Get(uint32_t index) const
+    {
+        return (index < m_ranges.size()) ? m_ranges[index] : EncodeSubAllocation();
+    }
+
+    MOS_STATUS EncodeLinearSubAllocator::Reset(EncodeAllocator *allocator)
+    {
+        ENCODE_FUNC_CALL();
+
+        if (m_backing != nullptr)
+        {
+            ENCODE_CHK_NULL_RETURN(allocator);
+            ENCODE_CHK_STATUS_RETURN(allocator->DestroyResource(m_backing));
+            m_backing = nullptr;
+        }
+
+        m_ranges.clear();
+        m_totalSize = 0;
+
+        return MOS_STATUS_SUCCESS;
+    }
+}
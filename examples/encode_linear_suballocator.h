@@ -0,0 +1,107 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+//!
+//! \file     encode_linear_suballocator.h
+//! \brief    Defines a suballocator which packs small buffers into one linear resource
+//!
+
+#ifndef __ENCODE_LINEAR_SUBALLOCATOR_H__
+#define __ENCODE_LINEAR_SUBALLOCATOR_H__
+
+#include <vector>
+#include "mos_os.h"
+#include "encode_allocator.h"
+
+namespace encode
+{
+    //!
+    //! \struct EncodeSubAllocation
+    //! \brief  Range of a backing resource
+    //!
+    struct EncodeSubAllocation
+    {
+        PMOS_RESOURCE resource = nullptr;  //!< Backing resource
+        uint32_t      offset   = 0;        //!< Offset in bytes
+        uint32_t      size     = 0;        //!< Size in bytes
+    };
+
+    //!
+    //! \class  EncodeLinearSubAllocator
+    //! \brief  Places the reserved buffers one after another in one linear resource
+    //! \details Buffers are reserved first, then Allocate() creates the backing resource
+    //!          and fixes the ranges. Each range starts at the requested alignment.
+    //!
+    class EncodeLinearSubAllocator
+    {
+    public:
+        //!
+        //! \brief  Reserve a buffer
+        //! \param  [in] size
+        //!         Size in bytes
+        //! \param  [in] alignment
+        //!         Alignment of the offset, a power of 2, a cache line by default
+        //! \return uint32_t
+        //!         Index of the buffer for Get()
+        //!
+        uint32_t Reserve(uint32_t size, uint32_t alignment = 64);
+
+        //!
+        //! \brief  Allocate the backing resource of all the reserved buffers
+        //! \param  [in] allocator
+        //!         Allocator of the session
+        //! \param  [in] name
+        //!         Name of the backing resource
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS Allocate(EncodeAllocator *allocator, const char *name);
+
+        //!
+        //! \brief  Get the range of a reserved buffer
+        //! \param  [in] index
+        //!         Index from Reserve()
+        //! \return EncodeSubAllocation
+        //!         Range, with a null resource before Allocate()
+        //!
+        EncodeSubAllocation Get(uint32_t index) const;
+
+        //!
+        //! \brief  Free the backing resource and drop the reservations
+        //! \param  [in] allocator
+        //!         Allocator the backing resource came from
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS Reset(EncodeAllocator *allocator);
+
+        PMOS_RESOURCE GetBacking() const { return m_backing; }
+        uint32_t GetTotalSize() const { return m_totalSize; }
+        uint32_t GetNumBuffers() const { return (uint32_t)m_ranges.size(); }
+
+    protected:
+        std::vector<EncodeSubAllocation> m_ranges;             //!< Reserved ranges
+        PMOS_RESOURCE                    m_backing = nullptr;  //!< Backing resource
+        uint32_t                         m_totalSize = 0;      //!< Bytes of all the ranges
+    };
+}
+
+#endif // __ENCODE_LINEAR_SUBALLOCATOR_H__
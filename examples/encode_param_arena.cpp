@@ -0,0 +1,109 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+//!
+//! \file     encode_param_arena.cpp
+//! \brief    Implements the per packet arena for MHW parameter structures
+//!
+#include "encode_param_arena.h"
+#include "encode_utils.h"
+
+namespace encode
+{
+    EncodeParamArena::EncodeParamArena(uint32_t initialSize)
+    {
+        m_nextBlockSize = MOS_ALIGN_CEIL(MOS_MAX(initialSize, m_alignment), m_alignment);
+    }
+
+    EncodeParamArena::~EncodeParamArena()
+    {
+        Reset();
+        FreeBlocks();
+    }
+
+    void *EncodeParamArena::Allocate(uint32_t size)
+    {
+        size = MOS_ALIGN_CEIL(size, m_alignment);
+
+        if (m_block == nullptr || m_blockUsed + size > m_block->capacity)
+        {
+            uint32_t capacity = MOS_MAX(m_nextBlockSize, size);
+            Block   *block    = (Block *)MOS_AllocMemory(m_blockHeaderSize + capacity);
+            if (block == nullptr)
+            {
+                return nullptr;
+            }
+            block->prev     = m_block;
+            block->capacity = capacity;
+            m_block         = block;
+            m_blockUsed     = 0;
+            m_nextBlockSize = capacity * 2;
+
+            m_heapAllocCount++;
+            m_allocatedSinceReset = true;
+            if (m_steadyState)
+            {
+                // Parameter usage of a submission is expected to be constant
+                m_steadyStateHeapAllocCount++;
+                ENCODE_ASSERTMESSAGE("Parameter arena allocates from heap in steady state.");
+                ENCODE_ASSERT(false);
+            }
+        }
+
+        void *mem = (uint8_t *)m_block + m_blockHeaderSize + m_blockUsed;
+        m_blockUsed      += size;
+        m_usedSinceReset += size;
+        return mem;
+    }
+
+    void EncodeParamArena::Reset()
+    {
+        for (DtorNode *node = m_dtorList; node != nullptr; node = node->next)
+        {
+            node->destroy(node->object);
+        }
+        m_dtorList = nullptr;
+
+        // Several blocks were needed, use one block for everything from now on
+        if (m_block != nullptr && m_block->prev != nullptr)
+        {
+            uint32_t usedSinceReset = m_usedSinceReset;
+            FreeBlocks();
+            m_nextBlockSize = usedSinceReset;
+        }
+
+        m_steadyState         = !m_allocatedSinceReset;
+        m_allocatedSinceReset = false;
+        m_blockUsed           = 0;
+        m_usedSinceReset      = 0;
+    }
+
+    void EncodeParamArena::FreeBlocks()
+    {
+        while (m_block != nullptr)
+        {
+            Block *prev = m_block->prev;
+            MOS_FreeMemory(m_block);
+            m_block = prev;
+        }
+        m_blockUsed = 0;
+    }
+}
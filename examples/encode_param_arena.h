@@ -0,0 +1,140 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+//!
+//! \file     encode_param_arena.h
+//! \brief    Defines the per packet arena for MHW parameter structures
+//!
+
+#ifndef __ENCODE_PARAM_ARENA_H__
+#define __ENCODE_PARAM_ARENA_H__
+
+#include <new>
+#include "mos_defs.h"
+
+namespace encode
+{
+    //!
+    //! \class  EncodeParamArena
+    //! \brief  Bump allocator for parameter structures which live until the next Reset()
+    //! \details Objects are destroyed in Reset(). When a submission needs more than the
+    //!          current block, Reset() replaces the blocks with one block large enough
+    //!          for the whole submission, so later submissions do not touch the heap.
+    //!          Not thread safe, only the submitting thread may use it.
+    //!
+    class EncodeParamArena
+    {
+    public:
+        //!
+        //! \brief  Constructor of class EncodeParamArena
+        //! \param  [in] initialSize
+        //!         Size of the first block in bytes, allocated on the first use
+        //!
+        EncodeParamArena(uint32_t initialSize = m_defaultBlockSize);
+
+        virtual ~EncodeParamArena();
+
+        //!
+        //! \brief  Create a value initialized object in the arena
+        //! \return T*
+        //!         The object, nullptr if out of memory
+        //!
+        template <class T>
+        T *New()
+        {
+            static_assert(alignof(T) <= m_alignment, "Parameter structure is over aligned");
+
+            uint8_t *mem = (uint8_t *)Allocate(m_nodeSize + sizeof(T));
+            if (mem == nullptr)
+            {
+                return nullptr;
+            }
+
+            T        *object = new (mem + m_nodeSize) T();
+            DtorNode *node   = (DtorNode *)mem;
+            node->object     = object;
+            node->destroy    = [](void *p) { static_cast<T *>(p)->~T(); };
+            node->next       = m_dtorList;
+            m_dtorList       = node;
+            return object;
+        }
+
+        //!
+        //! \brief  Destroy all the objects and rewind the arena
+        //! \return void
+        //!
+        void Reset();
+
+        //!
+        //! \brief  Get the number of heap allocations of the arena
+        //! \return uint32_t
+        //!
+        uint32_t GetHeapAllocCount() const { return m_heapAllocCount; }
+
+        //!
+        //! \brief  Get the number of heap allocations after the arena reached steady state
+        //! \return uint32_t
+        //!
+        uint32_t GetSteadyStateHeapAllocCount() const { return m_steadyStateHeapAllocCount; }
+
+    protected:
+        static constexpr uint32_t m_defaultBlockSize = 4096;
+        static constexpr uint32_t m_alignment        = 16;
+
+        //!
+        //! \brief  Header of a memory block
+        //!
+        struct Block
+        {
+            Block   *prev;
+            uint32_t capacity;
+        };
+
+        //!
+        //! \brief  Destructor record stored in front of each object
+        //!
+        struct DtorNode
+        {
+            DtorNode *next;
+            void     *object;
+            void    (*destroy)(void *);
+        };
+
+        static constexpr uint32_t m_blockHeaderSize = MOS_ALIGN_CEIL(sizeof(Block), m_alignment);
+        static constexpr uint32_t m_nodeSize        = MOS_ALIGN_CEIL(sizeof(DtorNode), m_alignment);
+
+        void *Allocate(uint32_t size);
+
+        void FreeBlocks();
+
+        Block    *m_block = nullptr;                    //!< Current block, chained to the older ones
+        uint32_t  m_blockUsed = 0;                      //!< Bytes used in the current block
+        uint32_t  m_usedSinceReset = 0;                 //!< Bytes used since the last reset
+        uint32_t  m_nextBlockSize = 0;                  //!< Size of the next block to allocate
+        DtorNode *m_dtorList = nullptr;                 //!< Objects to destroy on reset
+        bool      m_allocatedSinceReset = false;        //!< Heap was used since the last reset
+        bool      m_steadyState = false;                //!< Last submission did not use the heap
+        uint32_t  m_heapAllocCount = 0;                 //!< Number of heap allocations
+        uint32_t  m_steadyStateHeapAllocCount = 0;      //!< Number of heap allocations in steady state
+    };
+}
+
+#endif // __ENCODE_PARAM_ARENA_H__
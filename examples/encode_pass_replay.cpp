@@ -0,0 +1,473 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+//!
+//! \file     encode_pass_replay.cpp
+//! \brief    Implements the replay of the first pass commands for the later passes
+//!
+#include "encode_pass_replay.h"
+#include "encode_cmd_walker.h"
+#include "encode_utils.h"
+#include <algorithm>
+
+namespace encode
+{
+    std::mutex                      EncodePassReplay::m_hookMutex;
+    std::vector<EncodePassReplay *> EncodePassReplay::m_hooks;
+
+    bool EncodePassReplay::Split(
+        const uint32_t              *cmds,
+        uint32_t                     dwStart,
+        uint32_t                     dwEnd,
+        uint32_t                     batchOffset,
+        const std::vector<uint32_t> &patchDws,
+        std::vector<Segment>        &segments)
+    {
+        uint32_t numBatchStarts = 0;
+        uint32_t segmentStart   = dwStart;
+        auto     patchDw        = std::lower_bound(patchDws.begin(), patchDws.end(), dwStart);
+
+        for (uint32_t dw = dwStart, dwSize = 0; dw < dwEnd; dw += dwSize)
+        {
+            if (!EncodeCmdWalker::GetCmdSize(cmds + dw, dwEnd - dw, dwSize))
+            {
+                return false;
+            }
+
+            bool hasAddress = false;
+            for (; patchDw != patchDws.end() && *patchDw < dw + dwSize; patchDw++)
+            {
+                hasAddress = true;
+            }
+
+            if (!EncodeCmdWalker::IsMiCmd(cmds[dw], m_miBatchBufferStartHeader))
+            {
+                // The address would not be patched in the replayed copy
+                if (hasAddress)
+                {
+                    return false;
+                }
+                continue;
+            }
+
+            // A second batch start would target an unknown buffer
+            if (++numBatchStarts > 1)
+            {
+                return false;
+            }
+            if (dw > segmentStart)
+            {
+                segments.push_back({segmentStart, dw - segmentStart, false, 0});
+            }
+            segments.push_back({dw, dwSize, true, batchOffset});
+            segmentStart = dw + dwSize;
+        }
+
+        if (dwEnd > segmentStart)
+        {
+            segments.push_back({segmentStart, dwEnd - segmentStart, false, 0});
+        }
+
+        return true;
+    }
+
+    bool EncodePassReplay::HookPatchEntries(PMOS_INTERFACE osInterface)
+    {
+        if (osInterface == nullptr || !osInterface->bUsesPatchList || osInterface->pfnSetPatchEntry == nullptr)
+        {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(m_hookMutex);
+        for (auto hook : m_hooks)
+        {
+            if (hook->m_hookedOsInterface == osInterface)
+            {
+                return false;
+            }
+        }
+
+        m_hookedOsInterface           = osInterface;
+        m_setPatchEntry               = osInterface->pfnSetPatchEntry;
+        osInterface->pfnSetPatchEntry = SetPatchEntry;
+        m_hooks.push_back(this);
+
+        return true;
+    }
+
+    void EncodePassReplay::UnhookPatchEntries()
+    {
+        if (m_hookedOsInterface == nullptr)
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(m_hookMutex);
+        m_hookedOsInterface->pfnSetPatchEntry = m_setPatchEntry;
+        m_hooks.erase(std::find(m_hooks.begin(), m_hooks.end(), this));
+        m_hookedOsInterface = nullptr;
+        m_setPatchEntry     = nullptr;
+    }
+
+    MOS_STATUS EncodePassReplay::SetPatchEntry(PMOS_INTERFACE osInterface, PMOS_PATCH_ENTRY_PARAMS params)
+    {
+        ENCODE_CHK_NULL_RETURN(params);
+
+        SetPatchEntryFunc setPatchEntry = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(m_hookMutex);
+            for (auto hook : m_hooks)
+            {
+                if (hook->m_hookedOsInterface != osInterface)
+                {
+                    continue;
+                }
+                // Entries of batch buffers are relative to another base
+                if (params->cmdBufBase == hook->m_hookedCmdBase)
+                {
+                    hook->m_patchDws.push_back(params->uiPatchOffset / sizeof(uint32_t));
+                }
+                setPatchEntry = hook->m_setPatchEntry;
+                break;
+            }
+        }
+        ENCODE_CHK_NULL_RETURN(setPatchEntry);
+
+        return setPatchEntry(osInterface, params);
+    }
+
+    void EncodePassReplay::BeginRecord(PMOS_INTERFACE osInterface, const MOS_COMMAND_BUFFER &cmdBuffer)
+    {
+        UnhookPatchEntries();
+
+        m_cmds.clear();
+        m_segments.clear();
+        m_patchDws.clear();
+        m_startOffset     = cmdBuffer.iOffset;
+        m_segmentOffset   = cmdBuffer.iOffset;
+        m_hookedCmdBase   = (const uint8_t *)cmdBuffer.pCmdBase;
+        m_patchesPassType = m_numPassTypes;
+        m_recorded        = false;
+
+        // Without the patch list the addresses are written directly and cannot be found
+        m_recording = HookPatchEntries(osInterface);
+    }
+
+    void EncodePassReplay::AddSegments(const MOS_COMMAND_BUFFER &cmdBuffer, uint32_t batchOffset)
+    {
+        if (!m_recording)
+        {
+            return;
+        }
+
+        if (cmdBuffer.pCmdBase == nullptr || cmdBuffer.iOffset < m_segmentOffset ||
+            (const uint8_t *)cmdBuffer.pCmdBase != m_hookedCmdBase)
+        {
+            m_recording = false;
+            return;
+        }
+
+        const uint32_t *start   = cmdBuffer.pCmdBase + m_startOffset / sizeof(uint32_t);
+        uint32_t        dwStart = (m_segmentOffset - m_startOffset) / sizeof(uint32_t);
+        uint32_t        dwEnd   = (cmdBuffer.iOffset - m_startOffset) / sizeof(uint32_t);
+
+        // Patch list dwords relative to the region
+        std::vector<uint32_t> patchDws;
+        {
+            std::lock_guard<std::mutex> lock(m_hookMutex);
+            patchDws.swap(m_patchDws);
+        }
+        for (auto &dw : patchDws)
+        {
+            dw -= m_startOffset / sizeof(uint32_t);
+        }
+        std::sort(patchDws.begin(), patchDws.end());
+
+        m_cmds.insert(m_cmds.end(), start + dwStart, start + dwEnd);
+        if (!Split(m_cmds.data(), dwStart, dwEnd, batchOffset, patchDws, m_segments))
+        {
+            m_recording = false;
+            return;
+        }
+
+        m_segmentOffset = cmdBuffer.iOffset;
+    }
+
+    void EncodePassReplay::EndRecord(const MOS_COMMAND_BUFFER &cmdBuffer, uint32_t batchEndOffset)
+    {
+        UnhookPatchEntries();
+
+        // Commands after the last AddSegments() are not part of the region
+        m_recorded       = m_recording && cmdBuffer.iOffset == m_segmentOffset && m_patchDws.empty();
+        m_recording      = false;
+        m_batchEndOffset = batchEndOffset;
+    }
+
+    void EncodePassReplay::DiscardRecord()
+    {
+        UnhookPatchEntries();
+        m_recorded  = false;
+        m_recording = false;
+    }
+
+    bool EncodePassReplay::CanReplay(uint32_t passType) const
+    {
+        return m_recorded && passType < m_numPassTypes && m_passState[passType] == passLearned;
+    }
+
+    bool EncodePassReplay::NeedLearn(uint32_t passType) const
+    {
+        return m_recorded && passType < m_numPassTypes && m_passState[passType] == passUnknown;
+    }
+
+    bool EncodePassReplay::NeedPassCmds(uint32_t passType) const
+    {
+        return NeedLearn(passType) || (CanReplay(passType) && !m_fields[passType].empty());
+    }
+
+    void EncodePassReplay::BeginLearn(const MOS_COMMAND_BUFFER &cmdBuffer)
+    {
+        m_startOffset = cmdBuffer.iOffset;
+    }
+
+    bool EncodePassReplay::MapPassCmds(
+        const std::vector<uint32_t> &passCmds,
+        std::vector<uint32_t>       &passStarts,
+        std::vector<uint32_t>       &targets) const
+    {
+        uint32_t regionDw  = 0;
+        uint32_t regionEnd = (uint32_t)m_cmds.size();
+        uint32_t passEnd   = (uint32_t)passCmds.size();
+
+        for (uint32_t passDw = 0, passSize = 0; passDw < passEnd; passDw += passSize)
+        {
+            if (!EncodeCmdWalker::GetCmdSize(&passCmds[passDw], passEnd - passDw, passSize))
+            {
+                return false;
+            }
+
+            uint32_t regionSize = 0;
+            for (; regionDw < regionEnd; regionDw += regionSize)
+            {
+                if (!EncodeCmdWalker::GetCmdSize(&m_cmds[regionDw], regionEnd - regionDw, regionSize))
+                {
+                    return false;
+                }
+                if (regionSize == passSize && EncodeCmdWalker::IsSameCmd(m_cmds[regionDw], passCmds[passDw]))
+                {
+                    break;
+                }
+            }
+            if (regionDw >= regionEnd)
+            {
+                return false;
+            }
+
+            passStarts.push_back(passDw);
+            targets.push_back(regionDw);
+            regionDw += regionSize;
+        }
+        passStarts.push_back(passEnd);
+
+        return true;
+    }
+
+    void EncodePassReplay::EndLearn(const MOS_COMMAND_BUFFER &cmdBuffer, uint32_t passType, const std::vector<uint32_t> &passCmds)
+    {
+        if (!NeedLearn(passType))
+        {
+            return;
+        }
+
+        m_learnCount++;
+        m_passState[passType]   = passUnsupported;
+        m_numPassCmds[passType] = 0;
+        m_fields[passType].clear();
+
+        if (cmdBuffer.pCmdBase == nullptr ||
+            cmdBuffer.iOffset - m_startOffset != (int32_t)(m_cmds.size() * sizeof(uint32_t)))
+        {
+            return;
+        }
+
+        std::vector<uint32_t> passStarts, targets;
+        if (!MapPassCmds(passCmds, passStarts, targets))
+        {
+            return;
+        }
+
+        const uint32_t *cmds = cmdBuffer.pCmdBase + m_startOffset / sizeof(uint32_t);
+
+        // The pass commands have to be the ones of the full build
+        for (size_t i = 0; i < targets.size(); i++)
+        {
+            uint32_t dwSize = passStarts[i + 1] - passStarts[i];
+            if (memcmp(&cmds[targets[i]], &passCmds[passStarts[i]], dwSize * sizeof(uint32_t)) != 0)
+            {
+                return;
+            }
+        }
+
+        std::vector<Field> fields;
+        size_t             cmdIndex = 0;
+        for (auto &segment : m_segments)
+        {
+            // Batch starts are re-added on replay, their layout must still match
+            if (segment.batchStart)
+            {
+                if (!EncodeCmdWalker::IsMiCmd(cmds[segment.dwStart], m_miBatchBufferStartHeader))
+                {
+                    return;
+                }
+                continue;
+            }
+
+            for (uint32_t dw = segment.dwStart; dw < segment.dwStart + segment.dwSize; dw++)
+            {
+                uint32_t mask = cmds[dw] ^ m_cmds[dw];
+                if (mask == 0)
+                {
+                    continue;
+                }
+
+                // Only the pass commands are built again on replay
+                while (cmdIndex < targets.size() && targets[cmdIndex] + passStarts[cmdIndex + 1] - passStarts[cmdIndex] <= dw)
+                {
+                    cmdIndex++;
+                }
+                if (cmdIndex >= targets.size() || dw < targets[cmdIndex])
+                {
+                    return;
+                }
+                fields.push_back({(uint32_t)cmdIndex, dw - targets[cmdIndex], mask});
+            }
+        }
+
+        m_fields[passType].swap(fields);
+        m_numPassCmds[passType] = (uint32_t)targets.size();
+        m_passState[passType]   = passLearned;
+    }
+
+    bool EncodePassReplay::SetPassCmds(uint32_t passType, const std::vector<uint32_t> &passCmds)
+    {
+        if (!CanReplay(passType))
+        {
+            return false;
+        }
+
+        m_patches.clear();
+        m_patchesPassType = m_numPassTypes;
+
+        auto &fields = m_fields[passType];
+        if (!fields.empty())
+        {
+            std::vector<uint32_t> passStarts, targets;
+            bool matched = MapPassCmds(passCmds, passStarts, targets) && targets.size() == m_numPassCmds[passType];
+
+            // Outside the learned bits the pass commands have to match the first pass
+            for (size_t i = 0, field = 0; matched && i < targets.size(); i++)
+            {
+                uint32_t dwSize = passStarts[i + 1] - passStarts[i];
+                for (uint32_t dw = 0; matched && dw < dwSize; dw++)
+                {
+                    uint32_t passValue = passCmds[passStarts[i] + dw];
+                    uint32_t mask      = 0;
+                    if (field < fields.size() && fields[field].cmdIndex == i && fields[field].dwInCmd == dw)
+                    {
+                        mask = fields[field++].mask;
+                        m_patches.push_back({targets[i] + dw, mask, passValue & mask});
+                    }
+                    matched = ((passValue ^ m_cmds[targets[i] + dw]) & ~mask) == 0;
+                }
+            }
+
+            if (!matched)
+            {
+                // The pass dependent dwords moved, the next full build learns them again
+                m_passState[passType] = passUnknown;
+                m_fields[passType].clear();
+                m_patches.clear();
+                return false;
+            }
+        }
+
+        m_patchesPassType = passType;
+        return true;
+    }
+
+    MOS_STATUS EncodePassReplay::Replay(
+        MOS_COMMAND_BUFFER &cmdBuffer,
+        uint32_t            passType,
+        MhwMiInterface     *miInterface,
+        PMHW_BATCH_BUFFER   batchBuffer)
+    {
+        ENCODE_FUNC_CALL();
+
+        ENCODE_CHK_NULL_RETURN(miInterface);
+        ENCODE_CHK_NULL_RETURN(batchBuffer);
+        ENCODE_CHK_COND_RETURN(!CanReplay(passType) || m_patchesPassType != passType,
+            "Replaying a pass whose pass commands are not set");
+
+        auto patch    = m_patches.begin();
+        auto patchEnd = m_patches.end();
+
+        for (auto &segment : m_segments)
+        {
+            if (segment.batchStart)
+            {
+                int32_t offset        = cmdBuffer.iOffset;
+                batchBuffer->dwOffset = segment.batchOffset;
+                ENCODE_CHK_STATUS_RETURN(miInterface->AddMiBatchBufferStartCmd(&cmdBuffer, batchBuffer));
+                ENCODE_CHK_COND_RETURN(
+                    cmdBuffer.iOffset - offset != (int32_t)(segment.dwSize * sizeof(uint32_t)),
+                    "MI_BATCH_BUFFER_START size differs from the recorded one");
+                continue;
+            }
+
+            uint32_t *dst = cmdBuffer.pCmdPtr;
+            ENCODE_CHK_STATUS_RETURN(Mos_AddCommand(&cmdBuffer, &m_cmds[segment.dwStart], segment.dwSize * sizeof(uint32_t)));
+
+            for (; patch != patchEnd && patch->dwIndex < segment.dwStart + segment.dwSize; patch++)
+            {
+                uint32_t &dw = dst[patch->dwIndex - segment.dwStart];
+                dw           = (dw & ~patch->mask) | patch->value;
+            }
+        }
+
+        batchBuffer->dwOffset = m_batchEndOffset;
+        m_patchedDwordCount += (uint32_t)m_patches.size();
+        m_replayCount++;
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    void EncodePassReplay::Invalidate()
+    {
+        for (uint32_t i = 0; i < m_numPassTypes; i++)
+        {
+            m_passState[i]   = passUnknown;
+            m_numPassCmds[i] = 0;
+            m_fields[i].clear();
+        }
+        m_patches.clear();
+        m_patchesPassType = m_numPassTypes;
+    }
+}
@@ -0,0 +1,302 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+//!
+//! \file     encode_pass_replay.h
+//! \brief    Defines the replay of the first pass commands for the later BRC and PAK only passes
+//!
+
+#ifndef __ENCODE_PASS_REPLAY_H__
+#define __ENCODE_PASS_REPLAY_H__
+
+#include <vector>
+#include <mutex>
+#include "mos_os.h"
+#include "mhw_mi.h"
+
+namespace encode
+{
+    //!
+    //! \class  EncodePassReplay
+    //! \brief  Builds the later passes of a frame from the commands recorded in its first pass
+    //! \details The first pass records a command region. The region is split into address free
+    //!          segments and MI_BATCH_BUFFER_START commands, the latter are re-added through MHW
+    //!          on replay so that their patch list entries are registered again. Commands with
+    //!          other patch list entries are found while recording, the region is then not used.
+    //!          The dwords which depend on the pass are learned once per pass type, by diffing
+    //!          a full build of a later pass against the first pass. Each of them has to be in
+    //!          a pass command, a command the caller builds again for the replayed pass from
+    //!          its params. A replay copies the first pass and takes the learned bits from the
+    //!          pass commands of the current frame. Pass commands which differ from the first
+    //!          pass in other bits make the pass type learned again.
+    //!
+    class EncodePassReplay
+    {
+    public:
+        static constexpr uint32_t m_numPassTypes = 2;  //!< Repeated pass and PAK only pass
+
+        ~EncodePassReplay() { UnhookPatchEntries(); }
+
+        //!
+        //! \brief  Start recording the first pass region
+        //! \details The patch list entries added until EndRecord() are watched, the region is
+        //!          only recorded when the addresses go through the patch list.
+        //! \param  [in] osInterface
+        //!         OS interface the commands are added with
+        //! \param  [in] cmdBuffer
+        //!         Command buffer
+        //! \return void
+        //!
+        void BeginRecord(PMOS_INTERFACE osInterface, const MOS_COMMAND_BUFFER &cmdBuffer);
+
+        //!
+        //! \brief  Close the segments added since the last call
+        //! \details At most one MI_BATCH_BUFFER_START may be found, it is taken to start the
+        //!          batch buffer given to Replay() at batchOffset.
+        //! \param  [in] cmdBuffer
+        //!         Command buffer
+        //! \param  [in] batchOffset
+        //!         Batch buffer offset the commands were built with
+        //! \return void
+        //!
+        void AddSegments(const MOS_COMMAND_BUFFER &cmdBuffer, uint32_t batchOffset);
+
+        //!
+        //! \brief  Finish recording the first pass region
+        //! \param  [in] cmdBuffer
+        //!         Command buffer
+        //! \param  [in] batchEndOffset
+        //!         Batch buffer offset at the end of the region
+        //! \return void
+        //!
+        void EndRecord(const MOS_COMMAND_BUFFER &cmdBuffer, uint32_t batchEndOffset);
+
+        //!
+        //! \brief  Drop the recorded region, used when the first pass does not record
+        //! \return void
+        //!
+        void DiscardRecord();
+
+        //!
+        //! \brief  Check if the region was recorded in the current frame
+        //!
+        bool IsRecorded() const { return m_recorded; }
+
+        //!
+        //! \brief  Check if a pass of the type can be replayed
+        //! \param  [in] passType
+        //!         Pass type, 0 for a repeated pass and 1 for a PAK only pass
+        //! \return bool
+        //!
+        bool CanReplay(uint32_t passType) const;
+
+        //!
+        //! \brief  Check if a full build of the pass type should be diffed
+        //!
+        bool NeedLearn(uint32_t passType) const;
+
+        //!
+        //! \brief  Check if the pass commands have to be built for the pass type
+        //! \details They are needed to learn the pass type, and to replay it when it has
+        //!          pass dependent dwords.
+        //!
+        bool NeedPassCmds(uint32_t passType) const;
+
+        //!
+        //! \brief  Start the full build of a later pass to be diffed
+        //!
+        void BeginLearn(const MOS_COMMAND_BUFFER &cmdBuffer);
+
+        //!
+        //! \brief  Diff the full build of a later pass against the first pass
+        //! \details A region which differs in layout, or in a dword outside the pass commands,
+        //!          marks the pass type as not replayable until the next Invalidate().
+        //! \param  [in] cmdBuffer
+        //!         Command buffer
+        //! \param  [in] passType
+        //!         Pass type of the build
+        //! \param  [in] passCmds
+        //!         Pass commands of the build, in the order they are found in the region
+        //! \return void
+        //!
+        void EndLearn(const MOS_COMMAND_BUFFER &cmdBuffer, uint32_t passType, const std::vector<uint32_t> &passCmds);
+
+        //!
+        //! \brief  Take the values of the pass dependent dwords from the pass commands
+        //! \details Has to be called before Replay(). The pass type is learned again if the
+        //!          pass commands do not match the first pass outside the learned bits.
+        //! \param  [in] passType
+        //!         Pass type to replay
+        //! \param  [in] passCmds
+        //!         Pass commands of the current frame for the pass type
+        //! \return bool
+        //!         true if the pass can be replayed
+        //!
+        bool SetPassCmds(uint32_t passType, const std::vector<uint32_t> &passCmds);
+
+        //!
+        //! \brief  Add the recorded region with the values of the pass commands
+        //! \param  [in] cmdBuffer
+        //!         Command buffer
+        //! \param  [in] passType
+        //!         Pass type given to SetPassCmds()
+        //! \param  [in] miInterface
+        //!         MI interface to add MI_BATCH_BUFFER_START
+        //! \param  [in] batchBuffer
+        //!         Batch buffer started by the region
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS Replay(
+            MOS_COMMAND_BUFFER &cmdBuffer,
+            uint32_t            passType,
+            MhwMiInterface     *miInterface,
+            PMHW_BATCH_BUFFER   batchBuffer);
+
+        //!
+        //! \brief  Drop the learned layout, used on a new sequence
+        //! \return void
+        //!
+        void Invalidate();
+
+        uint32_t GetBatchEndOffset() const { return m_batchEndOffset; }
+        uint32_t GetRegionSize() const { return (uint32_t)(m_cmds.size() * sizeof(uint32_t)); }
+        uint32_t GetReplayCount() const { return m_replayCount; }
+        uint32_t GetLearnCount() const { return m_learnCount; }
+        uint32_t GetPatchedDwordCount() const { return m_patchedDwordCount; }
+
+    protected:
+        static constexpr uint32_t m_miBatchBufferStartHeader = 0x31 << 23;  //!< MI_BATCH_BUFFER_START opcode
+
+        //!
+        //! \brief  Address free commands or a single MI_BATCH_BUFFER_START
+        //!
+        struct Segment
+        {
+            uint32_t dwStart;      //!< Start in the region
+            uint32_t dwSize;       //!< Size in dwords
+            bool     batchStart;   //!< Segment is a MI_BATCH_BUFFER_START
+            uint32_t batchOffset;  //!< Batch buffer offset to start
+        };
+
+        //!
+        //! \brief  Bits of a pass command dword which depend on the pass, kept over frames
+        //!
+        struct Field
+        {
+            uint32_t cmdIndex;  //!< Pass command
+            uint32_t dwInCmd;   //!< Dword in the pass command
+            uint32_t mask;      //!< Bits which depend on the pass
+        };
+
+        //!
+        //! \brief  Bits of a region dword to replace in the current frame
+        //!
+        struct Patch
+        {
+            uint32_t dwIndex;  //!< Dword in the region
+            uint32_t mask;     //!< Bits to replace
+            uint32_t value;    //!< Value of the bits
+        };
+
+        enum PassState
+        {
+            passUnknown = 0,   //!< Not diffed yet
+            passLearned,       //!< Fields are known
+            passUnsupported    //!< Region layout differs, always built in full
+        };
+
+        //!
+        //! \brief  Split the dwords into segments
+        //! \param  [in] patchDws
+        //!         Sorted dwords of the patch list entries, only batch starts may hold one
+        //! \return bool
+        //!         false if a command cannot be decoded or carries an address
+        //!
+        static bool Split(
+            const uint32_t              *cmds,
+            uint32_t                     dwStart,
+            uint32_t                     dwEnd,
+            uint32_t                     batchOffset,
+            const std::vector<uint32_t> &patchDws,
+            std::vector<Segment>        &segments);
+
+        //!
+        //! \brief  Find the region command of each pass command
+        //! \details The pass commands are matched in order to the next region command of the
+        //!          same opcode and size.
+        //! \param  [in] passCmds
+        //!         Pass commands
+        //! \param  [out] passStarts
+        //!         Start of each pass command in passCmds, followed by the end of the last one
+        //! \param  [out] targets
+        //!         Start of the region command of each pass command
+        //! \return bool
+        //!         false if a pass command is not found
+        //!
+        bool MapPassCmds(
+            const std::vector<uint32_t> &passCmds,
+            std::vector<uint32_t>       &passStarts,
+            std::vector<uint32_t>       &targets) const;
+
+        //!
+        //! \brief  Replace the patch entry function of the OS interface to watch the region
+        //!
+        bool HookPatchEntries(PMOS_INTERFACE osInterface);
+
+        //!
+        //! \brief  Restore the patch entry function of the OS interface
+        //!
+        void UnhookPatchEntries();
+
+        //!
+        //! \brief  Patch entry function installed by HookPatchEntries()
+        //!
+        static MOS_STATUS SetPatchEntry(PMOS_INTERFACE osInterface, PMOS_PATCH_ENTRY_PARAMS params);
+
+        using SetPatchEntryFunc = MOS_STATUS (*)(PMOS_INTERFACE, PMOS_PATCH_ENTRY_PARAMS);
+
+        static std::mutex                      m_hookMutex;  //!< Guards m_hooks
+        static std::vector<EncodePassReplay *> m_hooks;      //!< Replays watching the patch entries
+
+        std::vector<uint32_t> m_cmds;                           //!< First pass region
+        std::vector<Segment>  m_segments;                       //!< Segments of the first pass region
+        std::vector<Field>    m_fields[m_numPassTypes];         //!< Learned fields, sorted by dword
+        uint32_t              m_numPassCmds[m_numPassTypes] = {};  //!< Pass commands the fields were learned with
+        PassState             m_passState[m_numPassTypes] = {}; //!< Learn state of each pass type
+        std::vector<Patch>    m_patches;                        //!< Patches of the current frame, sorted by dword
+        uint32_t              m_patchesPassType = m_numPassTypes;  //!< Pass type of m_patches
+        std::vector<uint32_t> m_patchDws;                       //!< Patch list entries of the current segments
+        PMOS_INTERFACE        m_hookedOsInterface = nullptr;    //!< OS interface whose patch entries are watched
+        SetPatchEntryFunc     m_setPatchEntry = nullptr;        //!< Patch entry function replaced by the hook
+        const uint8_t        *m_hookedCmdBase = nullptr;        //!< Command buffer of the watched patch entries
+        int32_t               m_startOffset = 0;                //!< Offset of the region being built
+        int32_t               m_segmentOffset = 0;              //!< Offset of the next segments
+        uint32_t              m_batchEndOffset = 0;             //!< Batch buffer offset after the region
+        bool                  m_recording = false;              //!< First pass is being recorded
+        bool                  m_recorded = false;               //!< First pass region is usable
+        uint32_t              m_replayCount = 0;                //!< Number of replayed passes
+        uint32_t              m_learnCount = 0;                 //!< Number of diffed full builds
+        uint32_t              m_patchedDwordCount = 0;          //!< Dwords patched over all replays
+    };
+}
+
+#endif // __ENCODE_PASS_REPLAY_H__
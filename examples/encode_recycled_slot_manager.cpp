@@ -0,0 +1,90 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+//!
+//! \file     encode_recycled_slot_manager.cpp
+//! \brief    Defines the fence aware manager of the recycled buffer slots
+//!
+#include "encode_recycled_slot_manager.h"
+#include "encode_utils.h"
+
+namespace encode
+{
+    EncodeRecycledSlotManager::EncodeRecycledSlotManager(uint32_t numSlots) :
+        m_slots(MOS_MAX(numSlots, 1))
+    {
+    }
+
+    bool EncodeRecycledSlotManager::IsSlotFree(Slot &slot, uint32_t completedFence)
+    {
+        if (slot.pending && EncodeFenceWait::IsDone(slot.fence, completedFence))
+        {
+            slot.pending = false;
+        }
+        return !slot.pending;
+    }
+
+    MOS_STATUS EncodeRecycledSlotManager::Wait(Slot &slot)
+    {
+        if (!m_fenceQuery || IsSlotFree(slot, m_fenceQuery()))
+        {
+            return MOS_STATUS_SUCCESS;
+        }
+
+        // The GPU may still use the buffers of a slot whose wait fails, it stays busy
+        uint64_t   waitedUs = 0;
+        MOS_STATUS status   = EncodeFenceWait::Wait(m_fenceQuery, slot.fence, m_stallTimeoutUs, waitedUs);
+        if (status == MOS_STATUS_SUCCESS)
+        {
+            slot.pending = false;
+        }
+        else
+        {
+            m_stats.timeouts++;
+        }
+
+        m_stats.stalls++;
+        m_stats.stallTimeUs += waitedUs;
+        m_stats.maxStallUs = MOS_MAX(m_stats.maxStallUs, waitedUs);
+
+        return status;
+    }
+
+    MOS_STATUS EncodeRecycledSlotManager::WaitSlot(uint32_t slot)
+    {
+        ENCODE_FUNC_CALL();
+
+        ENCODE_CHK_COND_RETURN(slot >= m_slots.size(), "Recycled slot %d is out of range", slot);
+
+        m_stats.checks++;
+
+        return Wait(m_slots[slot]);
+    }
+
+    void EncodeRecycledSlotManager::Retire(uint32_t slot, uint32_t fence)
+    {
+        if (slot < m_slots.size())
+        {
+            m_slots[slot].fence   = fence;
+            m_slots[slot].pending = true;
+        }
+    }
+}
@@ -0,0 +1,136 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+//!
+//! \file     encode_recycled_slot_manager.h
+//! \brief    Defines the fence aware manager of the recycled buffer slots
+//!
+
+#ifndef __ENCODE_RECYCLED_SLOT_MANAGER_H__
+#define __ENCODE_RECYCLED_SLOT_MANAGER_H__
+
+#include <vector>
+#include "mos_defs.h"
+#include "encode_fence_wait.h"
+
+namespace encode
+{
+    //!
+    //! \struct EncodeRecycledSlotStats
+    //! \brief  Statistics of the recycled slot manager
+    //!
+    struct EncodeRecycledSlotStats
+    {
+        uint64_t checks      = 0;  //!< Slots checked before they are written
+        uint64_t stalls      = 0;  //!< Slots which had to wait for the GPU
+        uint64_t timeouts    = 0;  //!< Waits which failed after the stall timeout
+        uint64_t stallTimeUs = 0;  //!< Total time spent waiting
+        uint64_t maxStallUs  = 0;  //!< Longest wait
+    };
+
+    //!
+    //! \class  EncodeRecycledSlotManager
+    //! \brief  Waits until the GPU has retired the previous user of a recycled buffer slot
+    //! \details The slot index comes from the round robin of the pipeline. A slot given to
+    //!          Retire() carries the fence of its submission and is free again once the
+    //!          completed fence reaches it. A slot is never written before its fence
+    //!          completed, a wait which times out fails instead.
+    //!
+    class EncodeRecycledSlotManager
+    {
+    public:
+        using FenceQuery = EncodeFenceWait::FenceQuery;
+
+        //!
+        //! \brief  Constructor of class EncodeRecycledSlotManager
+        //! \param  [in] numSlots
+        //!         Number of slots of the round robin
+        //!
+        EncodeRecycledSlotManager(uint32_t numSlots);
+
+        //!
+        //! \brief  Set the query of the completed fence, a slot never waits without one
+        //! \param  [in] query
+        //!         Returns the fence of the last completed submission
+        //! \return void
+        //!
+        void SetFenceQuery(FenceQuery query) { m_fenceQuery = query; }
+
+        //!
+        //! \brief  Set how long a slot is waited for before the wait fails
+        //! \param  [in] timeoutUs
+        //!         Timeout in microseconds
+        //! \return void
+        //!
+        void SetStallTimeout(uint32_t timeoutUs) { m_stallTimeoutUs = timeoutUs; }
+
+        //!
+        //! \brief  Wait until a slot chosen by the caller is free
+        //! \param  [in] slot
+        //!         Slot index, below the number of slots
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, MOS_STATUS_UNKNOWN if the slot is still
+        //!         busy after the stall timeout
+        //!
+        MOS_STATUS WaitSlot(uint32_t slot);
+
+        //!
+        //! \brief  Mark a slot as read by a submission
+        //! \param  [in] slot
+        //!         Slot index
+        //! \param  [in] fence
+        //!         Fence of the submission
+        //! \return void
+        //!
+        void Retire(uint32_t slot, uint32_t fence);
+
+        uint32_t GetNumSlots() const { return (uint32_t)m_slots.size(); }
+        const EncodeRecycledSlotStats &GetStats() const { return m_stats; }
+
+        static constexpr uint32_t m_defaultStallTimeoutUs = 100000;
+
+    protected:
+        //!
+        //! \brief  State of one slot
+        //!
+        struct Slot
+        {
+            uint32_t fence   = 0;      //!< Fence of the last submission using the slot
+            bool     pending = false;  //!< The fence may not be completed
+        };
+
+        bool IsSlotFree(Slot &slot, uint32_t completedFence);
+
+        //!
+        //! \brief  Wait for a slot, and record the stall
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if the slot is free, else the stall timed out
+        //!
+        MOS_STATUS Wait(Slot &slot);
+
+        std::vector<Slot>       m_slots;                                    //!< Slots of the round robin
+        uint32_t                m_stallTimeoutUs = m_defaultStallTimeoutUs; //!< Wait limit of a slot
+        FenceQuery              m_fenceQuery;                               //!< Completed fence query
+        EncodeRecycledSlotStats m_stats;                                    //!< Statistics
+    };
+}
+
+#endif // __ENCODE_RECYCLED_SLOT_MANAGER_H__
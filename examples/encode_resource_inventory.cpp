@@ -0,0 +1,107 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+//!
+//! \file     encode_resource_inventory.cpp
+//! \brief    Defines the inventory of the graphics buffers owned by an encode packet
+//!
+#include "encode_resource_inventory.h"
+#include "encode_utils.h"
+#include <chrono>
+
+namespace encode
+{
+    void EncodeResourceInventory::SetEnabled(bool enable)
+    {
+        m_enabled = enable;
+        if (!enable)
+        {
+            m_records.clear();
+            m_totals = EncodeResourceInventoryTotals();
+        }
+    }
+
+    void EncodeResourceInventory::Add(PMOS_RESOURCE resource, const MOS_ALLOC_GFXRES_PARAMS &allocParams, bool shared)
+    {
+        if (!m_enabled || resource == nullptr)
+        {
+            return;
+        }
+
+        EncodeResourceRecord record;
+        record.resource   = resource;
+        record.name       = allocParams.pBufName ? allocParams.pBufName : "";
+        record.size       = allocParams.dwBytes;
+        record.tileType   = allocParams.TileType;
+        record.createTime = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        record.shared     = shared;
+        m_records.push_back(record);
+
+        m_totals.numResources++;
+        m_totals.totalBytes += record.size;
+        m_totals.sharedBytes += shared ? record.size : 0;
+        m_totals.peakBytes = MOS_MAX(m_totals.peakBytes, m_totals.totalBytes);
+    }
+
+    void EncodeResourceInventory::Remove(PMOS_RESOURCE resource)
+    {
+        for (auto record = m_records.begin(); record != m_records.end(); record++)
+        {
+            if (record->resource == resource)
+            {
+                m_totals.numResources--;
+                m_totals.totalBytes -= record->size;
+                m_totals.sharedBytes -= record->shared ? record->size : 0;
+                m_records.erase(record);
+                return;
+            }
+        }
+    }
+
+    void EncodeResourceInventory::Touch(PMOS_RESOURCE resource, uint32_t frame)
+    {
+        for (auto &record : m_records)
+        {
+            if (record.resource == resource)
+            {
+                record.lastUseFrame = frame;
+                return;
+            }
+        }
+    }
+
+    void EncodeResourceInventory::TouchAll(uint32_t frame)
+    {
+        for (auto &record : m_records)
+        {
+            record.lastUseFrame = frame;
+        }
+    }
+
+    void EncodeResourceInventory::Accumulate(EncodeResourceInventoryTotals &totals) const
+    {
+        totals.numResources += m_totals.numResources;
+        totals.totalBytes += m_totals.totalBytes;
+        totals.sharedBytes += m_totals.sharedBytes;
+        totals.peakBytes += m_totals.peakBytes;
+    }
+}
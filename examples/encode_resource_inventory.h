@@ -0,0 +1,139 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+//!
+//! \file     encode_resource_inventory.h
+//! \brief    Defines the inventory of the graphics buffers owned by an encode packet
+//!
+
+#ifndef __ENCODE_RESOURCE_INVENTORY_H__
+#define __ENCODE_RESOURCE_INVENTORY_H__
+
+#include <string>
+#include <vector>
+#include "mos_os.h"
+
+namespace encode
+{
+    //!
+    //! \struct EncodeResourceRecord
+    //! \brief  One buffer of the inventory
+    //!
+    struct EncodeResourceRecord
+    {
+        PMOS_RESOURCE resource     = nullptr;           //!< Buffer
+        std::string   name;                             //!< Allocation name
+        uint32_t      size         = 0;                 //!< Size in bytes
+        MOS_TILE_TYPE tileType     = MOS_TILE_LINEAR;   //!< Tiling
+        uint64_t      createTime   = 0;                 //!< Creation time in microseconds, steady clock
+        uint32_t      lastUseFrame = 0;                 //!< Last frame which referenced the buffer
+        bool          shared       = false;             //!< Leased from EncodeSharedResourcePool
+    };
+
+    //!
+    //! \struct EncodeResourceInventoryTotals
+    //! \brief  Totals of one or more inventories
+    //!
+    struct EncodeResourceInventoryTotals
+    {
+        uint32_t numResources = 0;  //!< Buffers currently allocated
+        uint64_t totalBytes   = 0;  //!< Bytes currently allocated
+        uint64_t sharedBytes  = 0;  //!< Part of totalBytes leased from the shared pool
+        uint64_t peakBytes    = 0;  //!< Largest totalBytes so far
+    };
+
+    //!
+    //! \class  EncodeResourceInventory
+    //! \brief  Lists the buffers of an encode packet with their size and use
+    //! \details Records are only added and removed at allocation time, and a frame
+    //!          touches each record once, so the inventory is on by default.
+    //!          A pipeline sums the totals of its packets with Accumulate().
+    //!
+    class EncodeResourceInventory
+    {
+    public:
+        //!
+        //! \brief  Enable or disable the inventory, disabling drops the records
+        //! \param  [in] enable
+        //!         true to record the buffers
+        //! \return void
+        //!
+        void SetEnabled(bool enable);
+
+        bool IsEnabled() const { return m_enabled; }
+
+        //!
+        //! \brief  Record a buffer
+        //! \param  [in] resource
+        //!         Buffer
+        //! \param  [in] allocParams
+        //!         Params the buffer was allocated with
+        //! \param  [in] shared
+        //!         true if the buffer is leased from the shared pool
+        //! \return void
+        //!
+        void Add(PMOS_RESOURCE resource, const MOS_ALLOC_GFXRES_PARAMS &allocParams, bool shared);
+
+        //!
+        //! \brief  Drop the record of a buffer
+        //! \param  [in] resource
+        //!         Buffer, ignored if it is not recorded
+        //! \return void
+        //!
+        void Remove(PMOS_RESOURCE resource);
+
+        //!
+        //! \brief  Set the last use frame of a buffer
+        //! \param  [in] resource
+        //!         Buffer
+        //! \param  [in] frame
+        //!         Frame number
+        //! \return void
+        //!
+        void Touch(PMOS_RESOURCE resource, uint32_t frame);
+
+        //!
+        //! \brief  Set the last use frame of all the buffers
+        //! \param  [in] frame
+        //!         Frame number
+        //! \return void
+        //!
+        void TouchAll(uint32_t frame);
+
+        //!
+        //! \brief  Add the totals of this inventory to totals of other inventories
+        //! \param  [in, out] totals
+        //!         Totals to add to, the peak is summed as well
+        //! \return void
+        //!
+        void Accumulate(EncodeResourceInventoryTotals &totals) const;
+
+        const std::vector<EncodeResourceRecord> &GetRecords() const { return m_records; }
+        const EncodeResourceInventoryTotals &GetTotals() const { return m_totals; }
+
+    protected:
+        bool                              m_enabled = true;  //!< Record the buffers
+        std::vector<EncodeResourceRecord> m_records;         //!< Buffers currently allocated
+        EncodeResourceInventoryTotals     m_totals;          //!< Totals of m_records
+    };
+}
+
+#endif // __ENCODE_RESOURCE_INVENTORY_H__
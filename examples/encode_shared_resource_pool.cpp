@@ -0,0 +1,213 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+//!
+//! \file     encode_shared_resource_pool.cpp
+//! \brief    Implements the process wide pool of encode buffers
+//!
+#include "encode_shared_resource_pool.h"
+#include "encode_utils.h"
+
+namespace encode
+{
+    EncodeSharedResourcePool &EncodeSharedResourcePool::GetInstance()
+    {
+        static EncodeSharedResourcePool pool;
+        return pool;
+    }
+
+    void *EncodeSharedResourcePool::GetDeviceKey(PMOS_INTERFACE osInterface)
+    {
+        // All the sessions of one adapter share its GMM client context
+        return (osInterface && osInterface->pfnGetGmmClientContext) ?
+            (void *)osInterface->pfnGetGmmClientContext(osInterface) : nullptr;
+    }
+
+    MOS_STATUS EncodeSharedResourcePool::Acquire(
+        PMOS_INTERFACE                 osInterface,
+        const EncodeSharedResourceKey &key,
+        MOS_ALLOC_GFXRES_PARAMS       &allocParams,
+        PMOS_RESOURCE                 &resource)
+    {
+        ENCODE_FUNC_CALL();
+
+        ENCODE_CHK_NULL_RETURN(osInterface);
+        ENCODE_CHK_NULL_RETURN(key.device);
+
+        resource = nullptr;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        for (auto it = m_free.begin(); it != m_free.end(); it++)
+        {
+            if (IsSameKey(it->key, key))
+            {
+                resource = it->resource;
+                m_free.erase(it);
+                m_stats.hits++;
+                m_stats.freeBytes -= key.size;
+                break;
+            }
+        }
+
+        if (resource == nullptr)
+        {
+            resource = MOS_New(MOS_RESOURCE);
+            ENCODE_CHK_NULL_RETURN(resource);
+            MOS_ZeroMemory(resource, sizeof(MOS_RESOURCE));
+
+            MOS_STATUS status = osInterface->pfnAllocateResource(osInterface, &allocParams, resource);
+            if (status != MOS_STATUS_SUCCESS)
+            {
+                MOS_Delete(resource);
+                return status;
+            }
+            m_stats.misses++;
+        }
+
+        m_leased[resource] = key;
+        m_deviceLeases[key.device]++;
+        m_stats.leasedBytes += key.size;
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    MOS_STATUS EncodeSharedResourcePool::Release(PMOS_INTERFACE osInterface, PMOS_RESOURCE resource)
+    {
+        ENCODE_FUNC_CALL();
+
+        ENCODE_CHK_NULL_RETURN(osInterface);
+        ENCODE_CHK_NULL_RETURN(resource);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto leased = m_leased.find(resource);
+        ENCODE_CHK_COND_RETURN(leased == m_leased.end(), "Releasing a buffer which is not leased");
+
+        EncodeSharedResourceKey key = leased->second;
+        m_leased.erase(leased);
+        m_free.push_back({key, resource});
+        m_stats.releases++;
+        m_stats.leasedBytes -= key.size;
+        m_stats.freeBytes += key.size;
+
+        // No session of the adapter is left to reuse the buffers
+        if (--m_deviceLeases[key.device] == 0)
+        {
+            m_deviceLeases.erase(key.device);
+            FreeDeviceResources(osInterface, key.device);
+        }
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    MOS_STATUS EncodeSharedResourcePool::Prewarm(
+        PMOS_INTERFACE                 osInterface,
+        const EncodeSharedResourceKey &key,
+        MOS_ALLOC_GFXRES_PARAMS       &allocParams,
+        uint32_t                       count)
+    {
+        ENCODE_FUNC_CALL();
+
+        ENCODE_CHK_NULL_RETURN(osInterface);
+        ENCODE_CHK_NULL_RETURN(key.device);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // The adapter holds a lease of its own, so the warm buffers outlive its sessions
+        if (m_warmDevices.find(key.device) == m_warmDevices.end())
+        {
+            m_warmDevices[key.device] = true;
+            m_deviceLeases[key.device]++;
+        }
+
+        uint32_t numFree = 0;
+        for (auto &entry : m_free)
+        {
+            numFree += IsSameKey(entry.key, key) ? 1 : 0;
+        }
+
+        for (; numFree < count; numFree++)
+        {
+            PMOS_RESOURCE resource = MOS_New(MOS_RESOURCE);
+            ENCODE_CHK_NULL_RETURN(resource);
+            MOS_ZeroMemory(resource, sizeof(MOS_RESOURCE));
+
+            MOS_STATUS status = osInterface->pfnAllocateResource(osInterface, &allocParams, resource);
+            if (status != MOS_STATUS_SUCCESS)
+            {
+                MOS_Delete(resource);
+                return status;
+            }
+
+            m_free.push_back({key, resource});
+            m_stats.freeBytes += key.size;
+        }
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    MOS_STATUS EncodeSharedResourcePool::DrainWarm(PMOS_INTERFACE osInterface)
+    {
+        ENCODE_FUNC_CALL();
+
+        void *device = GetDeviceKey(osInterface);
+        ENCODE_CHK_NULL_RETURN(device);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (m_warmDevices.erase(device) == 0)
+        {
+            return MOS_STATUS_SUCCESS;
+        }
+
+        if (--m_deviceLeases[device] == 0)
+        {
+            m_deviceLeases.erase(device);
+            FreeDeviceResources(osInterface, device);
+        }
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    void EncodeSharedResourcePool::FreeDeviceResources(PMOS_INTERFACE osInterface, void *device)
+    {
+        for (auto it = m_free.begin(); it != m_free.end();)
+        {
+            if (it->key.device != device)
+            {
+                it++;
+                continue;
+            }
+
+            osInterface->pfnFreeResource(osInterface, it->resource);
+            MOS_Delete(it->resource);
+            m_stats.freeBytes -= it->key.size;
+            it = m_free.erase(it);
+        }
+    }
+
+    EncodeSharedResourcePoolStats EncodeSharedResourcePool::GetStats()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_stats;
+    }
+}
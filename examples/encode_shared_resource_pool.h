@@ -0,0 +1,204 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+//!
+//! \file     encode_shared_resource_pool.h
+//! \brief    Defines a process wide pool of encode buffers shared by the sessions of one adapter
+//!
+
+#ifndef __ENCODE_SHARED_RESOURCE_POOL_H__
+#define __ENCODE_SHARED_RESOURCE_POOL_H__
+
+#include <map>
+#include <mutex>
+#include <vector>
+#include "mos_os.h"
+
+namespace encode
+{
+    //!
+    //! \struct EncodeSharedResourceKey
+    //! \brief  Class and shape of a pooled buffer, only equal keys share a buffer
+    //!
+    struct EncodeSharedResourceKey
+    {
+        void     *device;         //!< Adapter of the buffer, the GMM client context
+        uint32_t  resourceClass;  //!< Purpose of the buffer, defined by the user of the pool
+        uint32_t  width;          //!< Frame width
+        uint32_t  height;         //!< Frame height
+        uint32_t  bitDepth;       //!< Bit depth
+        uint32_t  chromaFormat;   //!< Chroma format
+        uint32_t  lcuSize;        //!< Max LCU size
+        uint32_t  size;           //!< Size in bytes
+    };
+
+    //!
+    //! \struct EncodeSharedResourcePoolStats
+    //! \brief  Statistics of the shared resource pool
+    //!
+    struct EncodeSharedResourcePoolStats
+    {
+        uint64_t hits        = 0;  //!< Leases served from a freed buffer
+        uint64_t misses      = 0;  //!< Leases which allocated a buffer
+        uint64_t releases    = 0;  //!< Leases given back
+        uint64_t leasedBytes = 0;  //!< Bytes currently leased
+        uint64_t freeBytes   = 0;  //!< Bytes kept for later leases
+    };
+
+    //!
+    //! \class  EncodeSharedResourcePool
+    //! \brief  Leases buffers to the encode sessions and keeps the released ones for reuse
+    //! \details Only buffers whose content does not outlive a frame may be pooled. A lease
+    //!          is given back when its session is destroyed. Freed buffers are kept while
+    //!          other leases of the same adapter exist or the adapter is prewarmed, the
+    //!          last release of an adapter frees them with the releasing OS interface.
+    //!          The pool is off until SetEnabled() is called.
+    //!
+    class EncodeSharedResourcePool
+    {
+    public:
+        //!
+        //! \brief  Get the pool of the process
+        //! \return EncodeSharedResourcePool &
+        //!
+        static EncodeSharedResourcePool &GetInstance();
+
+        //!
+        //! \brief  Get the adapter key of an OS interface
+        //! \param  [in] osInterface
+        //!         OS interface of the session
+        //! \return void *
+        //!
+        static void *GetDeviceKey(PMOS_INTERFACE osInterface);
+
+        //!
+        //! \brief  Enable or disable leasing
+        //! \details Leases taken while enabled stay valid after disabling.
+        //! \param  [in] enable
+        //!         true to let the sessions share their buffers
+        //! \return void
+        //!
+        void SetEnabled(bool enable) { m_enabled = enable; }
+
+        bool IsEnabled() const { return m_enabled; }
+
+        //!
+        //! \brief  Lease a buffer, allocating it when no freed one matches the key
+        //! \param  [in] osInterface
+        //!         OS interface of the session
+        //! \param  [in] key
+        //!         Class and shape of the buffer
+        //! \param  [in] allocParams
+        //!         Allocation params used on a miss
+        //! \param  [out] resource
+        //!         Leased buffer
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS Acquire(
+            PMOS_INTERFACE                 osInterface,
+            const EncodeSharedResourceKey &key,
+            MOS_ALLOC_GFXRES_PARAMS       &allocParams,
+            PMOS_RESOURCE                 &resource);
+
+        //!
+        //! \brief  Give back a leased buffer
+        //! \param  [in] osInterface
+        //!         OS interface of the session, used if the buffer has to be freed
+        //! \param  [in] resource
+        //!         Leased buffer
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS Release(PMOS_INTERFACE osInterface, PMOS_RESOURCE resource);
+
+        //!
+        //! \brief  Allocate freed buffers ahead of the sessions which will lease them
+        //! \details The warm buffers of an adapter are kept until DrainWarm(), even when
+        //!          no session of the adapter is left.
+        //! \param  [in] osInterface
+        //!         OS interface used to allocate the buffers
+        //! \param  [in] key
+        //!         Class and shape of the buffers
+        //! \param  [in] allocParams
+        //!         Allocation params
+        //! \param  [in] count
+        //!         Number of freed buffers of the key to keep ready
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS Prewarm(
+            PMOS_INTERFACE                 osInterface,
+            const EncodeSharedResourceKey &key,
+            MOS_ALLOC_GFXRES_PARAMS       &allocParams,
+            uint32_t                       count);
+
+        //!
+        //! \brief  Stop keeping the warm buffers of an adapter
+        //! \details The freed buffers of the adapter are freed if no session of it is left.
+        //! \param  [in] osInterface
+        //!         OS interface of the adapter
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS DrainWarm(PMOS_INTERFACE osInterface);
+
+        //!
+        //! \brief  Get the statistics of the pool
+        //! \return EncodeSharedResourcePoolStats
+        //!
+        EncodeSharedResourcePoolStats GetStats();
+
+    protected:
+        EncodeSharedResourcePool() = default;
+
+        //!
+        //! \brief  Free the kept buffers of an adapter, the mutex is held by the caller
+        //!
+        void FreeDeviceResources(PMOS_INTERFACE osInterface, void *device);
+
+        static bool IsSameKey(const EncodeSharedResourceKey &a, const EncodeSharedResourceKey &b)
+        {
+            return memcmp(&a, &b, sizeof(EncodeSharedResourceKey)) == 0;
+        }
+
+        //!
+        //! \brief  Buffer owned by the pool
+        //!
+        struct Entry
+        {
+            EncodeSharedResourceKey key;
+            PMOS_RESOURCE           resource;
+        };
+
+        using LeaseMap = std::map<PMOS_RESOURCE, EncodeSharedResourceKey>;
+
+        std::mutex                    m_mutex;            //!< Protects all the members below
+        std::vector<Entry>            m_free;             //!< Buffers kept for later leases
+        LeaseMap                      m_leased;           //!< Leased buffers
+        std::map<void *, uint32_t>    m_deviceLeases;     //!< Number of leases of each adapter, a warm adapter holds one more
+        std::map<void *, bool>        m_warmDevices;      //!< Adapters with warm buffers
+        EncodeSharedResourcePoolStats m_stats;            //!< Statistics
+        bool                          m_enabled = false;  //!< Leasing is enabled
+    };
+}
+
+#endif // __ENCODE_SHARED_RESOURCE_POOL_H__
@@ -0,0 +1,166 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+//!
+//! \file     encode_tile_column_scheduler.cpp
+//! \brief    Defines the assignment of the tile columns to the VDBOX pipes
+//!
+#include "encode_tile_column_scheduler.h"
+#include "encode_utils.h"
+#include <cfloat>
+
+namespace encode
+{
+    void EncodeTileColumnScheduler::UpdateColumnCosts(const std::vector<uint32_t> &columnCtus)
+    {
+        uint32_t numColumns = (uint32_t)columnCtus.size();
+
+        // Cycles of another tile grid do not apply
+        if (m_cyclesPerCtu.size() != numColumns)
+        {
+            m_cyclesPerCtu.assign(numColumns, 0.0);
+        }
+
+        // Columns without a measure cost the mean of the measured ones
+        double   sumCycles   = 0.0;
+        uint32_t numMeasured = 0;
+        for (uint32_t col = 0; col < numColumns; col++)
+        {
+            if (m_cyclesPerCtu[col] > 0.0)
+            {
+                sumCycles += m_cyclesPerCtu[col];
+                numMeasured++;
+            }
+        }
+        double defaultCycles = numMeasured ? sumCycles / numMeasured : 1.0;
+
+        m_columnCosts.resize(numColumns);
+        for (uint32_t col = 0; col < numColumns; col++)
+        {
+            double cyclesPerCtu = (m_cyclesPerCtu[col] > 0.0) ? m_cyclesPerCtu[col] : defaultCycles;
+            m_columnCosts[col]  = columnCtus[col] * cyclesPerCtu;
+        }
+    }
+
+    MOS_STATUS EncodeTileColumnScheduler::Schedule(const std::vector<uint32_t> &columnCtus, uint32_t numPipes)
+    {
+        ENCODE_FUNC_CALL();
+
+        ENCODE_CHK_COND_RETURN(columnCtus.empty(), "No tile column to schedule");
+        numPipes = MOS_MAX(numPipes, 1);
+
+        uint32_t numColumns = (uint32_t)columnCtus.size();
+        UpdateColumnCosts(columnCtus);
+        m_columnCtus = columnCtus;
+
+        m_prefixCosts.resize(numColumns + 1);
+        m_prefixCosts[0] = 0.0;
+        for (uint32_t col = 0; col < numColumns; col++)
+        {
+            m_prefixCosts[col + 1] = m_prefixCosts[col] + m_columnCosts[col];
+        }
+
+        // Linear partition: best[p][c] is the lowest max pipe cost of columns [0, c) on
+        // pipes [0, p], split[p][c] the first column of pipe p in that split. Pipes beyond
+        // the column count stay empty.
+        uint32_t numBusyPipes = MOS_MIN(numPipes, numColumns);
+        uint32_t stride       = numColumns + 1;
+        m_bestCosts.assign(numBusyPipes * stride, DBL_MAX);
+        m_bestSplits.assign(numBusyPipes * stride, 0);
+
+        for (uint32_t c = 1; c <= numColumns; c++)
+        {
+            m_bestCosts[c] = m_prefixCosts[c];
+        }
+        for (uint32_t p = 1; p < numBusyPipes; p++)
+        {
+            for (uint32_t c = p + 1; c <= numColumns; c++)
+            {
+                // Pipe p takes columns [s, c), the pipes before it at least one column each
+                for (uint32_t s = p; s < c; s++)
+                {
+                    double cost = MOS_MAX(m_bestCosts[(p - 1) * stride + s], m_prefixCosts[c] - m_prefixCosts[s]);
+                    if (cost < m_bestCosts[p * stride + c])
+                    {
+                        m_bestCosts[p * stride + c]  = cost;
+                        m_bestSplits[p * stride + c] = s;
+                    }
+                }
+            }
+        }
+
+        m_pipeFirstColumn.assign(numPipes + 1, numColumns);
+        m_pipeFirstColumn[0] = 0;
+        for (uint32_t p = numBusyPipes - 1, c = numColumns; p > 0; p--)
+        {
+            c                    = m_bestSplits[p * stride + c];
+            m_pipeFirstColumn[p] = c;
+        }
+
+        m_columnPipe.resize(numColumns);
+        m_maxColumnsPerPipe = 0;
+        double maxCost      = 0.0;
+        for (uint32_t p = 0; p < numPipes; p++)
+        {
+            uint32_t first = m_pipeFirstColumn[p];
+            uint32_t last  = m_pipeFirstColumn[p + 1];
+            for (uint32_t col = first; col < last; col++)
+            {
+                m_columnPipe[col] = p;
+            }
+            m_maxColumnsPerPipe = MOS_MAX(m_maxColumnsPerPipe, last - first);
+            maxCost             = MOS_MAX(maxCost, m_prefixCosts[last] - m_prefixCosts[first]);
+        }
+
+        double meanCost = m_prefixCosts[numColumns] / numPipes;
+        m_imbalance     = (meanCost > 0.0) ? maxCost / meanCost : 1.0;
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    void EncodeTileColumnScheduler::UpdatePipeCycles(uint32_t pipe, uint64_t cycles)
+    {
+        if (pipe >= GetNumPipes() || m_cyclesPerCtu.size() != m_columnCtus.size())
+        {
+            return;
+        }
+
+        uint32_t first = m_pipeFirstColumn[pipe];
+        uint32_t last  = m_pipeFirstColumn[pipe + 1];
+        uint64_t ctus  = 0;
+        for (uint32_t col = first; col < last; col++)
+        {
+            ctus += m_columnCtus[col];
+        }
+        if (ctus == 0 || cycles == 0)
+        {
+            return;
+        }
+
+        // Averaged with the earlier frames, so a single slow frame does not move the split
+        double measured = (double)cycles / ctus;
+        for (uint32_t col = first; col < last; col++)
+        {
+            double &cyclesPerCtu = m_cyclesPerCtu[col];
+            cyclesPerCtu = (cyclesPerCtu > 0.0) ? (cyclesPerCtu + measured) / 2 : measured;
+        }
+    }
+}
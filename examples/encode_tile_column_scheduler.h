@@ -0,0 +1,123 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+//!
+//! \file     encode_tile_column_scheduler.h
+//! \brief    Defines the assignment of the tile columns to the VDBOX pipes
+//!
+
+#ifndef __ENCODE_TILE_COLUMN_SCHEDULER_H__
+#define __ENCODE_TILE_COLUMN_SCHEDULER_H__
+
+#include <vector>
+#include "mos_defs.h"
+
+namespace encode
+{
+    //!
+    //! \class  EncodeTileColumnScheduler
+    //! \brief  Splits the tile columns of a frame into one run of columns per pipe
+    //! \details Each pipe gets adjacent columns, so the pipes keep their left to right
+    //!          order, and the split minimizes the cost of the most loaded pipe. The cost
+    //!          of a column is its CTU count, weighted by the cycles per CTU measured on
+    //!          the earlier frames once UpdatePipeCycles() is called.
+    //!
+    class EncodeTileColumnScheduler
+    {
+    public:
+        //!
+        //! \brief  Assign the tile columns of a frame to the pipes
+        //! \details Every pipe gets at least one column if there are enough columns.
+        //! \param  [in] columnCtus
+        //!         CTU count of each tile column
+        //! \param  [in] numPipes
+        //!         Number of pipes
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if success, else fail reason
+        //!
+        MOS_STATUS Schedule(const std::vector<uint32_t> &columnCtus, uint32_t numPipes);
+
+        //!
+        //! \brief  Record the cycles a pipe spent on its columns of the last scheduled frame
+        //! \details Typically read from the status report. The cycles are spread over the
+        //!          columns of the pipe by their CTU count.
+        //! \param  [in] pipe
+        //!         Pipe index
+        //! \param  [in] cycles
+        //!         Cycles of the pipe
+        //! \return void
+        //!
+        void UpdatePipeCycles(uint32_t pipe, uint64_t cycles);
+
+        //!
+        //! \brief  Forget the measured cycles, the columns are weighted by CTU count only
+        //! \return void
+        //!
+        void ResetCycles() { m_cyclesPerCtu.assign(m_cyclesPerCtu.size(), 0.0); }
+
+        //!
+        //! \brief  Get the pipe of a tile column
+        //! \param  [in] column
+        //!         Tile column index
+        //! \return uint32_t
+        //!         Pipe index, 0 for a column which is not scheduled
+        //!
+        uint32_t GetColumnPipe(uint32_t column) const
+        {
+            return (column < m_columnPipe.size()) ? m_columnPipe[column] : 0;
+        }
+
+        uint32_t GetNumColumns() const { return (uint32_t)m_columnPipe.size(); }
+        uint32_t GetNumPipes() const { return m_pipeFirstColumn.empty() ? 0 : (uint32_t)m_pipeFirstColumn.size() - 1; }
+
+        //!
+        //! \brief  Get the largest number of columns of one pipe
+        //! \return uint32_t
+        //!
+        uint32_t GetMaxColumnsPerPipe() const { return m_maxColumnsPerPipe; }
+
+        //!
+        //! \brief  Get the cost of the most loaded pipe against the mean pipe cost
+        //! \return double
+        //!         1.0 for a perfect balance
+        //!
+        double GetImbalance() const { return m_imbalance; }
+
+    protected:
+        //!
+        //! \brief  Cost of each column, the CTU count times the cycles per CTU
+        //!
+        void UpdateColumnCosts(const std::vector<uint32_t> &columnCtus);
+
+        std::vector<uint32_t> m_columnPipe;            //!< Pipe of each column
+        std::vector<uint32_t> m_pipeFirstColumn;       //!< First column of each pipe, numPipes + 1 entries
+        std::vector<uint32_t> m_columnCtus;            //!< CTU count of each column of the last schedule
+        std::vector<double>   m_cyclesPerCtu;          //!< Measured cycles per CTU of each column, 0 if not measured
+        std::vector<double>   m_columnCosts;           //!< Cost of each column
+        std::vector<double>   m_prefixCosts;           //!< Scratch prefix sums of the costs
+        std::vector<double>   m_bestCosts;             //!< Scratch costs of the partial splits
+        std::vector<uint32_t> m_bestSplits;            //!< Scratch first column of the last pipe of the partial splits
+        uint32_t              m_maxColumnsPerPipe = 0; //!< Largest number of columns of one pipe
+        double                m_imbalance = 1.0;       //!< Most loaded pipe against the mean
+    };
+}
+
+#endif // __ENCODE_TILE_COLUMN_SCHEDULER_H__
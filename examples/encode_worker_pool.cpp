@@ -0,0 +1,137 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+//!
+//! \file     encode_worker_pool.cpp
+//! \brief    Implements the persistent worker pool for host side command building
+//!
+#include "encode_worker_pool.h"
+#include "encode_utils.h"
+
+namespace encode
+{
+    EncodeWorkerPool::EncodeWorkerPool(uint32_t numThreads)
+    {
+        for (uint32_t i = 0; i < numThreads; i++)
+        {
+            m_threads.emplace_back(&EncodeWorkerPool::WorkerLoop, this);
+        }
+    }
+
+    EncodeWorkerPool::~EncodeWorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_workCond.notify_all();
+
+        for (auto &thread : m_threads)
+        {
+            if (thread.joinable())
+            {
+                thread.join();
+            }
+        }
+    }
+
+    MOS_STATUS EncodeWorkerPool::Run(std::vector<Task> &tasks)
+    {
+        ENCODE_FUNC_CALL();
+
+        if (tasks.empty())
+        {
+            return MOS_STATUS_SUCCESS;
+        }
+
+        Batch batch;
+        batch.tasks = &tasks;
+
+        if (!m_threads.empty() && tasks.size() > 1)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_batch = &batch;
+            m_generation++;
+        }
+        m_workCond.notify_all();
+
+        RunTasks(batch);
+
+        // Detach the batch and wait until every worker which joined it has left
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (m_batch == &batch)
+            {
+                m_batch = nullptr;
+            }
+            m_doneCond.wait(lock, [&batch] { return batch.activeWorkers == 0; });
+        }
+
+        return (MOS_STATUS)batch.status.load();
+    }
+
+    void EncodeWorkerPool::RunTasks(Batch &batch)
+    {
+        uint32_t numTasks = (uint32_t)batch.tasks->size();
+        for (uint32_t idx = batch.next.fetch_add(1); idx < numTasks; idx = batch.next.fetch_add(1))
+        {
+            MOS_STATUS status = (*batch.tasks)[idx]();
+            if (status != MOS_STATUS_SUCCESS)
+            {
+                int32_t expected = MOS_STATUS_SUCCESS;
+                batch.status.compare_exchange_strong(expected, status);
+            }
+        }
+    }
+
+    void EncodeWorkerPool::WorkerLoop()
+    {
+        uint64_t seenGeneration = 0;
+
+        while (true)
+        {
+            Batch *batch = nullptr;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_workCond.wait(lock, [this, seenGeneration] { return m_stop || m_generation != seenGeneration; });
+                if (m_stop)
+                {
+                    return;
+                }
+                seenGeneration = m_generation;
+                batch          = m_batch;
+                if (batch == nullptr)
+                {
+                    continue;
+                }
+                batch->activeWorkers++;
+            }
+
+            RunTasks(*batch);
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                batch->activeWorkers--;
+            }
+            m_doneCond.notify_all();
+        }
+    }
+}
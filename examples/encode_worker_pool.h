@@ -0,0 +1,102 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+//!
+//! \file     encode_worker_pool.h
+//! \brief    Defines a small persistent worker pool for host side command building
+//!
+
+#ifndef __ENCODE_WORKER_POOL_H__
+#define __ENCODE_WORKER_POOL_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "mos_defs.h"
+
+namespace encode
+{
+    //!
+    //! \class  EncodeWorkerPool
+    //! \brief  Runs a batch of independent tasks on persistent worker threads
+    //! \details The calling thread takes part in the batch, so a pool of N threads
+    //!          runs up to N + 1 tasks at the same time. Run() returns once all the
+    //!          tasks of the batch are finished.
+    //!
+    class EncodeWorkerPool
+    {
+    public:
+        using Task = std::function<MOS_STATUS()>;
+
+        //!
+        //! \brief  Constructor of class EncodeWorkerPool
+        //! \param  [in] numThreads
+        //!         Number of worker threads besides the calling thread
+        //!
+        EncodeWorkerPool(uint32_t numThreads);
+
+        virtual ~EncodeWorkerPool();
+
+        //!
+        //! \brief  Run all the tasks and wait for them to finish
+        //! \param  [in] tasks
+        //!         Tasks of the batch, must stay valid until Run() returns
+        //! \return MOS_STATUS
+        //!         MOS_STATUS_SUCCESS if all tasks succeed, else the first failure
+        //!
+        MOS_STATUS Run(std::vector<Task> &tasks);
+
+        //!
+        //! \brief  Get the number of worker threads
+        //! \return uint32_t
+        //!
+        uint32_t GetNumThreads() const { return (uint32_t)m_threads.size(); }
+
+    protected:
+        //!
+        //! \brief  State of the batch being run
+        //!
+        struct Batch
+        {
+            std::vector<Task>    *tasks = nullptr;
+            std::atomic<uint32_t> next{0};
+            std::atomic<int32_t>  status{MOS_STATUS_SUCCESS};
+            uint32_t              activeWorkers = 0;
+        };
+
+        void WorkerLoop();
+
+        void RunTasks(Batch &batch);
+
+        std::vector<std::thread> m_threads;              //!< Worker threads
+        std::mutex               m_mutex;                //!< Protects the batch hand-over
+        std::condition_variable  m_workCond;             //!< Signals a new batch or stop
+        std::condition_variable  m_doneCond;             //!< Signals a worker left the batch
+        Batch                   *m_batch = nullptr;      //!< Batch being run
+        uint64_t                 m_generation = 0;       //!< Incremented for each batch
+        bool                     m_stop = false;         //!< Worker threads should exit
+    };
+}
+
+#endif // __ENCODE_WORKER_POOL_H__
@@ -0,0 +1,812 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+//!
+//! \file     mhw_cmd_recorder_g12.cpp
+//! \brief    Implements the host-only MHW G12 interfaces which record commands into an in-memory stream
+//!
+#include "mhw_cmd_recorder_g12.h"
+#include "mhw_utilities.h"
+#include "encode_cmd_walker.h"
+
+//!
+//! \brief  Payload recorded for MI_BATCH_BUFFER_START
+//!
+struct MhwRecordedBatchBufferStart
+{
+    const void *batchBuffer;    // Batch buffer which is started
+    uint32_t    offset;         // Start offset inside the batch buffer
+    uint32_t    size;           // Size of the batch buffer
+};
+
+//!
+//! \brief  Resource referenced by a recorded command
+//!
+struct MhwRecordedResource
+{
+    PMOS_RESOURCE resource;     // Referenced resource, can be nullptr
+    uint32_t      offset;       // Offset of the referenced data
+    bool          write;        // Written by the command
+};
+
+static PMOS_RESOURCE MhwRecordedSurfaceResource(PMOS_SURFACE surface)
+{
+    return surface ? &surface->OsResource : nullptr;
+}
+
+MOS_STATUS MhwCmdRecorderG12::Record(
+    PMOS_COMMAND_BUFFER cmdBuffer,
+    PMHW_BATCH_BUFFER   batchBuffer,
+    MHW_RECORDED_CMD    id,
+    const void         *params,
+    uint32_t            paramsSize)
+{
+    MHW_FUNCTION_ENTER;
+
+    if (cmdBuffer == nullptr && batchBuffer == nullptr)
+    {
+        MHW_ASSERTMESSAGE("There was no valid buffer to record the command to.");
+        return MOS_STATUS_NULL_POINTER;
+    }
+    if (id >= MHW_RECORDED_CMD_NUM)
+    {
+        return MOS_STATUS_INVALID_PARAMETER;
+    }
+
+    // DW0 is the header, DW1 the payload size in bytes, followed by the dword aligned payload
+    uint32_t payloadDw = MOS_ROUNDUP_DIVIDE(paramsSize, sizeof(uint32_t));
+    uint32_t cmdDw     = payloadDw + 2;
+    if (cmdDw - 2 > 0xfff)
+    {
+        MHW_ASSERTMESSAGE("Recorded command exceeds the maximum command length.");
+        return MOS_STATUS_INVALID_PARAMETER;
+    }
+
+    uint32_t header[2] = {MHW_CMD_RECORDER_HEADER(id, cmdDw), paramsSize};
+    MHW_CHK_STATUS_RETURN(Mhw_AddCommandCmdOrBB(cmdBuffer, batchBuffer, header, sizeof(header)));
+
+    if (paramsSize > 0)
+    {
+        MHW_CHK_NULL_RETURN(params);
+        MHW_CHK_STATUS_RETURN(Mhw_AddCommandCmdOrBB(cmdBuffer, batchBuffer, params, paramsSize));
+
+        uint32_t padding = payloadDw * sizeof(uint32_t) - paramsSize;
+        if (padding > 0)
+        {
+            static const uint8_t zero[sizeof(uint32_t)] = {};
+            MHW_CHK_STATUS_RETURN(Mhw_AddCommandCmdOrBB(cmdBuffer, batchBuffer, zero, padding));
+        }
+    }
+
+    m_cmdCount[id]++;
+    m_totalCmdCount++;
+    m_totalBytes += cmdDw * sizeof(uint32_t);
+
+    return MOS_STATUS_SUCCESS;
+}
+
+MOS_STATUS MhwCmdRecorderG12::RecordNative(
+    PMOS_COMMAND_BUFFER cmdBuffer,
+    PMHW_BATCH_BUFFER   batchBuffer,
+    MHW_RECORDED_CMD    id,
+    const void         *cmd,
+    uint32_t            cmdSize)
+{
+    MHW_FUNCTION_ENTER;
+
+    MHW_CHK_NULL_RETURN(cmd);
+    if (cmdBuffer == nullptr && batchBuffer == nullptr)
+    {
+        MHW_ASSERTMESSAGE("There was no valid buffer to record the command to.");
+        return MOS_STATUS_NULL_POINTER;
+    }
+    if (id >= MHW_RECORDED_CMD_NUM)
+    {
+        return MOS_STATUS_INVALID_PARAMETER;
+    }
+
+    MHW_CHK_STATUS_RETURN(Mhw_AddCommandCmdOrBB(cmdBuffer, batchBuffer, cmd, cmdSize));
+
+    m_cmdCount[id]++;
+    m_totalCmdCount++;
+    m_totalBytes += cmdSize;
+
+    return MOS_STATUS_SUCCESS;
+}
+
+MOS_STATUS MhwCmdRecorderG12::AddResource(
+    PMOS_INTERFACE      osInterface,
+    PMOS_COMMAND_BUFFER cmdBuffer,
+    PMOS_RESOURCE       resource,
+    uint32_t            offset,
+    bool                write)
+{
+    MHW_FUNCTION_ENTER;
+
+    if (resource == nullptr)
+    {
+        return MOS_STATUS_SUCCESS;
+    }
+    MHW_CHK_NULL_RETURN(osInterface);
+    MHW_CHK_NULL_RETURN(cmdBuffer);
+
+    MHW_CHK_STATUS_RETURN(osInterface->pfnRegisterResource(osInterface, resource, write, write));
+
+    MOS_PATCH_ENTRY_PARAMS patchEntryParams;
+    MOS_ZeroMemory(&patchEntryParams, sizeof(patchEntryParams));
+    patchEntryParams.presResource      = resource;
+    patchEntryParams.uiAllocationIndex = osInterface->pfnGetResourceAllocationIndex(osInterface, resource);
+    patchEntryParams.uiResourceOffset  = offset;
+    patchEntryParams.uiPatchOffset     = cmdBuffer->iOffset;
+    patchEntryParams.bWrite            = write;
+    patchEntryParams.cmdBuffer         = cmdBuffer;
+    patchEntryParams.cmdBufBase        = (uint8_t *)cmdBuffer->pCmdBase;
+    MHW_CHK_STATUS_RETURN(osInterface->pfnSetPatchEntry(osInterface, &patchEntryParams));
+
+    m_patchEntryCount++;
+
+    return MOS_STATUS_SUCCESS;
+}
+
+bool MhwCmdRecorderG12::GetHardwareCmdSize(const uint32_t *cmd, uint32_t dwLeft, uint32_t &dwSize, uint32_t &hwSize)
+{
+    if (!encode::EncodeCmdWalker::GetCmdSize(cmd, dwLeft, dwSize))
+    {
+        return false;
+    }
+
+    hwSize = dwSize * sizeof(uint32_t);
+    if (!MHW_CMD_RECORDER_IS_HEADER(cmd[0]) || dwSize < 2)
+    {
+        return true;
+    }
+
+    const void *payload     = cmd + 2;
+    uint32_t    payloadSize = cmd[1];
+    switch (MHW_CMD_RECORDER_GET_ID(cmd[0]))
+    {
+    case MHW_RECORDED_MI_BATCH_BUFFER_START:
+        hwSize = mhw_mi_g12_X::MI_BATCH_BUFFER_START_CMD::byteSize;
+        break;
+    case MHW_RECORDED_MI_BATCH_BUFFER_END:
+        hwSize = mhw_mi_g12_X::MI_BATCH_BUFFER_END_CMD::byteSize;
+        break;
+    case MHW_RECORDED_MI_FLUSH_DW:
+        hwSize = mhw_mi_g12_X::MI_FLUSH_DW_CMD::byteSize;
+        break;
+    case MHW_RECORDED_MI_SEMAPHORE_WAIT:
+        hwSize = mhw_mi_g12_X::MI_SEMAPHORE_WAIT_CMD::byteSize;
+        break;
+    case MHW_RECORDED_MI_ATOMIC:
+        hwSize = mhw_mi_g12_X::MI_ATOMIC_CMD::byteSize;
+        break;
+    case MHW_RECORDED_MI_STORE_DATA_IMM:
+        hwSize = mhw_mi_g12_X::MI_STORE_DATA_IMM_CMD::byteSize;
+        break;
+    case MHW_RECORDED_MI_STORE_REGISTER_MEM:
+        hwSize = mhw_mi_g12_X::MI_STORE_REGISTER_MEM_CMD::byteSize;
+        break;
+    case MHW_RECORDED_MI_LOAD_REGISTER_IMM:
+        hwSize = mhw_mi_g12_X::MI_LOAD_REGISTER_IMM_CMD::byteSize;
+        break;
+    case MHW_RECORDED_MI_CONDITIONAL_BATCH_BUFFER_END:
+        hwSize = mhw_mi_g12_X::MI_CONDITIONAL_BATCH_BUFFER_END_CMD::byteSize;
+        break;
+    case MHW_RECORDED_HCP_PIPE_MODE_SELECT:
+        hwSize = mhw_vdbox_hcp_g12_X::HCP_PIPE_MODE_SELECT_CMD::byteSize;
+        break;
+    case MHW_RECORDED_HCP_SURFACE_STATE:
+        hwSize = mhw_vdbox_hcp_g12_X::HCP_SURFACE_STATE_CMD::byteSize;
+        break;
+    case MHW_RECORDED_HCP_PIPE_BUF_ADDR_STATE:
+        hwSize = mhw_vdbox_hcp_g12_X::HCP_PIPE_BUF_ADDR_STATE_CMD::byteSize;
+        break;
+    case MHW_RECORDED_HCP_IND_OBJ_BASE_ADDR_STATE:
+        hwSize = mhw_vdbox_hcp_g12_X::HCP_IND_OBJ_BASE_ADDR_STATE_CMD::byteSize;
+        break;
+    case MHW_RECORDED_HCP_QM_STATE:
+        hwSize = mhw_vdbox_hcp_g12_X::HCP_QM_STATE_CMD::byteSize;
+        break;
+    case MHW_RECORDED_HCP_FQM_STATE:
+        hwSize = mhw_vdbox_hcp_g12_X::HCP_FQM_STATE_CMD::byteSize;
+        break;
+    case MHW_RECORDED_HCP_PIC_STATE:
+        hwSize = mhw_vdbox_hcp_g12_X::HCP_PIC_STATE_CMD::byteSize;
+        break;
+    case MHW_RECORDED_HCP_REF_IDX_STATE:
+        hwSize = mhw_vdbox_hcp_g12_X::HCP_REF_IDX_STATE_CMD::byteSize;
+        break;
+    case MHW_RECORDED_HCP_WEIGHTOFFSET_STATE:
+        hwSize = mhw_vdbox_hcp_g12_X::HCP_WEIGHTOFFSET_STATE_CMD::byteSize;
+        break;
+    case MHW_RECORDED_HCP_SLICE_STATE:
+        hwSize = mhw_vdbox_hcp_g12_X::HCP_SLICE_STATE_CMD::byteSize;
+        break;
+    case MHW_RECORDED_HCP_PAK_INSERT_OBJECT:
+    {
+        // End of sequence and end of stream are inlined by MHW, one dword each
+        hwSize = mhw_vdbox_hcp_g12_X::HCP_PAK_INSERT_OBJECT_CMD::byteSize;
+        if (payloadSize == sizeof(MHW_VDBOX_PAK_INSERT_PARAMS))
+        {
+            MHW_VDBOX_PAK_INSERT_PARAMS params;
+            MOS_SecureMemcpy(&params, sizeof(params), payload, sizeof(params));
+            hwSize += params.bLastPicInSeq ? sizeof(uint32_t) : 0;
+            hwSize += params.bLastPicInStream ? sizeof(uint32_t) : 0;
+        }
+        break;
+    }
+    case MHW_RECORDED_HCP_PAK_INSERT_DATA:
+        hwSize = MOS_ALIGN_CEIL(payloadSize, sizeof(uint32_t));
+        break;
+    case MHW_RECORDED_HCP_RDOQ_STATE:
+        hwSize = mhw_vdbox_hcp_g12_X::HEVC_VP9_RDOQ_STATE_CMD::byteSize;
+        break;
+    case MHW_RECORDED_VDENC_PIPE_MODE_SELECT:
+        hwSize = mhw_vdbox_vdenc_g12_X::VDENC_PIPE_MODE_SELECT_CMD::byteSize;
+        break;
+    case MHW_RECORDED_VDENC_SRC_SURFACE_STATE:
+        hwSize = mhw_vdbox_vdenc_g12_X::VDENC_SRC_SURFACE_STATE_CMD::byteSize;
+        break;
+    case MHW_RECORDED_VDENC_REF_SURFACE_STATE:
+        hwSize = mhw_vdbox_vdenc_g12_X::VDENC_REF_SURFACE_STATE_CMD::byteSize;
+        break;
+    case MHW_RECORDED_VDENC_DS_REF_SURFACE_STATE:
+        hwSize = mhw_vdbox_vdenc_g12_X::VDENC_DS_REF_SURFACE_STATE_CMD::byteSize;
+        break;
+    case MHW_RECORDED_VDENC_PIPE_BUF_ADDR_STATE:
+        hwSize = mhw_vdbox_vdenc_g12_X::VDENC_PIPE_BUF_ADDR_STATE_CMD::byteSize;
+        break;
+    case MHW_RECORDED_VDENC_WALKER_STATE:
+        hwSize = mhw_vdbox_vdenc_g12_X::VDENC_WALKER_STATE_CMD::byteSize;
+        break;
+    case MHW_RECORDED_VDENC_CMD1:
+        hwSize = mhw_vdbox_vdenc_g12_X::VDENC_CMD1_CMD::byteSize;
+        break;
+    case MHW_RECORDED_VDENC_CMD2:
+        hwSize = mhw_vdbox_vdenc_g12_X::VDENC_CMD2_CMD::byteSize;
+        break;
+    case MHW_RECORDED_VDENC_WEIGHTSOFFSETS_STATE:
+        hwSize = mhw_vdbox_vdenc_g12_X::VDENC_WEIGHTSOFFSETS_STATE_CMD::byteSize;
+        break;
+    default:
+        break;
+    }
+
+    return true;
+}
+
+const void *MhwCmdRecorderG12::GetBatchStartTarget(const uint32_t *cmd, uint32_t &offset)
+{
+    if (!MHW_CMD_RECORDER_IS_HEADER(cmd[0]) ||
+        MHW_CMD_RECORDER_GET_ID(cmd[0]) != MHW_RECORDED_MI_BATCH_BUFFER_START ||
+        cmd[1] != sizeof(MhwRecordedBatchBufferStart))
+    {
+        return nullptr;
+    }
+
+    // Payload is only dword aligned
+    MhwRecordedBatchBufferStart bbStart;
+    MOS_SecureMemcpy(&bbStart, sizeof(bbStart), cmd + 2, sizeof(bbStart));
+    offset = bbStart.offset;
+    return bbStart.batchBuffer;
+}
+
+void MhwCmdRecorderG12::Reset()
+{
+    for (uint32_t i = 0; i < MHW_RECORDED_CMD_NUM; i++)
+    {
+        m_cmdCount[i] = 0;
+    }
+    m_totalCmdCount   = 0;
+    m_totalBytes      = 0;
+    m_patchEntryCount = 0;
+}
+
+/******************************************************************
+MI commands
+*******************************************************************/
+MOS_STATUS MhwMiInterfaceG12Recorder::AddMiBatchBufferStartCmd(
+    PMOS_COMMAND_BUFFER cmdBuffer,
+    PMHW_BATCH_BUFFER   batchBuffer)
+{
+    MHW_FUNCTION_ENTER;
+
+    MHW_CHK_NULL_RETURN(m_recorder);
+    MHW_CHK_NULL_RETURN(cmdBuffer);
+    MHW_CHK_NULL_RETURN(batchBuffer);
+
+    MhwRecordedBatchBufferStart bbStart = {};
+    bbStart.batchBuffer = batchBuffer;
+    bbStart.offset      = batchBuffer->dwOffset;
+    bbStart.size        = (uint32_t)batchBuffer->iSize;
+
+    MHW_CHK_STATUS_RETURN(m_recorder->AddResource(m_osInterface, cmdBuffer, &batchBuffer->OsResource, batchBuffer->dwOffset, false));
+    return m_recorder->Record(cmdBuffer, nullptr, MHW_RECORDED_MI_BATCH_BUFFER_START, &bbStart, sizeof(bbStart));
+}
+
+MOS_STATUS MhwMiInterfaceG12Recorder::AddMiBatchBufferEnd(
+    PMOS_COMMAND_BUFFER cmdBuffer,
+    PMHW_BATCH_BUFFER   batchBuffer)
+{
+    MHW_FUNCTION_ENTER;
+
+    MHW_CHK_NULL_RETURN(m_recorder);
+    return m_recorder->Record(cmdBuffer, batchBuffer, MHW_RECORDED_MI_BATCH_BUFFER_END, nullptr, 0);
+}
+
+MOS_STATUS MhwMiInterfaceG12Recorder::AddMiFlushDwCmd(
+    PMOS_COMMAND_BUFFER     cmdBuffer,
+    PMHW_MI_FLUSH_DW_PARAMS params)
+{
+    MHW_FUNCTION_ENTER;
+
+    MHW_CHK_NULL_RETURN(m_recorder);
+    MHW_CHK_NULL_RETURN(params);
+
+    // Flushes with a post sync address keep the recorded form with the patched resource
+    if (params->pOsResource != nullptr)
+    {
+        MHW_CHK_STATUS_RETURN(m_recorder->AddResource(m_osInterface, cmdBuffer, params->pOsResource, params->dwResourceOffset, true));
+        return m_recorder->Record(cmdBuffer, nullptr, MHW_RECORDED_MI_FLUSH_DW, params, sizeof(*params));
+    }
+
+    mhw_mi_g12_X::MI_FLUSH_DW_CMD cmd;
+    cmd.DW0.VideoPipelineCacheInvalidate = params->bVideoPipelineCacheInvalidate;
+    cmd.DW0.PostSyncOperation            = params->postSyncOperation;
+    return m_recorder->RecordNative(cmdBuffer, nullptr, MHW_RECORDED_MI_FLUSH_DW, &cmd, sizeof(cmd));
+}
+
+MOS_STATUS MhwMiInterfaceG12Recorder::AddMiSemaphoreWaitCmd(
+    PMOS_COMMAND_BUFFER           cmdBuffer,
+    PMHW_MI_SEMAPHORE_WAIT_PARAMS params)
+{
+    MHW_FUNCTION_ENTER;
+
+    MHW_CHK_NULL_RETURN(m_recorder);
+    MHW_CHK_NULL_RETURN(params);
+    MHW_CHK_STATUS_RETURN(m_recorder->AddResource(m_osInterface, cmdBuffer, params->presSemaphoreMem, params->dwResourceOffset, false));
+    return m_recorder->Record(cmdBuffer, nullptr, MHW_RECORDED_MI_SEMAPHORE_WAIT, params, sizeof(*params));
+}
+
+MOS_STATUS MhwMiInterfaceG12Recorder::AddMiAtomicCmd(
+    PMOS_COMMAND_BUFFER   cmdBuffer,
+    PMHW_MI_ATOMIC_PARAMS params)
+{
+    MHW_FUNCTION_ENTER;
+
+    MHW_CHK_NULL_RETURN(m_recorder);
+    MHW_CHK_NULL_RETURN(params);
+    MHW_CHK_STATUS_RETURN(m_recorder->AddResource(m_osInterface, cmdBuffer, params->pOsResource, params->dwResourceOffset, true));
+    return m_recorder->Record(cmdBuffer, nullptr, MHW_RECORDED_MI_ATOMIC, params, sizeof(*params));
+}
+
+MOS_STATUS MhwMiInterfaceG12Recorder::AddMiStoreDataImmCmd(
+    PMOS_COMMAND_BUFFER       cmdBuffer,
+    PMHW_MI_STORE_DATA_PARAMS params)
+{
+    MHW_FUNCTION_ENTER;
+
+    MHW_CHK_NULL_RETURN(m_recorder);
+    MHW_CHK_NULL_RETURN(params);
+    MHW_CHK_STATUS_RETURN(m_recorder->AddResource(m_osInterface, cmdBuffer, params->pOsResource, params->dwResourceOffset, true));
+    return m_recorder->Record(cmdBuffer, nullptr, MHW_RECORDED_MI_STORE_DATA_IMM, params, sizeof(*params));
+}
+
+MOS_STATUS MhwMiInterfaceG12Recorder::AddMiStoreRegisterMemCmd(
+    PMOS_COMMAND_BUFFER               cmdBuffer,
+    PMHW_MI_STORE_REGISTER_MEM_PARAMS params)
+{
+    MHW_FUNCTION_ENTER;
+
+    MHW_CHK_NULL_RETURN(m_recorder);
+    MHW_CHK_NULL_RETURN(params);
+    MHW_CHK_STATUS_RETURN(m_recorder->AddResource(m_osInterface, cmdBuffer, params->presStoreBuffer, params->dwOffset, true));
+    return m_recorder->Record(cmdBuffer, nullptr, MHW_RECORDED_MI_STORE_REGISTER_MEM, params, sizeof(*params));
+}
+
+MOS_STATUS MhwMiInterfaceG12Recorder::AddMiLoadRegisterImmCmd(
+    PMOS_COMMAND_BUFFER              cmdBuffer,
+    PMHW_MI_LOAD_REGISTER_IMM_PARAMS params)
+{
+    MHW_FUNCTION_ENTER;
+
+    MHW_CHK_NULL_RETURN(m_recorder);
+    MHW_CHK_NULL_RETURN(params);
+    return m_recorder->Record(cmdBuffer, nullptr, MHW_RECORDED_MI_LOAD_REGISTER_IMM, params, sizeof(*params));
+}
+
+MOS_STATUS MhwMiInterfaceG12Recorder::AddMiConditionalBatchBufferEndCmd(
+    PMOS_COMMAND_BUFFER                         cmdBuffer,
+    PMHW_MI_CONDITIONAL_BATCH_BUFFER_END_PARAMS params)
+{
+    MHW_FUNCTION_ENTER;
+
+    MHW_CHK_NULL_RETURN(m_recorder);
+    MHW_CHK_NULL_RETURN(params);
+    MHW_CHK_STATUS_RETURN(m_recorder->AddResource(m_osInterface, cmdBuffer, params->presSemaphoreBuffer, params->dwOffset, false));
+    return m_recorder->Record(cmdBuffer, nullptr, MHW_RECORDED_MI_CONDITIONAL_BATCH_BUFFER_END, params, sizeof(*params));
+}
+
+MOS_STATUS MhwMiInterfaceG12Recorder::SetWatchdogTimerThreshold(
+    uint32_t frameWidth,
+    uint32_t frameHeight,
+    bool     isEncoder)
+{
+    MHW_FUNCTION_ENTER;
+
+    // There is no watchdog register on the host, nothing to program
+    return MOS_STATUS_SUCCESS;
+}
+
+/******************************************************************
+HCP commands
+*******************************************************************/
+MOS_STATUS MhwVdboxHcpInterfaceG12Recorder::AddHcpPipeModeSelectCmd(
+    PMOS_COMMAND_BUFFER                cmdBuffer,
+    PMHW_VDBOX_PIPE_MODE_SELECT_PARAMS params)
+{
+    MHW_FUNCTION_ENTER;
+
+    MHW_CHK_NULL_RETURN(m_recorder);
+    MHW_CHK_NULL_RETURN(params);
+    auto paramsG12 = static_cast<PMHW_VDBOX_PIPE_MODE_SELECT_PARAMS_G12>(params);
+    return m_recorder->Record(cmdBuffer, nullptr, MHW_RECORDED_HCP_PIPE_MODE_SELECT, paramsG12, sizeof(*paramsG12));
+}
+
+MOS_STATUS MhwVdboxHcpInterfaceG12Recorder::AddHcpSurfaceCmd(
+    PMOS_COMMAND_BUFFER       cmdBuffer,
+    PMHW_VDBOX_SURFACE_PARAMS params)
+{
+    MHW_FUNCTION_ENTER;
+
+    MHW_CHK_NULL_RETURN(m_recorder);
+    MHW_CHK_NULL_RETURN(params);
+    return m_recorder->Record(cmdBuffer, nullptr, MHW_RECORDED_HCP_SURFACE_STATE, params, sizeof(*params));
+}
+
+MOS_STATUS MhwVdboxHcpInterfaceG12Recorder::AddHcpPipeBufAddrCmd(
+    PMOS_COMMAND_BUFFER             cmdBuffer,
+    PMHW_VDBOX_PIPE_BUF_ADDR_PARAMS params)
+{
+    MHW_FUNCTION_ENTER;
+
+    MHW_CHK_NULL_RETURN(params);
+
+    // Every buffer at the start of its resource
+    MHW_VDBOX_PIPE_BUF_ADDR_PARAMS_OFFSET_G12 paramsOffset;
+    static_cast<MHW_VDBOX_PIPE_BUF_ADDR_PARAMS_G12 &>(paramsOffset) = *static_cast<PMHW_VDBOX_PIPE_BUF_ADDR_PARAMS_G12>(params);
+    return AddHcpPipeBufAddrCmdWithOffsets(cmdBuffer, &paramsOffset);
+}
+
+MOS_STATUS MhwVdboxHcpInterfaceG12Recorder::AddHcpPipeBufAddrCmdWithOffsets(
+    PMOS_COMMAND_BUFFER                        cmdBuffer,
+    PMHW_VDBOX_PIPE_BUF_ADDR_PARAMS_OFFSET_G12 params)
+{
+    MHW_FUNCTION_ENTER;
+
+    MHW_CHK_NULL_RETURN(m_recorder);
+    MHW_CHK_NULL_RETURN(params);
+
+    const MhwRecordedResource resources[] =
+    {
+        {MhwRecordedSurfaceResource(params->psPreDeblockSurface), 0, true},
+        {MhwRecordedSurfaceResource(params->psRawSurface), 0, false},
+        {params->presMfdDeblockingFilterRowStoreScratchBuffer, 0, true},
+        {params->presDeblockingFilterTileRowStoreScratchBuffer, 0, true},
+        {params->presDeblockingFilterColumnRowStoreScratchBuffer, 0, true},
+        {params->presMetadataLineBuffer, params->dwMetadataLineBufferOffset, true},
+        {params->presMetadataTileLineBuffer, params->dwMetadataTileLineBufferOffset, true},
+        {params->presMetadataTileColumnBuffer, params->dwMetadataTileColumnBufferOffset, true},
+        {params->presSaoLineBuffer, 0, true},
+        {params->presSaoTileLineBuffer, 0, true},
+        {params->presSaoTileColumnBuffer, 0, true},
+        {params->presCurMvTempBuffer, 0, true},
+        {params->presLcuBaseAddressBuffer, 0, false},
+        {params->presLcuILDBStreamOutBuffer, params->dwLcuILDBStreamOutBufferOffset, true},
+        {params->presFrameStatStreamOutBuffer, 0, true},
+        {params->presSseSrcPixelRowStoreBuffer, params->dwSseSrcPixelRowStoreBufferOffset, true},
+        {params->presPakCuLevelStreamoutBuffer, 0, true},
+    };
+    for (auto &resource : resources)
+    {
+        MHW_CHK_STATUS_RETURN(m_recorder->AddResource(m_osInterface, cmdBuffer, resource.resource, resource.offset, resource.write));
+    }
+    for (uint32_t i = 0; i < MOS_ARRAY_SIZE(params->presReferences); i++)
+    {
+        MHW_CHK_STATUS_RETURN(m_recorder->AddResource(m_osInterface, cmdBuffer, params->presReferences[i], 0, false));
+    }
+    for (uint32_t i = 0; i < MOS_ARRAY_SIZE(params->presColMvTempBuffer); i++)
+    {
+        MHW_CHK_STATUS_RETURN(m_recorder->AddResource(m_osInterface, cmdBuffer, params->presColMvTempBuffer[i], 0, false));
+    }
+
+    // The offsets are part of the payload, as they are part of the hardware addresses
+    return m_recorder->Record(cmdBuffer, nullptr, MHW_RECORDED_HCP_PIPE_BUF_ADDR_STATE, params, sizeof(*params));
+}
+
+MOS_STATUS MhwVdboxHcpInterfaceG12Recorder::AddHcpIndObjBaseAddrCmd(
+    PMOS_COMMAND_BUFFER                 cmdBuffer,
+    PMHW_VDBOX_IND_OBJ_BASE_ADDR_PARAMS params)
+{
+    MHW_FUNCTION_ENTER;
+
+    MHW_CHK_NULL_RETURN(m_recorder);
+    MHW_CHK_NULL_RETURN(params);
+    MHW_CHK_STATUS_RETURN(m_recorder->AddResource(m_osInterface, cmdBuffer, params->presMvObjectBuffer, params->dwMvObjectOffset, false));
+    MHW_CHK_STATUS_RETURN(m_recorder->AddResource(m_osInterface, cmdBuffer, params->presPakBaseObjectBuffer, 0, true));
+    return m_recorder->Record(cmdBuffer, nullptr, MHW_RECORDED_HCP_IND_OBJ_BASE_ADDR_STATE, params, sizeof(*params));
+}
+
+MOS_STATUS MhwVdboxHcpInterfaceG12Recorder::AddHcpQmStateCmd(
+    PMOS_COMMAND_BUFFER  cmdBuffer,
+    PMHW_VDBOX_QM_PARAMS params)
+{
+    MHW_FUNCTION_ENTER;
+
+    MHW_CHK_NULL_RETURN(m_recorder);
+    MHW_CHK_NULL_RETURN(params);
+    return m_recorder->Record(cmdBuffer, nullptr, MHW_RECORDED_HCP_QM_STATE, params, sizeof(*params));
+}
+
+MOS_STATUS MhwVdboxHcpInterfaceG12Recorder::AddHcpFqmStateCmd(
+    PMOS_COMMAND_BUFFER  cmdBuffer,
+    PMHW_VDBOX_QM_PARAMS params)
+{
+    MHW_FUNCTION_ENTER;
+
+    MHW_CHK_NULL_RETURN(m_recorder);
+    MHW_CHK_NULL_RETURN(params);
+    return m_recorder->Record(cmdBuffer, nullptr, MHW_RECORDED_HCP_FQM_STATE, params, sizeof(*params));
+}
+
+MOS_STATUS MhwVdboxHcpInterfaceG12Recorder::AddHcpPicStateCmd(
+    PMOS_COMMAND_BUFFER       cmdBuffer,
+    PMHW_VDBOX_HEVC_PIC_STATE params)
+{
+    MHW_FUNCTION_ENTER;
+
+    MHW_CHK_NULL_RETURN(m_recorder);
+    MHW_CHK_NULL_RETURN(params);
+    auto paramsG12 = static_cast<PMHW_VDBOX_HEVC_PIC_STATE_G12>(params);
+    return m_recorder->Record(cmdBuffer, nullptr, MHW_RECORDED_HCP_PIC_STATE, paramsG12, sizeof(*paramsG12));
+}
+
+MOS_STATUS MhwVdboxHcpInterfaceG12Recorder::AddHcpRefIdxStateCmd(
+    PMOS_COMMAND_BUFFER            cmdBuffer,
+    PMHW_BATCH_BUFFER              batchBuffer,
+    PMHW_VDBOX_HEVC_REF_IDX_PARAMS params)
+{
+    MHW_FUNCTION_ENTER;
+
+    MHW_CHK_NULL_RETURN(m_recorder);
+    MHW_CHK_NULL_RETURN(params);
+    auto paramsG12 = static_cast<PMHW_VDBOX_HEVC_REF_IDX_PARAMS_G12>(params);
+    return m_recorder->Record(cmdBuffer, batchBuffer, MHW_RECORDED_HCP_REF_IDX_STATE, paramsG12, sizeof(*paramsG12));
+}
+
+MOS_STATUS MhwVdboxHcpInterfaceG12Recorder::AddHcpWeightOffsetStateCmd(
+    PMOS_COMMAND_BUFFER                 cmdBuffer,
+    PMHW_BATCH_BUFFER                   batchBuffer,
+    PMHW_VDBOX_HEVC_WEIGHTOFFSET_PARAMS params)
+{
+    MHW_FUNCTION_ENTER;
+
+    MHW_CHK_NULL_RETURN(m_recorder);
+    MHW_CHK_NULL_RETURN(params);
+    return m_recorder->Record(cmdBuffer, batchBuffer, MHW_RECORDED_HCP_WEIGHTOFFSET_STATE, params, sizeof(*params));
+}
+
+MOS_STATUS MhwVdboxHcpInterfaceG12Recorder::AddHcpSliceStateCmd(
+    PMOS_COMMAND_BUFFER         cmdBuffer,
+    PMHW_VDBOX_HEVC_SLICE_STATE params)
+{
+    MHW_FUNCTION_ENTER;
+
+    MHW_CHK_NULL_RETURN(m_recorder);
+    MHW_CHK_NULL_RETURN(params);
+    auto paramsG12 = static_cast<PMHW_VDBOX_HEVC_SLICE_STATE_G12>(params);
+    return m_recorder->Record(cmdBuffer, nullptr, MHW_RECORDED_HCP_SLICE_STATE, paramsG12, sizeof(*paramsG12));
+}
+
+MOS_STATUS MhwVdboxHcpInterfaceG12Recorder::AddHcpPakInsertObject(
+    PMOS_COMMAND_BUFFER          cmdBuffer,
+    PMHW_VDBOX_PAK_INSERT_PARAMS params)
+{
+    MHW_FUNCTION_ENTER;
+
+    MHW_CHK_NULL_RETURN(m_recorder);
+    MHW_CHK_NULL_RETURN(params);
+    MHW_CHK_STATUS_RETURN(m_recorder->Record(cmdBuffer, nullptr, MHW_RECORDED_HCP_PAK_INSERT_OBJECT, params, sizeof(*params)));
+
+    // The header bytes are inlined after the command as the hardware command does
+    if (params->pBsBuffer && params->pBsBuffer->pBase && params->dwBitSize > 0)
+    {
+        uint32_t byteSize = MOS_ROUNDUP_DIVIDE(params->dwBitSize, 8);
+        MHW_CHK_STATUS_RETURN(m_recorder->Record(
+            cmdBuffer,
+            nullptr,
+            MHW_RECORDED_HCP_PAK_INSERT_DATA,
+            params->pBsBuffer->pBase + params->dwOffset,
+            byteSize));
+    }
+
+    return MOS_STATUS_SUCCESS;
+}
+
+MOS_STATUS MhwVdboxHcpInterfaceG12Recorder::AddHcpHevcVp9RdoqStateCmd(
+    PMOS_COMMAND_BUFFER       cmdBuffer,
+    PMHW_VDBOX_HEVC_PIC_STATE params)
+{
+    MHW_FUNCTION_ENTER;
+
+    MHW_CHK_NULL_RETURN(m_recorder);
+    MHW_CHK_NULL_RETURN(params);
+    auto paramsG12 = static_cast<PMHW_VDBOX_HEVC_PIC_STATE_G12>(params);
+    return m_recorder->Record(cmdBuffer, nullptr, MHW_RECORDED_HCP_RDOQ_STATE, paramsG12, sizeof(*paramsG12));
+}
+
+/******************************************************************
+VDENC commands
+*******************************************************************/
+MOS_STATUS MhwVdboxVdencInterfaceG12XRecorder::AddVdencPipeModeSelectCmd(
+    PMOS_COMMAND_BUFFER                cmdBuffer,
+    PMHW_VDBOX_PIPE_MODE_SELECT_PARAMS params)
+{
+    MHW_FUNCTION_ENTER;
+
+    MHW_CHK_NULL_RETURN(m_recorder);
+    MHW_CHK_NULL_RETURN(params);
+    auto paramsG12 = static_cast<PMHW_VDBOX_PIPE_MODE_SELECT_PARAMS_G12>(params);
+    return m_recorder->Record(cmdBuffer, nullptr, MHW_RECORDED_VDENC_PIPE_MODE_SELECT, paramsG12, sizeof(*paramsG12));
+}
+
+MOS_STATUS MhwVdboxVdencInterfaceG12XRecorder::AddVdencSrcSurfaceStateCmd(
+    PMOS_COMMAND_BUFFER       cmdBuffer,
+    PMHW_VDBOX_SURFACE_PARAMS params)
+{
+    MHW_FUNCTION_ENTER;
+
+    MHW_CHK_NULL_RETURN(m_recorder);
+    MHW_CHK_NULL_RETURN(params);
+    return m_recorder->Record(cmdBuffer, nullptr, MHW_RECORDED_VDENC_SRC_SURFACE_STATE, params, sizeof(*params));
+}
+
+MOS_STATUS MhwVdboxVdencInterfaceG12XRecorder::AddVdencRefSurfaceStateCmd(
+    PMOS_COMMAND_BUFFER       cmdBuffer,
+    PMHW_VDBOX_SURFACE_PARAMS params)
+{
+    MHW_FUNCTION_ENTER;
+
+    MHW_CHK_NULL_RETURN(m_recorder);
+    MHW_CHK_NULL_RETURN(params);
+    return m_recorder->Record(cmdBuffer, nullptr, MHW_RECORDED_VDENC_REF_SURFACE_STATE, params, sizeof(*params));
+}
+
+MOS_STATUS MhwVdboxVdencInterfaceG12XRecorder::AddVdencDsRefSurfaceStateCmd(
+    PMOS_COMMAND_BUFFER       cmdBuffer,
+    PMHW_VDBOX_SURFACE_PARAMS params,
+    uint8_t                   numSurfaces)
+{
+    MHW_FUNCTION_ENTER;
+
+    MHW_CHK_NULL_RETURN(m_recorder);
+    MHW_CHK_NULL_RETURN(params);
+    return m_recorder->Record(cmdBuffer, nullptr, MHW_RECORDED_VDENC_DS_REF_SURFACE_STATE, params, sizeof(*params) * numSurfaces);
+}
+
+MOS_STATUS MhwVdboxVdencInterfaceG12XRecorder::AddVdencPipeBufAddrCmd(
+    PMOS_COMMAND_BUFFER             cmdBuffer,
+    PMHW_VDBOX_PIPE_BUF_ADDR_PARAMS params)
+{
+    MHW_FUNCTION_ENTER;
+
+    MHW_CHK_NULL_RETURN(m_recorder);
+    MHW_CHK_NULL_RETURN(params);
+    auto paramsG12 = static_cast<PMHW_VDBOX_PIPE_BUF_ADDR_PARAMS_G12>(params);
+
+    const MhwRecordedResource resources[] =
+    {
+        {MhwRecordedSurfaceResource(params->psRawSurface), 0, false},
+        {params->presVdencStreamOutBuffer, 0, true},
+        {params->presVdencIntraRowStoreScratchBuffer, 0, true},
+        {params->presVdencStreamInBuffer, 0, false},
+    };
+    for (auto &resource : resources)
+    {
+        MHW_CHK_STATUS_RETURN(m_recorder->AddResource(m_osInterface, cmdBuffer, resource.resource, resource.offset, resource.write));
+    }
+    for (uint32_t i = 0; i < MOS_ARRAY_SIZE(params->presVdencReferences); i++)
+    {
+        MHW_CHK_STATUS_RETURN(m_recorder->AddResource(m_osInterface, cmdBuffer, params->presVdencReferences[i], 0, false));
+    }
+
+    return m_recorder->Record(cmdBuffer, nullptr, MHW_RECORDED_VDENC_PIPE_BUF_ADDR_STATE, paramsG12, sizeof(*paramsG12));
+}
+
+MOS_STATUS MhwVdboxVdencInterfaceG12XRecorder::AddVdencWalkerStateCmd(
+    PMOS_COMMAND_BUFFER                  cmdBuffer,
+    PMHW_VDBOX_VDENC_WALKER_STATE_PARAMS params)
+{
+    MHW_FUNCTION_ENTER;
+
+    MHW_CHK_NULL_RETURN(m_recorder);
+    MHW_CHK_NULL_RETURN(params);
+    auto paramsG12 = static_cast<PMHW_VDBOX_VDENC_WALKER_STATE_PARAMS_G12>(params);
+    return m_recorder->Record(cmdBuffer, nullptr, MHW_RECORDED_VDENC_WALKER_STATE, paramsG12, sizeof(*paramsG12));
+}
+
+MOS_STATUS MhwVdboxVdencInterfaceG12XRecorder::AddVdencCmd1Cmd(
+    PMOS_COMMAND_BUFFER          cmdBuffer,
+    PMHW_BATCH_BUFFER            batchBuffer,
+    PMHW_VDBOX_VDENC_CMD1_PARAMS params)
+{
+    MHW_FUNCTION_ENTER;
+
+    MHW_CHK_NULL_RETURN(m_recorder);
+    MHW_CHK_NULL_RETURN(params);
+    return m_recorder->Record(cmdBuffer, batchBuffer, MHW_RECORDED_VDENC_CMD1, params, sizeof(*params));
+}
+
+MOS_STATUS MhwVdboxVdencInterfaceG12XRecorder::AddVdencCmd2Cmd(
+    PMOS_COMMAND_BUFFER         cmdBuffer,
+    PMHW_BATCH_BUFFER           batchBuffer,
+    PMHW_VDBOX_VDENC_CMD2_STATE params)
+{
+    MHW_FUNCTION_ENTER;
+
+    MHW_CHK_NULL_RETURN(m_recorder);
+    MHW_CHK_NULL_RETURN(params);
+    return m_recorder->Record(cmdBuffer, batchBuffer, MHW_RECORDED_VDENC_CMD2, params, sizeof(*params));
+}
+
+MOS_STATUS MhwVdboxVdencInterfaceG12XRecorder::AddVdencWeightsOffsetsStateCmd(
+    PMOS_COMMAND_BUFFER                   cmdBuffer,
+    PMHW_BATCH_BUFFER                     batchBuffer,
+    PMHW_VDBOX_VDENC_WEIGHT_OFFSET_PARAMS params)
+{
+    MHW_FUNCTION_ENTER;
+
+    MHW_CHK_NULL_RETURN(m_recorder);
+    MHW_CHK_NULL_RETURN(params);
+    return m_recorder->Record(cmdBuffer, batchBuffer, MHW_RECORDED_VDENC_WEIGHTSOFFSETS_STATE, params, sizeof(*params));
+}
+
+MOS_STATUS MhwVdboxVdencInterfaceG12XRecorder::AddVdPipelineFlushCmd(
+    PMOS_COMMAND_BUFFER             cmdBuffer,
+    PMHW_VDBOX_VD_PIPE_FLUSH_PARAMS params)
+{
+    MHW_FUNCTION_ENTER;
+
+    MHW_CHK_NULL_RETURN(m_recorder);
+    MHW_CHK_NULL_RETURN(params);
+
+    mhw_vdbox_vdenc_g12_X::VD_PIPELINE_FLUSH_CMD cmd;
+    cmd.DW1.HevcPipelineDone           = params->Flags.bWaitDoneHEVC;
+    cmd.DW1.VdencPipelineDone          = params->Flags.bWaitDoneVDENC;
+    cmd.DW1.MflPipelineDone            = params->Flags.bWaitDoneMFL;
+    cmd.DW1.MfxPipelineDone            = params->Flags.bWaitDoneMFX;
+    cmd.DW1.VdCommandMessageParserDone = params->Flags.bWaitDoneVDCmdMsgParser;
+    cmd.DW1.HevcPipelineCommandFlush   = params->Flags.bFlushHEVC;
+    cmd.DW1.VdencPipelineCommandFlush  = params->Flags.bFlushVDENC;
+    cmd.DW1.MflPipelineCommandFlush    = params->Flags.bFlushMFL;
+    cmd.DW1.MfxPipelineCommandFlush    = params->Flags.bFlushMFX;
+    return m_recorder->RecordNative(cmdBuffer, nullptr, MHW_RECORDED_VD_PIPELINE_FLUSH, &cmd, sizeof(cmd));
+}
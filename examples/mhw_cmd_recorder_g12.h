@@ -0,0 +1,452 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+//!
+//! \file     mhw_cmd_recorder_g12.h
+//! \brief    Defines host-only MHW G12 interfaces which record commands into an in-memory stream
+//! \details  The recorder interfaces keep the packet code paths unchanged, but instead of
+//!           packing hardware commands they serialize the command parameters into the
+//!           target command buffer or batch buffer. Together with a host MOS interface
+//!           this allows the command-build cost of the encode packets to be measured
+//!           without a GPU. MI_FLUSH_DW without post sync address and VD_PIPELINE_FLUSH
+//!           are added as hardware commands, so command buffer passes see real flushes.
+//!           G12-only commands (VD_CONTROL_STATE, VDENC_CONTROL_STATE, HCP_TILE_CODING)
+//!           are called through the G12 types by the packets and are still packed by the
+//!           G12 implementation; they carry no graphics address and pack on the host.
+//!           The resources of the recorded commands are registered and get patch
+//!           entries through the OS interface, as the packed commands would.
+//!
+
+#ifndef __MHW_CMD_RECORDER_G12_H__
+#define __MHW_CMD_RECORDER_G12_H__
+
+#include "mhw_vdbox_g12_X.h"
+#include "mhw_vdbox_hcp_g12_X.h"
+#include "mhw_vdbox_vdenc_g12_X.h"
+#include "mhw_mi_g12_X.h"
+#include "mhw_vdbox_hcp_buf_offset_g12.h"
+#include <atomic>
+
+//!
+//! \brief  Header dword of one recorded command
+//! \details [31:29] command type 3, [28:27] pipeline 2 (video), [26:16] recorded
+//!          command id, [11:0] total dword count minus 2. The layout follows the
+//!          video command header so the stream can be walked with the same 12 bit
+//!          length rule as a hardware command buffer.
+//!
+#define MHW_CMD_RECORDER_HEADER(id, dwSize) \
+    ((3u << 29) | (2u << 27) | (((uint32_t)(id) & 0x7ff) << 16) | (((uint32_t)(dwSize) - 2) & 0xfff))
+#define MHW_CMD_RECORDER_GET_ID(header)     (((header) >> 16) & 0x7ff)
+#define MHW_CMD_RECORDER_IS_HEADER(header)  (((header) >> 27) == 0xe && MHW_CMD_RECORDER_GET_ID(header) < MHW_RECORDED_CMD_NUM)
+
+//!
+//! \enum   MHW_RECORDED_CMD
+//! \brief  Identifier of the recorded commands
+//!
+enum MHW_RECORDED_CMD
+{
+    MHW_RECORDED_MI_BATCH_BUFFER_START = 0,
+    MHW_RECORDED_MI_BATCH_BUFFER_END,
+    MHW_RECORDED_MI_FLUSH_DW,
+    MHW_RECORDED_MI_SEMAPHORE_WAIT,
+    MHW_RECORDED_MI_ATOMIC,
+    MHW_RECORDED_MI_STORE_DATA_IMM,
+    MHW_RECORDED_MI_STORE_REGISTER_MEM,
+    MHW_RECORDED_MI_LOAD_REGISTER_IMM,
+    MHW_RECORDED_MI_CONDITIONAL_BATCH_BUFFER_END,
+    MHW_RECORDED_HCP_PIPE_MODE_SELECT,
+    MHW_RECORDED_HCP_SURFACE_STATE,
+    MHW_RECORDED_HCP_PIPE_BUF_ADDR_STATE,
+    MHW_RECORDED_HCP_IND_OBJ_BASE_ADDR_STATE,
+    MHW_RECORDED_HCP_QM_STATE,
+    MHW_RECORDED_HCP_FQM_STATE,
+    MHW_RECORDED_HCP_PIC_STATE,
+    MHW_RECORDED_HCP_REF_IDX_STATE,
+    MHW_RECORDED_HCP_WEIGHTOFFSET_STATE,
+    MHW_RECORDED_HCP_SLICE_STATE,
+    MHW_RECORDED_HCP_PAK_INSERT_OBJECT,
+    MHW_RECORDED_HCP_PAK_INSERT_DATA,
+    MHW_RECORDED_HCP_RDOQ_STATE,
+    MHW_RECORDED_VDENC_PIPE_MODE_SELECT,
+    MHW_RECORDED_VDENC_SRC_SURFACE_STATE,
+    MHW_RECORDED_VDENC_REF_SURFACE_STATE,
+    MHW_RECORDED_VDENC_DS_REF_SURFACE_STATE,
+    MHW_RECORDED_VDENC_PIPE_BUF_ADDR_STATE,
+    MHW_RECORDED_VDENC_WALKER_STATE,
+    MHW_RECORDED_VDENC_CMD1,
+    MHW_RECORDED_VDENC_CMD2,
+    MHW_RECORDED_VDENC_WEIGHTSOFFSETS_STATE,
+    MHW_RECORDED_VD_PIPELINE_FLUSH,
+    MHW_RECORDED_CMD_NUM
+};
+
+//!
+//! \class  MhwCmdRecorderG12
+//! \brief  In-memory command stream shared by the G12 recorder interfaces
+//!
+class MhwCmdRecorderG12
+{
+public:
+    MhwCmdRecorderG12() { Reset(); }
+
+    virtual ~MhwCmdRecorderG12() {}
+
+    //!
+    //! \brief  Serialize one command into the command buffer or the batch buffer
+    //! \param  [in] cmdBuffer
+    //!         Command buffer to record into, can be nullptr if batchBuffer is valid
+    //! \param  [in] batchBuffer
+    //!         Batch buffer to record into, can be nullptr if cmdBuffer is valid
+    //! \param  [in] id
+    //!         Recorded command id
+    //! \param  [in] params
+    //!         Command parameters which are copied as payload, can be nullptr
+    //! \param  [in] paramsSize
+    //!         Size of the parameters in bytes
+    //! \return MOS_STATUS
+    //!         MOS_STATUS_SUCCESS if success, else fail reason
+    //!
+    MOS_STATUS Record(
+        PMOS_COMMAND_BUFFER cmdBuffer,
+        PMHW_BATCH_BUFFER   batchBuffer,
+        MHW_RECORDED_CMD    id,
+        const void         *params,
+        uint32_t            paramsSize);
+
+    //!
+    //! \brief  Add one hardware command as is and count it
+    //! \details Used for the flush commands, so passes over the command buffer can
+    //!          recognize them the same way as in a hardware command buffer.
+    //! \param  [in] cmdBuffer
+    //!         Command buffer to record into, can be nullptr if batchBuffer is valid
+    //! \param  [in] batchBuffer
+    //!         Batch buffer to record into, can be nullptr if cmdBuffer is valid
+    //! \param  [in] id
+    //!         Recorded command id used for the statistics
+    //! \param  [in] cmd
+    //!         Hardware command
+    //! \param  [in] cmdSize
+    //!         Size of the command in bytes
+    //! \return MOS_STATUS
+    //!         MOS_STATUS_SUCCESS if success, else fail reason
+    //!
+    MOS_STATUS RecordNative(
+        PMOS_COMMAND_BUFFER cmdBuffer,
+        PMHW_BATCH_BUFFER   batchBuffer,
+        MHW_RECORDED_CMD    id,
+        const void         *cmd,
+        uint32_t            cmdSize);
+
+    //!
+    //! \brief  Register one resource of a recorded command and add its patch entry
+    //! \details Makes the same OS interface calls as Mhw_AddResourceToCmd, so the
+    //!          resource list and the patch list see every address of the recorded
+    //!          commands. Call it before recording the command, the patch offset is
+    //!          the current offset of the command buffer.
+    //! \param  [in] osInterface
+    //!         OS interface which keeps the resource and patch lists
+    //! \param  [in] cmdBuffer
+    //!         Command buffer the command is recorded to
+    //! \param  [in] resource
+    //!         Resource referenced by the command, nothing is added if nullptr
+    //! \param  [in] offset
+    //!         Offset of the referenced data in the resource
+    //! \param  [in] write
+    //!         true if the command writes the resource
+    //! \return MOS_STATUS
+    //!         MOS_STATUS_SUCCESS if success, else fail reason
+    //!
+    MOS_STATUS AddResource(
+        PMOS_INTERFACE      osInterface,
+        PMOS_COMMAND_BUFFER cmdBuffer,
+        PMOS_RESOURCE       resource,
+        uint32_t            offset,
+        bool                write);
+
+    //!
+    //! \brief  Get the size of the hardware command a recorded command stands for
+    //! \details Hardware commands added as is, such as the flushes, keep their size.
+    //!          Used to compare the recorded stream with the size estimates, which
+    //!          are in hardware command bytes.
+    //! \param  [in] cmd
+    //!         First dword of the command
+    //! \param  [in] dwLeft
+    //!         Dwords left in the buffer from cmd on
+    //! \param  [out] dwSize
+    //!         Size of the command in the buffer in dwords
+    //! \param  [out] hwSize
+    //!         Size of the hardware command in bytes
+    //! \return bool
+    //!         false if the command cannot be decoded
+    //!
+    static bool GetHardwareCmdSize(const uint32_t *cmd, uint32_t dwLeft, uint32_t &dwSize, uint32_t &hwSize);
+
+    //!
+    //! \brief  Get the batch buffer started by a recorded MI_BATCH_BUFFER_START
+    //! \param  [in] cmd
+    //!         First dword of the command
+    //! \param  [out] offset
+    //!         Start offset inside the batch buffer
+    //! \return const void *
+    //!         Batch buffer given to AddMiBatchBufferStartCmd(), nullptr for other commands
+    //!
+    static const void *GetBatchStartTarget(const uint32_t *cmd, uint32_t &offset);
+
+    //!
+    //! \brief  Clear the recorded statistics
+    //! \return void
+    //!
+    void Reset();
+
+    //!
+    //! \brief  Get the number of recorded commands of one type
+    //! \param  [in] id
+    //!         Recorded command id
+    //! \return uint32_t
+    //!         Number of commands recorded since the last reset
+    //!
+    uint32_t GetCmdCount(MHW_RECORDED_CMD id) const { return id < MHW_RECORDED_CMD_NUM ? m_cmdCount[id] : 0; }
+
+    //!
+    //! \brief  Get the total number of recorded commands
+    //! \return uint32_t
+    //!
+    uint32_t GetTotalCmdCount() const { return m_totalCmdCount; }
+
+    //!
+    //! \brief  Get the total number of recorded bytes
+    //! \return uint64_t
+    //!
+    uint64_t GetTotalBytes() const { return m_totalBytes; }
+
+    //!
+    //! \brief  Get the number of patch entries added for the recorded commands
+    //! \return uint32_t
+    //!
+    uint32_t GetPatchEntryCount() const { return m_patchEntryCount; }
+
+protected:
+    // Tile level batches may be recorded from several threads
+    std::atomic<uint32_t> m_cmdCount[MHW_RECORDED_CMD_NUM];   //!< Number of recorded commands per type
+    std::atomic<uint32_t> m_totalCmdCount{0};                 //!< Number of recorded commands
+    std::atomic<uint64_t> m_totalBytes{0};                    //!< Number of recorded bytes
+    std::atomic<uint32_t> m_patchEntryCount{0};               //!< Number of added patch entries
+};
+
+//!
+//! \class  MhwMiInterfaceG12Recorder
+//! \brief  MI interface which records the MI commands used by the VDBOX encode packets
+//!
+class MhwMiInterfaceG12Recorder : public MhwMiInterfaceG12
+{
+public:
+    MhwMiInterfaceG12Recorder(
+        MhwCmdRecorderG12 *recorder,
+        MhwCpInterface    *cpInterface,
+        PMOS_INTERFACE     osInterface) :
+        MhwMiInterfaceG12(cpInterface, osInterface), m_recorder(recorder) {}
+
+    virtual ~MhwMiInterfaceG12Recorder() {}
+
+    MOS_STATUS AddMiBatchBufferStartCmd(
+        PMOS_COMMAND_BUFFER cmdBuffer,
+        PMHW_BATCH_BUFFER   batchBuffer) override;
+
+    MOS_STATUS AddMiBatchBufferEnd(
+        PMOS_COMMAND_BUFFER cmdBuffer,
+        PMHW_BATCH_BUFFER   batchBuffer) override;
+
+    MOS_STATUS AddMiFlushDwCmd(
+        PMOS_COMMAND_BUFFER     cmdBuffer,
+        PMHW_MI_FLUSH_DW_PARAMS params) override;
+
+    MOS_STATUS AddMiSemaphoreWaitCmd(
+        PMOS_COMMAND_BUFFER           cmdBuffer,
+        PMHW_MI_SEMAPHORE_WAIT_PARAMS params) override;
+
+    MOS_STATUS AddMiAtomicCmd(
+        PMOS_COMMAND_BUFFER   cmdBuffer,
+        PMHW_MI_ATOMIC_PARAMS params) override;
+
+    MOS_STATUS AddMiStoreDataImmCmd(
+        PMOS_COMMAND_BUFFER       cmdBuffer,
+        PMHW_MI_STORE_DATA_PARAMS params) override;
+
+    MOS_STATUS AddMiStoreRegisterMemCmd(
+        PMOS_COMMAND_BUFFER               cmdBuffer,
+        PMHW_MI_STORE_REGISTER_MEM_PARAMS params) override;
+
+    MOS_STATUS AddMiLoadRegisterImmCmd(
+        PMOS_COMMAND_BUFFER              cmdBuffer,
+        PMHW_MI_LOAD_REGISTER_IMM_PARAMS params) override;
+
+    MOS_STATUS AddMiConditionalBatchBufferEndCmd(
+        PMOS_COMMAND_BUFFER                         cmdBuffer,
+        PMHW_MI_CONDITIONAL_BATCH_BUFFER_END_PARAMS params) override;
+
+    MOS_STATUS SetWatchdogTimerThreshold(
+        uint32_t frameWidth,
+        uint32_t frameHeight,
+        bool     isEncoder = true) override;
+
+protected:
+    MhwCmdRecorderG12 *m_recorder = nullptr;     //!< Shared command stream recorder
+};
+
+//!
+//! \class  MhwVdboxHcpInterfaceG12Recorder
+//! \brief  HCP interface which records the HEVC encode commands
+//! \details Adds the offsets of MHW_VDBOX_PIPE_BUF_ADDR_PARAMS_OFFSET_G12 to the patch
+//!          entries of the pipe buffers.
+//!
+class MhwVdboxHcpInterfaceG12Recorder : public MhwVdboxHcpInterfaceG12, public MhwVdboxHcpBufOffsetInterfaceG12
+{
+public:
+    MhwVdboxHcpInterfaceG12Recorder(
+        MhwCmdRecorderG12 *recorder,
+        PMOS_INTERFACE     osInterface,
+        MhwMiInterface    *miInterface,
+        MhwCpInterface    *cpInterface) :
+        MhwVdboxHcpInterfaceG12(osInterface, miInterface, cpInterface, false), m_recorder(recorder) {}
+
+    virtual ~MhwVdboxHcpInterfaceG12Recorder() {}
+
+    MOS_STATUS AddHcpPipeModeSelectCmd(
+        PMOS_COMMAND_BUFFER                cmdBuffer,
+        PMHW_VDBOX_PIPE_MODE_SELECT_PARAMS params) override;
+
+    MOS_STATUS AddHcpSurfaceCmd(
+        PMOS_COMMAND_BUFFER       cmdBuffer,
+        PMHW_VDBOX_SURFACE_PARAMS params) override;
+
+    MOS_STATUS AddHcpPipeBufAddrCmd(
+        PMOS_COMMAND_BUFFER             cmdBuffer,
+        PMHW_VDBOX_PIPE_BUF_ADDR_PARAMS params) override;
+
+    MOS_STATUS AddHcpPipeBufAddrCmdWithOffsets(
+        PMOS_COMMAND_BUFFER                        cmdBuffer,
+        PMHW_VDBOX_PIPE_BUF_ADDR_PARAMS_OFFSET_G12 params) override;
+
+    MOS_STATUS AddHcpIndObjBaseAddrCmd(
+        PMOS_COMMAND_BUFFER                 cmdBuffer,
+        PMHW_VDBOX_IND_OBJ_BASE_ADDR_PARAMS params) override;
+
+    MOS_STATUS AddHcpQmStateCmd(
+        PMOS_COMMAND_BUFFER  cmdBuffer,
+        PMHW_VDBOX_QM_PARAMS params) override;
+
+    MOS_STATUS AddHcpFqmStateCmd(
+        PMOS_COMMAND_BUFFER  cmdBuffer,
+        PMHW_VDBOX_QM_PARAMS params) override;
+
+    MOS_STATUS AddHcpPicStateCmd(
+        PMOS_COMMAND_BUFFER         cmdBuffer,
+        PMHW_VDBOX_HEVC_PIC_STATE   params) override;
+
+    MOS_STATUS AddHcpRefIdxStateCmd(
+        PMOS_COMMAND_BUFFER             cmdBuffer,
+        PMHW_BATCH_BUFFER               batchBuffer,
+        PMHW_VDBOX_HEVC_REF_IDX_PARAMS  params) override;
+
+    MOS_STATUS AddHcpWeightOffsetStateCmd(
+        PMOS_COMMAND_BUFFER                 cmdBuffer,
+        PMHW_BATCH_BUFFER                   batchBuffer,
+        PMHW_VDBOX_HEVC_WEIGHTOFFSET_PARAMS params) override;
+
+    MOS_STATUS AddHcpSliceStateCmd(
+        PMOS_COMMAND_BUFFER         cmdBuffer,
+        PMHW_VDBOX_HEVC_SLICE_STATE params) override;
+
+    MOS_STATUS AddHcpPakInsertObject(
+        PMOS_COMMAND_BUFFER         cmdBuffer,
+        PMHW_VDBOX_PAK_INSERT_PARAMS params) override;
+
+    MOS_STATUS AddHcpHevcVp9RdoqStateCmd(
+        PMOS_COMMAND_BUFFER       cmdBuffer,
+        PMHW_VDBOX_HEVC_PIC_STATE params) override;
+
+protected:
+    MhwCmdRecorderG12 *m_recorder = nullptr;     //!< Shared command stream recorder
+};
+
+//!
+//! \class  MhwVdboxVdencInterfaceG12XRecorder
+//! \brief  VDENC interface which records the HEVC VDENC commands
+//!
+class MhwVdboxVdencInterfaceG12XRecorder : public MhwVdboxVdencInterfaceG12X
+{
+public:
+    MhwVdboxVdencInterfaceG12XRecorder(
+        MhwCmdRecorderG12 *recorder,
+        PMOS_INTERFACE     osInterface) :
+        MhwVdboxVdencInterfaceG12X(osInterface), m_recorder(recorder) {}
+
+    virtual ~MhwVdboxVdencInterfaceG12XRecorder() {}
+
+    MOS_STATUS AddVdencPipeModeSelectCmd(
+        PMOS_COMMAND_BUFFER                cmdBuffer,
+        PMHW_VDBOX_PIPE_MODE_SELECT_PARAMS params) override;
+
+    MOS_STATUS AddVdencSrcSurfaceStateCmd(
+        PMOS_COMMAND_BUFFER       cmdBuffer,
+        PMHW_VDBOX_SURFACE_PARAMS params) override;
+
+    MOS_STATUS AddVdencRefSurfaceStateCmd(
+        PMOS_COMMAND_BUFFER       cmdBuffer,
+        PMHW_VDBOX_SURFACE_PARAMS params) override;
+
+    MOS_STATUS AddVdencDsRefSurfaceStateCmd(
+        PMOS_COMMAND_BUFFER       cmdBuffer,
+        PMHW_VDBOX_SURFACE_PARAMS params,
+        uint8_t                   numSurfaces) override;
+
+    MOS_STATUS AddVdencPipeBufAddrCmd(
+        PMOS_COMMAND_BUFFER             cmdBuffer,
+        PMHW_VDBOX_PIPE_BUF_ADDR_PARAMS params) override;
+
+    MOS_STATUS AddVdencWalkerStateCmd(
+        PMOS_COMMAND_BUFFER                 cmdBuffer,
+        PMHW_VDBOX_VDENC_WALKER_STATE_PARAMS params) override;
+
+    MOS_STATUS AddVdencCmd1Cmd(
+        PMOS_COMMAND_BUFFER          cmdBuffer,
+        PMHW_BATCH_BUFFER            batchBuffer,
+        PMHW_VDBOX_VDENC_CMD1_PARAMS params) override;
+
+    MOS_STATUS AddVdencCmd2Cmd(
+        PMOS_COMMAND_BUFFER         cmdBuffer,
+        PMHW_BATCH_BUFFER           batchBuffer,
+        PMHW_VDBOX_VDENC_CMD2_STATE params) override;
+
+    MOS_STATUS AddVdencWeightsOffsetsStateCmd(
+        PMOS_COMMAND_BUFFER                   cmdBuffer,
+        PMHW_BATCH_BUFFER                     batchBuffer,
+        PMHW_VDBOX_VDENC_WEIGHT_OFFSET_PARAMS params) override;
+
+    MOS_STATUS AddVdPipelineFlushCmd(
+        PMOS_COMMAND_BUFFER              cmdBuffer,
+        PMHW_VDBOX_VD_PIPE_FLUSH_PARAMS  params) override;
+
+protected:
+    MhwCmdRecorderG12 *m_recorder = nullptr;     //!< Shared command stream recorder
+};
+
+#endif // __MHW_CMD_RECORDER_G12_H__
@@ -0,0 +1,75 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+//!
+//! \file     mhw_vdbox_hcp_buf_offset_g12.h
+//! \brief    Defines the G12 HCP pipe buffer address params with buffer offsets
+//! \details  The stock G12 HCP interface programs every pipe buffer at the start of
+//!           its resource. Packets which pack several buffers into one resource pass
+//!           the offsets in MHW_VDBOX_PIPE_BUF_ADDR_PARAMS_OFFSET_G12 to an HCP
+//!           interface which also implements MhwVdboxHcpBufOffsetInterfaceG12.
+//!
+
+#ifndef __MHW_VDBOX_HCP_BUF_OFFSET_G12_H__
+#define __MHW_VDBOX_HCP_BUF_OFFSET_G12_H__
+
+#include "mhw_vdbox_g12_X.h"
+
+//!
+//! \struct MHW_VDBOX_PIPE_BUF_ADDR_PARAMS_OFFSET_G12
+//! \brief  HCP pipe buffer address params with the offsets of packed buffers
+//!
+struct MHW_VDBOX_PIPE_BUF_ADDR_PARAMS_OFFSET_G12 : public MHW_VDBOX_PIPE_BUF_ADDR_PARAMS_G12
+{
+    uint32_t dwMetadataLineBufferOffset        = 0;  //!< Offset in presMetadataLineBuffer
+    uint32_t dwMetadataTileLineBufferOffset    = 0;  //!< Offset in presMetadataTileLineBuffer
+    uint32_t dwMetadataTileColumnBufferOffset  = 0;  //!< Offset in presMetadataTileColumnBuffer
+    uint32_t dwLcuILDBStreamOutBufferOffset    = 0;  //!< Offset in presLcuILDBStreamOutBuffer
+    uint32_t dwSseSrcPixelRowStoreBufferOffset = 0;  //!< Offset in presSseSrcPixelRowStoreBuffer
+};
+using PMHW_VDBOX_PIPE_BUF_ADDR_PARAMS_OFFSET_G12 = MHW_VDBOX_PIPE_BUF_ADDR_PARAMS_OFFSET_G12 *;
+
+//!
+//! \class  MhwVdboxHcpBufOffsetInterfaceG12
+//! \brief  HCP interface extension which programs the pipe buffers at an offset
+//! \details Implemented next to MhwVdboxHcpInterfaceG12 by the HCP interfaces which
+//!          add the offsets to the buffer addresses and to their patch entries.
+//!
+class MhwVdboxHcpBufOffsetInterfaceG12
+{
+public:
+    virtual ~MhwVdboxHcpBufOffsetInterfaceG12() {}
+
+    //!
+    //! \brief  Add HCP_PIPE_BUF_ADDR_STATE with the buffer offsets
+    //! \param  [in] cmdBuffer
+    //!         Command buffer to add the command to
+    //! \param  [in] params
+    //!         Pipe buffer address params and the offsets of the packed buffers
+    //! \return MOS_STATUS
+    //!         MOS_STATUS_SUCCESS if success, else fail reason
+    //!
+    virtual MOS_STATUS AddHcpPipeBufAddrCmdWithOffsets(
+        PMOS_COMMAND_BUFFER                        cmdBuffer,
+        PMHW_VDBOX_PIPE_BUF_ADDR_PARAMS_OFFSET_G12 params) = 0;
+};
+
+#endif // __MHW_VDBOX_HCP_BUF_OFFSET_G12_H__